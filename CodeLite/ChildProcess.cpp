@@ -45,7 +45,7 @@ void ChildProcess::Start(const wxArrayString& args)
     // Launch the process
     m_process = ::CreateAsyncProcess(this, command, IProcessCreateDefault | IProcessStderrEvent);
 #else
-    m_childProcess = new UnixProcess(this, args);
+    m_childProcess = new UnixProcess(this, args, m_stdoutCallback);
 #endif
 }
 
@@ -13,9 +13,16 @@
 #include "cl_command_event.h"
 #include <asyncprocess.h>
 #include "codelite_exports.h"
+#include <functional>
+#include <string>
 
 class WXDLLIMPEXP_CL ChildProcess : public wxEvtHandler
 {
+public:
+    typedef std::function<void(const std::string&)> OutputCallback_t;
+
+protected:
+    OutputCallback_t m_stdoutCallback;
 #if USE_IPROCESS
     IProcess* m_process = nullptr;
 #else
@@ -25,6 +32,13 @@ public:
     ChildProcess();
     virtual ~ChildProcess();
 
+    /**
+     * @brief pass the raw stdout bytes to 'callback' instead of sending wxEVT_ASYNC_PROCESS_OUTPUT events.
+     * The callback is called from a worker thread. Must be called before Start(). On Windows the output is
+     * always sent as events
+     */
+    void SetStdoutCallback(const OutputCallback_t& callback) { this->m_stdoutCallback = callback; }
+
     void Start(const wxArrayString& args);
     void Write(const wxString& message);
     void Write(const std::string& message);
@@ -1,11 +1,17 @@
 #include "CxxPreProcessor.h"
 #include <wx/regex.h>
+#include "CxxPreProcessorHeaderCache.h"
 #include "file_logger.h"
+#include "fileutils.h"
+#include <functional>
 
 CxxPreProcessor::CxxPreProcessor()
     : m_options(0)
     , m_maxDepth(-1)
     , m_currentDepth(0)
+    , m_contextHash(0)
+    , m_tokensHash(0)
+    , m_mappingHash(0)
 {
 }
 
@@ -20,6 +26,16 @@ void CxxPreProcessor::Parse(const wxFileName& filename, size_t options)
         scanner = new CxxPreProcessorScanner(filename, m_options);
         // Remove the option so recursive scanner won't get it
         m_options &= ~kLexerOpt_DontCollectMacrosDefinedInThisFile;
+
+        // The included files are parsed with these options and include paths
+        wxString context;
+        context << (int)m_options << "\n" << ::wxJoin(m_includePaths, '\n');
+        m_contextHash = std::hash<wxString>()(context);
+        UpdateHashes();
+        m_definedMacros.clear();
+        m_resolvedIncludes.clear();
+        m_parsedFiles.clear();
+
         if(scanner && !scanner->IsNull()) {
             scanner->Parse(this);
         }
@@ -36,11 +52,101 @@ void CxxPreProcessor::Parse(const wxFileName& filename, size_t options)
         }
     }
     m_tokens.swap(filteredMap);
+    UpdateHashes();
 
     // Make sure that the scanner is deleted
     wxDELETE(scanner);
 }
 
+void CxxPreProcessor::ParseInclude(const wxFileName& filename)
+{
+    wxString path = filename.GetFullPath();
+    size_t stateHash = m_contextHash;
+    stateHash = (stateHash * 1000003) ^ m_tokensHash;
+    stateHash = (stateHash * 1000003) ^ m_mappingHash;
+    wxString key = CxxPreProcessorHeaderCache::MakeKey(path, stateHash);
+
+    CxxPreProcessorHeaderCache::Entry::Ptr_t entry = CxxPreProcessorHeaderCache::Get().Find(key);
+    if(entry) {
+        // We already parsed this header in the same state: replay what it did
+        for(size_t i = 0; i < entry->tokens.size(); ++i) {
+            DefineMacro(entry->tokens[i]);
+        }
+        for(size_t i = 0; i < entry->includes.size(); ++i) {
+            AddMapping(entry->includes[i].first, entry->includes[i].second);
+        }
+        m_parsedFiles.insert(m_parsedFiles.end(), entry->files.begin(), entry->files.end());
+        return;
+    }
+
+    size_t firstMacro = m_definedMacros.size();
+    size_t firstInclude = m_resolvedIncludes.size();
+    size_t firstFile = m_parsedFiles.size();
+    m_parsedFiles.push_back(std::make_pair(path, FileUtils::GetFileModificationTime(filename)));
+
+    CxxPreProcessorScanner* scanner = new CxxPreProcessorScanner(filename, GetOptions());
+    try {
+        if(scanner && !scanner->IsNull()) {
+            scanner->Parse(this);
+        }
+    } catch(CxxLexerException& e) {
+        // catch the exception
+        CL_DEBUG("Exception caught: %s\n", e.message);
+    }
+    // make sure we always delete the scanner
+    wxDELETE(scanner);
+
+    std::shared_ptr<CxxPreProcessorHeaderCache::Entry> newEntry(new CxxPreProcessorHeaderCache::Entry());
+    newEntry->tokens.reserve(m_definedMacros.size() - firstMacro);
+    for(size_t i = firstMacro; i < m_definedMacros.size(); ++i) {
+        CxxPreProcessorToken::Map_t::const_iterator iter = m_tokens.find(m_definedMacros[i]);
+        if(iter != m_tokens.end()) { newEntry->tokens.push_back(iter->second); }
+    }
+    newEntry->includes.assign(m_resolvedIncludes.begin() + firstInclude, m_resolvedIncludes.end());
+    newEntry->files.assign(m_parsedFiles.begin() + firstFile, m_parsedFiles.end());
+    CxxPreProcessorHeaderCache::Get().Store(key, newEntry);
+}
+
+size_t CxxPreProcessor::GetTokenHash(const CxxPreProcessorToken& token)
+{
+    std::hash<wxString> hasher;
+    return (hasher(token.name) * 31) ^ hasher(token.value);
+}
+
+void CxxPreProcessor::UpdateHashes()
+{
+    // The hashes are order independent so they can be updated as macros and include statements are added
+    m_tokensHash = 0;
+    CxxPreProcessorToken::Map_t::const_iterator iter = m_tokens.begin();
+    for(; iter != m_tokens.end(); ++iter) {
+        m_tokensHash ^= GetTokenHash(iter->second);
+    }
+
+    m_mappingHash = 0;
+    std::hash<wxString> hasher;
+    std::map<wxString, wxString>::const_iterator mappingIter = m_fileMapping.begin();
+    for(; mappingIter != m_fileMapping.end(); ++mappingIter) {
+        m_mappingHash ^= hasher(mappingIter->first);
+    }
+}
+
+void CxxPreProcessor::DefineMacro(const CxxPreProcessorToken& token)
+{
+    if(m_tokens.insert(std::make_pair(token.name, token)).second) {
+        m_tokensHash ^= GetTokenHash(token);
+        m_definedMacros.push_back(token.name);
+    }
+}
+
+void CxxPreProcessor::AddMapping(const wxString& includeStatement, const wxString& filename)
+{
+    if(filename.IsEmpty()) { m_noSuchFiles.insert(includeStatement); }
+    if(m_fileMapping.insert(std::make_pair(includeStatement, filename)).second) {
+        m_mappingHash ^= std::hash<wxString>()(includeStatement);
+        m_resolvedIncludes.push_back(std::make_pair(includeStatement, filename));
+    }
+}
+
 bool
 CxxPreProcessor::ExpandInclude(const wxFileName& currentFile, const wxString& includeStatement, wxFileName& outFile)
 {
@@ -79,7 +185,7 @@ CxxPreProcessor::ExpandInclude(const wxFileName& currentFile, const wxString& in
             if(fixedFileName.FileExists()) {
                 fixedFileName.Normalize(wxPATH_NORM_DOTS);
                 tmpfile = fixedFileName.GetFullPath();
-                m_fileMapping.insert(std::make_pair(includeStatement, tmpfile));
+                AddMapping(includeStatement, tmpfile);
                 outFile = fixedFileName;
                 return true;
             } else {
@@ -89,8 +195,7 @@ CxxPreProcessor::ExpandInclude(const wxFileName& currentFile, const wxString& in
     }
 
     // remember that we could not locate this include statement
-    m_noSuchFiles.insert(includeStatement);
-    m_fileMapping.insert(std::make_pair(includeStatement, wxString()));
+    AddMapping(includeStatement, wxString());
     return false;
 }
 
@@ -104,7 +209,7 @@ void CxxPreProcessor::AddDefinition(const wxString& def)
     CxxPreProcessorToken token;
     token.name = macroName;
     token.value = macroValue;
-    m_tokens.insert(std::make_pair(macroName, token));
+    DefineMacro(token);
 }
 
 wxArrayString CxxPreProcessor::GetDefinitions() const
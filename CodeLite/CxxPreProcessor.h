@@ -30,6 +30,7 @@
 #include <wx/filename.h>
 #include "CxxPreProcessorScanner.h"
 #include <set>
+#include <vector>
 #include "codelite_exports.h"
 
 class WXDLLIMPEXP_CL CxxPreProcessor
@@ -42,6 +43,21 @@ class WXDLLIMPEXP_CL CxxPreProcessor
     int m_maxDepth;
     int m_currentDepth;
 
+    // The state used to find the headers in CxxPreProcessorHeaderCache
+    size_t m_contextHash; // include paths and options
+    size_t m_tokensHash;  // m_tokens
+    size_t m_mappingHash; // the include statements in m_fileMapping
+
+    // What the current Parse() did, in order. A header's entry in the cache is the part added while parsing it
+    std::vector<wxString> m_definedMacros;
+    std::vector<std::pair<wxString, wxString> > m_resolvedIncludes;
+    std::vector<std::pair<wxString, time_t> > m_parsedFiles;
+
+protected:
+    static size_t GetTokenHash(const CxxPreProcessorToken& token);
+    void UpdateHashes();
+    void AddMapping(const wxString& includeStatement, const wxString& filename);
+
 public:
     CxxPreProcessor();
     virtual ~CxxPreProcessor();
@@ -49,7 +65,11 @@ public:
     void SetMaxDepth(int maxDepth) { this->m_maxDepth = maxDepth; }
     int GetMaxDepth() const { return m_maxDepth; }
     void SetCurrentDepth(int currentDepth) { this->m_currentDepth = currentDepth; }
-    void SetFileMapping(const std::map<wxString, wxString>& fileMapping) { this->m_fileMapping = fileMapping; }
+    void SetFileMapping(const std::map<wxString, wxString>& fileMapping)
+    {
+        this->m_fileMapping = fileMapping;
+        UpdateHashes();
+    }
     int GetCurrentDepth() const { return m_currentDepth; }
     const std::map<wxString, wxString>& GetFileMapping() const { return m_fileMapping; }
     void SetIncludePaths(const wxArrayString& includePaths);
@@ -61,10 +81,17 @@ public:
      * @brief return a command that generates a single file with all defines in it
      */
     wxString GetGxxCommand(const wxString& gxx, const wxString& filename) const;
-    CxxPreProcessorToken::Map_t& GetTokens() { return m_tokens; }
-
     const CxxPreProcessorToken::Map_t& GetTokens() const { return m_tokens; }
-    void SetTokens(const CxxPreProcessorToken::Map_t& tokens) { m_tokens = tokens; }
+    void SetTokens(const CxxPreProcessorToken::Map_t& tokens)
+    {
+        m_tokens = tokens;
+        UpdateHashes();
+    }
+
+    /**
+     * @brief define a macro (unless it is already defined)
+     */
+    void DefineMacro(const CxxPreProcessorToken& token);
 
     /**
      * @brief add search path to the PreProcessor
@@ -83,6 +110,12 @@ public:
      * @param outFile [output]
      */
     bool ExpandInclude(const wxFileName& currentFile, const wxString& includeStatement, wxFileName& outFile);
+    /**
+     * @brief parse an included file, reusing the result of a previous parse of the same header (with the same
+     * macros and include statements already seen) from CxxPreProcessorHeaderCache when there is one
+     */
+    void ParseInclude(const wxFileName& filename);
+
     /**
      * @brief the main entry function
      * @param filename
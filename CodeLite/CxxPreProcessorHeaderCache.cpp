@@ -0,0 +1,74 @@
+#include "CxxPreProcessorHeaderCache.h"
+#include "fileutils.h"
+
+// Upper limit for the total number of tokens, include statements and files held by the entries.
+// The cache is cleared when it is reached
+#define MAX_HEADER_CACHE_SIZE 500000
+
+CxxPreProcessorHeaderCache::CxxPreProcessorHeaderCache() {}
+
+CxxPreProcessorHeaderCache::~CxxPreProcessorHeaderCache() {}
+
+CxxPreProcessorHeaderCache& CxxPreProcessorHeaderCache::Get()
+{
+    static CxxPreProcessorHeaderCache instance;
+    return instance;
+}
+
+wxString CxxPreProcessorHeaderCache::MakeKey(const wxString& filename, size_t stateHash)
+{
+    wxString key;
+    key << filename << "|" << wxString::Format("%" wxLongLongFmtSpec "x", (wxULongLong_t)stateHash);
+    return key;
+}
+
+CxxPreProcessorHeaderCache::Entry::Ptr_t CxxPreProcessorHeaderCache::Find(const wxString& key)
+{
+    Entry::Ptr_t entry;
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        std::unordered_map<wxString, Entry::Ptr_t>::iterator iter = m_entries.find(key);
+        if(iter == m_entries.end()) { return Entry::Ptr_t(); }
+        entry = iter->second;
+    }
+
+    // Make sure that none of the files was modified since the entry was created
+    for(size_t i = 0; i < entry->files.size(); ++i) {
+        if(FileUtils::GetFileModificationTime(entry->files[i].first) != entry->files[i].second) {
+            std::lock_guard<std::mutex> guard(m_lock);
+            std::unordered_map<wxString, Entry::Ptr_t>::iterator iter = m_entries.find(key);
+            if(iter != m_entries.end() && iter->second == entry) {
+                m_size -= entry->GetSize();
+                m_entries.erase(iter);
+            }
+            return Entry::Ptr_t();
+        }
+    }
+    return entry;
+}
+
+void CxxPreProcessorHeaderCache::Store(const wxString& key, Entry::Ptr_t entry)
+{
+    size_t size = entry->GetSize();
+    if(size > MAX_HEADER_CACHE_SIZE) { return; }
+
+    std::lock_guard<std::mutex> guard(m_lock);
+    std::unordered_map<wxString, Entry::Ptr_t>::iterator iter = m_entries.find(key);
+    if(iter != m_entries.end()) {
+        m_size -= iter->second->GetSize();
+        m_entries.erase(iter);
+    }
+    if(m_size + size > MAX_HEADER_CACHE_SIZE) {
+        m_entries.clear();
+        m_size = 0;
+    }
+    m_entries.insert({ key, entry });
+    m_size += size;
+}
+
+void CxxPreProcessorHeaderCache::Clear()
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_entries.clear();
+    m_size = 0;
+}
@@ -0,0 +1,75 @@
+#ifndef CXXPREPROCESSORHEADERCACHE_H
+#define CXXPREPROCESSORHEADERCACHE_H
+
+#include "CxxLexerAPI.h"
+#include "codelite_exports.h"
+#include "wxStringHash.h"
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <wx/string.h>
+
+/**
+ * @class CxxPreProcessorHeaderCache
+ * @brief remember what parsing a header (and everything it includes) did to the pre processor state.
+ *
+ * An entry is keyed by the header path and by the state the pre processor was in when it reached the header:
+ * the macros defined so far, the include statements already resolved, the include paths and the options.
+ * Given the same state, parsing the header again produces the same result, so CxxPreProcessor replays the
+ * entry instead of lexing the header. An entry is dropped once one of the files it was built from is modified.
+ * An entry holds everything its header includes, so the cache is bounded by the total size of its entries
+ * rather than by their number.
+ * The cache is shared by all the CxxPreProcessor instances and is thread safe
+ */
+class WXDLLIMPEXP_CL CxxPreProcessorHeaderCache
+{
+public:
+    struct Entry {
+        // The macros defined by the header, in order
+        std::vector<CxxPreProcessorToken> tokens;
+        // The include statements resolved by the header: statement -> full path (empty if not found)
+        std::vector<std::pair<wxString, wxString> > includes;
+        // The files parsed (the header and its includes) and their modification time
+        std::vector<std::pair<wxString, time_t> > files;
+        typedef std::shared_ptr<const Entry> Ptr_t;
+
+        size_t GetSize() const { return tokens.size() + includes.size() + files.size(); }
+    };
+
+protected:
+    std::unordered_map<wxString, Entry::Ptr_t> m_entries;
+    size_t m_size = 0; // the sum of the entries size
+    std::mutex m_lock;
+
+public:
+    CxxPreProcessorHeaderCache();
+    virtual ~CxxPreProcessorHeaderCache();
+
+    static CxxPreProcessorHeaderCache& Get();
+
+    /**
+     * @brief build the key of an entry
+     * @param filename the header full path
+     * @param stateHash a hash of the pre processor state, see CxxPreProcessor
+     */
+    static wxString MakeKey(const wxString& filename, size_t stateHash);
+
+    /**
+     * @brief return the entry for "key", null if there is none or if one of its files was modified
+     */
+    Entry::Ptr_t Find(const wxString& key);
+
+    /**
+     * @brief add (or replace) an entry
+     */
+    void Store(const wxString& key, Entry::Ptr_t entry);
+
+    /**
+     * @brief clear the cache content
+     */
+    void Clear();
+};
+
+#endif // CXXPREPROCESSORHEADERCACHE_H
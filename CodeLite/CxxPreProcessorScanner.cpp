@@ -68,7 +68,7 @@ void CxxPreProcessorScanner::Parse(CxxPreProcessor* pp)
 {
     CxxLexerToken token;
     bool searchingForBranch = false;
-    CxxPreProcessorToken::Map_t& ppTable = pp->GetTokens();
+    const CxxPreProcessorToken::Map_t& ppTable = pp->GetTokens();
     while(m_scanner && ::LexerNext(m_scanner, token)) {
         // Pre Processor state
         switch(token.GetType()) {
@@ -76,17 +76,7 @@ void CxxPreProcessorScanner::Parse(CxxPreProcessor* pp)
             // we found an include statement, recurse into it
             wxFileName include;
             if(pp->ExpandInclude(m_filename, token.GetWXString(), include)) {
-                CxxPreProcessorScanner* scanner = new CxxPreProcessorScanner(include, pp->GetOptions());
-                try {
-                    if(scanner && !scanner->IsNull()) {
-                        scanner->Parse(pp);
-                    }
-                } catch(CxxLexerException& e) {
-                    // catch the exception
-                    CL_DEBUG("Exception caught: %s\n", e.message);
-                }
-                // make sure we always delete the scanner
-                wxDELETE(scanner);
+                pp->ParseInclude(include);
                 clDEBUG1() << "<== Resuming parser on file:" << m_filename << clEndl;
             }
             break;
@@ -172,12 +162,12 @@ void CxxPreProcessorScanner::Parse(CxxPreProcessor* pp)
             // Optionally get the value
             GetRestOfPPLine(macroValue, m_options & kLexerOpt_CollectMacroValueNumbers);
 
-            CxxPreProcessorToken pp;
-            pp.name = macroName;
-            pp.value = macroValue;
+            CxxPreProcessorToken ppToken;
+            ppToken.name = macroName;
+            ppToken.value = macroValue;
             // mark this token for deletion when the entire TU parsing is done
-            pp.deleteOnExit = (m_options & kLexerOpt_DontCollectMacrosDefinedInThisFile);
-            ppTable.insert(std::make_pair(pp.name, pp));
+            ppToken.deleteOnExit = (m_options & kLexerOpt_DontCollectMacrosDefinedInThisFile);
+            pp->DefineMacro(ppToken);
             break;
         }
         }
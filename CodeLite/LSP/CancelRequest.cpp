@@ -0,0 +1,10 @@
+#include "CancelRequest.h"
+
+LSP::CancelRequest::CancelRequest(int requestId)
+{
+    SetMethod("$/cancelRequest");
+    m_params.reset(new CancelParams());
+    m_params->As<CancelParams>()->SetId(requestId);
+}
+
+LSP::CancelRequest::~CancelRequest() {}
@@ -0,0 +1,22 @@
+#ifndef CANCELREQUEST_H
+#define CANCELREQUEST_H
+
+#include "LSP/MessageWithParams.h"
+#include "LSP/Notification.h"
+
+namespace LSP
+{
+
+/**
+ * @class CancelRequest
+ * @brief the "$/cancelRequest" notification: tell the server that we are no longer interested in the response
+ * of a request
+ */
+class WXDLLIMPEXP_CL CancelRequest : public LSP::Notification
+{
+public:
+    CancelRequest(int requestId);
+    virtual ~CancelRequest();
+};
+};     // namespace LSP
+#endif // CANCELREQUEST_H
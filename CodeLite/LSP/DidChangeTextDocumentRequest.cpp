@@ -1,14 +1,13 @@
 #include "LSP/DidChangeTextDocumentRequest.h"
 
-static int counter = 0;
-
-LSP::DidChangeTextDocumentRequest::DidChangeTextDocumentRequest(const wxFileName& filename, const wxString& fileContent)
+LSP::DidChangeTextDocumentRequest::DidChangeTextDocumentRequest(const wxFileName& filename, int version,
+                                                                const wxString& fileContent)
 {
     SetMethod("textDocument/didChange");
     m_params.reset(new DidChangeTextDocumentParams());
 
     VersionedTextDocumentIdentifier id;
-    id.SetVersion(++counter);
+    id.SetVersion(version);
     id.SetFilename(filename);
     m_params->As<DidChangeTextDocumentParams>()->SetTextDocument(id);
 
@@ -17,4 +16,17 @@ LSP::DidChangeTextDocumentRequest::DidChangeTextDocumentRequest(const wxFileName
     m_params->As<DidChangeTextDocumentParams>()->SetContentChanges({ changeEvent });
 }
 
+LSP::DidChangeTextDocumentRequest::DidChangeTextDocumentRequest(
+    const wxFileName& filename, int version, const std::vector<TextDocumentContentChangeEvent>& changes)
+{
+    SetMethod("textDocument/didChange");
+    m_params.reset(new DidChangeTextDocumentParams());
+
+    VersionedTextDocumentIdentifier id;
+    id.SetVersion(version);
+    id.SetFilename(filename);
+    m_params->As<DidChangeTextDocumentParams>()->SetTextDocument(id);
+    m_params->As<DidChangeTextDocumentParams>()->SetContentChanges(changes);
+}
+
 LSP::DidChangeTextDocumentRequest::~DidChangeTextDocumentRequest() {}
@@ -3,6 +3,7 @@
 
 #include <wx/filename.h>
 #include "LSP/Notification.h"
+#include "LSP/basic_types.h"
 
 namespace LSP
 {
@@ -10,7 +11,16 @@ namespace LSP
 class WXDLLIMPEXP_CL DidChangeTextDocumentRequest : public LSP::Notification
 {
 public:
-    DidChangeTextDocumentRequest(const wxFileName& filename, const wxString& fileContent);
+    /**
+     * @brief send the whole document content
+     */
+    DidChangeTextDocumentRequest(const wxFileName& filename, int version, const wxString& fileContent);
+
+    /**
+     * @brief send the changes made to the document since the last update (incremental sync)
+     */
+    DidChangeTextDocumentRequest(const wxFileName& filename, int version,
+                                 const std::vector<TextDocumentContentChangeEvent>& changes);
     virtual ~DidChangeTextDocumentRequest();
 };
 
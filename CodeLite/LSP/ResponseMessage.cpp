@@ -94,6 +94,19 @@ LSP::ResponseMessage::ResponseMessage(wxString& message)
     }
 }
 
+LSP::ResponseMessage::ResponseMessage(wxSharedPtr<JSON> json)
+    : m_json(json)
+{
+    if(!m_json || !m_json->isOk()) {
+        m_json.reset(nullptr);
+        return;
+    }
+    FromJSON(m_json->toElement());
+
+    // The raw message is only needed to build a ResponseError, don't format the others
+    if(Has("error")) { m_jsonMessage = m_json->toElement().format(false); }
+}
+
 LSP::ResponseMessage::~ResponseMessage() {}
 
 std::string LSP::ResponseMessage::ToString() const { return ""; }
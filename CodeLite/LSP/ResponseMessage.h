@@ -22,7 +22,14 @@ protected:
     int ReadHeaders(const wxString& message, wxStringMap_t& headers);
 
 public:
+    typedef wxSharedPtr<ResponseMessage> Ptr_t;
+
     ResponseMessage(wxString& message);
+
+    /**
+     * @brief construct a response from an already parsed JSON-RPC message (e.g. by LSPMessageFramer)
+     */
+    ResponseMessage(wxSharedPtr<JSON> json);
     virtual ~ResponseMessage();
     virtual JSONItem ToJSON(const wxString& name) const;
     virtual void FromJSON(const JSONItem& json);
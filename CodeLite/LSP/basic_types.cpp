@@ -81,11 +81,17 @@ JSONItem TextDocumentItem::ToJSON(const wxString& name) const
 //===----------------------------------------------------------------------------------
 // TextDocumentContentChangeEvent
 //===----------------------------------------------------------------------------------
-void TextDocumentContentChangeEvent::FromJSON(const JSONItem& json) { m_text = json.namedObject("text").toString(); }
+void TextDocumentContentChangeEvent::FromJSON(const JSONItem& json)
+{
+    m_range = Range();
+    if(json.hasNamedObject("range")) { m_range.FromJSON(json.namedObject("range")); }
+    m_text = json.namedObject("text").toString();
+}
 
 JSONItem TextDocumentContentChangeEvent::ToJSON(const wxString& name) const
 {
     JSONItem json = JSONItem::createObject(name);
+    if(m_range.IsOk()) { json.append(m_range.ToJSON("range")); }
     json.addProperty("text", m_text);
     return json;
 }
@@ -100,7 +106,7 @@ JSONItem Range::ToJSON(const wxString& name) const
 {
     JSONItem json = JSONItem::createObject(name);
     json.append(m_start.ToJSON("start"));
-    json.append(m_start.ToJSON("end"));
+    json.append(m_end.ToJSON("end"));
     return json;
 }
 
@@ -9,29 +9,13 @@
 
 namespace LSP
 {
-//===----------------------------------------------------------------------------------
-// TextDocumentContentChangeEvent
-//===----------------------------------------------------------------------------------
-class WXDLLIMPEXP_CL TextDocumentContentChangeEvent : public Serializable
-{
-    wxString m_text;
-
-public:
-    virtual JSONItem ToJSON(const wxString& name) const;
-    virtual void FromJSON(const JSONItem& json);
-
-    TextDocumentContentChangeEvent() {}
-    TextDocumentContentChangeEvent(const wxString& text)
-        : m_text(text)
-    {
-    }
-    virtual ~TextDocumentContentChangeEvent() {}
-    TextDocumentContentChangeEvent& SetText(const wxString& text)
-    {
-        this->m_text = text;
-        return *this;
-    }
-    const wxString& GetText() const { return m_text; }
+/**
+ * @brief how the documents are synced with the server, as advertised in its "textDocumentSync" capability
+ */
+enum eTextDocumentSyncKind {
+    kTextDocumentSyncNone = 0,
+    kTextDocumentSyncFull = 1,
+    kTextDocumentSyncIncremental = 2,
 };
 
 //===----------------------------------------------------------------------------------
@@ -152,6 +136,43 @@ public:
     bool IsOk() const { return m_start.IsOk() && m_end.IsOk(); }
 };
 
+//===----------------------------------------------------------------------------------
+// TextDocumentContentChangeEvent
+//===----------------------------------------------------------------------------------
+class WXDLLIMPEXP_CL TextDocumentContentChangeEvent : public Serializable
+{
+    Range m_range; // when not set, m_text is the whole document
+    wxString m_text;
+
+public:
+    virtual JSONItem ToJSON(const wxString& name) const;
+    virtual void FromJSON(const JSONItem& json);
+
+    TextDocumentContentChangeEvent() {}
+    TextDocumentContentChangeEvent(const wxString& text)
+        : m_text(text)
+    {
+    }
+    TextDocumentContentChangeEvent(const Range& range, const wxString& text)
+        : m_range(range)
+        , m_text(text)
+    {
+    }
+    virtual ~TextDocumentContentChangeEvent() {}
+    TextDocumentContentChangeEvent& SetText(const wxString& text)
+    {
+        this->m_text = text;
+        return *this;
+    }
+    const wxString& GetText() const { return m_text; }
+    TextDocumentContentChangeEvent& SetRange(const Range& range)
+    {
+        this->m_range = range;
+        return *this;
+    }
+    const Range& GetRange() const { return m_range; }
+};
+
 //===----------------------------------------------------------------------------------
 // TextEdit
 //===----------------------------------------------------------------------------------
@@ -9,8 +9,9 @@
 #include <processreaderthread.h>
 #include <fileutils.h>
 
-UnixProcess::UnixProcess(wxEvtHandler* owner, const wxArrayString& args)
+UnixProcess::UnixProcess(wxEvtHandler* owner, const wxArrayString& args, OutputCallback_t stdoutCallback)
     : m_owner(owner)
+    , m_stdoutCallback(stdoutCallback)
 {
     m_goingDown.store(false);
 
@@ -70,7 +71,7 @@ UnixProcess::~UnixProcess()
 bool UnixProcess::ReadAll(int fd, std::string& content, int timeoutMilliseconds)
 {
     fd_set rset;
-    char buff[1024];
+    char buff[16 * 1024];
     FD_ZERO(&rset);
     FD_SET(fd, &rset);
 
@@ -80,9 +81,10 @@ bool UnixProcess::ReadAll(int fd, std::string& content, int timeoutMilliseconds)
     struct timeval tv = { seconds, ms * 1000 }; //  10 milliseconds timeout
     int rc = ::select(fd + 1, &rset, nullptr, nullptr, &tv);
     if(rc > 0) {
-        memset(buff, 0, sizeof(buff));
-        if(read(fd, buff, (sizeof(buff) - 1)) > 0) {
-            content.append(buff);
+        // The output may contain NULL bytes: append what we read, not a C string
+        ssize_t bytes = read(fd, buff, sizeof(buff));
+        if(bytes > 0) {
+            content.append(buff, bytes);
             return true;
         }
     } else if(rc == 0) {
@@ -165,6 +167,8 @@ void UnixProcess::StartReaderThread()
                     clProcessEvent evt(wxEVT_ASYNC_PROCESS_TERMINATED);
                     process->m_owner->AddPendingEvent(evt);
                     break;
+                } else if(!content.empty() && process->m_stdoutCallback) {
+                    process->m_stdoutCallback(content);
                 } else if(!content.empty()) {
                     clProcessEvent evt(wxEVT_ASYNC_PROCESS_OUTPUT);
                     evt.SetOutput(wxString() << content);
@@ -52,6 +52,9 @@ public:
 
 class UnixProcess
 {
+public:
+    typedef std::function<void(const std::string&)> OutputCallback_t;
+
 private:
     CPipe m_childStdin;
     CPipe m_childStdout;
@@ -61,6 +64,7 @@ private:
     wxMessageQueue<std::string> m_outgoingQueue;
     std::atomic_bool m_goingDown;
     wxEvtHandler* m_owner = nullptr;
+    OutputCallback_t m_stdoutCallback;
 
 protected:
     // sync operations
@@ -73,7 +77,11 @@ protected:
 public:
     int child_pid = -1;
 
-    UnixProcess(wxEvtHandler* owner, const wxArrayString& args);
+    /**
+     * @param stdoutCallback when set, the stdout bytes are passed to it (from the reader thread) instead of
+     * being sent as wxEVT_ASYNC_PROCESS_OUTPUT events
+     */
+    UnixProcess(wxEvtHandler* owner, const wxArrayString& args, OutputCallback_t stdoutCallback = nullptr);
     ~UnixProcess();
 
     // wait for process termination
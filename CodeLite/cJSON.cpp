@@ -114,6 +114,7 @@ void cJSON_Delete(cJSON* c)
         if(!(c->type & cJSON_IsReference) && c->child) cJSON_Delete(c->child);
         if(!(c->type & cJSON_IsReference) && c->valuestring) cJSON_free(c->valuestring);
         if(c->string) cJSON_free(c->string);
+        if(c->index) cJSON_free(c->index);
         cJSON_free(c);
         c = next;
     }
@@ -443,8 +444,9 @@ static const char* parse_array(cJSON* item, const char* value)
     value = skip(value + 1);
     if(*value == ']') return value + 1; /* empty array. */
 
-    item->child = child = cJSON_New_Item();
-    if(!item->child) return 0;                     /* memory fail */
+    item->child = item->lastchild = child = cJSON_New_Item();
+    if(!item->child) return 0; /* memory fail */
+    item->childcount = 1;
     value = skip(parse_value(child, skip(value))); /* skip any spacing, get the value. */
     if(!value) return 0;
 
@@ -453,7 +455,8 @@ static const char* parse_array(cJSON* item, const char* value)
         if(!(new_item = cJSON_New_Item())) return 0; /* memory fail */
         child->next = new_item;
         new_item->prev = child;
-        child = new_item;
+        child = item->lastchild = new_item;
+        item->childcount++;
         value = skip(parse_value(child, skip(value + 1)));
         if(!value) return 0; /* memory fail */
     }
@@ -537,8 +540,9 @@ static const char* parse_object(cJSON* item, const char* value)
     value = skip(value + 1);
     if(*value == '}') return value + 1; /* empty array. */
 
-    item->child = child = cJSON_New_Item();
+    item->child = item->lastchild = child = cJSON_New_Item();
     if(!item->child) return 0;
+    item->childcount = 1;
     value = skip(parse_string(child, skip(value)));
     if(!value) return 0;
     child->string = child->valuestring;
@@ -555,7 +559,8 @@ static const char* parse_object(cJSON* item, const char* value)
         if(!(new_item = cJSON_New_Item())) return 0; /* memory fail */
         child->next = new_item;
         new_item->prev = child;
-        child = new_item;
+        child = item->lastchild = new_item;
+        item->childcount++;
         value = skip(parse_string(child, skip(value + 1)));
         if(!value) return 0;
         child->string = child->valuestring;
@@ -657,17 +662,33 @@ static char* print_object(cJSON* item, int depth, int fmt)
 }
 
 /* Get Array size/item / object item. */
-int cJSON_GetArraySize(cJSON* array)
+int cJSON_GetArraySize(cJSON* array) { return array->childcount; }
+
+/* Arrays smaller than this are walked, not indexed */
+#define CJSON_MIN_INDEXED_SIZE 8
+
+/* Drop the index of an array/object, called whenever its child chain changes. */
+static void invalidate_index(cJSON* array)
 {
-    cJSON* c = array->child;
-    int i = 0;
-    while(c)
-        i++, c = c->next;
-    return i;
+    if(array->index) cJSON_free(array->index);
+    array->index = 0;
 }
+
 cJSON* cJSON_GetArrayItem(cJSON* array, int item)
 {
-    cJSON* c = array->child;
+    cJSON* c;
+    int i;
+    if(item < 0 || item >= array->childcount) return 0;
+    if(item == array->childcount - 1) return array->lastchild;
+    if(!array->index && array->childcount >= CJSON_MIN_INDEXED_SIZE) {
+        array->index = (cJSON**)cJSON_malloc(array->childcount * sizeof(cJSON*));
+        if(array->index)
+            for(c = array->child, i = 0; c; c = c->next)
+                array->index[i++] = c;
+    }
+    if(array->index) return array->index[item];
+
+    c = array->child;
     while(c && item > 0)
         item--, c = c->next;
     return c;
@@ -693,6 +714,7 @@ static cJSON* create_reference(cJSON* item)
     if(!ref) return 0;
     memcpy(ref, item, sizeof(cJSON));
     ref->string = 0;
+    ref->index = 0; /* owned by the referenced item */
     ref->type |= cJSON_IsReference;
     ref->next = ref->prev = 0;
     return ref;
@@ -701,15 +723,15 @@ static cJSON* create_reference(cJSON* item)
 /* Add item to array/object. */
 void cJSON_AddItemToArray(cJSON* array, cJSON* item)
 {
-    cJSON* c = array->child;
     if(!item) return;
-    if(!c) {
+    if(!array->child) {
         array->child = item;
     } else {
-        while(c && c->next)
-            c = c->next;
-        suffix_object(c, item);
+        suffix_object(array->lastchild, item);
     }
+    array->lastchild = item;
+    array->childcount++;
+    invalidate_index(array);
 }
 void cJSON_AddItemToObject(cJSON* object, const char* string, cJSON* item)
 {
@@ -733,6 +755,9 @@ cJSON* cJSON_DetachItemFromArray(cJSON* array, int which)
     if(c->prev) c->prev->next = c->next;
     if(c->next) c->next->prev = c->prev;
     if(c == array->child) array->child = c->next;
+    if(c == array->lastchild) array->lastchild = c->prev;
+    array->childcount--;
+    invalidate_index(array);
     c->prev = c->next = 0;
     return c;
 }
@@ -765,6 +790,8 @@ void cJSON_ReplaceItemInArray(cJSON* array, int which, cJSON* newitem)
         array->child = newitem;
     else
         newitem->prev->next = newitem;
+    if(c == array->lastchild) array->lastchild = newitem;
+    invalidate_index(array);
     c->next = c->prev = 0;
     cJSON_Delete(c);
 }
@@ -850,6 +877,7 @@ cJSON* cJSON_CreateIntArray(int* numbers, int count)
             suffix_object(p, n);
         p = n;
     }
+    if(a) a->lastchild = p, a->childcount = count;
     return a;
 }
 cJSON* cJSON_CreateFloatArray(float* numbers, int count)
@@ -864,6 +892,7 @@ cJSON* cJSON_CreateFloatArray(float* numbers, int count)
             suffix_object(p, n);
         p = n;
     }
+    if(a) a->lastchild = p, a->childcount = count;
     return a;
 }
 cJSON* cJSON_CreateDoubleArray(double* numbers, int count)
@@ -878,6 +907,7 @@ cJSON* cJSON_CreateDoubleArray(double* numbers, int count)
             suffix_object(p, n);
         p = n;
     }
+    if(a) a->lastchild = p, a->childcount = count;
     return a;
 }
 cJSON* cJSON_CreateStringArray(const char** strings, int count)
@@ -892,5 +922,6 @@ cJSON* cJSON_CreateStringArray(const char** strings, int count)
             suffix_object(p, n);
         p = n;
     }
+    if(a) a->lastchild = p, a->childcount = count;
     return a;
 }
@@ -79,6 +79,11 @@ typedef struct cJSON
 
     char*
     string; /* The item's name string, if this item is the child of, or is in the list of subitems of an object. */
+
+    /* Bookkeeping for arrays and objects, maintained by the functions below: don't link children by hand */
+    struct cJSON* lastchild; /* The last item of the child chain, for O(1) appends. */
+    int childcount;          /* The number of items in the child chain. */
+    struct cJSON** index;    /* The child chain as a contiguous array, built on the first indexed access. */
 } cJSON;
 
 typedef struct cJSON_Hooks
@@ -99,9 +104,10 @@ extern char* cJSON_PrintUnformatted(cJSON* item);
 /* Delete a cJSON entity and all subentities. */
 extern void cJSON_Delete(cJSON* c);
 
-/* Returns the number of items in an array (or object). */
+/* Returns the number of items in an array (or object). O(1) */
 extern int cJSON_GetArraySize(cJSON* array);
-/* Retrieve item number "item" from array "array". Returns NULL if unsuccessful. */
+/* Retrieve item number "item" from array "array". Returns NULL if unsuccessful. O(1), except for the first call on
+ * an array (or after it was modified) which indexes its items */
 extern cJSON* cJSON_GetArrayItem(cJSON* array, int item);
 /* Get item "string" from object. Case insensitive. */
 extern cJSON* cJSON_GetObjectItem(cJSON* object, const char* string);
@@ -0,0 +1,71 @@
+#include "clByteSearcher.h"
+#include <string.h>
+
+clByteSearcher::clByteSearcher() { SetNeedle("", true); }
+
+clByteSearcher::clByteSearcher(const std::string& needle, bool matchCase) { SetNeedle(needle, matchCase); }
+
+clByteSearcher::~clByteSearcher() {}
+
+void clByteSearcher::SetNeedle(const std::string& needle, bool matchCase)
+{
+    m_matchCase = matchCase;
+    for(size_t i = 0; i < 256; ++i) {
+        m_fold[i] = (!m_matchCase && i >= 'A' && i <= 'Z') ? (unsigned char)(i + ('a' - 'A')) : (unsigned char)i;
+    }
+
+    m_needle = needle;
+    for(size_t i = 0; i < m_needle.length(); ++i) {
+        m_needle[i] = (char)m_fold[(unsigned char)m_needle[i]];
+    }
+
+    // Build the Horspool bad character table. Since the haystack bytes are
+    // folded before the lookup, we only need entries for the folded needle
+    size_t len = m_needle.length();
+    for(size_t i = 0; i < 256; ++i) {
+        m_skip[i] = len;
+    }
+    for(size_t i = 0; len && i < len - 1; ++i) {
+        m_skip[(unsigned char)m_needle[i]] = len - 1 - i;
+    }
+}
+
+bool clByteSearcher::Equals(const unsigned char* hay) const
+{
+    const unsigned char* needle = (const unsigned char*)m_needle.data();
+    for(size_t i = 0; i < m_needle.length(); ++i) {
+        if(m_fold[hay[i]] != needle[i]) { return false; }
+    }
+    return true;
+}
+
+size_t clByteSearcher::Find(const char* buffer, size_t len, size_t offset) const
+{
+    size_t needleLen = m_needle.length();
+    if(needleLen == 0 || len < needleLen || offset > (len - needleLen)) { return std::string::npos; }
+
+    const unsigned char* hay = (const unsigned char*)buffer;
+    if(m_matchCase && needleLen < 4) {
+        // For short needles the Horspool shifts are too small to pay off, let
+        // the (vectorised) memchr of the C library find the candidates instead
+        const char first = m_needle[0];
+        const char* p = buffer + offset;
+        const char* end = buffer + (len - needleLen) + 1;
+        while(p < end) {
+            p = (const char*)memchr(p, first, end - p);
+            if(!p) { break; }
+            if(memcmp(p, m_needle.data(), needleLen) == 0) { return p - buffer; }
+            ++p;
+        }
+        return std::string::npos;
+    }
+
+    const unsigned char last = (unsigned char)m_needle[needleLen - 1];
+    size_t pos = offset;
+    while(pos <= (len - needleLen)) {
+        unsigned char ch = m_fold[hay[pos + needleLen - 1]];
+        if(ch == last && Equals(hay + pos)) { return pos; }
+        pos += m_skip[ch];
+    }
+    return std::string::npos;
+}
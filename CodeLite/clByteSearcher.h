@@ -0,0 +1,41 @@
+#ifndef CLBYTESEARCHER_H
+#define CLBYTESEARCHER_H
+
+#include "codelite_exports.h"
+#include <string>
+
+/**
+ * @class clByteSearcher
+ * @brief a substring matcher that works directly on raw (undecoded) bytes.
+ * Short case sensitive needles are located with memchr, everything else uses
+ * Boyer-Moore-Horspool. Case folding is ASCII only
+ */
+class WXDLLIMPEXP_CL clByteSearcher
+{
+    std::string m_needle;
+    bool m_matchCase = true;
+    unsigned char m_fold[256];
+    size_t m_skip[256];
+
+protected:
+    bool Equals(const unsigned char* hay) const;
+
+public:
+    clByteSearcher();
+    clByteSearcher(const std::string& needle, bool matchCase);
+    virtual ~clByteSearcher();
+
+    /**
+     * @brief (re)initialise the searcher with a new needle
+     */
+    void SetNeedle(const std::string& needle, bool matchCase);
+
+    bool IsOk() const { return !m_needle.empty(); }
+
+    /**
+     * @brief return the offset of the first match found in buffer at or after 'offset' or std::string::npos
+     */
+    size_t Find(const char* buffer, size_t len, size_t offset = 0) const;
+};
+
+#endif // CLBYTESEARCHER_H
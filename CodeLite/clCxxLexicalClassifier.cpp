@@ -0,0 +1,237 @@
+#include "clCxxLexicalClassifier.h"
+#include "cppwordscanner.h"
+#include <unordered_map>
+
+// The longest delimiter allowed by the standard for a raw string
+#define MAX_RAW_STRING_DELIMITER 16
+
+namespace
+{
+bool IsWordChar(const wxUniChar& ch) { return ch == '_' || wxIsalnum(ch); }
+} // namespace
+
+clCxxLexicalClassifier::clCxxLexicalClassifier(const wxString& text)
+    : m_text(text)
+{
+    Reset();
+}
+
+clCxxLexicalClassifier::~clCxxLexicalClassifier() {}
+
+void clCxxLexicalClassifier::Reset()
+{
+    m_pos = 0;
+    m_state = CppWordScanner::STATE_NORMAL;
+    m_charState = CppWordScanner::STATE_NORMAL;
+    m_prev = 0;
+    m_open = 0;
+    m_escape = false;
+    m_wordStart = 0;
+    m_inWord = false;
+    m_inNumber = false;
+    m_delimStart = 0;
+    m_delimLen = 0;
+    m_rawString = false;
+}
+
+bool clCxxLexicalClassifier::IsRawStringPrefix() const
+{
+    // R"...", LR"...", uR"...", UR"..." or u8R"..."
+    if(!m_inWord || m_prev != 'R') { return false; }
+    switch(m_pos - m_wordStart) {
+    case 1:
+        return true;
+    case 2: {
+        wxUniChar ch = m_text[m_wordStart];
+        return ch == 'L' || ch == 'u' || ch == 'U';
+    }
+    case 3:
+        return m_text[m_wordStart] == 'u' && m_text[m_wordStart + 1] == '8';
+    default:
+        return false;
+    }
+}
+
+bool clCxxLexicalClassifier::IsRawStringEnd() const
+{
+    // m_pos is on a '"', it closes the string if it follows ")delimiter"
+    if(m_pos < (m_open + m_delimLen + 2)) { return false; }
+    size_t closeParen = m_pos - m_delimLen - 1;
+    if(m_text[closeParen] != ')') { return false; }
+    for(size_t i = 0; i < m_delimLen; ++i) {
+        if(m_text[m_delimStart + i] != m_text[closeParen + 1 + i]) { return false; }
+    }
+    return true;
+}
+
+void clCxxLexicalClassifier::Step()
+{
+    wxUniChar ch = m_text[m_pos];
+    switch(m_state) {
+    case CppWordScanner::STATE_C_COMMENT:
+        m_charState = m_state;
+        // "/*/" does not close the comment
+        if(ch == '/' && m_prev == '*' && m_pos >= (m_open + 3)) { m_state = CppWordScanner::STATE_NORMAL; }
+        break;
+
+    case CppWordScanner::STATE_CPP_COMMENT:
+        m_charState = m_state;
+        if(ch == '\n') {
+            // A backslash at the end of the line continues the comment
+            if(!m_escape) { m_state = CppWordScanner::STATE_NORMAL; }
+            m_escape = false;
+        } else if(ch == '\\') {
+            m_escape = true;
+        } else if(ch != '\r') {
+            m_escape = false;
+        }
+        break;
+
+    case CppWordScanner::STATE_DQ_STRING:
+    case CppWordScanner::STATE_SINGLE_STRING:
+        m_charState = m_state;
+        if(m_rawString) {
+            if(ch == '"' && IsRawStringEnd()) {
+                m_state = CppWordScanner::STATE_NORMAL;
+                m_rawString = false;
+            }
+        } else if(m_escape) {
+            m_escape = false;
+        } else if(ch == '\\') {
+            m_escape = true;
+        } else if(ch == (m_state == CppWordScanner::STATE_DQ_STRING ? '"' : '\'') || ch == '\n') {
+            // A new line ends an unterminated string
+            m_state = CppWordScanner::STATE_NORMAL;
+        }
+        break;
+
+    default: {
+        m_charState = CppWordScanner::STATE_NORMAL;
+        wxUniChar next = (m_pos + 1) < m_text.length() ? m_text[m_pos + 1] : wxUniChar(0);
+        if(ch == '/' && next == '/') {
+            m_state = m_charState = CppWordScanner::STATE_CPP_COMMENT;
+            m_escape = false;
+
+        } else if(ch == '/' && next == '*') {
+            m_state = m_charState = CppWordScanner::STATE_C_COMMENT;
+            m_open = m_pos;
+
+        } else if(ch == '"') {
+            m_state = m_charState = CppWordScanner::STATE_DQ_STRING;
+            m_open = m_pos;
+            m_escape = false;
+            m_rawString = false;
+            if(IsRawStringPrefix()) {
+                // Read the delimiter, up to the '('
+                size_t end = m_pos + 1;
+                for(; end < m_text.length() && (end - m_pos) <= (MAX_RAW_STRING_DELIMITER + 1); ++end) {
+                    wxUniChar delimCh = m_text[end];
+                    if(delimCh == '(' || delimCh == ')' || delimCh == '\\' || delimCh == '"' || wxIsspace(delimCh)) {
+                        break;
+                    }
+                }
+                if(end < m_text.length() && m_text[end] == '(') {
+                    m_rawString = true;
+                    m_delimStart = m_pos + 1;
+                    m_delimLen = end - m_delimStart;
+                    m_open = end;
+                }
+            }
+
+        } else if(ch == '\'' && !m_inNumber) {
+            m_state = m_charState = CppWordScanner::STATE_SINGLE_STRING;
+            m_open = m_pos;
+            m_escape = false;
+        }
+
+        // Keep track of the current word, for the raw string prefixes and the digit separators (1'000)
+        if((ch == '\'' || ch == '.') && m_inNumber) {
+            // still in the number
+        } else if(m_state == CppWordScanner::STATE_NORMAL && IsWordChar(ch)) {
+            if(!m_inWord) {
+                m_inWord = true;
+                m_inNumber = wxIsdigit(ch);
+                m_wordStart = m_pos;
+            }
+        } else {
+            m_inWord = false;
+            m_inNumber = false;
+        }
+        break;
+    }
+    }
+    m_prev = ch;
+    ++m_pos;
+}
+
+int clCxxLexicalClassifier::GetState(size_t pos)
+{
+    if(pos >= m_text.length()) { return CppWordScanner::STATE_NORMAL; }
+    if((pos + 1) < m_pos) { Reset(); }
+    while(m_pos <= pos) {
+        Step();
+    }
+    return m_charState;
+}
+
+bool clCxxLexicalClassifier::IsComment(int state)
+{
+    return state == CppWordScanner::STATE_C_COMMENT || state == CppWordScanner::STATE_CPP_COMMENT;
+}
+
+bool clCxxLexicalClassifier::IsString(int state)
+{
+    return state == CppWordScanner::STATE_DQ_STRING || state == CppWordScanner::STATE_SINGLE_STRING;
+}
+
+void clCxxLexicalClassifier::FindIdentifiers(const wxString& text, CppIdentifiersList& identifiers)
+{
+    // The distinct names by the hash of their characters, so a repeated name is matched in place
+    typedef std::unordered_multimap<size_t, size_t> NamesIndex_t;
+    NamesIndex_t namesIndex;
+    clCxxLexicalClassifier classifier(text);
+    int line = 1;
+    size_t len = text.length();
+    size_t i = 0;
+    while(i < len) {
+        wxUniChar ch = text[i];
+        if(!IsWordChar(ch)) {
+            if(ch == '\n') { ++line; }
+            ++i;
+            continue;
+        }
+
+        size_t start = i;
+        size_t hash = 0;
+        for(; i < len && IsWordChar(text[i]); ++i) {
+            hash = (hash * 31) + text[i].GetValue();
+        }
+
+        // skip numbers, comments and strings
+        if(wxIsdigit(text[start])) { continue; }
+        int state = classifier.GetState(start);
+        if(IsComment(state) || IsString(state)) { continue; }
+
+        size_t length = i - start;
+        size_t name = identifiers.names.size();
+        std::pair<NamesIndex_t::iterator, NamesIndex_t::iterator> range = namesIndex.equal_range(hash);
+        for(; range.first != range.second; ++range.first) {
+            const wxString& candidate = identifiers.names[range.first->second];
+            if(candidate.length() == length && text.compare(start, length, candidate) == 0) {
+                name = range.first->second;
+                break;
+            }
+        }
+        if(name == identifiers.names.size()) {
+            identifiers.names.push_back(text.Mid(start, length));
+            namesIndex.insert({ hash, name });
+        }
+
+        CppIdentifiersList::Occurrence occurrence;
+        occurrence.name = name;
+        occurrence.offset = (int)start;
+        occurrence.line = line;
+        occurrence.state = state;
+        identifiers.occurrences.push_back(occurrence);
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef CLCXXLEXICALCLASSIFIER_H
+#define CLCXXLEXICALCLASSIFIER_H
+
+#include "codelite_exports.h"
+#include <wx/string.h>
+
+struct CppIdentifiersList;
+
+/**
+ * @class clCxxLexicalClassifier
+ * @brief tell whether a position in a C/C++ text is code, a comment or a string.
+ *
+ * Unlike CppWordScanner::states(), nothing is allocated: the classifier walks the text once, lazily, up to
+ * the position being asked about and only keeps the state of its cursor. Asking about increasing positions
+ * (e.g. the matches of a search, in order) costs a single pass over the text up to the last position asked.
+ * The states are the CppWordScanner::STATE_* values (the pre-processor lines are reported as STATE_NORMAL).
+ * Raw strings, line continuations in "//" comments and digit separators are handled
+ */
+class WXDLLIMPEXP_CL clCxxLexicalClassifier
+{
+    const wxString& m_text;
+    size_t m_pos = 0;       // the next character to classify
+    int m_state = 0;        // the state of the cursor
+    int m_charState = 0;    // the state of the character at m_pos - 1
+    wxUniChar m_prev = 0;   // the character at m_pos - 1
+    size_t m_open = 0;      // where the current comment or string starts
+    bool m_escape = false;  // the previous character was an escaping backslash
+    size_t m_wordStart = 0; // where the current word starts
+    bool m_inWord = false;
+    bool m_inNumber = false;
+    size_t m_delimStart = 0; // the delimiter of the current raw string
+    size_t m_delimLen = 0;
+    bool m_rawString = false;
+
+protected:
+    void Step();
+    bool IsRawStringPrefix() const;
+    bool IsRawStringEnd() const;
+
+public:
+    clCxxLexicalClassifier(const wxString& text);
+    virtual ~clCxxLexicalClassifier();
+
+    /**
+     * @brief return the state of the character at "pos". This is fast when called with increasing positions,
+     * going back restarts the scan from the beginning of the text
+     */
+    int GetState(size_t pos);
+
+    /**
+     * @brief restart from the beginning of the text
+     */
+    void Reset();
+
+    static bool IsComment(int state);
+    static bool IsString(int state);
+
+    /**
+     * @brief collect the identifiers found in the code of "text" (comments, strings and numbers are skipped).
+     * The text is walked once and a name is allocated only the first time it is seen
+     */
+    static void FindIdentifiers(const wxString& text, CppIdentifiersList& identifiers);
+};
+
+#endif // CLCXXLEXICALCLASSIFIER_H
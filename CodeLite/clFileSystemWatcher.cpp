@@ -5,17 +5,24 @@
 
 wxDEFINE_EVENT(wxEVT_FILE_MODIFIED, clFileSystemEvent);
 wxDEFINE_EVENT(wxEVT_FILE_NOT_FOUND, clFileSystemEvent);
+wxDEFINE_EVENT(wxEVT_FILES_MODIFIED, clFileSystemEvent);
+wxDEFINE_EVENT(wxEVT_FILES_DELETED, clFileSystemEvent);
 
 // In milliseconds
 #define FILE_CHECK_INTERVAL 500
 
 clFileSystemWatcher::clFileSystemWatcher()
     : m_owner(NULL)
-#if CL_FSW_USE_TIMER
+#if CL_FSW_USE_INOTIFY
+    , m_inotify(NULL)
+#elif CL_FSW_USE_TIMER
     , m_timer(NULL)
 #endif
 {
-#if CL_FSW_USE_TIMER
+#if CL_FSW_USE_INOTIFY
+    m_inotify = new clInotifyWatcher(this);
+    Bind(wxEVT_THREAD, &clFileSystemWatcher::OnInotifyChanges, this);
+#elif CL_FSW_USE_TIMER
     Bind(wxEVT_TIMER, &clFileSystemWatcher::OnTimer, this);
 #else
     m_watcher.SetOwner(this);
@@ -25,7 +32,11 @@ clFileSystemWatcher::clFileSystemWatcher()
 
 clFileSystemWatcher::~clFileSystemWatcher()
 {
-#if CL_FSW_USE_TIMER
+#if CL_FSW_USE_INOTIFY
+    Stop();
+    wxDELETE(m_inotify);
+    Unbind(wxEVT_THREAD, &clFileSystemWatcher::OnInotifyChanges, this);
+#elif CL_FSW_USE_TIMER
     Stop();
     Unbind(wxEVT_TIMER, &clFileSystemWatcher::OnTimer, this);
 #else
@@ -36,7 +47,17 @@ clFileSystemWatcher::~clFileSystemWatcher()
 
 void clFileSystemWatcher::SetFile(const wxFileName& filename)
 {
-#if CL_FSW_USE_TIMER
+#if CL_FSW_USE_INOTIFY
+    if(filename.Exists()) {
+        m_files.clear();
+        File f;
+        f.filename = filename;
+        f.lastModified = FileUtils::GetFileModificationTime(filename);
+        f.file_size = FileUtils::GetFileSize(filename);
+        m_files.insert(std::make_pair(filename.GetFullPath(), f));
+        DoRestart();
+    }
+#elif CL_FSW_USE_TIMER
     if(filename.Exists()) {
         m_files.clear();
         File f;
@@ -54,9 +75,52 @@ void clFileSystemWatcher::SetFile(const wxFileName& filename)
 #endif
 }
 
+void clFileSystemWatcher::AddTree(const wxString& path, const wxArrayString& excludeFolders)
+{
+    wxFileName fn(path, "");
+    m_trees[fn.GetPath()] = excludeFolders;
+#if CL_FSW_USE_INOTIFY
+    DoRestart();
+#endif
+}
+
+void clFileSystemWatcher::RemoveTree(const wxString& path)
+{
+    wxFileName fn(path, "");
+    if(m_trees.erase(fn.GetPath())) {
+#if CL_FSW_USE_INOTIFY
+        DoRestart();
+#endif
+    }
+}
+
 void clFileSystemWatcher::Start()
 {
-#if CL_FSW_USE_TIMER
+#if CL_FSW_USE_INOTIFY
+    Stop();
+
+    // Watch the folders of the files (not recursively) and the trees
+    std::vector<clInotifyWatcher::Root> roots;
+    std::set<wxString> folders;
+    std::for_each(m_files.begin(), m_files.end(), [&](const std::pair<wxString, clFileSystemWatcher::File>& p) {
+        folders.insert(p.second.filename.GetPath());
+    });
+    std::for_each(folders.begin(), folders.end(), [&](const wxString& folder) {
+        clInotifyWatcher::Root root;
+        root.path = folder.mb_str(wxConvUTF8).data();
+        roots.push_back(root);
+    });
+    std::for_each(m_trees.begin(), m_trees.end(), [&](const std::pair<wxString, wxArrayString>& p) {
+        clInotifyWatcher::Root root;
+        root.path = p.first.mb_str(wxConvUTF8).data();
+        root.recursive = true;
+        for(size_t i = 0; i < p.second.size(); ++i) {
+            root.excludeFolders.push_back(p.second.Item(i).mb_str(wxConvUTF8).data());
+        }
+        roots.push_back(root);
+    });
+    m_inotify->Start(roots);
+#elif CL_FSW_USE_TIMER
     Stop();
 
     m_timer = new wxTimer(this);
@@ -67,7 +131,9 @@ void clFileSystemWatcher::Start()
 
 void clFileSystemWatcher::Stop()
 {
-#if CL_FSW_USE_TIMER
+#if CL_FSW_USE_INOTIFY
+    m_inotify->Stop();
+#elif CL_FSW_USE_TIMER
     if(m_timer) {
         m_timer->Stop();
     }
@@ -79,14 +145,98 @@ void clFileSystemWatcher::Stop()
 
 void clFileSystemWatcher::Clear()
 {
-#if CL_FSW_USE_TIMER
+#if CL_FSW_USE_INOTIFY
+    Stop();
+    m_files.clear();
+    // Drop the changes that were not delivered
+    clInotifyWatcher::Changes_t changes;
+    m_inotify->TakeChanges(changes);
+#elif CL_FSW_USE_TIMER
     Stop();
     m_files.clear();
 #else
     m_watcher.RemoveAll();
 #endif
+    m_trees.clear();
 }
 
+#if CL_FSW_USE_INOTIFY
+void clFileSystemWatcher::DoRestart()
+{
+    // Apply the changes made to the watch list. The changes not delivered yet are kept by the watcher
+    if(IsRunning()) {
+        Start();
+    }
+}
+
+bool clFileSystemWatcher::IsUnderTree(const wxString& path) const
+{
+    std::map<wxString, wxArrayString>::const_iterator iter = m_trees.begin();
+    for(; iter != m_trees.end(); ++iter) {
+        const wxString& root = iter->first;
+        if(path.StartsWith(root) &&
+           (path.length() == root.length() || path[root.length()] == '/' || root.EndsWith("/"))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void clFileSystemWatcher::OnInotifyChanges(wxThreadEvent& event)
+{
+    clInotifyWatcher::Changes_t changes;
+    m_inotify->TakeChanges(changes);
+    if(changes.empty() || !GetOwner()) {
+        return;
+    }
+
+    wxArrayString modified, deleted;
+    std::for_each(changes.begin(), changes.end(), [&](const std::pair<std::string, clInotifyWatcher::eChange>& p) {
+        wxString path(p.first.c_str(), wxConvUTF8);
+
+        // Files added with SetFile()
+        File::Map_t::iterator iter = m_files.find(path);
+        if(iter != m_files.end()) {
+            if(p.second == clInotifyWatcher::kDeleted || !iter->second.filename.Exists()) {
+                clFileSystemEvent evt(wxEVT_FILE_NOT_FOUND);
+                evt.SetPath(path);
+                GetOwner()->AddPendingEvent(evt);
+                m_files.erase(iter);
+            } else {
+                time_t lastModified = FileUtils::GetFileModificationTime(iter->second.filename);
+                size_t fileSize = FileUtils::GetFileSize(iter->second.filename);
+                if(lastModified != iter->second.lastModified || fileSize != iter->second.file_size) {
+                    iter->second.lastModified = lastModified;
+                    iter->second.file_size = fileSize;
+                    clFileSystemEvent evt(wxEVT_FILE_MODIFIED);
+                    evt.SetPath(path);
+                    GetOwner()->AddPendingEvent(evt);
+                }
+            }
+        }
+
+        if(IsUnderTree(path)) {
+            if(p.second == clInotifyWatcher::kDeleted) {
+                deleted.Add(path);
+            } else {
+                modified.Add(path);
+            }
+        }
+    });
+
+    if(!modified.IsEmpty()) {
+        clFileSystemEvent evt(wxEVT_FILES_MODIFIED);
+        evt.SetPaths(modified);
+        GetOwner()->AddPendingEvent(evt);
+    }
+    if(!deleted.IsEmpty()) {
+        clFileSystemEvent evt(wxEVT_FILES_DELETED);
+        evt.SetPaths(deleted);
+        GetOwner()->AddPendingEvent(evt);
+    }
+}
+#endif
+
 #if CL_FSW_USE_TIMER
 void clFileSystemWatcher::OnTimer(wxTimerEvent& event)
 {
@@ -144,7 +294,7 @@ void clFileSystemWatcher::OnTimer(wxTimerEvent& event)
 }
 #endif
 
-#if !CL_FSW_USE_TIMER
+#if !CL_FSW_USE_INOTIFY && !CL_FSW_USE_TIMER
 void clFileSystemWatcher::OnFileModified(wxFileSystemWatcherEvent& event)
 {
     if(event.GetChangeType() == wxFSW_EVENT_MODIFY) {
@@ -162,7 +312,11 @@ void clFileSystemWatcher::OnFileModified(wxFileSystemWatcherEvent& event)
 
 void clFileSystemWatcher::RemoveFile(const wxFileName& filename)
 {
-#if CL_FSW_USE_TIMER
+#if CL_FSW_USE_INOTIFY
+    if(m_files.erase(filename.GetFullPath())) {
+        DoRestart();
+    }
+#elif CL_FSW_USE_TIMER
     if(m_files.count(filename.GetFullPath())) {
         m_files.erase(filename.GetFullPath());
     }
@@ -171,7 +325,9 @@ void clFileSystemWatcher::RemoveFile(const wxFileName& filename)
 
 bool clFileSystemWatcher::IsRunning() const
 {
-#if CL_FSW_USE_TIMER
+#if CL_FSW_USE_INOTIFY
+    return m_inotify->IsRunning();
+#elif CL_FSW_USE_TIMER
     return m_timer;
 #else
     return m_watcher.GetWatchedPathsCount();
@@ -7,13 +7,17 @@
 #include <wx/timer.h>
 #include <wx/filename.h>
 
-#ifdef __WXMSW__
-#define CL_FSW_USE_TIMER 1
+#if defined(__linux__)
+#define CL_FSW_USE_INOTIFY 1
+#define CL_FSW_USE_TIMER 0
 #else
+#define CL_FSW_USE_INOTIFY 0
 #define CL_FSW_USE_TIMER 1
 #endif
 
-#if !CL_FSW_USE_TIMER
+#if CL_FSW_USE_INOTIFY
+#include "clInotifyWatcher.h"
+#elif !CL_FSW_USE_TIMER
 #include <wx/fswatcher.h>
 #endif
 
@@ -28,7 +32,11 @@ public:
     };
 
     wxEvtHandler* m_owner;
-#if CL_FSW_USE_TIMER
+    std::map<wxString, wxArrayString> m_trees; // tree root -> excluded folders
+#if CL_FSW_USE_INOTIFY
+    clFileSystemWatcher::File::Map_t m_files;
+    clInotifyWatcher* m_inotify;
+#elif CL_FSW_USE_TIMER
     clFileSystemWatcher::File::Map_t m_files;
     wxTimer* m_timer;
 #else
@@ -40,7 +48,11 @@ public:
     typedef wxSharedPtr<clFileSystemWatcher> Ptr_t;
 
 protected:
-#if CL_FSW_USE_TIMER
+#if CL_FSW_USE_INOTIFY
+    void OnInotifyChanges(wxThreadEvent& event);
+    void DoRestart();
+    bool IsUnderTree(const wxString& path) const;
+#elif CL_FSW_USE_TIMER
     void OnTimer(wxTimerEvent& event);
 #else
     void OnFileModified(wxFileSystemWatcherEvent& event);
@@ -63,10 +75,24 @@ public:
      */
     void RemoveFile(const wxFileName& filename);
 
+    /**
+     * @brief watch a directory tree, recursively. Folders named in 'excludeFolders' (e.g. ".git") are skipped.
+     * The changes made under the tree are reported in batches, see Start()
+     * @note only supported by the native (inotify) backend, ignored otherwise
+     */
+    void AddTree(const wxString& path, const wxArrayString& excludeFolders = wxArrayString());
+
+    /**
+     * @brief stop watching a directory tree
+     */
+    void RemoveTree(const wxString& path);
+
     /**
      * @brief start to watching list of files.
      * This object fires the following events (clFileSystemEvent):
-     * wxEVT_FILE_MODIFIED, wxEVT_FILE_DELETED
+     * wxEVT_FILE_MODIFIED, wxEVT_FILE_NOT_FOUND for the files added with SetFile()
+     * wxEVT_FILES_MODIFIED, wxEVT_FILES_DELETED for the changes under the trees added with AddTree().
+     * The changes are coalesced, use clFileSystemEvent::GetPaths() to get the batch
      */
     void Start();
 
@@ -88,5 +114,7 @@ public:
 
 wxDECLARE_EXPORTED_EVENT(WXDLLIMPEXP_CL, wxEVT_FILE_MODIFIED, clFileSystemEvent);
 wxDECLARE_EXPORTED_EVENT(WXDLLIMPEXP_CL, wxEVT_FILE_NOT_FOUND, clFileSystemEvent);
+wxDECLARE_EXPORTED_EVENT(WXDLLIMPEXP_CL, wxEVT_FILES_MODIFIED, clFileSystemEvent);
+wxDECLARE_EXPORTED_EVENT(WXDLLIMPEXP_CL, wxEVT_FILES_DELETED, clFileSystemEvent);
 
 #endif // CLFILESYSTEMWATCHER_H
@@ -1,57 +1,595 @@
 #include "clFilesCollector.h"
 #include "file_logger.h"
 #include "fileutils.h"
-#include <queue>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <wx/dir.h>
 #include <wx/filename.h>
 #include <wx/tokenzr.h>
 
-clFilesScanner::clFilesScanner() {}
+#if defined(__linux__)
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
-clFilesScanner::~clFilesScanner() {}
+// The maximum number of threads used by a single scan
+#define MAX_SCAN_THREADS 8
 
-size_t clFilesScanner::Scan(const wxString& rootFolder, std::vector<wxString>& filesOutput, const wxString& filespec,
-                            const wxString& excludeFilespec, const wxStringSet_t& excludeFolders)
+// The getdents64() buffer size, per thread
+#define SCAN_DIRENT_BUFFER_SIZE (32 * 1024)
+
+#ifdef __WXMSW__
+#define SCAN_PATH_SEP '\\'
+#else
+#define SCAN_PATH_SEP '/'
+#endif
+
+enum eGlobFlags {
+    kGlobPath = (1 << 0),     // '*' and '?' do not match '/', "**" does
+    kGlobNoCase = (1 << 1),   // ASCII case insensitive
+    kGlobBrackets = (1 << 2), // support "[a-z]" character classes
+};
+
+static inline char GlobLower(char ch) { return (ch >= 'A' && ch <= 'Z') ? (ch - 'A' + 'a') : ch; }
+
+static bool GlobMatch(const char* p, const char* pend, const char* s, const char* send, size_t flags)
 {
-    filesOutput.clear();
-    if(!wxFileName::DirExists(rootFolder)) {
-        clDEBUG() << "clFilesScanner: No such dir:" << rootFolder << clEndl;
-        return 0;
+    bool nocase = flags & kGlobNoCase;
+    while(p < pend) {
+        char pc = *p;
+        if(pc == '*') {
+            bool any = !(flags & kGlobPath);
+            if((p + 1 < pend) && (p[1] == '*') && (flags & kGlobPath)) {
+                any = true;
+                ++p;
+                // "**/" also matches zero folders
+                if((p + 1 < pend) && (p[1] == '/') && GlobMatch(p + 2, pend, s, send, flags)) { return true; }
+            }
+            ++p;
+            if(p == pend) { return any || (std::find(s, send, '/') == send); }
+            for(const char* t = s;; ++t) {
+                if(GlobMatch(p, pend, t, send, flags)) { return true; }
+                if(t == send || (!any && *t == '/')) { break; }
+            }
+            return false;
+        }
+
+        if(s == send) { return false; }
+        if(pc == '?') {
+            if((flags & kGlobPath) && *s == '/') { return false; }
+            ++p;
+            ++s;
+            continue;
+        }
+
+        if(pc == '[' && (flags & kGlobBrackets)) {
+            const char* q = p + 1;
+            bool negate = false;
+            if(q < pend && (*q == '!' || *q == '^')) {
+                negate = true;
+                ++q;
+            }
+            const char* first = q;
+            bool matched = false;
+            char ch = nocase ? GlobLower(*s) : *s;
+            while(q < pend && (*q != ']' || q == first)) {
+                char lo = *q;
+                char hi = *q;
+                if((q + 2 < pend) && (q[1] == '-') && (q[2] != ']')) {
+                    hi = q[2];
+                    q += 3;
+                } else {
+                    ++q;
+                }
+                if(nocase) {
+                    lo = GlobLower(lo);
+                    hi = GlobLower(hi);
+                }
+                if(ch >= lo && ch <= hi) { matched = true; }
+            }
+
+            if(q < pend) {
+                if(matched == negate || ((flags & kGlobPath) && *s == '/')) { return false; }
+                p = q + 1;
+                ++s;
+                continue;
+            }
+            // No closing bracket, match the '[' literally
+        }
+
+        if(pc == '\\' && (flags & kGlobBrackets) && (p + 1 < pend)) { pc = *(++p); }
+        if(nocase ? (GlobLower(pc) != GlobLower(*s)) : (pc != *s)) { return false; }
+        ++p;
+        ++s;
+    }
+    return s == send;
+}
+
+//===------------------------------------------------------------------------------------------------------
+// Matcher
+//===------------------------------------------------------------------------------------------------------
+
+clFilesScanner::Matcher::Matcher(const wxString& spec)
+{
+    wxArrayString specArr = ::wxStringTokenize(spec.Lower(), ";,|", wxTOKEN_STRTOK);
+    for(size_t i = 0; i < specArr.size(); ++i) {
+        wxString token = specArr.Item(i);
+        token.Trim().Trim(false);
+        if(token.IsEmpty()) { continue; }
+
+        std::string pattern = token.mb_str(wxConvUTF8).data();
+        size_t wildcard = pattern.find_first_of("*?");
+        if(pattern == "*") {
+            m_matchAll = true;
+        } else if(wildcard == std::string::npos) {
+            m_exact.insert(pattern);
+        } else if(wildcard == 0 && pattern[0] == '*' && pattern.find_first_of("*?", 1) == std::string::npos) {
+            m_suffixes.push_back(pattern.substr(1));
+        } else {
+            m_patterns.push_back(pattern);
+        }
+    }
+}
+
+bool clFilesScanner::Matcher::Matches(const char* name, size_t len) const
+{
+    if(m_matchAll) { return true; }
+
+    for(size_t i = 0; i < m_suffixes.size(); ++i) {
+        const std::string& suffix = m_suffixes[i];
+        if(suffix.length() > len) { continue; }
+        const char* p = name + len - suffix.length();
+        bool match = true;
+        for(size_t j = 0; j < suffix.length() && match; ++j) {
+            match = (GlobLower(p[j]) == suffix[j]);
+        }
+        if(match) { return true; }
+    }
+
+    if(!m_exact.empty()) {
+        std::string lcname(name, len);
+        std::transform(lcname.begin(), lcname.end(), lcname.begin(), GlobLower);
+        if(m_exact.count(lcname)) { return true; }
+    }
+
+    for(size_t i = 0; i < m_patterns.size(); ++i) {
+        const std::string& pattern = m_patterns[i];
+        if(GlobMatch(pattern.c_str(), pattern.c_str() + pattern.length(), name, name + len, kGlobNoCase)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool clFilesScanner::Matcher::Matches(const wxString& name) const
+{
+    wxCharBuffer cb = name.mb_str(wxConvUTF8);
+    return Matches(cb.data(), cb.length());
+}
+
+//===------------------------------------------------------------------------------------------------------
+// IgnoreRules
+//===------------------------------------------------------------------------------------------------------
+
+void clFilesScanner::IgnoreRules::Add(const std::string& line)
+{
+    std::string pattern = line;
+    // Trailing spaces are ignored, unless escaped
+    while(!pattern.empty() && (pattern.back() == '\r' || pattern.back() == '\n' || pattern.back() == ' ') &&
+          !(pattern.length() > 1 && pattern.back() == ' ' && pattern[pattern.length() - 2] == '\\')) {
+        pattern.pop_back();
+    }
+    if(pattern.empty() || pattern[0] == '#') { return; }
+
+    Rule rule;
+    if(pattern[0] == '!') {
+        rule.negate = true;
+        pattern.erase(0, 1);
+    } else if(pattern[0] == '\\') {
+        pattern.erase(0, 1);
+    }
+
+    if(!pattern.empty() && pattern.back() == '/') {
+        rule.dirOnly = true;
+        pattern.pop_back();
+    }
+
+    if(!pattern.empty() && pattern[0] == '/') {
+        rule.anchored = true;
+        pattern.erase(0, 1);
+    } else if(pattern.find('/') != std::string::npos) {
+        rule.anchored = true;
+    }
+
+    if(pattern.empty()) { return; }
+    rule.pattern.swap(pattern);
+    m_rules.push_back(rule);
+}
+
+bool clFilesScanner::IgnoreRules::Load(const wxFileName& filename)
+{
+    std::string content;
+    if(!FileUtils::ReadFileContentRaw(filename, content)) { return false; }
+
+    size_t start = 0;
+    while(start < content.length()) {
+        size_t end = content.find('\n', start);
+        if(end == std::string::npos) { end = content.length(); }
+        Add(content.substr(start, end - start));
+        start = end + 1;
     }
+    return true;
+}
 
-    wxArrayString specArr = ::wxStringTokenize(filespec.Lower(), ";,|", wxTOKEN_STRTOK);
-    wxArrayString excludeSpecArr = ::wxStringTokenize(excludeFilespec.Lower(), ";,|", wxTOKEN_STRTOK);
-    std::queue<wxString> Q;
-    Q.push(rootFolder);
+int clFilesScanner::IgnoreRules::Match(const char* relpath, size_t len, bool isDir) const
+{
+    const char* basename = relpath + len;
+    while(basename > relpath && *(basename - 1) != '/') {
+        --basename;
+    }
 
-    while(!Q.empty()) {
-        wxString dirpath = Q.front();
-        Q.pop();
+    // The last matching rule wins
+    for(std::vector<Rule>::const_reverse_iterator iter = m_rules.rbegin(); iter != m_rules.rend(); ++iter) {
+        const Rule& rule = *iter;
+        if(rule.dirOnly && !isDir) { continue; }
 
+        const char* pstart = rule.pattern.c_str();
+        const char* pend = pstart + rule.pattern.length();
+        bool match = rule.anchored ? GlobMatch(pstart, pend, relpath, relpath + len, kGlobPath | kGlobBrackets)
+                                   : GlobMatch(pstart, pend, basename, relpath + len, kGlobPath | kGlobBrackets);
+        if(match) { return rule.negate ? -1 : 1; }
+    }
+    return 0;
+}
+
+//===------------------------------------------------------------------------------------------------------
+// The parallel crawler
+//===------------------------------------------------------------------------------------------------------
+
+struct clScanIgnoreNode {
+    std::shared_ptr<const clScanIgnoreNode> parent;
+    size_t baseLen = 0; // the length of the base folder path, including the trailing separator
+    clFilesScanner::IgnoreRules rules;
+};
+typedef std::shared_ptr<const clScanIgnoreNode> clScanIgnoreNodePtr_t;
+
+struct clScanDirTask {
+    std::string path;     // the folder to scan, with a trailing separator
+    std::string realPath; // the same folder, with symlinks resolved
+    clScanIgnoreNodePtr_t ignore;
+};
+
+struct clScanDirEntry {
+    std::string name;
+    bool isDir = false;
+    bool isLink = false;
+};
+
+/**
+ * @class clScanCrawler
+ * @brief walk a folder tree with a pool of threads. Each thread owns a queue of folders to scan: it pushes the sub
+ * folders it finds to its own queue, and steals from the other queues when it runs out of work
+ */
+class clScanCrawler
+{
+    struct Queue {
+        std::mutex lock;
+        std::deque<clScanDirTask> tasks;
+    };
+
+    const clFilesScanner::Matcher& m_spec;
+    const clFilesScanner::Matcher& m_excludeSpec;
+    std::unordered_set<std::string> m_excludeFolders;
+    size_t m_flags;
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::vector<wxString>> m_results;
+    std::atomic<size_t> m_pending; // folders queued or being scanned
+    std::atomic<size_t> m_queued;  // folders queued
+    std::atomic<size_t> m_idle;    // workers waiting for work
+    std::mutex m_idleLock;
+    std::condition_variable m_idleCond;
+
+protected:
+    static bool IsIgnored(const clScanIgnoreNode* node, const std::string& fullpath, bool isDir)
+    {
+        for(; node; node = node->parent.get()) {
+            int match = node->rules.Match(fullpath.c_str() + node->baseLen, fullpath.length() - node->baseLen, isDir);
+            if(match != 0) { return match > 0; }
+        }
+        return false;
+    }
+
+    void Push(size_t worker, clScanDirTask& task)
+    {
+        m_pending.fetch_add(1);
+        {
+            Queue& queue = *m_queues[worker];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            queue.tasks.push_back(std::move(task));
+        }
+        m_queued.fetch_add(1);
+        if(m_idle.load() > 0) {
+            std::lock_guard<std::mutex> guard(m_idleLock);
+            m_idleCond.notify_one();
+        }
+    }
+
+    void Done()
+    {
+        if(m_pending.fetch_sub(1) == 1) {
+            // The last folder was scanned: release the idle workers
+            std::lock_guard<std::mutex> guard(m_idleLock);
+            m_idleCond.notify_all();
+        }
+    }
+
+    void WaitForWork()
+    {
+        std::unique_lock<std::mutex> guard(m_idleLock);
+        m_idle.fetch_add(1);
+        m_idleCond.wait(guard, [&]() { return m_queued.load() > 0 || m_pending.load() == 0; });
+        m_idle.fetch_sub(1);
+    }
+
+    bool Pop(size_t worker, clScanDirTask& task)
+    {
+        {
+            // Depth first from our own queue
+            Queue& queue = *m_queues[worker];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if(!queue.tasks.empty()) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+                m_queued.fetch_sub(1);
+                return true;
+            }
+        }
+
+        // Steal the oldest (and usually largest) sub tree from another thread
+        for(size_t i = 1; i < m_queues.size(); ++i) {
+            Queue& queue = *m_queues[(worker + i) % m_queues.size()];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if(!queue.tasks.empty()) {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                m_queued.fetch_sub(1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool ListDir(const std::string& path, std::vector<clScanDirEntry>& entries, std::vector<char>& buffer)
+    {
+        entries.clear();
+#if defined(__linux__)
+        // getdents64() gives us the entry type without a stat() per entry
+        struct linux_dirent64 {
+            uint64_t d_ino;
+            int64_t d_off;
+            unsigned short d_reclen;
+            unsigned char d_type;
+            char d_name[1];
+        };
+
+        int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if(fd < 0) { return false; }
+        while(true) {
+            long bytes = syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+            if(bytes <= 0) { break; }
+            for(long offset = 0; offset < bytes;) {
+                const linux_dirent64* d = reinterpret_cast<const linux_dirent64*>(buffer.data() + offset);
+                offset += d->d_reclen;
+                const char* name = d->d_name;
+                if(name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))) { continue; }
+
+                clScanDirEntry entry;
+                entry.name = name;
+                if(d->d_type == DT_DIR) {
+                    entry.isDir = true;
+                } else if(d->d_type == DT_LNK || d->d_type == DT_UNKNOWN) {
+                    // Follow symlinks (and cope with file systems that don't fill d_type)
+                    struct stat st;
+                    std::string fullpath = path + entry.name;
+                    entry.isLink = (d->d_type == DT_LNK);
+                    entry.isDir = (stat(fullpath.c_str(), &st) == 0) && S_ISDIR(st.st_mode);
+                }
+                entries.push_back(entry);
+            }
+        }
+        close(fd);
+        return true;
+#else
+        wxString dirpath(path.c_str(), wxConvUTF8);
         wxDir dir(dirpath);
-        if(!dir.IsOpened()) { continue; }
+        if(!dir.IsOpened()) { return false; }
 
         wxString filename;
         bool cont = dir.GetFirst(&filename);
         while(cont) {
-            // Check to see if this is a folder
-            wxString fullpath;
-            fullpath << dir.GetNameWithSep() << filename;
-            bool isDirectory = wxFileName::DirExists(fullpath);
-            // Use FileUtils::RealPath() here to cope with symlinks on Linux
-            bool isExcludeDir = (excludeFolders.count(FileUtils::RealPath(fullpath)) || excludeFolders.count(filename));
-            if(isDirectory && !isExcludeDir) {
-                // Traverse into this folder
-                Q.push(fullpath);
-            } else if(!isDirectory && FileUtils::WildMatch(excludeSpecArr, filename)) {
-                // Do nothing
-            } else if(!isDirectory && FileUtils::WildMatch(specArr, filename)) {
-                // Include this file
-                filesOutput.push_back(fullpath);
-            }
+            clScanDirEntry entry;
+            entry.name = filename.mb_str(wxConvUTF8).data();
+            entry.isDir = wxFileName::DirExists(dirpath + filename);
+            entries.push_back(entry);
             cont = dir.GetNext(&filename);
         }
+        return true;
+#endif
     }
+
+    void ScanDir(size_t worker, const clScanDirTask& task, std::vector<clScanDirEntry>& entries,
+                 std::vector<char>& buffer)
+    {
+        if(!ListDir(task.path, entries, buffer)) { return; }
+
+        clScanIgnoreNodePtr_t ignore = task.ignore;
+        if(m_flags & clFilesScanner::kUseGitIgnore) {
+            for(size_t i = 0; i < entries.size(); ++i) {
+                if(!entries[i].isDir && entries[i].name == ".gitignore") {
+                    std::shared_ptr<clScanIgnoreNode> node(new clScanIgnoreNode());
+                    node->parent = task.ignore;
+                    node->baseLen = task.path.length();
+                    wxString gitignore(std::string(task.path + entries[i].name).c_str(), wxConvUTF8);
+                    if(node->rules.Load(wxFileName(gitignore)) && !node->rules.IsEmpty()) { ignore = node; }
+                    break;
+                }
+            }
+        }
+
+        std::vector<wxString>& results = m_results[worker];
+        for(size_t i = 0; i < entries.size(); ++i) {
+            const clScanDirEntry& entry = entries[i];
+            std::string fullpath = task.path + entry.name;
+            if(entry.isDir) {
+                if(m_excludeFolders.count(entry.name)) { continue; }
+
+                std::string realPath = task.realPath + entry.name;
+#if defined(__linux__)
+                if(entry.isLink) {
+                    char* buf = realpath(fullpath.c_str(), NULL);
+                    if(!buf) { continue; }
+                    realPath = buf;
+                    free(buf);
+
+                    // Don't follow a link to one of our parent folders
+                    std::string linkTarget = realPath + SCAN_PATH_SEP;
+                    if(task.realPath.compare(0, linkTarget.length(), linkTarget) == 0) { continue; }
+                }
+#endif
+                if(m_excludeFolders.count(realPath)) { continue; }
+                if(ignore && IsIgnored(ignore.get(), fullpath, true)) { continue; }
+
+                clScanDirTask subdir;
+                subdir.path = fullpath + SCAN_PATH_SEP;
+                subdir.realPath = realPath + SCAN_PATH_SEP;
+                subdir.ignore = ignore;
+                Push(worker, subdir);
+
+            } else if(!m_excludeSpec.Matches(entry.name.c_str(), entry.name.length()) &&
+                      m_spec.Matches(entry.name.c_str(), entry.name.length()) &&
+                      !(ignore && IsIgnored(ignore.get(), fullpath, false))) {
+                results.push_back(wxString(fullpath.c_str(), wxConvUTF8));
+            }
+        }
+    }
+
+    void WorkerMain(size_t worker)
+    {
+        std::vector<clScanDirEntry> entries;
+        std::vector<char> buffer(SCAN_DIRENT_BUFFER_SIZE);
+        clScanDirTask task;
+        while(true) {
+            if(Pop(worker, task)) {
+                ScanDir(worker, task, entries, buffer);
+                Done();
+
+            } else if(m_pending.load() == 0) {
+                // No folder left to scan, and none that can produce new work
+                break;
+
+            } else {
+                // Other workers are scanning folders, wait until they queue sub folders (or finish)
+                WaitForWork();
+            }
+        }
+    }
+
+public:
+    clScanCrawler(const clFilesScanner::Matcher& spec, const clFilesScanner::Matcher& excludeSpec,
+                  const wxStringSet_t& excludeFolders, size_t flags)
+        : m_spec(spec)
+        , m_excludeSpec(excludeSpec)
+        , m_flags(flags)
+        , m_pending(0)
+        , m_queued(0)
+        , m_idle(0)
+    {
+        std::for_each(excludeFolders.begin(), excludeFolders.end(),
+                      [&](const wxString& folder) { m_excludeFolders.insert(folder.mb_str(wxConvUTF8).data()); });
+    }
+
+    void Run(const wxString& rootFolder, const clFilesScanner::IgnoreRules* ignoreRules, size_t threads,
+             std::vector<wxString>& filesOutput)
+    {
+        clScanDirTask root;
+        root.path = rootFolder.mb_str(wxConvUTF8).data();
+        root.realPath = FileUtils::RealPath(rootFolder).mb_str(wxConvUTF8).data();
+        if(root.path.empty() || root.path.back() != SCAN_PATH_SEP) { root.path += SCAN_PATH_SEP; }
+        if(root.realPath.empty() || root.realPath.back() != SCAN_PATH_SEP) { root.realPath += SCAN_PATH_SEP; }
+        if(ignoreRules && !ignoreRules->IsEmpty()) {
+            std::shared_ptr<clScanIgnoreNode> node(new clScanIgnoreNode());
+            node->baseLen = root.path.length();
+            node->rules = *ignoreRules;
+            root.ignore = node;
+        }
+
+        m_queues.clear();
+        for(size_t i = 0; i < threads; ++i) {
+            m_queues.push_back(std::unique_ptr<Queue>(new Queue()));
+        }
+        m_results.clear();
+        m_results.resize(threads);
+        Push(0, root);
+
+        std::vector<std::thread> workers;
+        for(size_t i = 1; i < threads; ++i) {
+            workers.push_back(std::thread(&clScanCrawler::WorkerMain, this, i));
+        }
+        WorkerMain(0);
+        for(size_t i = 0; i < workers.size(); ++i) {
+            workers[i].join();
+        }
+
+        size_t count = 0;
+        for(size_t i = 0; i < m_results.size(); ++i) {
+            count += m_results[i].size();
+        }
+        filesOutput.reserve(count);
+        for(size_t i = 0; i < m_results.size(); ++i) {
+            std::move(m_results[i].begin(), m_results[i].end(), std::back_inserter(filesOutput));
+        }
+        m_results.clear();
+
+        // The workers interleave, make the output independent of the scheduling
+        std::sort(filesOutput.begin(), filesOutput.end());
+    }
+};
+
+clFilesScanner::clFilesScanner() {}
+
+clFilesScanner::~clFilesScanner() {}
+
+size_t clFilesScanner::Scan(const wxString& rootFolder, std::vector<wxString>& filesOutput, const wxString& filespec,
+                            const wxString& excludeFilespec, const wxStringSet_t& excludeFolders)
+{
+    return Scan(rootFolder, filesOutput, Matcher(filespec), Matcher(excludeFilespec), excludeFolders);
+}
+
+size_t clFilesScanner::Scan(const wxString& rootFolder, std::vector<wxString>& filesOutput, const Matcher& filespec,
+                            const Matcher& excludeFilespec, const wxStringSet_t& excludeFolders,
+                            const IgnoreRules* ignoreRules, size_t flags)
+{
+    filesOutput.clear();
+    if(!wxFileName::DirExists(rootFolder)) {
+        clDEBUG() << "clFilesScanner: No such dir:" << rootFolder << clEndl;
+        return 0;
+    }
+
+    size_t threads = m_threads;
+    if(threads == 0) { threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), MAX_SCAN_THREADS); }
+
+    clScanCrawler crawler(filespec, excludeFilespec, excludeFolders, flags);
+    crawler.Run(rootFolder, ignoreRules, threads, filesOutput);
     return filesOutput.size();
 }
 
@@ -3,7 +3,10 @@
 
 #include "codelite_exports.h"
 #include "macros.h"
+#include <string>
+#include <unordered_set>
 #include <vector>
+#include <wx/filename.h>
 #include <wx/string.h>
 
 class WXDLLIMPEXP_CL clFilesScanner
@@ -23,10 +26,70 @@ public:
         kIsSymlink = (1 << 3),
     };
 
+    enum eScanFlags {
+        kScanDefault = 0,
+        kUseGitIgnore = (1 << 0), // honour the .gitignore files found while scanning
+    };
+
+    /**
+     * @class Matcher
+     * @brief a list of file name wildcards (e.g. "*.cpp;*.h"), prepared once and matched against many names.
+     * The match is case insensitive. An empty spec matches nothing
+     */
+    class WXDLLIMPEXP_CL Matcher
+    {
+        bool m_matchAll = false;
+        std::unordered_set<std::string> m_exact;  // "Makefile"
+        std::vector<std::string> m_suffixes;      // "*.cpp" -> ".cpp"
+        std::vector<std::string> m_patterns;      // anything else
+
+    public:
+        Matcher(const wxString& spec = "");
+        bool IsEmpty() const { return !m_matchAll && m_exact.empty() && m_suffixes.empty() && m_patterns.empty(); }
+        bool Matches(const char* name, size_t len) const;
+        bool Matches(const wxString& name) const;
+    };
+
+    /**
+     * @class IgnoreRules
+     * @brief a set of .gitignore style rules: '#' comments, '!' negation, trailing '/' for folders only,
+     * patterns with a '/' are relative to the base folder, '*', '?', "[a-z]" and "**" wildcards
+     */
+    class WXDLLIMPEXP_CL IgnoreRules
+    {
+        struct Rule {
+            std::string pattern;
+            bool negate = false;
+            bool dirOnly = false;
+            bool anchored = false;
+        };
+        std::vector<Rule> m_rules;
+
+    public:
+        void Add(const std::string& line);
+        void Add(const wxString& line) { Add(std::string(line.mb_str(wxConvUTF8).data())); }
+        bool Load(const wxFileName& filename);
+        bool IsEmpty() const { return m_rules.empty(); }
+
+        /**
+         * @brief match a path, relative to the base folder and '/' separated
+         * @return 1 if the path is ignored, -1 if it is explicitly included (negated rule), 0 if no rule matched
+         */
+        int Match(const char* relpath, size_t len, bool isDir) const;
+    };
+
+protected:
+    size_t m_threads = 0;
+
 public:
     clFilesScanner();
     virtual ~clFilesScanner();
 
+    /**
+     * @brief set the number of threads used by Scan(). 0 (the default) picks one per core
+     */
+    void SetThreads(size_t threads) { this->m_threads = threads; }
+
     /**
      * @brief collect all files matching a given pattern from a root folder
      * @param rootFolder the scan root folder
@@ -38,6 +101,16 @@ public:
     size_t Scan(const wxString& rootFolder, std::vector<wxString>& filesOutput, const wxString& filespec = "*",
                 const wxString& excludeFilespec = "", const wxStringSet_t& excludeFolders = wxStringSet_t());
 
+    /**
+     * @brief same as above, with prepared matchers. The sub folders are scanned in parallel, the order of the
+     * output is not defined
+     * @param ignoreRules extra .gitignore style rules, relative to rootFolder (can be null)
+     * @param flags see eScanFlags
+     */
+    size_t Scan(const wxString& rootFolder, std::vector<wxString>& filesOutput, const Matcher& filespec,
+                const Matcher& excludeFilespec, const wxStringSet_t& excludeFolders,
+                const IgnoreRules* ignoreRules = nullptr, size_t flags = kScanDefault);
+
     /**
      * @brief scan folder for files and folders. This function does not recurse into folders. Everything that matches
      * "matchSpec" will get collected.
@@ -0,0 +1,305 @@
+#if defined(__linux__)
+
+#include "clInotifyWatcher.h"
+#include "file_logger.h"
+#include <algorithm>
+#include <chrono>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Report the changes once the file system has been quiet for this long (milliseconds)
+#define INOTIFY_QUIET_PERIOD 200
+
+// ... but don't hold a continuous stream of changes for more than this (milliseconds)
+#define INOTIFY_MAX_DELAY 1000
+
+#define INOTIFY_DIR_MASK                                                                                      \
+    (IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR | \
+     IN_EXCL_UNLINK)
+
+clInotifyWatcher::clInotifyWatcher(wxEvtHandler* sink)
+    : m_sink(sink)
+    , m_shutdown(false)
+{
+}
+
+clInotifyWatcher::~clInotifyWatcher() { Stop(); }
+
+bool clInotifyWatcher::Start(const std::vector<Root>& roots)
+{
+    Stop();
+
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(m_fd < 0) {
+        clWARNING() << "inotify_init1 failed:" << strerror(errno) << clEndl;
+        return false;
+    }
+    if(pipe2(m_wakeupPipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+        clWARNING() << "Failed to create pipe:" << strerror(errno) << clEndl;
+        close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    m_roots = roots;
+    m_shutdown.store(false);
+    m_thread = std::thread(&clInotifyWatcher::WorkerMain, this);
+    return true;
+}
+
+void clInotifyWatcher::Stop()
+{
+    if(m_thread.joinable()) {
+        m_shutdown.store(true);
+        // Wake the worker
+        char ch = 'x';
+        if(write(m_wakeupPipe[1], &ch, 1) < 0) { clWARNING() << "Failed to wake inotify thread" << clEndl; }
+        m_thread.join();
+    }
+
+    if(m_fd != -1) {
+        // Closing the descriptor removes all the watches
+        close(m_fd);
+        m_fd = -1;
+    }
+    for(int i = 0; i < 2; ++i) {
+        if(m_wakeupPipe[i] != -1) {
+            close(m_wakeupPipe[i]);
+            m_wakeupPipe[i] = -1;
+        }
+    }
+    m_watches.clear();
+    m_watchedPaths.clear();
+    m_roots.clear();
+}
+
+void clInotifyWatcher::TakeChanges(Changes_t& changes)
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    changes.swap(m_changes);
+    m_changes.clear();
+}
+
+void clInotifyWatcher::AddChange(const std::string& path, eChange change)
+{
+    // The last change wins
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_changes[path] = change;
+}
+
+bool clInotifyWatcher::IsExcluded(const Root* root, const std::string& name) const
+{
+    if(!root) { return false; }
+    for(size_t i = 0; i < root->excludeFolders.size(); ++i) {
+        if(root->excludeFolders[i] == name) { return true; }
+    }
+    return false;
+}
+
+void clInotifyWatcher::AddDirectory(const std::string& path, const Root* root, bool recursive, bool reportFiles)
+{
+    // Iterate instead of recursing, trees can be deep
+    std::vector<std::string> queue;
+    queue.push_back(path);
+    while(!queue.empty() && !m_shutdown.load()) {
+        std::string dir = queue.back();
+        queue.pop_back();
+
+        int wd = inotify_add_watch(m_fd, dir.c_str(), INOTIFY_DIR_MASK);
+        if(wd < 0) {
+            if(errno == ENOSPC) {
+                clWARNING() << "inotify watch limit reached (see /proc/sys/fs/inotify/max_user_watches)" << clEndl;
+                return;
+            }
+            continue;
+        }
+
+        // The same directory may be reached from two roots: a recursive watch wins
+        Watch& watch = m_watches[wd];
+        if(watch.path.empty() || !watch.recursive) {
+            watch.path = dir;
+            watch.recursive = recursive;
+            watch.root = root;
+        }
+        m_watchedPaths[dir] = wd;
+        if(!recursive && !reportFiles) { continue; }
+
+        DIR* dp = opendir(dir.c_str());
+        if(!dp) { continue; }
+        struct dirent* entry = nullptr;
+        while((entry = readdir(dp)) != nullptr) {
+            if(strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) { continue; }
+            std::string fullpath = dir + "/" + entry->d_name;
+
+            bool isDir = (entry->d_type == DT_DIR);
+            if(entry->d_type == DT_UNKNOWN) {
+                struct stat st;
+                isDir = (stat(fullpath.c_str(), &st) == 0) && S_ISDIR(st.st_mode);
+            }
+
+            if(isDir) {
+                if(recursive && !IsExcluded(root, entry->d_name)) { queue.push_back(fullpath); }
+            } else if(reportFiles) {
+                // Files created before we got to watch their folder
+                AddChange(fullpath, kModified);
+            }
+        }
+        closedir(dp);
+    }
+}
+
+void clInotifyWatcher::RemoveDirectory(const std::string& path)
+{
+    // A folder moved away keeps its watches (with a stale path): remove them. The IN_IGNORED events
+    // that follow clean up m_watches
+    std::string prefix = path + "/";
+    std::vector<int> wds;
+    for(std::unordered_map<std::string, int>::iterator iter = m_watchedPaths.begin(); iter != m_watchedPaths.end();
+        ++iter) {
+        if(iter->first == path || iter->first.compare(0, prefix.length(), prefix) == 0) {
+            wds.push_back(iter->second);
+        }
+    }
+    for(size_t i = 0; i < wds.size(); ++i) {
+        inotify_rm_watch(m_fd, wds[i]);
+    }
+}
+
+void clInotifyWatcher::ProcessEvents(const char* buffer, size_t len)
+{
+    size_t offset = 0;
+    while(offset + sizeof(struct inotify_event) <= len) {
+        const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+        offset += sizeof(struct inotify_event) + event->len;
+
+        if(event->mask & IN_Q_OVERFLOW) {
+            // We lost events, report the roots as modified
+            clWARNING() << "inotify queue overflow" << clEndl;
+            for(size_t i = 0; i < m_roots.size(); ++i) {
+                AddChange(m_roots[i].path, kModified);
+            }
+            continue;
+        }
+
+        std::unordered_map<int, Watch>::iterator iter = m_watches.find(event->wd);
+        if(iter == m_watches.end()) { continue; }
+
+        if(event->mask & IN_IGNORED) {
+            // The watch was removed (the folder was deleted or unmounted)
+            m_watchedPaths.erase(iter->second.path);
+            m_watches.erase(iter);
+            continue;
+        }
+
+        const Watch& watch = iter->second;
+        std::string fullpath = watch.path;
+        if(event->len && event->name[0]) {
+            fullpath += "/";
+            fullpath += event->name;
+        }
+
+        if(event->mask & IN_ISDIR) {
+            if(event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                if(watch.recursive && !IsExcluded(watch.root, event->name)) {
+                    AddDirectory(fullpath, watch.root, true, true);
+                }
+                AddChange(fullpath, kModified);
+
+            } else if(event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                if(event->mask & IN_MOVED_FROM) { RemoveDirectory(fullpath); }
+                AddChange(fullpath, kDeleted);
+            }
+
+        } else if(event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+            AddChange(fullpath, kDeleted);
+
+        } else if(event->mask & (IN_CREATE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_TO)) {
+            AddChange(fullpath, kModified);
+        }
+    }
+}
+
+void clInotifyWatcher::WorkerMain()
+{
+    for(size_t i = 0; i < m_roots.size() && !m_shutdown.load(); ++i) {
+        AddDirectory(m_roots[i].path, &m_roots[i], m_roots[i].recursive, false);
+    }
+
+    typedef std::chrono::steady_clock Clock_t;
+    Clock_t::time_point firstChange = Clock_t::now();
+    Clock_t::time_point lastChange = firstChange;
+    bool pending = false;
+    {
+        // Changes kept from before a restart (or reported while adding the watches)
+        std::lock_guard<std::mutex> guard(m_lock);
+        pending = !m_changes.empty();
+    }
+
+    // Aligned as required by struct inotify_event
+    alignas(inotify_event) char buffer[64 * 1024];
+    while(!m_shutdown.load()) {
+        int timeout = -1;
+        if(pending) {
+            Clock_t::time_point now = Clock_t::now();
+            long quiet = (long)std::chrono::duration_cast<std::chrono::milliseconds>(now - lastChange).count();
+            long held = (long)std::chrono::duration_cast<std::chrono::milliseconds>(now - firstChange).count();
+            timeout = (int)std::max(0L, std::min(INOTIFY_QUIET_PERIOD - quiet, INOTIFY_MAX_DELAY - held));
+        }
+
+        struct pollfd fds[2];
+        fds[0].fd = m_fd;
+        fds[0].events = POLLIN;
+        fds[1].fd = m_wakeupPipe[0];
+        fds[1].events = POLLIN;
+        int rc = poll(fds, 2, timeout);
+        if(rc < 0) {
+            if(errno == EINTR) { continue; }
+            clWARNING() << "inotify poll error:" << strerror(errno) << clEndl;
+            break;
+        }
+
+        if(fds[1].revents & POLLIN) {
+            // Stop() was called
+            break;
+        }
+
+        if(fds[0].revents & POLLIN) {
+            while(true) {
+                ssize_t bytes = read(m_fd, buffer, sizeof(buffer));
+                if(bytes <= 0) { break; }
+                ProcessEvents(buffer, (size_t)bytes);
+            }
+
+            bool hasChanges = false;
+            {
+                std::lock_guard<std::mutex> guard(m_lock);
+                hasChanges = !m_changes.empty();
+            }
+            if(hasChanges) {
+                lastChange = Clock_t::now();
+                if(!pending) { firstChange = lastChange; }
+                pending = true;
+            }
+        }
+
+        if(pending) {
+            // Notify the sink once the quiet period is over, or if we held the changes for too long
+            // (a continuous stream of changes never lets the file system become quiet)
+            Clock_t::time_point now = Clock_t::now();
+            long quiet = (long)std::chrono::duration_cast<std::chrono::milliseconds>(now - lastChange).count();
+            long held = (long)std::chrono::duration_cast<std::chrono::milliseconds>(now - firstChange).count();
+            if(quiet >= INOTIFY_QUIET_PERIOD || held >= INOTIFY_MAX_DELAY) {
+                pending = false;
+                if(m_sink) { m_sink->QueueEvent(new wxThreadEvent()); }
+            }
+        }
+    }
+}
+
+#endif // __linux__
@@ -0,0 +1,93 @@
+#ifndef CLINOTIFYWATCHER_H
+#define CLINOTIFYWATCHER_H
+
+#if defined(__linux__)
+
+#include "codelite_exports.h"
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <wx/event.h>
+
+/**
+ * @class clInotifyWatcher
+ * @brief a Linux file system watcher built on top of inotify(7), used by clFileSystemWatcher.
+ *
+ * The directories are watched by a worker thread, recursively when requested: sub folders created
+ * while watching are added on the fly. The changes are coalesced: the sink is notified (with a wxEVT_THREAD
+ * event) only after the file system has been quiet for a short while, so a burst of changes (e.g.
+ * a 'git checkout') is reported as a single batch. Collect the batch with TakeChanges()
+ */
+class WXDLLIMPEXP_CL clInotifyWatcher
+{
+public:
+    struct Root {
+        std::string path;
+        bool recursive = false;
+        std::vector<std::string> excludeFolders; // folder names to skip when recursing
+    };
+
+    enum eChange {
+        kModified = 0, // created, modified or moved in
+        kDeleted = 1,  // deleted or moved out
+    };
+    typedef std::map<std::string, eChange> Changes_t;
+
+protected:
+    struct Watch {
+        std::string path;
+        bool recursive = false;
+        const Root* root = nullptr;
+    };
+
+    wxEvtHandler* m_sink = nullptr;
+    int m_fd = -1;
+    int m_wakeupPipe[2] = { -1, -1 };
+    std::thread m_thread;
+    std::atomic_bool m_shutdown;
+    std::vector<Root> m_roots;
+
+    // Worker thread only
+    std::unordered_map<int, Watch> m_watches;
+    std::unordered_map<std::string, int> m_watchedPaths;
+
+    // Shared with the main thread
+    std::mutex m_lock;
+    Changes_t m_changes;
+
+protected:
+    void WorkerMain();
+    void AddDirectory(const std::string& path, const Root* root, bool recursive, bool reportFiles);
+    void RemoveDirectory(const std::string& path);
+    void ProcessEvents(const char* buffer, size_t len);
+    void AddChange(const std::string& path, eChange change);
+    bool IsExcluded(const Root* root, const std::string& name) const;
+
+public:
+    clInotifyWatcher(wxEvtHandler* sink);
+    virtual ~clInotifyWatcher();
+
+    /**
+     * @brief start watching the roots. Any previous watch is stopped
+     */
+    bool Start(const std::vector<Root>& roots);
+
+    /**
+     * @brief stop watching. The changes that were not taken yet are kept, see TakeChanges()
+     */
+    void Stop();
+
+    bool IsRunning() const { return m_thread.joinable(); }
+
+    /**
+     * @brief return the changes accumulated since the last call (path -> change)
+     */
+    void TakeChanges(Changes_t& changes);
+};
+
+#endif // __linux__
+#endif // CLINOTIFYWATCHER_H
@@ -0,0 +1,279 @@
+#include "clByteSearcher.h"
+#include "clSymbolIndex.h"
+#include "file_logger.h"
+#include <algorithm>
+#include <string.h>
+#include <unordered_set>
+#include <wx/wxsqlite3.h>
+
+namespace
+{
+std::string ToLowerUTF8(const wxString& str) { return std::string(str.Lower().mb_str(wxConvUTF8).data()); }
+
+// Binary search the first index in [0, count) for which 'get(index)' is not less than 'str'
+template <typename GetFunc> size_t LowerBound(size_t count, const char* str, GetFunc get)
+{
+    size_t lo = 0;
+    size_t hi = count;
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if(strcmp(get(mid), str) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+bool StartsWith(const char* str, const std::string& prefix) { return strncmp(str, prefix.c_str(), prefix.length()) == 0; }
+} // namespace
+
+clSymbolIndex::clSymbolIndex() {}
+
+clSymbolIndex::~clSymbolIndex() {}
+
+void clSymbolIndex::Clear()
+{
+    clSymbolIndex empty;
+    Swap(empty);
+}
+
+void clSymbolIndex::Swap(clSymbolIndex& other)
+{
+    m_entries.swap(other.m_entries);
+    m_names.swap(other.m_names);
+    m_nameOffsets.swap(other.m_nameOffsets);
+    m_nameFirstEntry.swap(other.m_nameFirstEntry);
+    m_suffixes.swap(other.m_suffixes);
+    m_paths.swap(other.m_paths);
+    m_entriesByPath.swap(other.m_entriesByPath);
+    m_fileIds.swap(other.m_fileIds);
+    m_hiddenFiles.swap(other.m_hiddenFiles);
+}
+
+void clSymbolIndex::DoAdd(long tagId, const wxString& name, const wxString& path, const wxString& file,
+                          std::unordered_map<std::string, wxUint32>& interned, std::vector<Entry>& entries,
+                          std::vector<std::string>& names)
+{
+    Entry entry;
+    entry.m_tagId = (wxUint32)tagId;
+
+    std::string lcName = ToLowerUTF8(name);
+    std::unordered_map<std::string, wxUint32>::iterator iter = interned.find(lcName);
+    if(iter == interned.end()) {
+        iter = interned.insert(std::make_pair(lcName, (wxUint32)names.size())).first;
+        names.push_back(lcName);
+    }
+    entry.m_name = iter->second;
+
+    std::unordered_map<wxString, wxUint32>::iterator fileIter = m_fileIds.find(file);
+    if(fileIter == m_fileIds.end()) {
+        fileIter = m_fileIds.insert(std::make_pair(file, (wxUint32)m_hiddenFiles.size())).first;
+        m_hiddenFiles.push_back(false);
+    }
+    entry.m_file = fileIter->second;
+
+    entry.m_path = (wxUint32)m_paths.length();
+    m_paths.append(ToLowerUTF8(path));
+    m_paths.push_back('\0');
+    entries.push_back(entry);
+}
+
+void clSymbolIndex::DoBuild(std::vector<Entry>& entries, std::vector<std::string>& names)
+{
+    // Sort the distinct names and lay them out in a single buffer
+    std::vector<wxUint32> order(names.size());
+    for(size_t i = 0; i < order.size(); ++i) {
+        order[i] = (wxUint32)i;
+    }
+    std::sort(order.begin(), order.end(), [&](wxUint32 a, wxUint32 b) { return names[a] < names[b]; });
+
+    std::vector<wxUint32> remap(names.size());
+    m_nameOffsets.reserve(names.size());
+    for(size_t i = 0; i < order.size(); ++i) {
+        remap[order[i]] = (wxUint32)i;
+        m_nameOffsets.push_back((wxUint32)m_names.length());
+        m_names.append(names[order[i]]);
+        m_names.push_back('\0');
+    }
+    names.clear();
+
+    // Sort the entries by name
+    for(size_t i = 0; i < entries.size(); ++i) {
+        entries[i].m_name = remap[entries[i].m_name];
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return (a.m_name < b.m_name) || (a.m_name == b.m_name && a.m_tagId < b.m_tagId);
+    });
+    m_entries.swap(entries);
+
+    // Name -> the range of its entries
+    m_nameFirstEntry.assign(m_nameOffsets.size() + 1, 0);
+    for(size_t i = 0; i < m_entries.size(); ++i) {
+        m_nameFirstEntry[m_entries[i].m_name + 1]++;
+    }
+    for(size_t i = 1; i < m_nameFirstEntry.size(); ++i) {
+        m_nameFirstEntry[i] += m_nameFirstEntry[i - 1];
+    }
+
+    // The suffix array
+    m_suffixes.reserve(m_names.length() - m_nameOffsets.size());
+    for(size_t i = 0; i < m_names.length(); ++i) {
+        if(m_names[i] != '\0') { m_suffixes.push_back((wxUint32)i); }
+    }
+    const char* pool = m_names.c_str();
+    std::sort(m_suffixes.begin(), m_suffixes.end(),
+              [pool](wxUint32 a, wxUint32 b) { return strcmp(pool + a, pool + b) < 0; });
+
+    // The entries in the order of their paths
+    m_entriesByPath.resize(m_entries.size());
+    for(size_t i = 0; i < m_entriesByPath.size(); ++i) {
+        m_entriesByPath[i] = (wxUint32)i;
+    }
+    std::sort(m_entriesByPath.begin(), m_entriesByPath.end(),
+              [this](wxUint32 a, wxUint32 b) { return m_entries[a].m_path < m_entries[b].m_path; });
+}
+
+bool clSymbolIndex::Load(const wxFileName& dbfile, const std::atomic_bool* cancelled, const wxStringSet_t* files)
+{
+    Clear();
+    if(!dbfile.FileExists()) { return false; }
+
+    std::unordered_map<std::string, wxUint32> interned;
+    std::vector<Entry> entries;
+    std::vector<std::string> names;
+    try {
+        wxSQLite3Database db;
+        db.Open(dbfile.GetFullPath());
+        db.SetBusyTimeout(1000);
+
+        if(files) {
+            wxSQLite3Statement st = db.PrepareStatement("select ID, name, path, file from tags where file=?");
+            for(wxStringSet_t::const_iterator iter = files->begin(); iter != files->end(); ++iter) {
+                st.Bind(1, *iter);
+                wxSQLite3ResultSet rs = st.ExecuteQuery();
+                while(rs.NextRow()) {
+                    DoAdd(rs.GetInt(0), rs.GetString(1), rs.GetString(2), rs.GetString(3), interned, entries, names);
+                }
+                rs.Finalize();
+                st.Reset();
+            }
+
+        } else {
+            wxSQLite3ResultSet rs = db.ExecuteQuery("select ID, name, path, file from tags");
+            while(rs.NextRow()) {
+                if(cancelled && cancelled->load()) {
+                    Clear();
+                    return false;
+                }
+                DoAdd(rs.GetInt(0), rs.GetString(1), rs.GetString(2), rs.GetString(3), interned, entries, names);
+            }
+            rs.Finalize();
+        }
+        db.Close();
+
+    } catch(wxSQLite3Exception& e) {
+        clWARNING() << "Failed to load symbol index from" << dbfile << ":" << e.GetMessage() << clEndl;
+        Clear();
+        return false;
+    }
+
+    interned.clear();
+    DoBuild(entries, names);
+    clDEBUG() << "Symbol index loaded:" << m_entries.size() << "symbols," << m_nameOffsets.size() << "distinct names"
+              << clEndl;
+    return true;
+}
+
+void clSymbolIndex::HideFiles(const wxStringSet_t& files)
+{
+    for(wxStringSet_t::const_iterator iter = files.begin(); iter != files.end(); ++iter) {
+        std::unordered_map<wxString, wxUint32>::const_iterator fileIter = m_fileIds.find(*iter);
+        if(fileIter != m_fileIds.end()) { m_hiddenFiles[fileIter->second] = true; }
+    }
+}
+
+void clSymbolIndex::DoAddName(wxUint32 name, size_t limit, Ids_t& ids) const
+{
+    for(wxUint32 i = m_nameFirstEntry[name]; i < m_nameFirstEntry[name + 1] && ids.size() < limit; ++i) {
+        if(!IsHidden(m_entries[i])) { ids.push_back(m_entries[i].m_tagId); }
+    }
+}
+
+size_t clSymbolIndex::FindNameByOffset(wxUint32 offset) const
+{
+    // The name that contains 'offset' is the last one that starts at or before it
+    std::vector<wxUint32>::const_iterator iter = std::upper_bound(m_nameOffsets.begin(), m_nameOffsets.end(), offset);
+    return (iter - m_nameOffsets.begin()) - 1;
+}
+
+void clSymbolIndex::FindByPrefix(const wxString& prefix, size_t limit, Ids_t& ids) const
+{
+    std::string lcPrefix = ToLowerUTF8(prefix);
+    if(lcPrefix.empty()) { return; }
+
+    size_t count = m_nameOffsets.size();
+    size_t first = LowerBound(count, lcPrefix.c_str(), [this](size_t i) { return GetName(i); });
+    for(size_t i = first; i < count && ids.size() < limit && StartsWith(GetName(i), lcPrefix); ++i) {
+        DoAddName(i, limit, ids);
+    }
+}
+
+void clSymbolIndex::FindBySubstring(const wxString& str, size_t limit, Ids_t& ids) const
+{
+    std::string lcStr = ToLowerUTF8(str);
+    if(lcStr.empty()) { return; }
+
+    const char* pool = m_names.c_str();
+    size_t count = m_suffixes.size();
+    size_t first = LowerBound(count, lcStr.c_str(), [&](size_t i) { return pool + m_suffixes[i]; });
+
+    // A name may contain the string more than once
+    std::unordered_set<size_t> visited;
+    for(size_t i = first; i < count && ids.size() < limit && StartsWith(pool + m_suffixes[i], lcStr); ++i) {
+        size_t name = FindNameByOffset(m_suffixes[i]);
+        if(visited.insert(name).second) { DoAddName(name, limit, ids); }
+    }
+}
+
+void clSymbolIndex::FindByPathParts(const wxArrayString& parts, size_t limit, Ids_t& ids) const
+{
+    if(parts.IsEmpty() || m_paths.empty()) { return; }
+
+    // Search the buffer for the longest part, and verify the others on each candidate path
+    std::vector<std::string> lcParts;
+    size_t longest = 0;
+    for(size_t i = 0; i < parts.size(); ++i) {
+        lcParts.push_back(ToLowerUTF8(parts.Item(i)));
+        if(lcParts.back().empty()) { return; }
+        if(lcParts.back().length() > lcParts[longest].length()) { longest = i; }
+    }
+
+    clByteSearcher searcher(lcParts[longest], true);
+    size_t pos = 0;
+    while(ids.size() < limit && (pos = searcher.Find(m_paths.c_str(), m_paths.length(), pos)) != std::string::npos) {
+        // Locate the entry that owns this path
+        size_t lo = 0;
+        size_t hi = m_entriesByPath.size();
+        while(hi - lo > 1) {
+            size_t mid = lo + (hi - lo) / 2;
+            if(m_entries[m_entriesByPath[mid]].m_path <= pos) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+
+        const Entry& entry = m_entries[m_entriesByPath[lo]];
+        const char* path = m_paths.c_str() + entry.m_path;
+        bool matched = true;
+        for(size_t i = 0; i < lcParts.size() && matched; ++i) {
+            matched = (i == longest) || (strstr(path, lcParts[i].c_str()) != NULL);
+        }
+        if(matched && !IsHidden(entry)) { ids.push_back(entry.m_tagId); }
+
+        // Continue from the next path
+        pos = entry.m_path + strlen(path) + 1;
+    }
+}
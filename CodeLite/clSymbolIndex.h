@@ -0,0 +1,102 @@
+#ifndef CLSYMBOLINDEX_H
+#define CLSYMBOLINDEX_H
+
+#include "codelite_exports.h"
+#include "macros.h"
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <wx/arrstr.h>
+#include <wx/filename.h>
+#include <wx/string.h>
+
+/**
+ * @class clSymbolIndex
+ * @brief an in-memory index of the symbols found in a tags database, used to answer
+ * name queries without scanning the TAGS table.
+ *
+ * The names are interned (lower case, UTF-8) and kept sorted in a single buffer, with a suffix array
+ * on top of it for substring queries. Each symbol is a small POD entry that holds the tag ID. The caller
+ * fetches the complete tags from the database by ID, and only for the matches it needs.
+ *
+ * The index is immutable once loaded, except that the symbols of a file can be hidden: when files are
+ * retagged, their symbols are hidden in the index of the whole database and a small index is loaded
+ * with the symbols of these files only (see TagsManager::UpdateSymbolIndex).
+ */
+class WXDLLIMPEXP_CL clSymbolIndex
+{
+public:
+    typedef std::vector<long> Ids_t;
+
+protected:
+    struct Entry {
+        wxUint32 m_tagId;
+        wxUint32 m_name; // index into m_nameOffsets
+        wxUint32 m_path; // offset into m_paths
+        wxUint32 m_file; // index into m_hiddenFiles
+    };
+
+    std::vector<Entry> m_entries;                      // sorted by name
+    std::string m_names;                               // the distinct names, sorted, '\0' terminated
+    std::vector<wxUint32> m_nameOffsets;               // name index -> offset in m_names
+    std::vector<wxUint32> m_nameFirstEntry;            // name index -> first entry in m_entries (+1 sentinel)
+    std::vector<wxUint32> m_suffixes;                  // every suffix of every name, sorted
+    std::string m_paths;                               // the symbols path, '\0' terminated
+    std::vector<wxUint32> m_entriesByPath;             // entry indexes, in the order of m_paths
+    std::unordered_map<wxString, wxUint32> m_fileIds;  // file -> file index
+    std::vector<bool> m_hiddenFiles;                   // file index -> are its symbols hidden?
+
+protected:
+    const char* GetName(wxUint32 name) const { return m_names.c_str() + m_nameOffsets[name]; }
+    bool IsHidden(const Entry& entry) const { return m_hiddenFiles[entry.m_file]; }
+    void DoAdd(long tagId, const wxString& name, const wxString& path, const wxString& file,
+               std::unordered_map<std::string, wxUint32>& interned, std::vector<Entry>& entries,
+               std::vector<std::string>& names);
+    void DoBuild(std::vector<Entry>& entries, std::vector<std::string>& names);
+    void DoAddName(wxUint32 name, size_t limit, Ids_t& ids) const;
+    size_t FindNameByOffset(wxUint32 offset) const;
+
+public:
+    clSymbolIndex();
+    virtual ~clSymbolIndex();
+
+    /**
+     * @brief (re)build the index from a tags database. This can take a while on large databases,
+     * call it from a worker thread
+     * @param dbfile the tags database
+     * @param cancelled when set, the build is aborted
+     * @param files when set, only the symbols of these files are loaded
+     */
+    bool Load(const wxFileName& dbfile, const std::atomic_bool* cancelled = nullptr,
+              const wxStringSet_t* files = nullptr);
+
+    /**
+     * @brief hide the symbols of 'files' from the queries
+     */
+    void HideFiles(const wxStringSet_t& files);
+
+    void Clear();
+    void Swap(clSymbolIndex& other);
+    bool IsEmpty() const { return m_entries.empty(); }
+    size_t GetCount() const { return m_entries.size(); }
+
+    // All queries are case insensitive and return at most 'limit' tag IDs
+
+    /**
+     * @brief symbols whose name starts with 'prefix'
+     */
+    void FindByPrefix(const wxString& prefix, size_t limit, Ids_t& ids) const;
+
+    /**
+     * @brief symbols whose name contains 'str'
+     */
+    void FindBySubstring(const wxString& str, size_t limit, Ids_t& ids) const;
+
+    /**
+     * @brief symbols whose path contains all of 'parts'
+     */
+    void FindByPathParts(const wxArrayString& parts, size_t limit, Ids_t& ids) const;
+};
+
+#endif // CLSYMBOLINDEX_H
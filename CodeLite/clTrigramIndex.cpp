@@ -0,0 +1,404 @@
+#include "clTrigramIndex.h"
+#include "file_logger.h"
+#include <algorithm>
+#include <iterator>
+
+// Bump this when the format of the index changes: the index is a cache, it is dropped and rebuilt
+#define INDEX_FORMAT_VERSION 3
+
+static inline unsigned char FoldByte(unsigned char ch)
+{
+    return (ch >= 'A' && ch <= 'Z') ? (unsigned char)(ch + ('a' - 'A')) : ch;
+}
+
+static inline unsigned int MakeTrigram(unsigned char c1, unsigned char c2, unsigned char c3)
+{
+    return ((unsigned int)c1 << 16) | ((unsigned int)c2 << 8) | (unsigned int)c3;
+}
+
+// The trigrams of a file are stored as a blob of 3 bytes per trigram
+static void EncodeTrigrams(const clTrigramIndex::Trigrams_t& trigrams, std::vector<unsigned char>& blob)
+{
+    blob.resize(trigrams.size() * 3);
+    for(size_t i = 0; i < trigrams.size(); ++i) {
+        blob[i * 3] = (unsigned char)(trigrams[i] >> 16);
+        blob[i * 3 + 1] = (unsigned char)(trigrams[i] >> 8);
+        blob[i * 3 + 2] = (unsigned char)trigrams[i];
+    }
+}
+
+static void DecodeTrigrams(const unsigned char* blob, size_t len, clTrigramIndex::Trigrams_t& trigrams)
+{
+    trigrams.resize(len / 3);
+    for(size_t i = 0; i < trigrams.size(); ++i) {
+        trigrams[i] = MakeTrigram(blob[i * 3], blob[i * 3 + 1], blob[i * 3 + 2]);
+    }
+}
+
+clTrigramIndex::clTrigramIndex() {}
+
+clTrigramIndex::~clTrigramIndex() { Close(); }
+
+bool clTrigramIndex::Open(const wxFileName& fileName)
+{
+    Close();
+    try {
+        m_db.Open(fileName.GetFullPath());
+        m_db.SetBusyTimeout(10);
+        CreateSchema();
+
+        wxSQLite3ResultSet res = m_db.ExecuteQuery("select id, file, last_modified, size from FILES");
+        while(res.NextRow()) {
+            FileInfo info;
+            info.id = res.GetInt64(0).GetValue();
+            info.lastModified = (time_t)res.GetInt64(2).GetValue();
+            info.size = (size_t)res.GetInt64(3).GetValue();
+            m_files.insert({ res.GetString(1), info });
+        }
+        m_fileName = fileName;
+        PurgeDeletedFiles();
+        clDEBUG() << "Search index" << m_fileName << "loaded." << m_files.size() << "files indexed";
+
+    } catch(wxSQLite3Exception& e) {
+        clWARNING() << "Failed to open search index:" << fileName << "." << e.GetMessage();
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void clTrigramIndex::Close()
+{
+    if(m_db.IsOpen()) {
+        Flush();
+        m_db.Close();
+    }
+    m_files.clear();
+    m_candidates.clear();
+    m_matchAll = true;
+    m_dirty.clear();
+    m_fileName.Clear();
+}
+
+void clTrigramIndex::CreateSchema()
+{
+    m_db.ExecuteUpdate("PRAGMA journal_mode = OFF;");
+    m_db.ExecuteUpdate("PRAGMA synchronous = OFF;");
+    m_db.ExecuteUpdate("PRAGMA temp_store = MEMORY;");
+    if(m_db.ExecuteScalar("PRAGMA user_version;") != INDEX_FORMAT_VERSION) {
+        m_db.ExecuteUpdate("drop table if exists SIGNATURES;");
+        m_db.ExecuteUpdate("drop table if exists POSTINGS;");
+        m_db.ExecuteUpdate("drop table if exists FILES;");
+        m_db.ExecuteUpdate(wxString() << "PRAGMA user_version = " << INDEX_FORMAT_VERSION << ";");
+    }
+    m_db.ExecuteUpdate("create table if not exists FILES (id integer primary key, file string unique, "
+                       "last_modified integer, size integer, trigrams blob);");
+    // The primary key keeps the posting list of a trigram sorted by file id
+    m_db.ExecuteUpdate("create table if not exists POSTINGS (trigram integer, file_id integer, "
+                       "primary key (trigram, file_id)) without rowid;");
+}
+
+void clTrigramIndex::DeleteFile(wxLongLong_t id)
+{
+    Trigrams_t trigrams;
+    {
+        wxSQLite3Statement st = m_db.PrepareStatement("select trigrams from FILES where id=?");
+        st.Bind(1, wxLongLong(id));
+        wxSQLite3ResultSet res = st.ExecuteQuery();
+        if(res.NextRow()) {
+            int len = 0;
+            const unsigned char* blob = res.GetBlob(0, len);
+            if(blob) { DecodeTrigrams(blob, (size_t)len, trigrams); }
+        }
+    }
+
+    wxSQLite3Statement st = m_db.PrepareStatement("delete from POSTINGS where trigram=? and file_id=?");
+    for(size_t i = 0; i < trigrams.size(); ++i) {
+        st.Bind(1, (int)trigrams[i]);
+        st.Bind(2, wxLongLong(id));
+        st.ExecuteUpdate();
+        st.Reset();
+    }
+
+    wxSQLite3Statement deleteFile = m_db.PrepareStatement("delete from FILES where id=?");
+    deleteFile.Bind(1, wxLongLong(id));
+    deleteFile.ExecuteUpdate();
+}
+
+void clTrigramIndex::PurgeDeletedFiles()
+{
+    std::vector<wxLongLong_t> deletedFiles;
+    std::unordered_map<wxString, FileInfo>::iterator iter = m_files.begin();
+    while(iter != m_files.end()) {
+        if(wxFileName::FileExists(iter->first)) {
+            ++iter;
+        } else {
+            deletedFiles.push_back(iter->second.id);
+            iter = m_files.erase(iter);
+        }
+    }
+    if(deletedFiles.empty()) { return; }
+
+    try {
+        m_db.Begin();
+        for(size_t i = 0; i < deletedFiles.size(); ++i) {
+            DeleteFile(deletedFiles[i]);
+        }
+        m_db.Commit();
+        clDEBUG() << "Search index:" << deletedFiles.size() << "deleted files were removed" << clEndl;
+
+    } catch(wxSQLite3Exception& e) {
+        clWARNING() << "Failed to update search index:" << m_fileName << "." << e.GetMessage();
+        try {
+            m_db.Rollback();
+        } catch(wxSQLite3Exception& rollbackError) {
+            wxUnusedVar(rollbackError);
+        }
+    }
+}
+
+void clTrigramIndex::ReadPostingList(unsigned int trigram, std::vector<wxLongLong_t>& ids)
+{
+    ids.clear();
+    wxSQLite3Statement st = m_db.PrepareStatement("select file_id from POSTINGS where trigram=? order by file_id");
+    st.Bind(1, (int)trigram);
+    wxSQLite3ResultSet res = st.ExecuteQuery();
+    while(res.NextRow()) {
+        ids.push_back(res.GetInt64(0).GetValue());
+    }
+}
+
+void clTrigramIndex::Prepare(const Query_t& query)
+{
+    m_candidates.clear();
+    m_matchAll = query.empty();
+    if(m_matchAll || !m_db.IsOpen()) { return; }
+
+    // Intersect the posting lists of the query trigrams. The lists are sorted by file id
+    std::vector<wxLongLong_t> candidates;
+    std::vector<wxLongLong_t> postings;
+    std::vector<wxLongLong_t> intersection;
+    try {
+        for(size_t i = 0; i < query.size(); ++i) {
+            ReadPostingList(query[i], postings);
+            if(i == 0) {
+                candidates.swap(postings);
+            } else {
+                intersection.clear();
+                std::set_intersection(candidates.begin(), candidates.end(), postings.begin(), postings.end(),
+                                      std::back_inserter(intersection));
+                candidates.swap(intersection);
+            }
+            if(candidates.empty()) { break; }
+        }
+    } catch(wxSQLite3Exception& e) {
+        // Can't tell which files are candidates: don't skip any
+        clWARNING() << "Failed to query search index:" << m_fileName << "." << e.GetMessage();
+        m_matchAll = true;
+        return;
+    }
+    m_candidates.insert(candidates.begin(), candidates.end());
+}
+
+clTrigramIndex::eMatch clTrigramIndex::Match(const wxString& file, time_t lastModified, size_t size) const
+{
+    std::unordered_map<wxString, FileInfo>::const_iterator iter = m_files.find(file);
+    if(iter == m_files.end() || iter->second.lastModified != lastModified || iter->second.size != size) {
+        return kNotIndexed;
+    }
+    if(m_matchAll || m_candidates.count(iter->second.id)) { return kCandidate; }
+    return kNoMatch;
+}
+
+void clTrigramIndex::Update(const wxString& file, const Entry& entry) { m_dirty.push_back({ file, entry }); }
+
+void clTrigramIndex::Flush()
+{
+    if(m_dirty.empty() || !m_db.IsOpen()) { return; }
+    try {
+        m_db.Begin();
+        wxSQLite3Statement insertFile =
+            m_db.PrepareStatement("insert into FILES (file, last_modified, size, trigrams) values (?, ?, ?, ?)");
+        wxSQLite3Statement insertPosting = m_db.PrepareStatement("insert into POSTINGS (trigram, file_id) values (?, ?)");
+        std::vector<unsigned char> blob;
+        for(size_t i = 0; i < m_dirty.size(); ++i) {
+            const wxString& file = m_dirty[i].first;
+            const Entry& entry = m_dirty[i].second;
+
+            // Remove the previous version of the file from the posting lists
+            std::unordered_map<wxString, FileInfo>::iterator iter = m_files.find(file);
+            if(iter != m_files.end()) {
+                DeleteFile(iter->second.id);
+                m_files.erase(iter);
+            }
+
+            EncodeTrigrams(entry.trigrams, blob);
+            insertFile.Bind(1, file);
+            insertFile.Bind(2, wxLongLong((wxLongLong_t)entry.lastModified));
+            insertFile.Bind(3, wxLongLong((wxLongLong_t)entry.size));
+            insertFile.Bind(4, blob.data(), (int)blob.size());
+            insertFile.ExecuteUpdate();
+            insertFile.Reset();
+
+            FileInfo info;
+            info.id = m_db.GetLastRowId().GetValue();
+            info.lastModified = entry.lastModified;
+            info.size = entry.size;
+            for(size_t n = 0; n < entry.trigrams.size(); ++n) {
+                insertPosting.Bind(1, (int)entry.trigrams[n]);
+                insertPosting.Bind(2, wxLongLong(info.id));
+                insertPosting.ExecuteUpdate();
+                insertPosting.Reset();
+            }
+            m_files[file] = info;
+        }
+        m_db.Commit();
+
+    } catch(wxSQLite3Exception& e) {
+        clWARNING() << "Failed to update search index:" << m_fileName << "." << e.GetMessage();
+        try {
+            m_db.Rollback();
+        } catch(wxSQLite3Exception& rollbackError) {
+            wxUnusedVar(rollbackError);
+        }
+        // The memory no longer reflects the database: reload it on the next search
+        m_files.clear();
+        m_fileName.Clear();
+        m_db.Close();
+    }
+    m_dirty.clear();
+}
+
+void clTrigramIndex::CollectTrigrams(const char* buffer, size_t len, Trigrams_t& trigrams)
+{
+    trigrams.clear();
+    if(len < 3) { return; }
+
+    const unsigned char* p = (const unsigned char*)buffer;
+    trigrams.reserve(len - 2);
+    unsigned char c1 = FoldByte(p[0]);
+    unsigned char c2 = FoldByte(p[1]);
+    for(size_t i = 2; i < len; ++i) {
+        unsigned char c3 = FoldByte(p[i]);
+        trigrams.push_back(MakeTrigram(c1, c2, c3));
+        c1 = c2;
+        c2 = c3;
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+}
+
+void clTrigramIndex::CreateQuery(const wxArrayString& literals, Query_t& query)
+{
+    query.clear();
+    for(size_t i = 0; i < literals.size(); ++i) {
+        const wxString& literal = literals.Item(i);
+        if(literal.length() < 3 || !literal.IsAscii()) { continue; }
+
+        std::string str = literal.ToStdString();
+        for(size_t n = 2; n < str.length(); ++n) {
+            query.push_back(MakeTrigram(FoldByte(str[n - 2]), FoldByte(str[n - 1]), FoldByte(str[n])));
+        }
+    }
+    std::sort(query.begin(), query.end());
+    query.erase(std::unique(query.begin(), query.end()), query.end());
+}
+
+void clTrigramIndex::GetRegexLiterals(const wxString& expr, wxArrayString& literals)
+{
+    literals.clear();
+
+    // Alternation means that none of the literals is mandatory
+    if(expr.Find('|') != wxNOT_FOUND) { return; }
+
+    wxString current;
+    int depth = 0;
+    bool lastIsLiteral = false;
+    auto flush = [&]() {
+        if(current.length() >= 3) { literals.Add(current); }
+        current.clear();
+    };
+
+    size_t i = 0;
+    while(i < expr.length()) {
+        wxChar ch = expr[i];
+        switch(ch) {
+        case '\\': {
+            // escaped punctuation is a literal character, anything else is a
+            // character class, a back reference or an assertion
+            wxChar next = ((i + 1) < expr.length()) ? (wxChar)expr[i + 1] : 0;
+            if(next && next < 128 && !wxIsalnum(next)) {
+                if(depth == 0) {
+                    current << next;
+                    lastIsLiteral = true;
+                } else {
+                    flush();
+                    lastIsLiteral = false;
+                }
+            } else {
+                flush();
+                lastIsLiteral = false;
+            }
+            i += 2;
+        } break;
+        case '*':
+        case '?':
+        case '{':
+        case '+':
+            // the quantifier applies to the previous atom
+            if(ch != '+' && lastIsLiteral && !current.IsEmpty()) { current.RemoveLast(); }
+            flush();
+            lastIsLiteral = false;
+            if(ch == '{') {
+                while(i < expr.length() && expr[i] != '}') {
+                    ++i;
+                }
+            }
+            ++i;
+            // lazy quantifier
+            if(i < expr.length() && expr[i] == '?') { ++i; }
+            break;
+        case '[': {
+            flush();
+            lastIsLiteral = false;
+            ++i;
+            if(i < expr.length() && expr[i] == '^') { ++i; }
+            if(i < expr.length() && expr[i] == ']') { ++i; }
+            while(i < expr.length() && expr[i] != ']') {
+                ++i;
+            }
+            ++i;
+        } break;
+        case '(':
+            flush();
+            lastIsLiteral = false;
+            ++depth;
+            ++i;
+            break;
+        case ')':
+            flush();
+            lastIsLiteral = false;
+            --depth;
+            ++i;
+            break;
+        case '.':
+        case '^':
+        case '$':
+            flush();
+            lastIsLiteral = false;
+            ++i;
+            break;
+        default:
+            if(depth == 0 && ch < 128) {
+                current << ch;
+                lastIsLiteral = true;
+            } else {
+                flush();
+                lastIsLiteral = false;
+            }
+            ++i;
+            break;
+        }
+    }
+    flush();
+}
@@ -0,0 +1,135 @@
+#ifndef CLTRIGRAMINDEX_H
+#define CLTRIGRAMINDEX_H
+
+#include "codelite_exports.h"
+#include "wxStringHash.h"
+#include <time.h>
+#include <unordered_set>
+#include <vector>
+#include <wx/arrstr.h>
+#include <wx/filename.h>
+#include <wx/string.h>
+#include <wx/wxsqlite3.h>
+
+/**
+ * @class clTrigramIndex
+ * @brief a persistent trigram index used to narrow the list of files that need to be scanned by the "Find in Files"
+ *
+ * For every (ASCII case folded) byte trigram, the index keeps the list of the files that contain it (its posting
+ * list). A file can only contain a string if it appears in the posting lists of all the trigrams of that string, so
+ * a query only reads the posting lists of its own trigrams and never visits the other files. Only the modification
+ * time and the size of the indexed files are kept in memory. Entries whose modification time or size does not match
+ * the file on the disk are considered as not indexed. Since the modification time has a one second resolution, an
+ * edit that keeps the size of a file and is made within the second it was indexed goes unnoticed until the file is
+ * modified again.
+ *
+ * Database tables:
+ *
+ * Table Name: FILES
+ *
+ * || Column Name   || Type   || Description
+ * | id             | Number | The file id, used by the posting lists
+ * | file           | String | Full path of the file
+ * | last_modified  | Number | The file modification time when the file was indexed
+ * | size           | Number | The file size when the file was indexed
+ * | trigrams       | Blob   | The trigrams of the file (3 bytes each), used to remove the file from the posting lists
+ *
+ * Table Name: POSTINGS
+ *
+ * || Column Name   || Type   || Description
+ * | trigram        | Number | The trigram
+ * | file_id        | Number | The id of a file that contains the trigram
+ */
+class WXDLLIMPEXP_CL clTrigramIndex
+{
+public:
+    typedef std::vector<unsigned int> Trigrams_t;
+    typedef std::vector<unsigned int> Query_t;
+
+    struct Entry {
+        time_t lastModified = 0;
+        size_t size = 0;
+        Trigrams_t trigrams;
+    };
+    typedef std::vector<std::pair<wxString, Entry> > Vec_t;
+
+    enum eMatch {
+        kNotIndexed = 0,
+        kNoMatch,
+        kCandidate,
+    };
+
+protected:
+    struct FileInfo {
+        wxLongLong_t id = 0;
+        time_t lastModified = 0;
+        size_t size = 0;
+    };
+
+    wxSQLite3Database m_db;
+    wxFileName m_fileName;
+    std::unordered_map<wxString, FileInfo> m_files;
+    std::unordered_set<wxLongLong_t> m_candidates;
+    bool m_matchAll = true;
+    Vec_t m_dirty;
+
+protected:
+    void CreateSchema();
+    void PurgeDeletedFiles();
+    void DeleteFile(wxLongLong_t id);
+    void ReadPostingList(unsigned int trigram, std::vector<wxLongLong_t>& ids);
+
+public:
+    clTrigramIndex();
+    virtual ~clTrigramIndex();
+
+    /**
+     * @brief open (or create) the index file. The entries of the files that no longer exist are removed
+     */
+    bool Open(const wxFileName& fileName);
+    void Close();
+    bool IsOpen() const { return m_fileName.IsOk(); }
+    const wxFileName& GetFileName() const { return m_fileName; }
+
+    /**
+     * @brief read the posting lists of the trigrams of 'query' and keep the files found in all of them as
+     * the candidates returned by Match(). An empty query makes every indexed file a candidate
+     */
+    void Prepare(const Query_t& query);
+
+    /**
+     * @brief check if 'file' may contain the strings of the query passed to Prepare()
+     * @param lastModified the current modification time of the file
+     * @param size the current size of the file
+     */
+    eMatch Match(const wxString& file, time_t lastModified, size_t size) const;
+
+    /**
+     * @brief update the entry for 'file'. The change is kept in memory until Flush() is called
+     */
+    void Update(const wxString& file, const Entry& entry);
+
+    /**
+     * @brief write all pending updates to the disk
+     */
+    void Flush();
+
+    /**
+     * @brief collect the sorted list of the distinct trigrams of a raw buffer
+     */
+    static void CollectTrigrams(const char* buffer, size_t len, Trigrams_t& trigrams);
+
+    /**
+     * @brief build a query from a list of ASCII strings that must all exist in a file. Strings shorter than
+     * 3 bytes are ignored. An empty query matches every indexed file
+     */
+    static void CreateQuery(const wxArrayString& literals, Query_t& query);
+
+    /**
+     * @brief collect the literal strings that any match of the regular expression must contain.
+     * This is conservative: when the expression can not be reasoned about, nothing is returned
+     */
+    static void GetRegexLiterals(const wxString& expr, wxArrayString& literals);
+};
+
+#endif // CLTRIGRAMINDEX_H
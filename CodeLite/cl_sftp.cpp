@@ -31,6 +31,23 @@
 #include <wx/filefn.h>
 #include <libssh/sftp.h>
 #include "cl_standard_paths.h"
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <vector>
+
+// Size of a single read / write request
+#define SFTP_CHUNK_SIZE 32768
+
+// Max number of read / write requests in flight for a single file
+#define SFTP_MAX_PENDING_REQUESTS 16
+
+// libssh 0.11 comes with an asynchronous write API
+#if defined(LIBSSH_VERSION_INT) && LIBSSH_VERSION_INT >= SSH_VERSION_INT(0, 11, 0)
+#define SFTP_HAS_AIO 1
+#else
+#define SFTP_HAS_AIO 0
+#endif
 
 class SFTPDirCloser
 {
@@ -44,6 +61,23 @@ public:
     ~SFTPDirCloser() { sftp_closedir(m_dir); }
 };
 
+class SFTPFileCloser
+{
+    sftp_file m_file;
+
+public:
+    SFTPFileCloser(sftp_file f)
+        : m_file(f)
+    {
+    }
+    ~SFTPFileCloser() { Close(); }
+    void Close()
+    {
+        if(m_file) { sftp_close(m_file); }
+        m_file = NULL;
+    }
+};
+
 clSFTP::clSFTP(clSSH::Ptr_t ssh)
     : m_ssh(ssh)
     , m_sftp(NULL)
@@ -55,8 +89,11 @@ clSFTP::~clSFTP() { Close(); }
 
 /**
  * @brief update 'attr' to include details about the symlink
+ * @param targets the type of the targets already stat-ed (wxNOT_FOUND if the stat failed), the links of a folder
+ * often point to the same place
  */
-static void clSFTPReadLink(SFTPAttribute::Ptr_t attr, SFTPSession_t sftp, const wxString& curdir)
+static void clSFTPReadLink(SFTPAttribute::Ptr_t attr, SFTPSession_t sftp, const wxString& curdir,
+                           std::map<wxString, int>& targets)
 {
     if(!attr->IsSymlink()) { return; }
     // build the symlink full path and read the target path
@@ -70,12 +107,19 @@ static void clSFTPReadLink(SFTPAttribute::Ptr_t attr, SFTPSession_t sftp, const
             targetPath.Replace("//", "/");
         }
         attr->SetSymlinkPath(targetPath);
-        sftp_attributes linkattr = sftp_stat(sftp, targetPath.mb_str(wxConvUTF8).data());
-        if(linkattr) {
-            SFTPAttribute::Ptr_t targetAttr(new SFTPAttribute(linkattr));
-            if(targetAttr->IsFile()) { attr->SetFile(); }
-            if(targetAttr->IsFolder()) { attr->SetFolder(); }
+        std::map<wxString, int>::iterator iter = targets.find(targetPath);
+        if(iter == targets.end()) {
+            int targetType = wxNOT_FOUND;
+            sftp_attributes linkattr = sftp_stat(sftp, targetPath.mb_str(wxConvUTF8).data());
+            if(linkattr) {
+                SFTPAttribute::Ptr_t targetAttr(new SFTPAttribute(linkattr));
+                if(targetAttr->IsFile()) { targetType = SFTPAttribute::TYPE_REGULAR_FILE; }
+                if(targetAttr->IsFolder()) { targetType = SFTPAttribute::TYPE_FOLDER; }
+            }
+            iter = targets.insert(std::make_pair(targetPath, targetType)).first;
         }
+        if(iter->second == SFTPAttribute::TYPE_REGULAR_FILE) { attr->SetFile(); }
+        if(iter->second == SFTPAttribute::TYPE_FOLDER) { attr->SetFolder(); }
     }
 }
 
@@ -118,13 +162,20 @@ void clSFTP::Write(const wxFileName& localFile, const wxString& remotePath, SFTP
                                      << ::strerror(errno));
     }
 
-    char buffer[4096];
     wxMemoryBuffer memBuffer;
-    size_t nbytes(0);
-    while(!fp.Eof()) {
-        nbytes = fp.Read(buffer, sizeof(buffer));
-        if(nbytes == 0) break;
-        memBuffer.AppendData(buffer, nbytes);
+    wxFileOffset fileSize = fp.Length();
+    if(fileSize == wxInvalidOffset) {
+        throw clException(wxString() << "scp::Write could not get the size of file '" << localFile.GetFullPath()
+                                     << "'");
+    }
+    if(fileSize > 0) {
+        size_t nbytes = fp.Read(memBuffer.GetWriteBuf(fileSize), fileSize);
+        if(nbytes == (size_t)wxInvalidOffset || nbytes != (size_t)fileSize || fp.Error()) {
+            // Don't upload a truncated file
+            memBuffer.UngetWriteBuf(0);
+            throw clException(wxString() << "scp::Write failed to read file '" << localFile.GetFullPath() << "'");
+        }
+        memBuffer.UngetWriteBuf(nbytes);
     }
     fp.Close();
     Write(memBuffer, remotePath);
@@ -147,23 +198,69 @@ void clSFTP::Write(const wxMemoryBuffer& fileContent, const wxString& remotePath
                           sftp_get_error(m_sftp));
     }
 
-    char* p = (char*)fileContent.GetData();
-    const int maxChunkSize = 65536;
-    wxInt64 bytesLeft = fileContent.GetDataLen();
-
-    while(bytesLeft > 0) {
-        wxInt64 chunkSize = bytesLeft > maxChunkSize ? maxChunkSize : bytesLeft;
-        wxInt64 bytesWritten = sftp_write(file, p, chunkSize);
-        if(bytesWritten < 0) {
-            sftp_close(file);
-            throw clException(wxString() << _("Can't write data to file: ") << tmpRemoteFile << ". "
-                                         << ssh_get_error(m_ssh->GetSession()),
-                              sftp_get_error(m_sftp));
+    SFTPFileCloser closer(file);
+    const char* p = (const char*)fileContent.GetData();
+    wxInt64 fileSize = fileContent.GetDataLen();
+    wxInt64 bytesWritten = 0;
+    bool cancelled = false;
+    bool failed = false;
+
+#if SFTP_HAS_AIO
+    // Keep several write requests in flight: waiting for each chunk to be acknowledged before sending the next
+    // one limits the throughput to a chunk per round trip
+    std::deque<sftp_aio> pending;
+    wxInt64 bytesSent = 0;
+    while(bytesWritten < fileSize && !cancelled && !failed) {
+        while(pending.size() < SFTP_MAX_PENDING_REQUESTS && bytesSent < fileSize) {
+            size_t len = (size_t)std::min<wxInt64>(SFTP_CHUNK_SIZE, fileSize - bytesSent);
+            sftp_aio aio = NULL;
+            if(sftp_aio_begin_write(file, p + bytesSent, len, &aio) < 0) {
+                failed = true;
+                break;
+            }
+            pending.push_back(aio);
+            bytesSent += len;
         }
-        bytesLeft -= bytesWritten;
-        p += bytesWritten;
+        if(failed || pending.empty()) { break; }
+
+        sftp_aio aio = pending.front();
+        pending.pop_front();
+        ssize_t nbytes = sftp_aio_wait_write(&aio);
+        if(nbytes < 0) {
+            failed = true;
+            break;
+        }
+        bytesWritten += nbytes;
+        cancelled = !DoReportProgress(bytesWritten, fileSize);
+    }
+    for(size_t i = 0; i < pending.size(); ++i) {
+        sftp_aio_free(pending[i]);
+    }
+#else
+    while(bytesWritten < fileSize && !cancelled) {
+        size_t len = (size_t)std::min<wxInt64>(SFTP_CHUNK_SIZE * SFTP_MAX_PENDING_REQUESTS, fileSize - bytesWritten);
+        ssize_t nbytes = sftp_write(file, p + bytesWritten, len);
+        if(nbytes < 0) {
+            failed = true;
+            break;
+        }
+        bytesWritten += nbytes;
+        cancelled = !DoReportProgress(bytesWritten, fileSize);
+    }
+#endif
+
+    if(failed) {
+        throw clException(wxString() << _("Can't write data to file: ") << tmpRemoteFile << ". "
+                                     << ssh_get_error(m_ssh->GetSession()),
+                          sftp_get_error(m_sftp));
+    }
+    closer.Close();
+
+    if(cancelled) {
+        // Don't leave the partial file behind
+        sftp_unlink(m_sftp, tmpRemoteFile.mb_str(wxConvUTF8).data());
+        throw clException(wxString() << _("Transfer cancelled: ") << remotePath);
     }
-    sftp_close(file);
 
     // Unlink the original file if it exists
     bool needUnlink = false;
@@ -213,11 +310,18 @@ SFTPAttribute::List_t clSFTP::List(const wxString& folder, size_t flags, const w
     SFTPDirCloser dc(dir);
     SFTPAttribute::List_t files;
 
+    // Read the whole folder first and resolve the symlinks afterwards, once per target
+    std::vector<SFTPAttribute::Ptr_t> entries;
     attributes = sftp_readdir(m_sftp, dir);
     while(attributes) {
-        SFTPAttribute::Ptr_t attr(new SFTPAttribute(attributes));
-        if(attr->IsSymlink()) { clSFTPReadLink(attr, m_sftp, m_currentFolder); }
+        entries.push_back(SFTPAttribute::Ptr_t(new SFTPAttribute(attributes)));
         attributes = sftp_readdir(m_sftp, dir);
+    }
+
+    std::map<wxString, int> targets;
+    for(size_t i = 0; i < entries.size(); ++i) {
+        SFTPAttribute::Ptr_t attr = entries[i];
+        if(attr->IsSymlink()) { clSFTPReadLink(attr, m_sftp, m_currentFolder, targets); }
 
         // Don't show files ?
         if(!(flags & SFTP_BROWSE_FILES) && !attr->IsFolder()) {
@@ -259,6 +363,7 @@ SFTPAttribute::Ptr_t clSFTP::Read(const wxString& remotePath, wxMemoryBuffer& bu
                                      << ssh_get_error(m_ssh->GetSession()),
                           sftp_get_error(m_sftp));
     }
+    SFTPFileCloser closer(file);
 
     SFTPAttribute::Ptr_t fileAttr = Stat(remotePath);
     if(!fileAttr) {
@@ -269,27 +374,61 @@ SFTPAttribute::Ptr_t clSFTP::Read(const wxString& remotePath, wxMemoryBuffer& bu
     wxInt64 fileSize = fileAttr->GetSize();
     if(fileSize == 0) return fileAttr;
 
-    // Allocate buffer for the file content
-    char pBuffer[65536]; // buffer
-
-    // Read the entire file content
-    wxInt64 bytesLeft = fileSize;
+    // Keep several read requests in flight: waiting for each chunk before asking for the next one limits the
+    // throughput to a chunk per round trip. The replies are consumed in the order the requests were sent
+    std::deque<std::pair<int, wxInt64> > pending; // request id + length
+    char pBuffer[SFTP_CHUNK_SIZE];
+    wxInt64 bytesRequested = 0;
     wxInt64 bytesRead = 0;
-    while(bytesLeft > 0) {
-        wxInt64 nbytes = sftp_read(file, pBuffer, sizeof(pBuffer));
-        bytesRead += nbytes;
-        bytesLeft -= nbytes;
+    bool failed = false;
+    bool cancelled = false;
+    while(bytesRead < fileSize && !failed && !cancelled) {
+        while(pending.size() < SFTP_MAX_PENDING_REQUESTS && bytesRequested < fileSize) {
+            wxInt64 len = std::min<wxInt64>(SFTP_CHUNK_SIZE, fileSize - bytesRequested);
+            int id = sftp_async_read_begin(file, (uint32_t)len);
+            if(id < 0) {
+                failed = true;
+                break;
+            }
+            pending.push_back(std::make_pair(id, len));
+            bytesRequested += len;
+        }
+        if(failed || pending.empty()) { break; }
+
+        std::pair<int, wxInt64> request = pending.front();
+        pending.pop_front();
+        int nbytes = sftp_async_read(file, pBuffer, sizeof(pBuffer), request.first);
+        if(nbytes <= 0) {
+            // error, or the file was truncated while we were reading it
+            failed = (nbytes < 0);
+            break;
+        }
         buffer.AppendData(pBuffer, nbytes);
+        bytesRead += nbytes;
+
+        if(nbytes < request.second && !pending.empty()) {
+            // A short read: the data of the pending requests does not follow. Drop them and continue from here
+            for(size_t i = 0; i < pending.size(); ++i) {
+                sftp_async_read(file, pBuffer, sizeof(pBuffer), pending[i].first);
+            }
+            pending.clear();
+            sftp_seek64(file, bytesRead);
+            bytesRequested = bytesRead;
+        }
+        cancelled = !DoReportProgress(bytesRead, fileSize);
+    }
+
+    if(cancelled) {
+        buffer.Clear();
+        throw clException(wxString() << _("Transfer cancelled: ") << remotePath);
     }
 
     if(bytesRead != fileSize) {
-        sftp_close(file);
         buffer.Clear();
         throw clException(wxString() << _("Could not read file:") << remotePath << ". "
                                      << ssh_get_error(m_ssh->GetSession()),
                           sftp_get_error(m_sftp));
     }
-    sftp_close(file);
     return fileAttr;
 }
 
@@ -426,6 +565,12 @@ void clSFTP::Chmod(const wxString& remotePath, size_t permissions)
     }
 }
 
+bool clSFTP::DoReportProgress(wxInt64 transferred, wxInt64 total)
+{
+    if(!m_progressCallback) { return true; }
+    return m_progressCallback(transferred, total);
+}
+
 wxString clSFTP::GetDefaultDownloadFolder()
 {
     wxFileName path(clStandardPaths::Get().GetUserDataDir(), "");
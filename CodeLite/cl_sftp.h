@@ -33,6 +33,7 @@
 #include <wx/filename.h>
 #include "codelite_exports.h"
 #include "cl_sftp_attribute.h"
+#include <functional>
 #include <wx/buffer.h>
 
 // We do it this way to avoid exposing the include to <libssh/sftp.h> to files including this header
@@ -41,11 +42,23 @@ typedef struct sftp_session_struct* SFTPSession_t;
 
 class WXDLLIMPEXP_CL clSFTP
 {
+public:
+    /**
+     * @brief called while a file is read or written with the number of bytes transferred so far and the file size.
+     * Returning false cancels the transfer
+     */
+    typedef std::function<bool(wxInt64, wxInt64)> ProgressCallback_t;
+
+protected:
     clSSH::Ptr_t m_ssh;
     SFTPSession_t m_sftp;
     bool m_connected;
     wxString m_currentFolder;
     wxString m_account;
+    ProgressCallback_t m_progressCallback;
+
+protected:
+    bool DoReportProgress(wxInt64 transferred, wxInt64 total);
 
 public:
     typedef wxSharedPtr<clSFTP> Ptr_t;
@@ -71,6 +84,7 @@ public:
     bool IsConnected() const { return m_connected; }
 
     void SetAccount(const wxString& account) { this->m_account = account; }
+    void SetProgressCallback(const ProgressCallback_t& progressCallback) { this->m_progressCallback = progressCallback; }
     const wxString& GetAccount() const { return m_account; }
     /**
      * @brief intialize the scp over ssh
@@ -92,14 +106,16 @@ public:
                SFTPAttribute::Ptr_t attributes = SFTPAttribute::Ptr_t(NULL)) ;
 
     /**
-     * @brief write the content of 'fileContent' into the remote file represented by remotePath
+     * @brief write the content of 'fileContent' into the remote file represented by remotePath.
+     * Several write requests are kept in flight (when libssh supports it) so the transfer is not bound by the latency
      */
     void Write(const wxMemoryBuffer& fileContent,
                const wxString& remotePath,
                SFTPAttribute::Ptr_t attributes = SFTPAttribute::Ptr_t(NULL)) ;
 
     /**
-     * @brief read remote file and return its content
+     * @brief read remote file and return its content. Several read requests are kept in flight so the transfer is
+     * not bound by the latency
      * @return the file content + the file attributes
      */
     SFTPAttribute::Ptr_t Read(const wxString& remotePath, wxMemoryBuffer& buffer) ;
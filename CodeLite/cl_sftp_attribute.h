@@ -44,6 +44,7 @@ class WXDLLIMPEXP_CL SFTPAttribute : public wxClientData
     size_t m_size;
     SFTPAttribute_t m_attributes;
     size_t m_permissions;
+    size_t m_modificationTime;
     wxString m_symlinkPath; // incase this file represents a symlink, this member will hold the target path
 
 public:
@@ -87,6 +88,7 @@ public:
     bool IsSpecial() const { return m_flags & TYPE_SEPCIAL; }
     void SetPermissions(size_t permissions) { this->m_permissions = permissions; }
     size_t GetPermissions() const { return m_permissions; }
+    size_t GetModificationTime() const { return m_modificationTime; }
 
     void SetSymlinkPath(const wxString& symlinkPath) { this->m_symlinkPath = symlinkPath; }
     const wxString& GetSymlinkPath() const { return m_symlinkPath; }
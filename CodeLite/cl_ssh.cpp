@@ -127,6 +127,12 @@ void clSSH::Connect(int seconds)
     ssh_set_blocking(m_session, 1);
 }
 
+void clSSH::SetTimeout(long seconds)
+{
+    if(!m_session) { return; }
+    ssh_options_set(m_session, SSH_OPTIONS_TIMEOUT, &seconds);
+}
+
 bool clSSH::AuthenticateServer(wxString& message)
 {
     int state;
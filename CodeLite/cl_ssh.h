@@ -85,6 +85,11 @@ public:
      */
     void Connect(int seconds = 10) ;
 
+    /**
+     * @brief set the number of seconds a blocking call on the session waits for the server before it fails
+     */
+    void SetTimeout(long seconds);
+
     /**
      * @brief authenticate the server
      * @param [output] message in case the authentication failed, prompt the user with the message
@@ -34,22 +34,27 @@
 CppWordScanner::CppWordScanner(const wxString& fileName)
     : m_filename(fileName)
     , m_offset(0)
+{
+    ReadFile(m_filename, m_text);
+    doInit();
+}
+
+void CppWordScanner::ReadFile(const wxString& fileName, wxString& text)
 {
     // disable log
     wxLogNull nolog;
     wxCSConv fontEncConv(wxFONTENCODING_ISO8859_1);
 
-    wxFFile thefile(m_filename, wxT("rb"));
+    text.Clear();
+    wxFFile thefile(fileName, wxT("rb"));
     if(thefile.IsOpened()) {
-        m_text.Clear();
-        thefile.ReadAll(&m_text, fontEncConv);
-        if(m_text.IsEmpty()) {
+        thefile.ReadAll(&text, fontEncConv);
+        if(text.IsEmpty()) {
             // Try another converter
             fontEncConv = wxFONTENCODING_UTF8;
-            thefile.ReadAll(&m_text, fontEncConv);
+            thefile.ReadAll(&text, fontEncConv);
         }
     }
-    doInit();
 }
 
 CppWordScanner::CppWordScanner(const wxString& fileName, const wxString& text, int offset)
@@ -85,6 +85,50 @@ public:
 
 typedef SmartPtr<TextStates> TextStatesPtr;
 
+/**
+ * @brief an identifier occurrence, as read from the identifiers index
+ */
+struct WXDLLIMPEXP_CL CppIdentifier {
+    wxString name;
+    wxString filename;
+    int offset = 0;
+    int line = 0;  // 1 based
+    int state = 0; // the lexical context: one of the CppWordScanner::STATE_* values
+
+    typedef std::vector<CppIdentifier> Vec_t;
+};
+
+/**
+ * @brief the identifiers of a file, see clCxxLexicalClassifier::FindIdentifiers().
+ * Each distinct name is kept once, the occurrences refer to it by index
+ */
+struct WXDLLIMPEXP_CL CppIdentifiersList {
+    struct Occurrence {
+        size_t name = 0; // index in "names"
+        int offset = 0;
+        int line = 0;  // 1 based
+        int state = 0; // the lexical context: one of the CppWordScanner::STATE_* values
+    };
+    std::vector<wxString> names;
+    std::vector<Occurrence> occurrences;
+
+    void Clear()
+    {
+        std::vector<wxString>().swap(names);
+        std::vector<Occurrence>().swap(occurrences);
+    }
+};
+
+/**
+ * @brief the state of a file when its identifiers were collected
+ */
+struct WXDLLIMPEXP_CL CppIdentifiersFile {
+    time_t lastModified = 0;
+    size_t size = 0;
+
+    typedef std::unordered_map<wxString, CppIdentifiersFile> Map_t;
+};
+
 class WXDLLIMPEXP_CL CppWordScanner
 {
     wxStringSet_t m_keywords;
@@ -111,6 +155,11 @@ public:
     CppWordScanner(const wxString& file_name);
     CppWordScanner(const wxString& file_name, const wxString& text, int offset);
 
+    /**
+     * @brief read a file the way the scanner does (ISO-8859-1, UTF-8 if that fails), so the offsets match
+     */
+    static void ReadFile(const wxString& fileName, wxString& text);
+
     /**
      * @brief tokenize the file and return list of tokens
      * @return
@@ -128,6 +177,11 @@ public:
     // we use std::vector<char> and NOT std::vector<char> since the specialization of vector<bool>
     // is broken
     TextStatesPtr states();
+
+    /**
+     * @brief is "state" a code state (i.e. not a comment nor a string)?
+     */
+    static bool IsCodeState(int state) { return state == STATE_NORMAL || state == STATE_PRE_PROCESSING; }
 };
 
 #endif // __cppwordscanner__
@@ -26,6 +26,7 @@
 #include "CxxVariable.h"
 #include "CxxVariableScanner.h"
 #include "asyncprocess.h"
+#include "cl_config.h"
 #include "cl_indexer_reply.h"
 #include "cl_indexer_request.h"
 #include "cl_standard_paths.h"
@@ -50,8 +51,10 @@
 #include "wx/tokenzr.h"
 #include "wxStringHash.h"
 #include <algorithm>
+#include <limits>
 #include <set>
 #include <sstream>
+#include <thread>
 #include <wx/app.h>
 #include <wx/busyinfo.h>
 #include <wx/file.h>
@@ -77,6 +80,23 @@
 #define PIPE_NAME "/tmp/codelite_indexer.%s.sock"
 #endif
 
+// Maximum number of indexers started when retagging in parallel
+#define MAX_INDEXERS_COUNT 8
+
+// Past this number of retagged files, the symbol index is rebuilt instead of being updated
+#define SYMBOL_INDEX_MAX_DELTA_FILES 500
+
+// The unique string identifying the channel of an indexer process. The first indexer
+// uses the process ID, the helpers append their index to it. Since the indexer reads
+// its parent process ID with atol(), the suffix does not break the '--pid' option
+static std::string GetIndexerUID(size_t indexer)
+{
+    std::stringstream s;
+    s << wxGetProcessId();
+    if(indexer) { s << "_" << indexer; }
+    return s.str();
+}
+
 wxDEFINE_EVENT(wxEVT_TAGS_DB_UPGRADE, wxCommandEvent);
 wxDEFINE_EVENT(wxEVT_TAGS_DB_UPGRADE_INTER, wxCommandEvent);
 
@@ -140,10 +160,17 @@ TagsManager::TagsManager()
     : wxEvtHandler()
     , m_codeliteIndexerPath(wxT("codelite_indexer"))
     , m_codeliteIndexerProcess(NULL)
+    , m_indexerRestartPending(false)
+    , m_indexerRunning(false)
+    , m_indexersCount(1)
     , m_canRestartIndexer(true)
     , m_lang(NULL)
     , m_evtHandler(NULL)
     , m_encoding(wxFONTENCODING_DEFAULT)
+    , m_symbolIndexEnabled(false)
+    , m_symbolIndexBuilding(false)
+    , m_symbolIndexFullBuild(false)
+    , m_symbolIndexCancelled(false)
 {
     Bind(wxEVT_ASYNC_PROCESS_TERMINATED, &TagsManager::OnIndexerTerminated, this);
 
@@ -159,34 +186,42 @@ TagsManager::TagsManager()
     m_CppIgnoreKeyWords.insert(wxT("for"));
     m_CppIgnoreKeyWords.insert(wxT("switch"));
     m_symbolsCache.reset(new clCxxFileCacheSymbols());
+    SetIndexersCount(0);
 }
 
 TagsManager::~TagsManager()
 {
     m_symbolsCache.reset(nullptr);
-    if(m_codeliteIndexerProcess) {
 
-        // Dont kill the indexer process, just terminate the
-        // reader-thread (this is done by deleting the indexer object)
-        m_canRestartIndexer = false;
+    // Stop building the symbol index
+    m_symbolIndexCancelled.store(true);
+    if(m_symbolIndexThread.joinable()) { m_symbolIndexThread.join(); }
+
+    // Dont kill the indexer processes, just terminate the
+    // reader-thread (this is done by deleting the indexer object)
+    m_canRestartIndexer = false;
+    m_indexerRunning.store(false);
+
+    std::vector<IProcess*> indexers = m_helperIndexers;
+    indexers.insert(indexers.begin(), m_codeliteIndexerProcess);
+    for(size_t i = 0; i < indexers.size(); ++i) {
+        if(!indexers[i]) { continue; }
 
 #ifndef __WXMSW__
-        m_codeliteIndexerProcess->Terminate();
+        indexers[i]->Terminate();
 #endif
-        delete m_codeliteIndexerProcess;
+        delete indexers[i];
 
 #ifndef __WXMSW__
         // Clear the socket file
-        std::stringstream s;
-        s << wxGetProcessId();
-
         char channel_name[1024];
         memset(channel_name, 0, sizeof(channel_name));
-        sprintf(channel_name, PIPE_NAME, s.str().c_str());
+        sprintf(channel_name, PIPE_NAME, GetIndexerUID(i).c_str());
         ::unlink(channel_name);
         ::remove(channel_name);
 #endif
     }
+    m_helperIndexers.clear();
 }
 
 void TagsManager::OpenDatabase(const wxFileName& fileName)
@@ -220,13 +255,14 @@ void TagsManager::OpenDatabase(const wxFileName& fileName)
         m_evtHandler->AddPendingEvent(e);
     }
 #endif
+    RebuildSymbolIndex();
 }
 
 TagTreePtr TagsManager::ParseSourceFile(const wxFileName& fp, std::vector<CommentPtr>* comments)
 {
     wxString tags;
 
-    if(!m_codeliteIndexerProcess) {
+    if(!IsIndexerRunning()) {
         clWARNING() << "Indexer process is not running..." << clEndl;
         return TagTreePtr(NULL);
     }
@@ -259,7 +295,21 @@ TagTreePtr TagsManager::ParseSourceFile2(const wxFileName& fp, const wxString& t
 // Database operations
 //-----------------------------------------------------------
 
-void TagsManager::Store(TagTreePtr tree, const wxFileName& path) { GetDatabase()->Store(tree, path); }
+void TagsManager::Store(TagTreePtr tree, const wxFileName& path)
+{
+    GetDatabase()->Store(tree, path);
+    if(!tree) { return; }
+
+    std::vector<std::pair<wxString, TagEntry> > entries;
+    tree->ToVector(entries);
+    wxStringSet_t files;
+    for(size_t i = 0; i < entries.size(); ++i) {
+        if(!entries[i].second.GetFile().IsEmpty()) { files.insert(entries[i].second.GetFile()); }
+    }
+    wxArrayString arrFiles;
+    arrFiles.insert(arrFiles.end(), files.begin(), files.end());
+    UpdateSymbolIndex(arrFiles);
+}
 
 TagTreePtr TagsManager::Load(const wxFileName& fileName, TagEntryPtrVector_t* tags)
 {
@@ -286,6 +336,7 @@ TagTreePtr TagsManager::Load(const wxFileName& fileName, TagEntryPtrVector_t* ta
 void TagsManager::Delete(const wxFileName& path, const wxString& fileName)
 {
     GetDatabase()->DeleteByFileName(path, fileName);
+    UpdateSymbolIndex(wxArrayString(1, &fileName));
 }
 
 //--------------------------------------------------------
@@ -296,29 +347,65 @@ void TagsManager::StartCodeLiteIndexer()
 {
     if(!m_canRestartIndexer) return;
 
+    m_codeliteIndexerProcess = DoStartIndexer(0);
+    m_indexerRunning.store(m_codeliteIndexerProcess != NULL);
+}
+
+void TagsManager::StartHelperIndexers()
+{
+    if(!m_canRestartIndexer) return;
+
+    // Start any missing helper indexer
+    m_helperIndexers.resize(m_indexersCount - 1, NULL);
+    for(size_t i = 0; i < m_helperIndexers.size(); ++i) {
+        if(!m_helperIndexers[i]) { m_helperIndexers[i] = DoStartIndexer(i + 1); }
+    }
+}
+
+IProcess* TagsManager::DoStartIndexer(size_t indexer)
+{
     // Run ctags process
     wxString cmd;
-    wxString ctagsCmd;
 
     // build the command, we surround ctags name with double quatations
-    wxString uid;
-    uid << wxGetProcessId();
+    wxString uid = GetIndexerUID(indexer);
 
     if(m_codeliteIndexerPath.FileExists() == false) {
         CL_ERROR(wxT("ERROR: Could not locate indexer: %s"), m_codeliteIndexerPath.GetFullPath().c_str());
-        m_codeliteIndexerProcess = NULL;
-        return;
+        return NULL;
     }
 
     // concatenate the PID to identifies this channel to this instance of codelite
     cmd << wxT("\"") << m_codeliteIndexerPath.GetFullPath() << wxT("\" ") << uid << wxT(" --pid");
-    m_codeliteIndexerProcess =
-        CreateAsyncProcess(this, cmd, IProcessCreateDefault, clStandardPaths::Get().GetUserDataDir());
+    return CreateAsyncProcess(this, cmd, IProcessCreateDefault, clStandardPaths::Get().GetUserDataDir());
+}
+
+void TagsManager::SetIndexersCount(size_t count)
+{
+    if(count == 0) { count = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), MAX_INDEXERS_COUNT); }
+    m_indexersCount = count;
 }
 
 void TagsManager::RestartCodeLiteIndexer()
 {
-    if(m_codeliteIndexerProcess) { m_codeliteIndexerProcess->Terminate(); }
+    // Several parsing workers may fail at once: restart only once
+    if(m_indexerRestartPending.exchange(true)) { return; }
+
+    // The process is replaced by OnIndexerTerminated() on the main thread, never touch it from a worker
+    if(!wxThread::IsMain()) {
+        CallAfter(&TagsManager::DoRestartCodeLiteIndexer);
+        return;
+    }
+    DoRestartCodeLiteIndexer();
+}
+
+void TagsManager::DoRestartCodeLiteIndexer()
+{
+    if(!m_codeliteIndexerProcess) {
+        m_indexerRestartPending.store(false);
+        return;
+    }
+    m_codeliteIndexerProcess->Terminate();
 
     // no need to call StartCodeLiteIndexer(), since it will be called automatically
     // by the termination handler
@@ -328,22 +415,30 @@ void TagsManager::SetCodeLiteIndexerPath(const wxString& path) { m_codeliteIndex
 
 void TagsManager::OnIndexerTerminated(clProcessEvent& event)
 {
-    wxUnusedVar(event);
+    std::vector<IProcess*>::iterator iter =
+        std::find(m_helperIndexers.begin(), m_helperIndexers.end(), event.GetProcess());
+    if(iter != m_helperIndexers.end()) {
+        // a helper indexer went down, restart only this one
+        size_t indexer = std::distance(m_helperIndexers.begin(), iter) + 1;
+        wxDELETE(*iter);
+        if(m_canRestartIndexer) { *iter = DoStartIndexer(indexer); }
+        return;
+    }
+
     wxDELETE(m_codeliteIndexerProcess);
+    m_indexerRunning.store(false);
     StartCodeLiteIndexer();
+    m_indexerRestartPending.store(false);
 }
 
 //---------------------------------------------------------------------
 // Parsing
 //---------------------------------------------------------------------
-void TagsManager::SourceToTags(const wxFileName& source, wxString& tags)
+void TagsManager::SourceToTags(const wxFileName& source, wxString& tags, size_t indexer)
 {
-    std::stringstream s;
-    s << wxGetProcessId();
-
     char channel_name[1024];
     memset(channel_name, 0, sizeof(channel_name));
-    sprintf(channel_name, PIPE_NAME, s.str().c_str());
+    sprintf(channel_name, PIPE_NAME, GetIndexerUID(indexer).c_str());
 
     clNamedPipeClient client(channel_name);
 
@@ -366,6 +461,11 @@ void TagsManager::SourceToTags(const wxFileName& source, wxString& tags)
     clDEBUG1() << "Sending CTAGS command:" << ctagsCmd << clEndl;
     // connect to the indexer
     if(!client.connect()) {
+        if(indexer != 0) {
+            // the helper indexer is not available (e.g. it is being restarted), use the main one
+            SourceToTags(source, tags, 0);
+            return;
+        }
         clWARNING() << "Failed to connect to indexer process. Indexer ID:" << wxGetProcessId() << clEndl;
         return;
     }
@@ -383,7 +483,8 @@ void TagsManager::SourceToTags(const wxFileName& source, wxString& tags)
         std::string errmsg;
         if(!clIndexerProtocol::ReadReply(&client, reply, errmsg)) {
             clWARNING() << "Failed to read indexer reply: " << (wxString() << errmsg) << clEndl;
-            RestartCodeLiteIndexer();
+            // helper indexers are restarted by the termination handler
+            if(indexer == 0) { RestartCodeLiteIndexer(); }
             return;
         }
     } catch(std::bad_alloc& ex) {
@@ -1274,25 +1375,10 @@ void TagsManager::RetagFiles(const std::vector<wxFileName>& files, RetagType typ
         return;
     }
 
-    // step 2: remove all files which do not need retag
-    if(type == Retag_Quick || type == Retag_Quick_No_Scan) {
-        DoFilterNonNeededFilesForRetaging(strFiles, GetDatabase());
-    }
-
-    // If there are no files to tag - send the 'end' event
-    if(strFiles.IsEmpty()) {
-#if wxUSE_GUI
-        wxFrame* frame = dynamic_cast<wxFrame*>(wxTheApp->GetTopWindow());
-        if(frame) {
-            wxCommandEvent retaggingCompletedEvent(wxEVT_PARSE_THREAD_RETAGGING_COMPLETED);
-            frame->GetEventHandler()->AddPendingEvent(retaggingCompletedEvent);
-        }
-#endif
-        return;
-    }
-
-    // step 4: Remove tags belonging to these files
-    DeleteFilesTags(strFiles);
+    // step 2: remove all files which do not need retag and the tags belonging to the others. A quick retag
+    // compares the content hash of the touched files, the parser thread does it before it parses them
+    bool quickRetag = (type == Retag_Quick || type == Retag_Quick_No_Scan);
+    if(!quickRetag) { DeleteFilesTags(strFiles); }
 
     // step 5: build the database
     ParseRequest* req = new ParseRequest(ParseThreadST::Get()->GetNotifiedWindow());
@@ -1301,9 +1387,14 @@ void TagsManager::RetagFiles(const std::vector<wxFileName>& files, RetagType typ
     }
 
     req->setDbFile(GetDatabase()->GetDatabaseFileName().GetFullPath().c_str());
+    req->_quickRetag = quickRetag;
 
     req->setType(type == Retag_Quick_No_Scan ? ParseRequest::PR_PARSE_FILE_NO_INCLUDES
                                              : ParseRequest::PR_PARSE_AND_STORE);
+
+    // The helper indexers are only needed to parse files in parallel, start them on the first retag. Until a
+    // helper is ready, its files are sent to the main indexer
+    if(req->getType() == ParseRequest::PR_PARSE_AND_STORE) { StartHelperIndexers(); }
     req->_workspaceFiles.clear();
     req->_workspaceFiles.reserve(strFiles.size());
     for(size_t i = 0; i < strFiles.GetCount(); i++) {
@@ -2226,11 +2317,12 @@ void TagsManager::DeleteTagsByFilePrefix(const wxString& dbfileName, const wxStr
     delete db;
 }
 
-void TagsManager::UpdateFilesRetagTimestamp(const wxArrayString& files, ITagsStoragePtr db)
+void TagsManager::UpdateFilesRetagTimestamp(const wxArrayString& files, const wxArrayString& hashes,
+                                            const std::vector<size_t>& sizes, ITagsStoragePtr db)
 {
     db->Begin();
     for(size_t i = 0; i < files.GetCount(); i++) {
-        db->InsertFileEntry(files.Item(i), (int)time(NULL));
+        db->InsertFileEntry(files.Item(i), (int)time(NULL), hashes.Item(i), sizes[i]);
     }
     db->Commit();
 }
@@ -2245,6 +2337,9 @@ void TagsManager::FilterNonNeededFilesForRetaging(wxArrayString& strFiles, ITags
         files_set.insert(strFiles.Item(i));
     }
 
+    // Files that were touched (e.g. by 'git checkout') but their content did not change
+    wxArrayString touchedFiles;
+    std::vector<CppIdentifiersFile> touchedFilesState;
     for(size_t i = 0; i < files_entries.size(); i++) {
         FileEntryPtr fe = files_entries.at(i);
 
@@ -2254,15 +2349,46 @@ void TagsManager::FilterNonNeededFilesForRetaging(wxArrayString& strFiles, ITags
             // get the actual modifiaction time of the file from the disk
             struct stat buff;
             int modified(0);
+            size_t fileSize(0);
 
             const wxCharBuffer cname = _C((*iter));
-            if(stat(cname.data(), &buff) == 0) { modified = (int)buff.st_mtime; }
+            if(stat(cname.data(), &buff) == 0) {
+                modified = (int)buff.st_mtime;
+                fileSize = (size_t)buff.st_size;
+            }
 
             // if the timestamp from the database < then the actual timestamp, re-tag the file
-            if(fe->GetLastRetaggedTimestamp() >= modified) { files_set.erase(iter); }
+            if(fe->GetLastRetaggedTimestamp() >= modified) {
+                files_set.erase(iter);
+
+            } else if(!fe->GetHash().IsEmpty() && fe->GetSize() == fileSize) {
+                // Same size: compare the content hash before we decide to re-tag the file
+                wxString hash;
+                size_t size = 0;
+                if(FileUtils::GetFileHash(*iter, hash, size) && (size == fe->GetSize()) && (hash == fe->GetHash())) {
+                    CppIdentifiersFile state;
+                    state.lastModified = buff.st_mtime;
+                    state.size = fileSize;
+                    touchedFiles.Add(*iter);
+                    touchedFilesState.push_back(state);
+                    files_set.erase(iter);
+                }
+            }
         }
     }
 
+    // Update the timestamp of the unmodified files so we wont hash them again next time.
+    // Their stored identifiers are still valid, keep them usable by Find References
+    if(!touchedFiles.IsEmpty()) {
+        clDEBUG() << "Quick retag:" << touchedFiles.size() << "files were touched but not modified" << clEndl;
+        db->Begin();
+        for(size_t i = 0; i < touchedFiles.size(); ++i) {
+            db->UpdateFileEntry(touchedFiles.Item(i), (int)time(NULL));
+            db->UpdateIdentifiersFile(touchedFiles.Item(i), touchedFilesState[i]);
+        }
+        db->Commit();
+    }
+
     // copy back the files to the array
     std::unordered_set<wxString>::iterator iter = files_set.begin();
     strFiles.Clear();
@@ -2272,11 +2398,6 @@ void TagsManager::FilterNonNeededFilesForRetaging(wxArrayString& strFiles, ITags
     }
 }
 
-void TagsManager::DoFilterNonNeededFilesForRetaging(wxArrayString& strFiles, ITagsStoragePtr db)
-{
-    FilterNonNeededFilesForRetaging(strFiles, db);
-}
-
 wxString TagsManager::GetFunctionReturnValueFromPattern(TagEntryPtr tag)
 {
     // evaluate the return value of the tag
@@ -2658,6 +2779,20 @@ ITagsStoragePtr TagsManager::GetDatabase() { return m_db; }
 
 void TagsManager::GetTagsByName(const wxString& prefix, std::vector<TagEntryPtr>& tags)
 {
+    if(prefix.IsEmpty()) { return; }
+
+    // The index is case insensitive
+    SymbolIndexFilter_t filter;
+    if(m_tagsOptions.GetFlags() & CC_IS_CASE_SENSITIVE) {
+        filter = [&](TagEntryPtr tag) { return tag->GetName().StartsWith(prefix); };
+    }
+    if(DoQuerySymbolIndex(
+           [&](const clSymbolIndex& index, size_t limit, clSymbolIndex::Ids_t& ids) {
+               index.FindByPrefix(prefix, limit, ids);
+           },
+           tags, filter)) {
+        return;
+    }
     GetDatabase()->GetTagsByName(prefix, tags);
 }
 
@@ -2687,9 +2822,136 @@ wxString TagsManager::DoReplaceMacrosFromDatabase(const wxString& name)
 
 void TagsManager::GetTagsByPartialName(const wxString& partialName, std::vector<TagEntryPtr>& tags)
 {
+    if(partialName.IsEmpty()) { return; }
+    if(DoQuerySymbolIndex(
+           [&](const clSymbolIndex& index, size_t limit, clSymbolIndex::Ids_t& ids) {
+               index.FindBySubstring(partialName, limit, ids);
+           },
+           tags)) {
+        return;
+    }
     GetDatabase()->GetTagsByPartName(partialName, tags);
 }
 
+bool TagsManager::DoQuerySymbolIndex(const SymbolIndexQuery_t& query, std::vector<TagEntryPtr>& tags,
+                                     const SymbolIndexFilter_t& filter)
+{
+    size_t searchLimit = (size_t)GetDatabase()->GetSingleSearchLimit();
+    if(tags.size() >= searchLimit) { return true; }
+
+    // When the tags are filtered, the limit applies to the accepted tags: take all the candidates
+    size_t limit = filter ? std::numeric_limits<size_t>::max() : (searchLimit - tags.size());
+    clSymbolIndex::Ids_t ids;
+    {
+        std::lock_guard<std::mutex> guard(m_symbolIndexLock);
+        if(m_symbolIndex.IsEmpty() && m_symbolIndexDelta.IsEmpty()) { return false; }
+        query(m_symbolIndex, limit, ids);
+        if(ids.size() < limit) { query(m_symbolIndexDelta, limit - ids.size(), ids); }
+    }
+
+    if(!filter) {
+        GetDatabase()->GetTagsByIds(ids, tags);
+        return true;
+    }
+
+    // Fetch the candidates by chunks, until there are enough accepted tags
+    size_t first = 0;
+    while(first < ids.size() && tags.size() < searchLimit) {
+        size_t count = std::min(ids.size() - first, searchLimit - tags.size());
+        clSymbolIndex::Ids_t chunk(ids.begin() + first, ids.begin() + first + count);
+        first += count;
+
+        std::vector<TagEntryPtr> candidates;
+        GetDatabase()->GetTagsByIds(chunk, candidates);
+        for(size_t i = 0; i < candidates.size(); ++i) {
+            if(filter(candidates[i])) { tags.push_back(candidates[i]); }
+        }
+    }
+    return true;
+}
+
+void TagsManager::RebuildSymbolIndex()
+{
+    std::lock_guard<std::mutex> guard(m_symbolIndexLock);
+    m_symbolIndexEnabled = clConfig::Get().Read("CodeCompletion/UseSymbolIndex", false) && m_dbFile.IsOk();
+    if(!m_symbolIndexEnabled) {
+        // Release the memory
+        m_symbolIndex.Clear();
+        m_symbolIndexDelta.Clear();
+        m_symbolIndexDeltaFiles.clear();
+        m_symbolIndexPendingFiles.clear();
+        return;
+    }
+
+    m_symbolIndexDbFile = m_dbFile;
+    m_symbolIndexFullBuild = true;
+    DoStartSymbolIndexWorker();
+}
+
+void TagsManager::UpdateSymbolIndex(const wxArrayString& files)
+{
+    if(files.IsEmpty()) { return; }
+
+    std::lock_guard<std::mutex> guard(m_symbolIndexLock);
+    if(!m_symbolIndexEnabled) { return; }
+    m_symbolIndexPendingFiles.insert(files.begin(), files.end());
+    DoStartSymbolIndexWorker();
+}
+
+void TagsManager::DoStartSymbolIndexWorker()
+{
+    // A running worker handles the new request once it is done with the current one
+    if(m_symbolIndexBuilding) { return; }
+
+    // The previous worker is done, collect it
+    if(m_symbolIndexThread.joinable()) { m_symbolIndexThread.join(); }
+
+    m_symbolIndexBuilding = true;
+    m_symbolIndexThread = std::thread([this]() {
+        while(true) {
+            bool fullBuild = false;
+            wxFileName dbfile;
+            wxStringSet_t files;      // the files retagged since the last update
+            wxStringSet_t deltaFiles; // the files retagged since the last full build
+            {
+                std::lock_guard<std::mutex> guard(m_symbolIndexLock);
+                if(m_symbolIndexCancelled.load() || (!m_symbolIndexFullBuild && m_symbolIndexPendingFiles.empty())) {
+                    m_symbolIndexBuilding = false;
+                    break;
+                }
+                dbfile = m_symbolIndexDbFile;
+                files.swap(m_symbolIndexPendingFiles);
+                deltaFiles = m_symbolIndexDeltaFiles;
+                deltaFiles.insert(files.begin(), files.end());
+                fullBuild = m_symbolIndexFullBuild || m_symbolIndex.IsEmpty() ||
+                            (deltaFiles.size() > SYMBOL_INDEX_MAX_DELTA_FILES);
+                m_symbolIndexFullBuild = false;
+            }
+
+            // Either load the whole database, or only the symbols of the retagged files
+            clSymbolIndex index;
+            bool loaded = index.Load(dbfile, &m_symbolIndexCancelled, fullBuild ? nullptr : &deltaFiles);
+
+            std::lock_guard<std::mutex> guard(m_symbolIndexLock);
+            if(!loaded) {
+                // The retagged files can not be hidden without their new symbols: fall back to a full build
+                if(!fullBuild) { m_symbolIndexFullBuild = true; }
+                continue;
+            }
+
+            if(fullBuild) {
+                m_symbolIndex.Swap(index);
+                m_symbolIndexDelta.Clear();
+                m_symbolIndexDeltaFiles.clear();
+            } else {
+                m_symbolIndex.HideFiles(files);
+                m_symbolIndexDelta.Swap(index);
+                m_symbolIndexDeltaFiles.swap(deltaFiles);
+            }
+        }
+    });
+}
+
 bool TagsManager::AreTheSame(const TagEntryPtrVector_t& v1, const TagEntryPtrVector_t& v2) const
 {
     // Assuming that v1 and v2 are sorted!
@@ -2876,7 +3138,7 @@ void TagsManager::GetCXXKeywords(wxArrayString& words)
 
 TagEntryPtrVector_t TagsManager::ParseBuffer(const wxString& content, const wxString& filename)
 {
-    if(!m_codeliteIndexerProcess) { return TagEntryPtrVector_t(); }
+    if(!IsIndexerRunning()) { return TagEntryPtrVector_t(); }
 
     // Write the content into temporary file
     wxString tmpfilename = wxFileName::CreateTempFileName("ctagstemp");
@@ -3042,5 +3304,13 @@ void TagsManager::DoFilterCtorDtorIfNeeded(std::vector<TagEntryPtr>& tags, const
 
 void TagsManager::GetTagsByPartialNames(const wxArrayString& partialNames, std::vector<TagEntryPtr>& tags)
 {
+    if(partialNames.IsEmpty()) { return; }
+    if(DoQuerySymbolIndex(
+           [&](const clSymbolIndex& index, size_t limit, clSymbolIndex::Ids_t& ids) {
+               index.FindByPathParts(partialNames, limit, ids);
+           },
+           tags)) {
+        return;
+    }
     GetDatabase()->GetTagsByPartName(partialNames, tags);
 }
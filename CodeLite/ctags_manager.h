@@ -27,6 +27,7 @@
 #define CODELITE_CTAGS_MANAGER_H
 
 #include "clCxxFileCacheSymbols.h"
+#include "clSymbolIndex.h"
 #include "cl_calltip.h"
 #include "cl_command_event.h"
 #include "cl_process.h"
@@ -45,7 +46,11 @@
 #include "wx/event.h"
 #include "wx/process.h"
 #include "wxStringHash.h"
+#include <atomic>
+#include <functional>
+#include <mutex>
 #include <set>
+#include <thread>
 #include <wx/stopwatch.h>
 #include <wx/thread.h>
 #include <wx/timer.h>
@@ -144,7 +149,11 @@ public:
 
 private:
     wxFileName m_codeliteIndexerPath;
-    IProcess* m_codeliteIndexerProcess;
+    IProcess* m_codeliteIndexerProcess; // accessed by the main thread only
+    std::vector<IProcess*> m_helperIndexers;
+    std::atomic_bool m_indexerRestartPending;
+    std::atomic_bool m_indexerRunning; // m_codeliteIndexerProcess is set, for the worker threads
+    size_t m_indexersCount;
     wxString m_ctagsCmd;
     wxStopWatch m_watch;
     TagsOptionsData m_tagsOptions;
@@ -165,6 +174,20 @@ private:
 #endif
     clCxxFileCacheSymbols::Ptr_t m_symbolsCache;
 
+    // The in-memory symbol index: the whole database as of the last full build, plus the symbols of the
+    // files retagged since then. Both are updated in the background
+    clSymbolIndex m_symbolIndex;
+    clSymbolIndex m_symbolIndexDelta;
+    wxStringSet_t m_symbolIndexDeltaFiles;   // the files loaded into m_symbolIndexDelta
+    wxStringSet_t m_symbolIndexPendingFiles; // the files retagged since the last update
+    wxFileName m_symbolIndexDbFile;
+    std::mutex m_symbolIndexLock;
+    std::thread m_symbolIndexThread;
+    bool m_symbolIndexEnabled;
+    bool m_symbolIndexBuilding;
+    bool m_symbolIndexFullBuild;
+    std::atomic_bool m_symbolIndexCancelled;
+
 public:
     /**
      * @brief return a set of CXX keywords
@@ -202,6 +225,17 @@ public:
      */
     void ClearAllCaches();
 
+    /**
+     * @brief rebuild the in-memory symbol index in the background (when enabled)
+     */
+    void RebuildSymbolIndex();
+
+    /**
+     * @brief reload the symbols of 'files' into the in-memory symbol index in the background. Call this
+     * once their tags were changed in the database, from any thread
+     */
+    void UpdateSymbolIndex(const wxArrayString& files);
+
     /**
      * @brief load fileName into cache, note that this call will clear perivous
      * cache
@@ -299,10 +333,33 @@ public:
     void StartCodeLiteIndexer();
 
     /**
-     * Restart ctags process.
+     * @brief start the helper codelite_indexer processes that are not running (see SetIndexersCount)
+     */
+    void StartHelperIndexers();
+
+    /**
+     * @brief is the main codelite_indexer process running?
+     */
+    bool IsIndexerRunning() const { return m_indexerRunning.load(); }
+
+    /**
+     * Restart ctags process. Can be called by any thread, the restart itself is done by the main thread. The calls
+     * made until the indexer is back are ignored
      */
     void RestartCodeLiteIndexer();
 
+    /**
+     * @brief set the number of codelite_indexer processes to run. The first one serves the editor requests,
+     * all of them are used to parse files concurrently when retagging the workspace. The helpers are started
+     * by the first retag. Passing 0 uses one indexer per core
+     */
+    void SetIndexersCount(size_t count);
+
+    /**
+     * @brief return the number of codelite_indexer processes that can serve requests concurrently
+     */
+    size_t GetIndexersCount() const { return m_indexersCount; }
+
     /**
      * Test if filename matches the current ctags file spec.
      * @param filename file name to test
@@ -529,8 +586,9 @@ public:
      * Pass a source file to ctags process, wait for it to process it and return the output.
      * @param source Source file name
      * @param tags String containing the ctags output
+     * @param indexer the indexer process to use, in the range [0, GetIndexersCount())
      */
-    void SourceToTags(const wxFileName& source, wxString& tags);
+    void SourceToTags(const wxFileName& source, wxString& tags, size_t indexer = 0);
 
     /**
      * return list of files from the database(s). The returned list is ordered
@@ -772,9 +830,12 @@ public:
     /**
      * @brief update the 'last_retagged' column in the 'files' table for the current timestamp
      * @param files list of files
+     * @param hashes the files content hash, taken before they were parsed
+     * @param sizes the files size, taken with the hash
      * @brief db    database to use
      */
-    void UpdateFilesRetagTimestamp(const wxArrayString& files, ITagsStoragePtr db);
+    void UpdateFilesRetagTimestamp(const wxArrayString& files, const wxArrayString& hashes,
+                                   const std::vector<size_t>& sizes, ITagsStoragePtr db);
 
     /**
      * @brief accept as input ctags pattern of a function and tries to evaluate the
@@ -845,6 +906,16 @@ protected:
      */
     void OnIndexerTerminated(clProcessEvent& event);
 
+    /**
+     * Start a single codelite_indexer process listening on the channel of 'indexer'
+     */
+    IProcess* DoStartIndexer(size_t indexer);
+
+    /**
+     * Terminate the main codelite_indexer, OnIndexerTerminated() starts it again. Main thread only
+     */
+    void DoRestartCodeLiteIndexer();
+
 private:
     /**
      * Construct a TagsManager object, for internal use
@@ -909,7 +980,20 @@ protected:
     void FilterImplementation(const std::vector<TagEntryPtr>& src, std::vector<TagEntryPtr>& tags);
     void FilterDeclarations(const std::vector<TagEntryPtr>& src, std::vector<TagEntryPtr>& tags);
     wxString DoReplaceMacros(const wxString& name);
-    void DoFilterNonNeededFilesForRetaging(wxArrayString& strFiles, ITagsStoragePtr db);
+
+    typedef std::function<void(const clSymbolIndex&, size_t, clSymbolIndex::Ids_t&)> SymbolIndexQuery_t;
+    typedef std::function<bool(TagEntryPtr)> SymbolIndexFilter_t;
+    /**
+     * @brief run a query against the symbol index and fetch the matched tags from the database.
+     * Return false when the index can not be used (disabled or not loaded yet)
+     * @param filter when set, only the tags accepted by the filter are returned (and count for the search limit)
+     */
+    bool DoQuerySymbolIndex(const SymbolIndexQuery_t& query, std::vector<TagEntryPtr>& tags,
+                            const SymbolIndexFilter_t& filter = SymbolIndexFilter_t());
+    /**
+     * @brief start the symbol index worker thread, unless it is running. Call with m_symbolIndexLock held
+     */
+    void DoStartSymbolIndexWorker();
     void DoGetFunctionTipForEmptyExpression(const wxString& word, const wxString& text, std::vector<TagEntryPtr>& tips,
                                             bool globalScopeOnly = false);
     void TryFindImplDeclUsingNS(const wxString& scope, const wxString& word, bool imp,
@@ -31,6 +31,239 @@
 #include <wx/log.h>
 #include <wx/stdpaths.h>
 #include <wx/utils.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+// Lines per thread buffer (a power of 2)
+#define LOG_RING_SIZE 1024
+
+// Max bytes waiting to be written, per thread
+#define LOG_RING_MAX_BYTES (8 * 1024 * 1024)
+
+// The writer wakes up at least this often (milliseconds)
+#define LOG_WRITER_INTERVAL 100
+
+// A logging thread wakes the writer before its next tick only once its ring holds this many lines or bytes
+#define LOG_WAKEUP_LINES (LOG_RING_SIZE / 2)
+#define LOG_WAKEUP_BYTES (LOG_RING_MAX_BYTES / 2)
+
+namespace
+{
+/**
+ * @brief a single producer / single consumer queue of log lines. Each logging thread owns one,
+ * the writer thread is the consumer
+ */
+struct LogRing {
+    std::string lines[LOG_RING_SIZE];
+    std::atomic<size_t> head; // next slot to write, producer only
+    std::atomic<size_t> tail; // next slot to read, consumer only
+    std::atomic<size_t> bytes;
+    std::atomic_bool orphaned; // the owner thread is gone
+
+    LogRing()
+        : head(0)
+        , tail(0)
+        , bytes(0)
+        , orphaned(false)
+    {
+    }
+
+    bool Push(std::string& line)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if((h - tail.load(std::memory_order_acquire)) >= LOG_RING_SIZE) { return false; }
+        if(bytes.load(std::memory_order_relaxed) + line.length() > LOG_RING_MAX_BYTES) { return false; }
+        bytes.fetch_add(line.length(), std::memory_order_relaxed);
+        lines[h & (LOG_RING_SIZE - 1)].swap(line);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool IsEmpty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_relaxed); }
+
+    // Producer only
+    bool IsAlmostFull() const
+    {
+        size_t count = head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire);
+        return count >= LOG_WAKEUP_LINES || bytes.load(std::memory_order_relaxed) >= LOG_WAKEUP_BYTES;
+    }
+
+    void Drain(std::string& output)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t h = head.load(std::memory_order_acquire);
+        for(; t != h; ++t) {
+            std::string& line = lines[t & (LOG_RING_SIZE - 1)];
+            output.append(line);
+            bytes.fetch_sub(line.length(), std::memory_order_relaxed);
+            // Release the memory, a long line should not stay around
+            std::string().swap(line);
+        }
+        tail.store(h, std::memory_order_release);
+    }
+};
+
+typedef std::shared_ptr<LogRing> LogRingPtr_t;
+
+std::string ToUTF8String(const wxString& str)
+{
+    const wxScopedCharBuffer buffer = str.ToUTF8();
+    return std::string(buffer.data(), buffer.length());
+}
+
+/**
+ * @brief the thread local handle of a ring. The ring itself is owned by the writer, so the lines
+ * logged by a thread are written even after it exits
+ */
+struct ThreadRing {
+    LogRingPtr_t ring;
+    ~ThreadRing()
+    {
+        if(ring) { ring->orphaned.store(true); }
+    }
+};
+
+class LogWriter
+{
+    std::mutex m_ringsLock;
+    std::vector<LogRingPtr_t> m_rings;
+
+    std::mutex m_fileLock; // held while writing, by the writer thread or FlushAll()
+    std::string m_filename;
+    std::string m_openedFilename;
+    FILE* m_fp = nullptr;
+
+    std::mutex m_wakeupLock;
+    std::condition_variable m_wakeup;
+    std::thread* m_thread = nullptr;
+    std::atomic<size_t> m_dropped;
+    size_t m_droppedReported = 0;
+    std::terminate_handler m_previousTerminate = nullptr;
+
+protected:
+    void WriterMain()
+    {
+        while(true) {
+            {
+                std::unique_lock<std::mutex> lk(m_wakeupLock);
+                m_wakeup.wait_for(lk, std::chrono::milliseconds(LOG_WRITER_INTERVAL));
+            }
+            Flush(true);
+        }
+    }
+
+    static void FlushAtExit()
+    {
+        // Don't wait: the writer thread may have been killed while writing
+        Get().Flush(false);
+    }
+
+    static void FlushAtTerminate()
+    {
+        FlushAtExit();
+        std::terminate_handler previous = Get().m_previousTerminate;
+        if(previous) { previous(); }
+        abort();
+    }
+
+public:
+    LogWriter()
+        : m_dropped(0)
+    {
+    }
+
+    static LogWriter& Get()
+    {
+        // Never deleted: threads may log while the statics are being destroyed
+        static LogWriter* writer = new LogWriter();
+        return *writer;
+    }
+
+    void SetFilename(const wxString& filename)
+    {
+        std::lock_guard<std::mutex> guard(m_fileLock);
+        m_filename = ToUTF8String(filename);
+    }
+
+    void Write(std::string& line)
+    {
+        static thread_local ThreadRing threadRing;
+        if(!threadRing.ring) {
+            threadRing.ring.reset(new LogRing());
+            std::lock_guard<std::mutex> guard(m_ringsLock);
+            m_rings.push_back(threadRing.ring);
+            if(!m_thread) {
+                m_thread = new std::thread(&LogWriter::WriterMain, this);
+                m_thread->detach();
+                atexit(&LogWriter::FlushAtExit);
+                m_previousTerminate = std::set_terminate(&LogWriter::FlushAtTerminate);
+            }
+        }
+        // The writer drains the rings every LOG_WRITER_INTERVAL ms, wake it up earlier only when this one fills up
+        bool pushed = threadRing.ring->Push(line);
+        if(!pushed) { m_dropped.fetch_add(1, std::memory_order_relaxed); }
+        if(!pushed || threadRing.ring->IsAlmostFull()) { m_wakeup.notify_one(); }
+    }
+
+    size_t GetDropped() const { return m_dropped.load(); }
+
+    void Flush(bool wait)
+    {
+        std::unique_lock<std::mutex> fileGuard(m_fileLock, std::defer_lock);
+        if(wait) {
+            fileGuard.lock();
+        } else if(!fileGuard.try_lock()) {
+            return;
+        }
+        std::vector<LogRingPtr_t> rings;
+        {
+            std::lock_guard<std::mutex> guard(m_ringsLock);
+            // Forget the rings of the threads that exited, once they were drained
+            for(size_t i = 0; i < m_rings.size(); ++i) {
+                if(m_rings[i]->orphaned.load() && m_rings[i]->IsEmpty()) {
+                    m_rings.erase(m_rings.begin() + i);
+                    --i;
+                }
+            }
+            rings = m_rings;
+        }
+
+        std::string batch;
+        for(size_t i = 0; i < rings.size(); ++i) {
+            rings[i]->Drain(batch);
+        }
+        size_t dropped = m_dropped.load();
+        if(dropped != m_droppedReported) {
+            batch += "[FileLogger] " + std::to_string(dropped - m_droppedReported) + " log lines were dropped\n";
+            m_droppedReported = dropped;
+        }
+        if(batch.empty()) { return; }
+
+        if(m_fp && m_openedFilename != m_filename) {
+            fclose(m_fp);
+            m_fp = nullptr;
+        }
+        if(!m_fp && !m_filename.empty()) {
+            m_fp = wxFopen(wxString(m_filename.c_str(), wxConvUTF8), wxT("a+"));
+            m_openedFilename = m_filename;
+        }
+        if(m_fp) {
+            fwrite(batch.c_str(), 1, batch.length(), m_fp);
+            fflush(m_fp);
+        }
+    }
+};
+} // namespace
 
 int FileLogger::m_verbosity = FileLogger::Error;
 wxString FileLogger::m_logfile;
@@ -39,34 +272,34 @@ wxCriticalSection FileLogger::m_cs;
 
 FileLogger::FileLogger(int requestedVerbo)
     : _requestedLogLevel(requestedVerbo)
-    , m_fp(NULL)
 {
-    m_fp = wxFopen(m_logfile, wxT("a+"));
 }
 
 FileLogger::~FileLogger()
 {
-    if(m_fp) {
-        // flush any content that remain
-        Flush();
-        fclose(m_fp);
-        m_fp = NULL;
-    }
+    // flush any content that remain
+    Flush();
 }
 
 void FileLogger::AddLogLine(const wxString& msg, int verbosity)
 {
     if(msg.IsEmpty()) return;
-    if((m_verbosity >= verbosity) && m_fp) {
+    if(m_verbosity >= verbosity) {
         wxString formattedMsg = Prefix(verbosity);
         formattedMsg << " " << msg;
         formattedMsg.Trim().Trim(false);
         formattedMsg << wxT("\n");
-        wxFprintf(m_fp, wxT("%s"), formattedMsg.c_str());
-        fflush(m_fp);
+        std::string line = ToUTF8String(formattedMsg);
+        LogWriter::Get().Write(line);
     }
 }
 
+void FileLogger::FlushAll() { LogWriter::Get().Flush(true); }
+
+void FileLogger::FlushOnCrash() { LogWriter::Get().Flush(false); }
+
+size_t FileLogger::GetDroppedLinesCount() { return LogWriter::Get().GetDropped(); }
+
 void FileLogger::SetVerbosity(int level)
 {
     if(level > FileLogger::Warning) {
@@ -124,6 +357,7 @@ void FileLogger::OpenLog(const wxString& fullName, int verbosity)
     m_logfile.Clear();
     m_logfile << clStandardPaths::Get().GetUserDataDir() << wxFileName::GetPathSeparator() << fullName;
     m_verbosity = verbosity;
+    LogWriter::Get().SetFilename(m_logfile);
 }
 
 void FileLogger::AddLogLine(const wxArrayString& arr, int verbosity)
@@ -136,22 +370,28 @@ void FileLogger::AddLogLine(const wxArrayString& arr, int verbosity)
 void FileLogger::Flush()
 {
     if(m_buffer.IsEmpty()) { return; }
-    if(m_fp) {
-        wxFprintf(m_fp, "%s\n", m_buffer);
-        fflush(m_fp);
-    }
+    m_buffer << "\n";
+    std::string line = ToUTF8String(m_buffer);
+    LogWriter::Get().Write(line);
     m_buffer.Clear();
 }
 
 wxString FileLogger::Prefix(int verbosity)
 {
-    wxString prefix;
     timeval tim;
     gettimeofday(&tim, NULL);
-    int ms = (int)tim.tv_usec / 1000.0;
+    time_t seconds = tim.tv_sec;
+    struct tm localTime;
+#ifdef __WXMSW__
+    localtime_s(&localTime, &seconds);
+#else
+    localtime_r(&seconds, &localTime);
+#endif
+    char timeStr[32];
+    snprintf(timeStr, sizeof(timeStr), "[%02d:%02d:%02d:%03d", localTime.tm_hour, localTime.tm_min, localTime.tm_sec,
+             (int)(tim.tv_usec / 1000));
 
-    wxString msStr = wxString::Format(wxT("%03d"), ms);
-    prefix << wxT("[") << wxDateTime::Now().FormatISOTime() << wxT(":") << msStr;
+    wxString prefix(timeStr);
     switch(verbosity) {
     case System:
         prefix << wxT(" SYS]");
@@ -37,6 +37,11 @@
 class FileLogger;
 typedef FileLogger& (*FileLoggerFunction)(FileLogger&);
 
+/**
+ * @class FileLogger
+ * @brief a log line builder. A complete line is handed to a background writer (see Flush()) which batches
+ * the lines of all the threads into the log file, so logging never blocks on I/O
+ */
 class WXDLLIMPEXP_CL FileLogger
 {
 public:
@@ -46,7 +51,6 @@ protected:
     static int m_verbosity;
     static wxString m_logfile;
     int _requestedLogLevel;
-    FILE* m_fp;
     wxString m_buffer;
     static std::unordered_map<wxThreadIdType, wxString> m_threads;
     static wxCriticalSection m_cs;
@@ -66,6 +70,20 @@ public:
 
     int GetRequestedLogLevel() const { return _requestedLogLevel; }
 
+    /**
+     * @brief is the requested log level enabled?
+     */
+    bool IsEnabled() const { return _requestedLogLevel <= m_verbosity; }
+
+    /**
+     * @brief start the line with the log entry prefix. The prefix is only formatted if the level is enabled
+     */
+    FileLogger& AppendPrefix()
+    {
+        if(IsEnabled()) { m_buffer << Prefix(_requestedLogLevel); }
+        return *this;
+    }
+
     /**
      * @brief give a thread-id a unique name which will be displayed in log
      */
@@ -96,6 +114,22 @@ public:
      * @brief open the log file
      */
     static void OpenLog(const wxString& fullName, int verbosity);
+
+    /**
+     * @brief write the pending lines to the log file now
+     */
+    static void FlushAll();
+
+    /**
+     * @brief write the pending lines from a fatal signal or exception handler. Unlike FlushAll(), this
+     * does not wait for the log file: the crashed thread may be the one writing to it
+     */
+    static void FlushOnCrash();
+
+    /**
+     * @brief number of lines dropped because the writer could not keep up
+     */
+    static size_t GetDroppedLinesCount();
     // Various util methods
     static wxString GetVerbosityAsString(int verbosity);
     static int GetVerbosityAsNumber(const wxString& verbosity);
@@ -188,11 +222,11 @@ template <typename T> FileLogger& operator<<(FileLogger& logger, const T& obj)
 #define CL_DEBUG1_ARR(arr) FileLogger(FileLogger::Developer).AddLogLine(arr, FileLogger::Developer);
 
 // New API
-#define clDEBUG() FileLogger(FileLogger::Dbg) << FileLogger::Prefix(FileLogger::Dbg)
-#define clDEBUG1() FileLogger(FileLogger::Developer) << FileLogger::Prefix(FileLogger::Developer)
-#define clERROR() FileLogger(FileLogger::Error) << FileLogger::Prefix(FileLogger::Error)
-#define clWARNING() FileLogger(FileLogger::Warning) << FileLogger::Prefix(FileLogger::Warning)
-#define clSYSTEM() FileLogger(FileLogger::System) << FileLogger::Prefix(FileLogger::System)
+#define clDEBUG() FileLogger(FileLogger::Dbg).AppendPrefix()
+#define clDEBUG1() FileLogger(FileLogger::Developer).AppendPrefix()
+#define clERROR() FileLogger(FileLogger::Error).AppendPrefix()
+#define clWARNING() FileLogger(FileLogger::Warning).AppendPrefix()
+#define clSYSTEM() FileLogger(FileLogger::System).AppendPrefix()
 
 // A replacement for wxLogMessage
 #define clLogMessage(msg) clDEBUG() << msg
@@ -33,6 +33,8 @@ class FileEntry
 	long      m_id;
 	wxString  m_file;
 	int       m_lastRetaggedTimestamp;
+	size_t    m_size;
+	wxString  m_hash;
 
 public:
 	FileEntry();
@@ -51,6 +53,18 @@ public:
 	const int& GetLastRetaggedTimestamp() const {
 		return m_lastRetaggedTimestamp;
 	}
+	void SetSize(size_t size) {
+		this->m_size = size;
+	}
+	size_t GetSize() const {
+		return m_size;
+	}
+	void SetHash(const wxString& hash) {
+		this->m_hash = hash;
+	}
+	const wxString& GetHash() const {
+		return m_hash;
+	}
 	void SetId(const long& id) {
 		this->m_id = id;
 	}
@@ -132,6 +132,136 @@ bool FileUtils::ReadFileContent(const wxFileName& fn, wxString& data, const wxMB
     return true;
 }
 
+bool FileUtils::ReadFileContentRaw(const wxFileName& fn, std::string& data)
+{
+    data.clear();
+    wxCharBuffer cfile = fn.GetFullPath().mb_str(wxConvUTF8);
+    FILE* fp = fopen(cfile.data(), "rb");
+    if(!fp) {
+        clERROR() << "Failed to open file:" << fn << "." << strerror(errno);
+        return false;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long fsize = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    if(fsize > 0) {
+        data.resize(fsize);
+        if(fread(&data[0], 1, fsize, fp) != (size_t)fsize) {
+            clERROR() << "Failed to read file content:" << fn << "." << strerror(errno);
+            data.clear();
+            fclose(fp);
+            return false;
+        }
+    }
+    fclose(fp);
+    return true;
+}
+
+namespace
+{
+const wxUint64 XXH_PRIME64_1 = 11400714785074694791ULL;
+const wxUint64 XXH_PRIME64_2 = 14029467366897019727ULL;
+const wxUint64 XXH_PRIME64_3 = 1609587929392839161ULL;
+const wxUint64 XXH_PRIME64_4 = 9650029242287828579ULL;
+const wxUint64 XXH_PRIME64_5 = 2870177450012600261ULL;
+
+inline wxUint64 XXH_rotl64(wxUint64 x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline wxUint64 XXH_read64(const unsigned char* p)
+{
+    // little endian read, regardless of the host byte order
+    wxUint64 v = 0;
+    for(int i = 7; i >= 0; --i) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+inline wxUint32 XXH_read32(const unsigned char* p)
+{
+    return (wxUint32)p[0] | ((wxUint32)p[1] << 8) | ((wxUint32)p[2] << 16) | ((wxUint32)p[3] << 24);
+}
+
+inline wxUint64 XXH_round(wxUint64 acc, wxUint64 input)
+{
+    acc += input * XXH_PRIME64_2;
+    acc = XXH_rotl64(acc, 31);
+    return acc * XXH_PRIME64_1;
+}
+
+inline wxUint64 XXH_mergeRound(wxUint64 acc, wxUint64 val)
+{
+    acc ^= XXH_round(0, val);
+    return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+} // namespace
+
+wxUint64 FileUtils::Hash64(const char* data, size_t len)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    const unsigned char* end = p + len;
+    wxUint64 h = 0;
+
+    if(len >= 32) {
+        const unsigned char* limit = end - 32;
+        wxUint64 v1 = XXH_PRIME64_1 + XXH_PRIME64_2;
+        wxUint64 v2 = XXH_PRIME64_2;
+        wxUint64 v3 = 0;
+        wxUint64 v4 = 0 - XXH_PRIME64_1;
+        do {
+            v1 = XXH_round(v1, XXH_read64(p));
+            v2 = XXH_round(v2, XXH_read64(p + 8));
+            v3 = XXH_round(v3, XXH_read64(p + 16));
+            v4 = XXH_round(v4, XXH_read64(p + 24));
+            p += 32;
+        } while(p <= limit);
+
+        h = XXH_rotl64(v1, 1) + XXH_rotl64(v2, 7) + XXH_rotl64(v3, 12) + XXH_rotl64(v4, 18);
+        h = XXH_mergeRound(h, v1);
+        h = XXH_mergeRound(h, v2);
+        h = XXH_mergeRound(h, v3);
+        h = XXH_mergeRound(h, v4);
+    } else {
+        h = XXH_PRIME64_5;
+    }
+
+    h += (wxUint64)len;
+    while(p + 8 <= end) {
+        h ^= XXH_round(0, XXH_read64(p));
+        h = XXH_rotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+        p += 8;
+    }
+    if(p + 4 <= end) {
+        h ^= (wxUint64)XXH_read32(p) * XXH_PRIME64_1;
+        h = XXH_rotl64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        p += 4;
+    }
+    while(p < end) {
+        h ^= (*p) * XXH_PRIME64_5;
+        h = XXH_rotl64(h, 11) * XXH_PRIME64_1;
+        ++p;
+    }
+
+    // avalanche
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+bool FileUtils::GetFileHash(const wxFileName& fn, wxString& hash, size_t& size)
+{
+    std::string data;
+    if(!ReadFileContentRaw(fn, data)) { return false; }
+    size = data.length();
+    hash = wxString::Format("%016llx", (unsigned long long)Hash64(data.c_str(), data.length()));
+    return true;
+}
+
 void FileUtils::OpenFileExplorerAndSelect(const wxFileName& filename)
 {
 #ifdef __WXMSW__
@@ -55,6 +55,22 @@ public:
 public:
     static bool ReadFileContent(const wxFileName& fn, wxString& data, const wxMBConv& conv = wxConvUTF8);
 
+    /**
+     * @brief read the file content as raw bytes, without any conversion
+     */
+    static bool ReadFileContentRaw(const wxFileName& fn, std::string& data);
+
+    /**
+     * @brief return a fast, non cryptographic, 64 bit hash of a buffer (xxHash64)
+     */
+    static wxUint64 Hash64(const char* data, size_t len);
+
+    /**
+     * @brief compute the content hash (as hex string) and the size of a file
+     * @return false if the file could not be read
+     */
+    static bool GetFileHash(const wxFileName& fn, wxString& hash, size_t& size);
+
     /**
      * @brief attempt to read up to bufferSize from the beginning of file
      */
@@ -31,6 +31,9 @@
 #include "tag_tree.h"
 #include "fileentry.h"
 #include "entry.h"
+#include "cppwordscanner.h"
+#include "wxStringHash.h"
+#include <unordered_map>
 
 #define MAX_SEARCH_LIMIT 250
 
@@ -230,9 +233,12 @@ public:
     /**
      * @brief insert entry by file name
      * @param filename
+     * @param timestamp retag timestamp
+     * @param hash the file content hash, see FileUtils::GetFileHash()
+     * @param size the file size in bytes
      * @return
      */
-    virtual int InsertFileEntry(const wxString& filename, int timestamp) = 0;
+    virtual int InsertFileEntry(const wxString& filename, int timestamp, const wxString& hash, size_t size) = 0;
 
     /**
      * @brief update file entry using file name as key
@@ -499,6 +505,11 @@ public:
      */
     virtual void GetTagsByPartName(const wxArrayString& parts, std::vector<TagEntryPtr>& tags) = 0;
 
+    /**
+     * @brief return the tags with the given IDs (see clSymbolIndex)
+     */
+    virtual void GetTagsByIds(const std::vector<long>& ids, std::vector<TagEntryPtr>& tags) = 0;
+
     /**
      * @brief search for a single match in the database for an entry with a given name
      */
@@ -511,6 +522,37 @@ public:
     virtual void RemoveNonWorkspaceSymbols(const std::vector<wxString>& symbols,
                                            std::vector<wxString>& workspaceSymbols,
                                            std::vector<wxString>& nonWorkspaceSymbols) = 0;
+
+    /**
+     * @brief replace the identifiers stored for a file
+     * @param filename the file full path
+     * @param file the file modification time and size when the identifiers were collected
+     * @param identifiers the file identifiers, see clCxxLexicalClassifier::FindIdentifiers()
+     */
+    virtual void StoreIdentifiers(const wxString& filename, const CppIdentifiersFile& file,
+                                  const CppIdentifiersList& identifiers) = 0;
+
+    /**
+     * @brief the file was touched but its content did not change: keep its identifiers and
+     * record its new modification time and size
+     */
+    virtual void UpdateIdentifiersFile(const wxString& filename, const CppIdentifiersFile& file) = 0;
+
+    /**
+     * @brief delete the identifiers stored for the given files
+     */
+    virtual void DeleteIdentifiers(const wxArrayString& files) = 0;
+
+    /**
+     * @brief return the files that have their identifiers stored, with their modification time and size when
+     * the identifiers were collected
+     */
+    virtual void GetIdentifiersFiles(CppIdentifiersFile::Map_t& files) = 0;
+
+    /**
+     * @brief return all the stored occurrences of an identifier
+     */
+    virtual void GetIdentifierOccurrences(const wxString& name, CppIdentifier::Vec_t& occurrences) = 0;
 };
 
 enum { TagOk = 0, TagExist, TagError };
@@ -24,21 +24,30 @@
 //////////////////////////////////////////////////////////////////////////////
 #include "CxxScannerTokens.h"
 #include "CxxVariableScanner.h"
+#include "clCxxLexicalClassifier.h"
 #include "cl_command_event.h"
 #include "cl_standard_paths.h"
 #include "cpp_scanner.h"
+#include "cppwordscanner.h"
 #include "crawler_include.h"
 #include "ctags_manager.h"
 #include "file_logger.h"
 #include "fileutils.h"
 #include "istorage.h"
 #include "parse_thread.h"
+#include "performance.h"
 #include "pp_include.h"
 #include "pptable.h"
 #include "precompiled_header.h"
 #include "tags_storage_sqlite3.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <set>
 #include <tags_options_data.h>
+#include <thread>
 #include <wx/ffile.h>
 #include <wx/stopwatch.h>
 #include <wx/tokenzr.h>
@@ -66,6 +75,27 @@ wxDEFINE_EVENT(wxEVT_PARSE_THREAD_READY, wxCommandEvent);
 wxDEFINE_EVENT(wxEVT_PARSE_THREAD_SUGGEST_COLOUR_TOKENS, clCommandEvent);
 wxDEFINE_EVENT(wxEVT_PARSE_THREAD_SOURCE_TAGS, clCommandEvent);
 
+// Number of files stored in a single transaction when retagging the workspace
+#define RETAG_COMMIT_INTERVAL 500
+
+// Number of parsed files each retagging worker may keep ahead of the writer
+#define RETAG_WINDOW_PER_WORKER 32
+
+namespace
+{
+// A file parsed by one of the retagging workers
+struct ParsedFile {
+    wxString filename;
+    TagTreePtr tree;
+    CppIdentifiersList identifiers;
+    CppIdentifiersFile identifiersFile;
+    wxString hash;
+    size_t size = 0;
+    bool skipped = false;
+    bool done = false;
+};
+} // namespace
+
 static const wxString& WriteCodeLiteCCHelperFile()
 {
     // Due to heavy changes to shared_ptr in GCC 7.X and later
@@ -106,6 +136,7 @@ void ParseThread::ProcessRequest(ThreadRequest* request)
     // request is delete by the parent WorkerThread after this method is completed
     ParseRequest* req = (ParseRequest*)request;
     FileLogger::RegisterThread(wxThread::GetCurrentId(), "C++ Parser Thread");
+    CL_TRACE_SCOPE("ParseThread::ProcessRequest");
 
     // Filter non C++ files
     if(!req->_workspaceFiles.empty()) {
@@ -252,6 +283,11 @@ void ParseThread::ProcessSimple(ParseRequest* req)
     ITagsStoragePtr db(new TagsStorageSQLite());
     db->OpenDatabase(dbfile);
 
+    // Hash the content before we parse it: if the file is modified meanwhile, the next retag will notice it
+    wxString hash;
+    size_t size = 0;
+    FileUtils::GetFileHash(file, hash, size);
+
     // convert the file content into tags
     wxString tags;
     wxString file_name(req->getFile());
@@ -266,7 +302,19 @@ void ParseThread::ProcessSimple(ParseRequest* req)
     ///////////////////////////////////////////
     // update the file retag timestamp
     ///////////////////////////////////////////
-    db->InsertFileEntry(file, (int)time(NULL));
+    db->InsertFileEntry(file, (int)time(NULL), hash, size);
+
+    ////////////////////////////////////////////////
+    // Update the identifiers of the saved file
+    ////////////////////////////////////////////////
+    CppIdentifiersFile identifiersFile;
+    identifiersFile.lastModified = FileUtils::GetFileModificationTime(file);
+    identifiersFile.size = FileUtils::GetFileSize(file);
+    CppIdentifiersList identifiers;
+    wxString text;
+    CppWordScanner::ReadFile(file, text);
+    clCxxLexicalClassifier::FindIdentifiers(text, identifiers);
+    db->StoreIdentifiers(file, identifiersFile, identifiers);
 
     ////////////////////////////////////////////////
     // Parse and store the macros found in this file
@@ -277,6 +325,7 @@ void ParseThread::ProcessSimple(ParseRequest* req)
     PPTable::Instance()->Clear();
 
     db->Commit();
+    TagsManagerST::Get()->UpdateSymbolIndex(wxArrayString(1, &file_name));
 
     // Parse the saved file to get a list of files to include
     ParseIncludeFiles(req, file, db);
@@ -340,12 +389,20 @@ void ParseThread::ParseAndStoreFiles(ParseRequest* req, const wxArrayString& arr
 {
     // Loop over the files and parse them
     int totalSymbols(0);
+    wxArrayString hashes;
+    std::vector<size_t> sizes(arrFiles.GetCount(), 0);
+    hashes.Alloc(arrFiles.GetCount());
     DEBUG_MESSAGE(wxString::Format(wxT("Parsing and saving files to database....")));
     for(size_t i = 0; i < arrFiles.GetCount(); i++) {
 
         // give a shutdown request a chance
         TEST_DESTROY();
 
+        // Hash the content before we parse it
+        wxString hash;
+        FileUtils::GetFileHash(arrFiles.Item(i), hash, sizes[i]);
+        hashes.Add(hash);
+
         wxString tags; // output
         TagsManagerST::Get()->SourceToTags(arrFiles.Item(i), tags);
 
@@ -355,7 +412,8 @@ void ParseThread::ParseAndStoreFiles(ParseRequest* req, const wxArrayString& arr
     DEBUG_MESSAGE(wxString(wxT("Done")));
 
     // Update the retagging timestamp
-    TagsManagerST::Get()->UpdateFilesRetagTimestamp(arrFiles, db);
+    TagsManagerST::Get()->UpdateFilesRetagTimestamp(arrFiles, hashes, sizes, db);
+    TagsManagerST::Get()->UpdateSymbolIndex(arrFiles);
 
     if(req->_evtHandler) {
         wxCommandEvent e(wxEVT_PARSE_THREAD_MESSAGE);
@@ -385,92 +443,213 @@ void ParseThread::ProcessDeleteTagsOfFiles(ParseRequest* req)
     ITagsStoragePtr db(new TagsStorageSQLite());
 
     db->OpenDatabase(dbfile);
-    db->Begin();
 
     wxArrayString file_array;
-
     for(size_t i = 0; i < req->_workspaceFiles.size(); i++) {
-        wxString filename(req->_workspaceFiles.at(i).c_str(), wxConvUTF8);
-        db->DeleteByFileName(wxFileName(), filename, false);
-        file_array.Add(filename);
+        file_array.Add(wxString(req->_workspaceFiles.at(i).c_str(), wxConvUTF8));
     }
 
-    db->DeleteFromFiles(file_array);
-    db->Commit();
+    DoDeleteTagsOfFiles(file_array, db);
     DEBUG_MESSAGE(wxString(wxT("ParseThread::ProcessDeleteTagsOfFile - completed")));
 }
 
-void ParseThread::ProcessParseAndStore(ParseRequest* req)
+void ParseThread::DoDeleteTagsOfFiles(const wxArrayString& files, ITagsStoragePtr db)
 {
-    wxString dbfile = req->getDbfile();
+    if(files.IsEmpty()) { return; }
 
-    // convert the file to tags
-    double maxVal = (double)req->_workspaceFiles.size();
-    if(maxVal == 0.0) { return; }
+    db->Begin();
+    for(size_t i = 0; i < files.size(); i++) {
+        db->DeleteByFileName(wxFileName(), files.Item(i), false);
+    }
+
+    db->DeleteFromFiles(files);
+    db->DeleteIdentifiers(files);
+    db->Commit();
+    TagsManagerST::Get()->UpdateSymbolIndex(files);
+}
 
-    // we report every 10%
-    double reportingPoint = maxVal / 100.0;
-    reportingPoint = ceil(reportingPoint);
-    if(reportingPoint == 0.0) { reportingPoint = 1.0; }
+void ParseThread::ProcessParseAndStore(ParseRequest* req)
+{
+    wxString dbfile = req->getDbfile();
+    if(req->_workspaceFiles.empty()) { return; }
 
     ITagsStoragePtr db(new TagsStorageSQLite());
     db->OpenDatabase(dbfile);
 
-    // We commit every 10 files
-    db->Begin();
-    int precent(0);
-    int lastPercentageReported(0);
+    if(req->_quickRetag) {
+        // Remove the files which do not need retag. This hashes the files that were touched,
+        // which is why it is done here and not by the caller
+        wxArrayString files;
+        files.Alloc(req->_workspaceFiles.size());
+        for(size_t i = 0; i < req->_workspaceFiles.size(); i++) {
+            files.Add(wxString(req->_workspaceFiles.at(i).c_str(), wxConvUTF8));
+        }
+        TagsManagerST::Get()->FilterNonNeededFilesForRetaging(files, db);
+
+        if(files.IsEmpty()) {
+            if(req->_evtHandler) {
+                wxCommandEvent retaggingCompletedEvent(wxEVT_PARSE_THREAD_RETAGGING_COMPLETED);
+                req->_evtHandler->AddPendingEvent(retaggingCompletedEvent);
+            }
+            return;
+        }
+
+        // Remove the tags belonging to these files
+        DoDeleteTagsOfFiles(files, db);
+        req->_workspaceFiles.clear();
+        req->_workspaceFiles.reserve(files.size());
+        for(size_t i = 0; i < files.size(); i++) {
+            req->_workspaceFiles.push_back(files.Item(i).mb_str(wxConvUTF8).data());
+        }
+    }
 
     // Prepend our hack file to the list of files to parse
     const wxString& hackfile = WriteCodeLiteCCHelperFile();
     req->_workspaceFiles.insert(req->_workspaceFiles.begin(), hackfile.ToStdString());
+
+    // convert the file to tags
+    double maxVal = (double)req->_workspaceFiles.size();
+
+    // We commit every RETAG_COMMIT_INTERVAL files
+    db->Begin();
+    int precent(0);
+    int lastPercentageReported(0);
     PPTable::Instance()->Clear();
 
-    for(size_t i = 0; i < maxVal; i++) {
+    // The files are parsed by several workers, each one talking to its own indexer
+    // process. This thread is the single writer: it scans the macros and stores the
+    // parsed files in the original order, in large transactions
+    std::vector<ParsedFile> parsedFiles(req->_workspaceFiles.size());
+    std::mutex lock;
+    std::condition_variable cv;
+    std::atomic_size_t nextFile(0);
+    std::atomic_size_t storedFiles(0);
+    std::atomic_bool cancelled(false);
+
+    size_t workersCount = std::min(TagsManagerST::Get()->GetIndexersCount(), parsedFiles.size());
+    size_t window = RETAG_WINDOW_PER_WORKER * workersCount;
+
+    std::vector<std::thread> workers;
+    for(size_t w = 0; w < workersCount; ++w) {
+        workers.push_back(std::thread([&, w]() {
+            while(!cancelled.load()) {
+                size_t index = nextFile.fetch_add(1);
+                if(index >= parsedFiles.size()) { break; }
+
+                // Dont get too far ahead of the writer, the parsed trees are kept in memory
+                {
+                    std::unique_lock<std::mutex> guard(lock);
+                    while(!cancelled.load() && index >= (storedFiles.load() + window)) {
+                        cv.wait_for(guard, std::chrono::milliseconds(50));
+                    }
+                }
+                if(cancelled.load()) { break; }
+
+                ParsedFile& parsed = parsedFiles[index];
+                {
+                    wxFileName curFile(wxString(req->_workspaceFiles[index].c_str(), wxConvUTF8));
+                    parsed.filename = curFile.GetFullPath();
+
+                    // Skip binary files
+                    if(TagsManagerST::Get()->IsBinaryFile(parsed.filename)) {
+                        parsed.skipped = true;
+                    } else if(!TagsManagerST::Get()->IsIndexerRunning()) {
+                        // Leave the file out of the FILES table, so the next retag parses it
+                        clWARNING() << "Indexer process is not running..." << clEndl;
+                        parsed.skipped = true;
+                    } else {
+                        // Hash the content before we parse it: if the file is modified meanwhile,
+                        // the next retag will notice it
+                        parsed.identifiersFile.lastModified = FileUtils::GetFileModificationTime(curFile);
+                        FileUtils::GetFileHash(curFile, parsed.hash, parsed.size);
+                        parsed.identifiersFile.size = parsed.size;
+
+                        wxString tags;
+                        TagsManagerST::Get()->SourceToTags(curFile, tags, w);
+                        int count = 0;
+                        parsed.tree = TagsManagerST::Get()->TreeFromTags(tags, count);
+
+                        // Collect the identifiers for the references index (Find References / Rename Symbol)
+                        wxString text;
+                        CppWordScanner::ReadFile(parsed.filename, text);
+                        clCxxLexicalClassifier::FindIdentifiers(text, parsed.identifiers);
+                    }
+                }
 
-        // give a shutdown request a chance
-        if(TestDestroy()) {
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    parsed.done = true;
+                }
+                cv.notify_all();
+            }
+        }));
+    }
+
+    for(size_t i = 0; i < parsedFiles.size(); i++) {
+        ParsedFile& parsed = parsedFiles[i];
+        bool ready = false;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            // give a shutdown request a chance
+            while(!parsed.done && !TestDestroy()) {
+                cv.wait_for(guard, std::chrono::milliseconds(50));
+            }
+            ready = parsed.done;
+        }
+
+        if(!ready || TestDestroy()) {
             // Do an ordered shutdown:
-            // rollback any transaction
+            // stop the workers, rollback any transaction
             // and close the database
+            cancelled.store(true);
+            cv.notify_all();
+            std::for_each(workers.begin(), workers.end(), [&](std::thread& worker) { worker.join(); });
             db->Rollback();
             return;
         }
 
-        wxFileName curFile(wxString(req->_workspaceFiles[i].c_str(), wxConvUTF8));
+        if(parsed.skipped) {
+            DEBUG_MESSAGE(wxString::Format(wxT("Skipping file %s"), parsed.filename.c_str()));
 
-        // Skip binary files
-        if(TagsManagerST::Get()->IsBinaryFile(curFile.GetFullPath())) {
-            DEBUG_MESSAGE(wxString::Format(wxT("Skipping binary file %s"), curFile.GetFullPath().c_str()));
-            continue;
-        }
+        } else {
+            // Send notification to the main window with our progress report
+            precent = (int)((i / maxVal) * 100);
 
-        // Send notification to the main window with our progress report
-        precent = (int)((i / maxVal) * 100);
+            if(req->_evtHandler && lastPercentageReported != precent) {
+                lastPercentageReported = precent;
+                wxCommandEvent retaggingProgressEvent(wxEVT_PARSE_THREAD_RETAGGING_PROGRESS);
+                retaggingProgressEvent.SetInt((int)precent);
+                req->_evtHandler->AddPendingEvent(retaggingProgressEvent);
+            }
 
-        if(req->_evtHandler && lastPercentageReported != precent) {
-            lastPercentageReported = precent;
-            wxCommandEvent retaggingProgressEvent(wxEVT_PARSE_THREAD_RETAGGING_PROGRESS);
-            retaggingProgressEvent.SetInt((int)precent);
-            req->_evtHandler->AddPendingEvent(retaggingProgressEvent);
-        }
+            PPScan(parsed.filename, false);
 
-        TagTreePtr tree = TagsManagerST::Get()->ParseSourceFile(curFile);
-        PPScan(curFile.GetFullPath(), false);
+            db->Store(parsed.tree, wxFileName(), false);
+            db->StoreIdentifiers(parsed.filename, parsed.identifiersFile, parsed.identifiers);
+            if(db->InsertFileEntry(parsed.filename, (int)time(NULL), parsed.hash, parsed.size) == TagExist) {
+                db->UpdateFileEntry(parsed.filename, (int)time(NULL));
+            }
 
-        db->Store(tree, wxFileName(), false);
-        if(db->InsertFileEntry(curFile.GetFullPath(), (int)time(NULL)) == TagExist) {
-            db->UpdateFileEntry(curFile.GetFullPath(), (int)time(NULL));
+            if(i % RETAG_COMMIT_INTERVAL == 0) {
+                // Commit what we got so far
+                db->Commit();
+                // Start a new transaction
+                db->Begin();
+            }
         }
 
-        if(i % 50 == 0) {
-            // Commit what we got so far
-            db->Commit();
-            // Start a new transaction
-            db->Begin();
+        // release the tree and let the workers continue
+        parsed.tree.Reset(NULL);
+        parsed.identifiers.Clear();
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            storedFiles.store(i + 1);
         }
+        cv.notify_all();
     }
 
+    std::for_each(workers.begin(), workers.end(), [&](std::thread& worker) { worker.join(); });
+
     // Process the macros
     // PPTable::Instance()->Squeeze();
     const std::map<wxString, PPToken>& table = PPTable::Instance()->GetTable();
@@ -484,6 +663,13 @@ void ParseThread::ProcessParseAndStore(ParseRequest* req)
     // Clear the results
     PPTable::Instance()->Clear();
 
+    wxArrayString storedFiles;
+    storedFiles.Alloc(req->_workspaceFiles.size());
+    for(size_t i = 0; i < req->_workspaceFiles.size(); i++) {
+        storedFiles.Add(wxString(req->_workspaceFiles.at(i).c_str(), wxConvUTF8));
+    }
+    TagsManagerST::Get()->UpdateSymbolIndex(storedFiles);
+
     /// Send notification to the main window with our progress report
     if(req->_evtHandler) {
         wxCommandEvent retaggingCompletedEvent(wxEVT_PARSE_THREAD_RETAGGING_COMPLETED);
@@ -603,6 +789,7 @@ void ParseThread::ProcessSimpleNoIncludes(ParseRequest* req)
     db->OpenDatabase(dbfile);
 
     TagsManagerST::Get()->FilterNonNeededFilesForRetaging(filesArr, db);
+    DoDeleteTagsOfFiles(filesArr, db);
     ParseAndStoreFiles(req, filesArr, -1, db);
 
     if(req->_evtHandler) {
@@ -651,6 +838,7 @@ void ParseThread::DoNotifyReady(wxEvtHandler* caller, int requestType)
 
 void ParseThread::ProcessColourRequest(ParseRequest* req)
 {
+    CL_TRACE_SCOPE("ParseThread::ProcessColourRequest");
     CxxTokenizer tokenizer;
     // read the file content
     wxString content;
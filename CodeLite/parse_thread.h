@@ -154,6 +154,7 @@ private:
     virtual ~ParseThread();
 
     void DoStoreTags(const wxString& tags, const wxString& filename, int& count, ITagsStoragePtr db);
+    void DoDeleteTagsOfFiles(const wxArrayString& files, ITagsStoragePtr db);
     TagTreePtr DoTreeFromTags(const wxString& tags, int& count);
     void DoNotifyReady(wxEvtHandler* caller, int requestType);
 
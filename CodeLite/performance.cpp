@@ -26,58 +26,185 @@
 #define __PERFORMANCE
 #include "performance.h"
 
-#ifdef __WXMSW__
-
-#include <assert.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
 #include <stdio.h>
-#include <string>
+#include <thread>
 #include <vector>
-#include <windows.h>
-
-#if 0
-static FILE* dbgFile(NULL);
-static std::string output = "";
-static std::vector<std::pair<DWORD, DWORD> > tickCounts;
-#endif
-void PERF_OUTPUT(const char* path) 
-{ 
-#if 0
-    output = path; 
-#endif
+#include <wx/thread.h>
+
+// Max spans recorded per thread, the others are dropped
+#define TRACE_MAX_EVENTS_PER_THREAD 1000000
+
+std::atomic_bool clTracer::ms_enabled(false);
+
+namespace
+{
+struct TraceEvent {
+    const char* name = nullptr;
+    std::string dynamicName; // when 'name' is null
+    long long start = 0;
+    long long duration = 0;
+};
+
+struct ThreadBuffer {
+    std::mutex lock; // only contended while the trace is written
+    std::vector<TraceEvent> events;
+    std::vector<std::pair<const char*, long long> > stack; // open spans, owner thread only
+    size_t dropped = 0;
+    int tid = 0;
+    bool isMain = false;
+};
+typedef std::shared_ptr<ThreadBuffer> ThreadBufferPtr_t;
+
+std::mutex g_buffersLock;
+std::vector<ThreadBufferPtr_t> g_buffers; // kept after their thread exits
+std::string g_filename;
+int g_nextTid = 1;
+
+ThreadBuffer& GetThreadBuffer()
+{
+    static thread_local ThreadBufferPtr_t buffer;
+    if(!buffer) {
+        buffer.reset(new ThreadBuffer());
+        buffer->isMain = wxThread::IsMain();
+        std::lock_guard<std::mutex> guard(g_buffersLock);
+        buffer->tid = g_nextTid++;
+        g_buffers.push_back(buffer);
+    }
+    return *buffer;
 }
 
-void PERF_START(const char* func_name)
-{
-#if 0
-    if(!dbgFile) {
-        dbgFile = fopen(output.c_str(), "w+");
-        assert(dbgFile != 0);
+void Record(ThreadBuffer& buffer, const char* name, const std::string& dynamicName, long long start, long long end)
+{
+    std::lock_guard<std::mutex> guard(buffer.lock);
+    if(buffer.events.size() >= TRACE_MAX_EVENTS_PER_THREAD) {
+        ++buffer.dropped;
+        return;
     }
-    fprintf(dbgFile, "%*c<block name=\"%s\">\n", 4 * tickCounts.size(), ' ', func_name);
-    fflush(dbgFile);
-    tickCounts.push_back(std::make_pair(DWORD(GetTickCount()), DWORD(0)));
-#endif
+    buffer.events.push_back(TraceEvent());
+    TraceEvent& event = buffer.events.back();
+    event.name = name;
+    if(!name) { event.dynamicName = dynamicName; }
+    event.start = start;
+    event.duration = end - start;
 }
 
-void PERF_END()
-{
-#if 0
-    assert(dbgFile != 0);
-    if(tickCounts.empty()) { return; }
-    DWORD tickCount = GetTickCount();
-    DWORD elapsed = tickCount - tickCounts.back().first;
-    DWORD unaccounted = elapsed - tickCounts.back().second;
-
-    fprintf(dbgFile, "%*c<elapsed time=\"%ld\"", 4 * tickCounts.size(), ' ', elapsed);
-    if(0 < unaccounted && unaccounted < elapsed) { fprintf(dbgFile, " unaccounted=\"%ld\"", unaccounted); }
-    fprintf(dbgFile, "/>\n");
-
-    tickCounts.pop_back();
-    if(!tickCounts.empty()) { tickCounts.back().second += elapsed; }
-
-    fprintf(dbgFile, "%*c</block>\n", 4 * tickCounts.size(), ' ');
-    fflush(dbgFile);
-#endif
+void WriteJSONString(FILE* fp, const char* str)
+{
+    fputc('"', fp);
+    for(; *str; ++str) {
+        unsigned char ch = *str;
+        if(ch == '"' || ch == '\\') {
+            fputc('\\', fp);
+            fputc(ch, fp);
+        } else if(ch < 0x20) {
+            fprintf(fp, "\\u%04x", ch);
+        } else {
+            fputc(ch, fp);
+        }
+    }
+    fputc('"', fp);
+}
+} // namespace
+
+long long clTracer::Now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
 }
 
-#endif
+void clTracer::Start(const std::string& filename)
+{
+    {
+        std::lock_guard<std::mutex> guard(g_buffersLock);
+        g_filename = filename;
+    }
+    ms_enabled.store(true);
+}
+
+std::string clTracer::GetFileName()
+{
+    std::lock_guard<std::mutex> guard(g_buffersLock);
+    return g_filename;
+}
+
+void clTracer::Begin(const char* name)
+{
+    GetThreadBuffer().stack.push_back({ name, Now() });
+}
+
+void clTracer::End()
+{
+    ThreadBuffer& buffer = GetThreadBuffer();
+    if(buffer.stack.empty()) { return; }
+    std::pair<const char*, long long> span = buffer.stack.back();
+    buffer.stack.pop_back();
+    // Tracing may have been switched off since the span was opened
+    if(IsEnabled()) { Record(buffer, span.first, std::string(), span.second, Now()); }
+}
+
+void clTracer::AddSpan(const std::string& name, long long start, long long end)
+{
+    if(!IsEnabled()) { return; }
+    Record(GetThreadBuffer(), nullptr, name, start, end);
+}
+
+void clTracer::Stop()
+{
+    if(!ms_enabled.exchange(false)) { return; }
+
+    std::vector<ThreadBufferPtr_t> buffers;
+    std::string filename;
+    {
+        std::lock_guard<std::mutex> guard(g_buffersLock);
+        buffers = g_buffers;
+        filename = g_filename;
+    }
+    if(filename.empty()) { return; }
+
+    FILE* fp = fopen(filename.c_str(), "w+");
+    if(!fp) { return; }
+
+    // The Chrome trace event format: an array of "complete" events, plus the thread names
+    fprintf(fp, "{\"traceEvents\":[\n");
+    bool first = true;
+    for(size_t i = 0; i < buffers.size(); ++i) {
+        ThreadBuffer& buffer = *buffers[i];
+        std::lock_guard<std::mutex> guard(buffer.lock);
+        fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s%d\"}}",
+                first ? "" : ",\n", buffer.tid, buffer.isMain ? "Main " : "Thread ", buffer.tid);
+        first = false;
+        for(size_t j = 0; j < buffer.events.size(); ++j) {
+            const TraceEvent& event = buffer.events[j];
+            fprintf(fp, ",\n{\"name\":");
+            WriteJSONString(fp, event.name ? event.name : event.dynamicName.c_str());
+            fprintf(fp, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lld,\"dur\":%lld}", buffer.tid, event.start,
+                    event.duration);
+        }
+        if(buffer.dropped) {
+            fprintf(fp, ",\n{\"name\":\"%lu spans dropped\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"ts\":%lld}",
+                    (unsigned long)buffer.dropped, buffer.tid, buffer.events.empty() ? 0LL : buffer.events.back().start);
+        }
+        buffer.events.clear();
+        buffer.dropped = 0;
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+}
+
+// Legacy API
+void PERF_OUTPUT(const char* path) { clTracer::Start(path); }
+
+void PERF_START(const char* func_name)
+{
+    if(clTracer::IsEnabled()) { clTracer::Begin(func_name); }
+}
+
+void PERF_END()
+{
+    if(clTracer::IsEnabled()) { clTracer::End(); }
+}
@@ -1,32 +1,51 @@
-//////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////
-//
-// copyright            : (C) 2009 by Eran Ifrah
-// file name            : performance.h
-//
-// -------------------------------------------------------------------------
-// A
-//              _____           _      _     _ _
-//             /  __ \         | |    | |   (_) |
-//             | /  \/ ___   __| | ___| |    _| |_ ___
-//             | |    / _ \ / _  |/ _ \ |   | | __/ _ )
-//             | \__/\ (_) | (_| |  __/ |___| | ||  __/
-//              \____/\___/ \__,_|\___\_____/_|\__\___|
-//
-//                                                  F i l e
-//
-//    This program is free software; you can redistribute it and/or modify
-//    it under the terms of the GNU General Public License as published by
-//    the Free Software Foundation; either version 2 of the License, or
-//    (at your option) any later version.
-//
-//////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////
-
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+//
+// copyright            : (C) 2009 by Eran Ifrah
+// file name            : performance.h
+//
+// -------------------------------------------------------------------------
+// A
+//              _____           _      _     _ _
+//             /  __ \         | |    | |   (_) |
+//             | /  \/ ___   __| | ___| |    _| |_ ___
+//             | |    / _ \ / _  |/ _ \ |   | | __/ _ )
+//             | \__/\ (_) | (_| |  __/ |___| | ||  __/
+//              \____/\___/ \__,_|\___\_____/_|\__\___|
+//
+//                                                  F i l e
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
 #ifndef __PERFORMANCE_H__
 #define __PERFORMANCE_H__
 
-// Usage: in your file that you want to profile, first do this:
+// Tracing
+// -------
+// Put a scoped span in the code you want to trace:
+//
+//     CL_TRACE_FUNCTION();          -- at the top of a function, traces the whole function
+//     CL_TRACE_SCOPE("some name");  -- traces the enclosing scope. The name must be a string literal
+//
+// The spans are always compiled in and cost a single atomic load when tracing is off. Tracing is switched on at
+// runtime with clTracer::Start() and the trace is written by clTracer::Stop(). In codelite, use the
+// "Help > Record a Performance Trace" menu entry to start and stop it, or set the CODELITE_TRACE environment
+// variable to an output file to trace a whole session, startup included. Each thread records its spans into its
+// own buffer.
+//
+// The output is in the Chrome trace event format: open it with chrome://tracing or https://ui.perfetto.dev
+//
+// Define CL_DISABLE_TRACING to compile all the spans out.
+//
+// Profiling (legacy)
+// ------------------
+// In your file that you want to profile, first do this:
 //     #define __PERFORMANCE
 //     #include "performance.h"
 // (Just comment out the #define __PERFORMANCE when you're done.)
@@ -43,32 +62,79 @@
 //    [your code here]
 //    PERF_END();
 //
-// Output is sent to file "codelite.perf" in the startup directory.  The file is opened automatically for you.  It is
-// overwritten on each run.
-//
-// Output format is XML, so you can use xml tools, or view the file in a folding editor.  Looks like this:
-//     <block name="Function Signature|Your Comment">
-//        <block ...>
-//           ...
-//       </block>
-//       ...
-//       <elapsed .../>
-//    </block>
-//
-// The <elapsed> element shows the time spent for the entire block it is in, and includes an optional "unaccounted"
-// attribute for any ticks not counted by inner blocks (so you know how much time you're missing from profiled
-//  subfunctions).
-
-#include "codelite_exports.h"
+// These are recorded as spans of the tracer above. PERF_OUTPUT(path) starts the tracer.
 
-#ifdef __PERFORMANCE
-    #ifdef __WXMSW__ 
-        //Uncomment this to globally disable all profiling
-        //#undef __PERFORMANCE
-    #else
-        // Don't change this
-        #undef __PERFORMANCE
-    #endif
+#include "codelite_exports.h"
+#include <atomic>
+#include <string>
+
+class WXDLLIMPEXP_CL clTracer
+{
+    static std::atomic_bool ms_enabled;
+
+public:
+    static bool IsEnabled() { return ms_enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief start recording. The trace is written into 'filename' when Stop() is called
+     */
+    static void Start(const std::string& filename);
+
+    /**
+     * @brief stop recording and write the trace file
+     */
+    static void Stop();
+
+    /**
+     * @brief the file passed to the last call to Start()
+     */
+    static std::string GetFileName();
+
+    /**
+     * @brief a timestamp in microseconds, as used by the tracer
+     */
+    static long long Now();
+
+    /**
+     * @brief open a span on the current thread. 'name' must outlive the tracer (e.g. a string literal)
+     */
+    static void Begin(const char* name);
+
+    /**
+     * @brief close the last span opened on the current thread
+     */
+    static void End();
+
+    /**
+     * @brief record a span that does not match a scope, e.g. a request and its response. Timestamps are from Now()
+     */
+    static void AddSpan(const std::string& name, long long start, long long end);
+};
+
+class clTraceScope
+{
+    bool m_active;
+
+public:
+    clTraceScope(const char* name)
+        : m_active(clTracer::IsEnabled())
+    {
+        if(m_active) { clTracer::Begin(name); }
+    }
+    ~clTraceScope()
+    {
+        if(m_active) { clTracer::End(); }
+    }
+};
+
+#ifdef CL_DISABLE_TRACING
+    #define CL_TRACE_SCOPE(name)
+    #define CL_TRACE_FUNCTION()
+#else
+    #define CL_TRACE_CONCAT_IMPL(a, b) a##b
+    #define CL_TRACE_CONCAT(a, b) CL_TRACE_CONCAT_IMPL(a, b)
+    #define CL_TRACE_SCOPE(name) clTraceScope CL_TRACE_CONCAT(__clTraceScope, __LINE__)(name)
+    #define CL_TRACE_FUNCTION() CL_TRACE_SCOPE(__FUNCTION__)
 #endif
 
 #ifdef __PERFORMANCE
@@ -30,6 +30,11 @@
 #include "fileextmanager.h"
 #include "event_notifier.h"
 #include "search_thread.h"
+#include "fileutils.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <unordered_set>
 #if wxUSE_GUI
 #include <wx/progdlg.h>
 #include <wx/sizer.h>
@@ -39,6 +44,12 @@
 wxDEFINE_EVENT(wxEVT_REFACTOR_ENGINE_REFERENCES, clRefactoringEvent);
 wxDEFINE_EVENT(wxEVT_REFACTOR_ENGINE_RENAME_SYMBOL, clRefactoringEvent);
 
+// Number of files loaded (in parallel) ahead of the matches verification
+#define REFACTOR_FILES_WINDOW 64
+
+// Max number of threads used to load the files
+#define REFACTOR_MAX_THREADS 8
+
 RefactoringEngine::RefactoringEngine()
 {
     Bind(wxEVT_SEARCH_THREAD_MATCHFOUND, &RefactoringEngine::OnSearchMatch, this);
@@ -349,13 +360,10 @@ void RefactoringEngine::DoFindReferences(const wxString& symname, const wxFileNa
     m_refactorSource.Reset();
     if(!DoResolveWord(states, fn, pos + symname.Len(), line, symname, &m_refactorSource)) return;
 
-    // Now that we got here, ask the search thread to search for this symbol in the list of input files
-    SearchData sd;
-    sd.SetFindString(symname);
-    sd.SetEnablePipeSupport(false);
-    sd.SetMatchCase(true);
-    sd.SetMatchWholeWord(true);
-    sd.SetRegularExpression(false);
+    m_currentAction = type;
+    m_symbolName = symname;
+    m_onlyDefiniteMatches = onlyDefiniteMatches;
+
     wxArrayString filesArray;
     filesArray.reserve(files.size());
     for(const wxFileName& fn : files) {
@@ -363,32 +371,129 @@ void RefactoringEngine::DoFindReferences(const wxString& symname, const wxFileNa
         filesArray.Add(fn.GetFullPath());
     }
 
-    sd.SetFiles(filesArray);
-    sd.SetOwner(this); // send back the events here
-
     // based on the input file, set the file extensions
     wxString extensions;
     FileExtManager::FileType fileType = FileExtManager::GetType(fn.GetFullName(), FileExtManager::TypeText);
     switch(fileType) {
     case FileExtManager::TypeSourceC:
     case FileExtManager::TypeSourceCpp:
-    case FileExtManager::TypeHeader:
+    case FileExtManager::TypeHeader: {
         extensions = "*.cpp;*.c;*.h;*.hpp;*.cxx;*.cc;";
+        // Start from the occurrences stored in the identifiers index, only the files that are not
+        // indexed (or were modified since) need to be searched
+        wxArrayString notIndexed;
+        DoFindIndexedReferences(symname, filesArray, notIndexed);
+        filesArray.swap(notIndexed);
         break;
+    }
     default:
         extensions = "*";
         break;
     }
+
+    if(filesArray.IsEmpty()) {
+        // Nothing to search
+        CallAfter(&RefactoringEngine::DoCompleteFindReferences);
+        return;
+    }
+
+    // Now that we got here, ask the search thread to search for this symbol in the list of input files
+    SearchData sd;
+    sd.SetFindString(symname);
+    sd.SetEnablePipeSupport(false);
+    sd.SetMatchCase(true);
+    sd.SetMatchWholeWord(true);
+    sd.SetRegularExpression(false);
+    sd.SetFiles(filesArray);
+    sd.SetOwner(this); // send back the events here
     sd.SetExtensions(extensions); // All the files in the list should be scanned
     sd.SetEncoding("ISO-8859-1");
     m_seartchThread->PerformSearch(sd);
-    m_currentAction = type;
-    m_symbolName = symname;
-    m_onlyDefiniteMatches = onlyDefiniteMatches;
 
     // Find references will complete when the 'Find in files' action is completed
 }
 
+void RefactoringEngine::DoFindIndexedReferences(const wxString& symname, const wxArrayString& files,
+                                                wxArrayString& notIndexed)
+{
+    ITagsStoragePtr db = TagsManagerST::Get()->GetDatabase();
+    CppIdentifiersFile::Map_t indexedFiles;
+    if(db) { db->GetIdentifiersFiles(indexedFiles); }
+
+    // An entry is used only if the file was not modified since it was indexed. The modification time
+    // has a one second resolution, compare the size as well
+    std::unordered_set<wxString> upToDate;
+    for(size_t i = 0; i < files.size(); ++i) {
+        const wxString& file = files.Item(i);
+        CppIdentifiersFile::Map_t::const_iterator iter = indexedFiles.find(file);
+        if(iter != indexedFiles.end() && iter->second.lastModified == FileUtils::GetFileModificationTime(file) &&
+           iter->second.size == FileUtils::GetFileSize(file)) {
+            upToDate.insert(file);
+        } else {
+            notIndexed.Add(file);
+        }
+    }
+    if(upToDate.empty()) { return; }
+
+    CppIdentifier::Vec_t occurrences;
+    db->GetIdentifierOccurrences(symname, occurrences);
+    for(const CppIdentifier& occurrence : occurrences) {
+        if(upToDate.count(occurrence.filename) == 0) { continue; }
+        CppToken tok;
+        tok.setFilename(occurrence.filename);
+        tok.setLineNumber(occurrence.line);
+        tok.setOffset(occurrence.offset);
+        tok.setName(symname);
+        // Only the code occurrences are stored in the index
+        m_tokens.push_back(std::move(tok));
+    }
+    clDEBUG() << "Find references:" << upToDate.size() << "files found in the identifiers index," << notIndexed.size()
+              << "files need to be searched" << clEndl;
+}
+
+size_t RefactoringEngine::DoLoadStates(const CppToken::Vec_t& tokens, size_t first,
+                                       std::unordered_map<wxString, TextStatesPtr>& states)
+{
+    // The tokens are grouped by file: take the files of the next tokens
+    std::vector<wxString> files;
+    size_t last = first;
+    for(; last < tokens.size(); ++last) {
+        if(files.empty() || files.back() != tokens[last].getFilename()) {
+            if(files.size() == REFACTOR_FILES_WINDOW) { break; }
+            files.push_back(tokens[last].getFilename());
+        }
+    }
+
+    // Reading the files and computing their states does not involve the parser, do it in parallel
+    std::vector<TextStatesPtr> loaded(files.size());
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        while(true) {
+            size_t i = next.fetch_add(1);
+            if(i >= files.size()) { break; }
+            CppWordScanner scanner(files[i]);
+            loaded[i] = scanner.states();
+        }
+    };
+
+    size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), REFACTOR_MAX_THREADS);
+    threads = std::min(threads, files.size());
+    std::vector<std::thread> workers;
+    for(size_t i = 1; i < threads; ++i) {
+        workers.push_back(std::thread(worker));
+    }
+    worker();
+    for(size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+
+    states.clear();
+    for(size_t i = 0; i < files.size(); ++i) {
+        states[files[i]] = loaded[i];
+    }
+    return last;
+}
+
 TagEntryPtr RefactoringEngine::SyncSignature(const wxFileName& fn, int line, int pos, const wxString& word,
                                              const wxString& text, const wxString& expr)
 {
@@ -448,15 +553,22 @@ void RefactoringEngine::DoCompleteFindReferences()
     // Load all tokens, first we need to parse the workspace files...
     CppToken::Vec_t tokens = std::move(m_tokens);
 
+    // Group the tokens by file, the files are loaded in batches (see DoLoadStates)
+    std::stable_sort(tokens.begin(), tokens.end(), [](const CppToken& a, const CppToken& b) {
+        return a.getFilename() < b.getFilename();
+    });
+
     RefactorSource target;
     int counter(0);
 
-    TextStatesPtr statesPtr(NULL);
-    wxString statesPtrFileName;
+    std::unordered_map<wxString, TextStatesPtr> loadedStates;
+    size_t nextToLoad = 0;
 #if wxUSE_GUI
     clProgressDlg* prgDlg = CreateProgressDialog(_("Parsing matches..."), (int)tokens.size());
 #endif
-    for(CppToken& token : tokens) {
+    for(size_t i = 0; i < tokens.size(); ++i) {
+        CppToken& token = tokens[i];
+        if(i == nextToLoad) { nextToLoad = DoLoadStates(tokens, i, loadedStates); }
         wxFileName f(token.getFilename());
 #if wxUSE_GUI
         wxString msg;
@@ -472,15 +584,16 @@ void RefactoringEngine::DoCompleteFindReferences()
         // reset the result
         target.Reset();
 
-        if(!statesPtr || statesPtrFileName != token.getFilename()) {
-            // Create new statesPtr
-            CppWordScanner sc(token.getFilename());
-            statesPtr = sc.states();
-            statesPtrFileName = token.getFilename();
-        }
-
+        TextStatesPtr statesPtr = loadedStates[token.getFilename()];
         if(!statesPtr) continue;
 
+        if(statesPtr->states.size() > token.getOffset() &&
+           !CppWordScanner::IsCodeState(statesPtr->states[token.getOffset()].state)) {
+            // Comments and strings can't be resolved
+            if(!m_onlyDefiniteMatches) { m_possibleCandidates.push_back(token); }
+            continue;
+        }
+
         if(DoResolveWord(statesPtr, wxFileName(token.getFilename()), token.getOffset(), token.getLineNumber(),
                          m_symbolName, &target)) {
 
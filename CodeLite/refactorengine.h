@@ -30,6 +30,8 @@
 #include <wx/filename.h>
 #include <vector>
 #include <list>
+#include <unordered_map>
+#include "wxStringHash.h"
 #include "entry.h"
 #include "cppwordscanner.h"
 #include "cpptoken.h"
@@ -137,6 +139,8 @@ protected:
                           bool onlyDefiniteMatches, eActionType type);
     void DoCompleteFindReferences();
     void DoCleanup();
+    void DoFindIndexedReferences(const wxString& symname, const wxArrayString& files, wxArrayString& notIndexed);
+    size_t DoLoadStates(const CppToken::Vec_t& tokens, size_t first, std::unordered_map<wxString, TextStatesPtr>& states);
 
 private:
     RefactoringEngine();
@@ -22,16 +22,24 @@
 //
 //////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////
+#include "clByteSearcher.h"
+#include "clCxxLexicalClassifier.h"
 #include "clFilesCollector.h"
 #include "cppwordscanner.h"
 #include "dirtraverser.h"
 #include "fileutils.h"
 #include "macros.h"
+#include "performance.h"
 #include "search_thread.h"
 #include "wx/event.h"
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <iostream>
+#include <mutex>
 #include <set>
+#include <thread>
 #include <wx/dir.h>
 #if wxUSE_GUI
 #include <wx/fontmap.h>
@@ -77,6 +85,7 @@ SearchData& SearchData::Copy(const SearchData& other)
     m_owner = other.m_owner;
     m_encoding = other.m_encoding.c_str();
     m_replaceWith = other.m_replaceWith;
+    m_indexFile = other.m_indexFile;
     m_excludePatterns.clear();
     m_excludePatterns.insert(m_excludePatterns.end(), other.m_excludePatterns.begin(), other.m_excludePatterns.end());
     m_files.clear();
@@ -91,10 +100,29 @@ SearchData& SearchData::Copy(const SearchData& other)
 // SearchThread
 //----------------------------------------------------------------
 
+// Number of files handed to a worker at a time
+#define SEARCH_BATCH_SIZE 16
+
+#if wxUSE_GUI
+// Return true if the encoding stores ASCII characters as single bytes
+static bool IsAsciiCompatible(wxFontEncoding enc)
+{
+    switch(enc) {
+    case wxFONTENCODING_UTF7:
+    case wxFONTENCODING_UTF16BE:
+    case wxFONTENCODING_UTF16LE:
+    case wxFONTENCODING_UTF32BE:
+    case wxFONTENCODING_UTF32LE:
+        return false;
+    default:
+        return true;
+    }
+}
+#endif
+
 SearchThread::SearchThread()
     : WorkerThread()
     , m_wordChars(wxT("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_"))
-    , m_reExpr(wxT(""))
 {
     IndexWordChars();
 }
@@ -115,29 +143,23 @@ void SearchThread::SetWordChars(const wxString& chars)
     IndexWordChars();
 }
 
-wxRegEx& SearchThread::GetRegex(const wxString& expr, bool matchCase)
+void SearchThread::CompileRegex(wxRegEx& re, const wxString& expr, bool matchCase)
 {
-    if(m_reExpr == expr && matchCase == m_matchCase) {
-        return m_regex;
-    } else {
-        m_reExpr = expr;
-        m_matchCase = matchCase;
 #ifndef __WXMAC__
-        int flags = wxRE_ADVANCED;
+    int flags = wxRE_ADVANCED;
 #else
-        int flags = wxRE_DEFAULT;
+    int flags = wxRE_DEFAULT;
 #endif
 
-        if(!matchCase) flags |= wxRE_ICASE;
-        m_regex.Compile(m_reExpr, flags);
-    }
-    return m_regex;
+    if(!matchCase) flags |= wxRE_ICASE;
+    re.Compile(expr, flags);
 }
 
 void SearchThread::PerformSearch(const SearchData& data) { Add(new SearchData(data)); }
 
 void SearchThread::ProcessRequest(ThreadRequest* req)
 {
+    CL_TRACE_SCOPE("SearchThread::ProcessRequest");
     wxStopWatch sw;
     m_summary = SearchSummary();
     DoSearchFiles(req);
@@ -191,6 +213,7 @@ void SearchThread::DoSearchFiles(ThreadRequest* req)
     StopSearch(false);
     wxArrayString fileList;
     GetFiles(data, fileList);
+    PrepareIndex(data);
 
     wxStopWatch sw;
 
@@ -206,17 +229,175 @@ void SearchThread::DoSearchFiles(ThreadRequest* req)
         }
     }
 
-    for(size_t i = 0; i < fileList.Count(); i++) {
-        m_summary.SetNumFileScanned((int)i + 1);
+    // Split the file list into batches. The workers pick the next free batch
+    // while this thread merges the completed ones back in file order so the
+    // results are reported exactly as a sequential scan would report them
+    std::vector<SearchBatch> batches;
+    batches.reserve((fileList.size() / SEARCH_BATCH_SIZE) + 1);
+    for(size_t first = 0; first < fileList.size(); first += SEARCH_BATCH_SIZE) {
+        SearchBatch batch;
+        batch.first = first;
+        batch.last = std::min(first + SEARCH_BATCH_SIZE, fileList.size());
+        batches.push_back(batch);
+    }
+
+    size_t workersCount = m_workersCount;
+    if(workersCount == 0) { workersCount = std::max(1u, std::thread::hardware_concurrency()); }
+    workersCount = std::min(workersCount, batches.size());
+
+    std::mutex lock;
+    std::condition_variable cv;
+    std::atomic_size_t nextBatch(0);
+    std::atomic_bool cancelled(false);
+
+    std::vector<std::thread> workers;
+    for(size_t i = 0; i < workersCount; ++i) {
+        workers.push_back(std::thread([&]() {
+            DoSearchWorker(fileList, data,
+                           [&]() -> SearchBatch* {
+                               if(cancelled.load()) { return nullptr; }
+                               size_t index = nextBatch.fetch_add(1);
+                               return index < batches.size() ? &batches[index] : nullptr;
+                           },
+                           [&](SearchBatch& batch) {
+                               {
+                                   std::lock_guard<std::mutex> guard(lock);
+                                   batch.done = true;
+                               }
+                               cv.notify_all();
+                           },
+                           cancelled);
+        }));
+    }
+
+    for(size_t i = 0; i < batches.size(); ++i) {
+        SearchBatch& batch = batches[i];
+        bool ready = false;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            // wake up periodically so we can test for cancellation
+            while(!batch.done && !TestStopSearch()) {
+                cv.wait_for(guard, std::chrono::milliseconds(50));
+            }
+            ready = batch.done;
+        }
 
         // give user chance to cancel the search ...
-        if(TestStopSearch()) {
-            // Send cancel event
-            SendEvent(wxEVT_SEARCH_THREAD_SEARCHCANCELED, data->GetOwner());
-            StopSearch(false);
+        if(!ready || TestStopSearch()) {
+            cancelled.store(true);
             break;
         }
-        DoSearchFile(fileList.Item(i), data);
+
+        m_summary.SetNumFileScanned((int)batch.last);
+        m_summary.SetNumMatchesFound(m_summary.GetNumMatchesFound() + (int)batch.results.size());
+        m_summary.GetFailedFiles().insert(m_summary.GetFailedFiles().end(), batch.failedFiles.begin(),
+                                          batch.failedFiles.end());
+        if(!batch.results.empty()) {
+            m_results.splice(m_results.end(), batch.results);
+            SendEvent(wxEVT_SEARCH_THREAD_MATCHFOUND, data->GetOwner());
+        }
+    }
+
+    // Stop the workers still busy (when cancelled) or waiting for a batch
+    bool wasCancelled = cancelled.exchange(true);
+    std::for_each(workers.begin(), workers.end(), [&](std::thread& worker) { worker.join(); });
+
+    if(wasCancelled) {
+        // Send cancel event, only once the workers are gone
+        SendEvent(wxEVT_SEARCH_THREAD_SEARCHCANCELED, data->GetOwner());
+        StopSearch(false);
+    }
+
+    // Index the files we had to read. This must be done
+    // after the workers are gone, since they are reading the index
+    if(m_useIndex) {
+        std::for_each(batches.begin(), batches.end(), [&](const SearchBatch& batch) {
+            for(size_t n = 0; n < batch.indexUpdates.size(); ++n) {
+                m_index.Update(batch.indexUpdates[n].first, batch.indexUpdates[n].second);
+            }
+        });
+        m_index.Flush();
+    }
+}
+
+void SearchThread::PrepareIndex(const SearchData* data)
+{
+    m_useIndex = false;
+    if(data->GetIndexFile().IsEmpty()) { return; }
+
+#if wxUSE_GUI
+    // The index is built from the raw bytes of the files, so it can only be
+    // used with encodings that store ASCII characters as single bytes
+    if(!IsAsciiCompatible(wxFontMapper::GetEncodingFromName(data->GetEncoding().c_str()))) { return; }
+#endif
+
+    wxFileName indexFile(data->GetIndexFile());
+    if(m_index.GetFileName().GetFullPath() != indexFile.GetFullPath() && !m_index.Open(indexFile)) { return; }
+
+    wxArrayString literals;
+    if(data->IsRegularExpression()) {
+        clTrigramIndex::GetRegexLiterals(data->GetFindString(), literals);
+
+    } else if(data->IsEnablePipeSupport()) {
+        // the search string and all the pipe filters must appear in the file
+        literals = ::wxStringTokenize(data->GetFindString(), "|", wxTOKEN_STRTOK);
+
+    } else {
+        literals.Add(data->GetFindString());
+    }
+    clTrigramIndex::Query_t query;
+    clTrigramIndex::CreateQuery(literals, query);
+    m_index.Prepare(query);
+    m_useIndex = true;
+}
+
+void SearchThread::DoSearchWorker(const wxArrayString& files, const SearchData* data,
+                                  const std::function<SearchBatch*()>& nextBatch,
+                                  const std::function<void(SearchBatch&)>& batchDone,
+                                  const std::atomic_bool& cancelled)
+{
+    // Each worker owns its converter and compiled expression: neither is safe
+    // to share between the workers
+#if wxUSE_GUI
+    // support for other encoding
+    wxFontEncoding enc = wxFontMapper::GetEncodingFromName(data->GetEncoding().c_str());
+    wxCSConv conv(enc);
+#else
+    wxMBConv& conv = wxConvLibc;
+#endif
+
+    wxRegEx re;
+    if(data->IsRegularExpression()) { CompileRegex(re, data->GetFindString(), data->IsMatchCase()); }
+
+    clByteSearcher prefilter;
+    if(!data->IsRegularExpression()) {
+#if wxUSE_GUI
+        bool asciiCompatible = IsAsciiCompatible(enc);
+#else
+        bool asciiCompatible = true;
+#endif
+        wxString findWhat = data->GetFindString();
+        if(data->IsEnablePipeSupport() && findWhat.Find('|') != wxNOT_FOUND) { findWhat = findWhat.BeforeFirst('|'); }
+
+        // Case folding is done on ASCII only, so non ASCII strings can only be
+        // searched at the byte level when the case must match
+        if(asciiCompatible && findWhat.IsAscii()) {
+            prefilter.SetNeedle(findWhat.ToStdString(), data->IsMatchCase());
+
+        } else if(asciiCompatible && data->IsMatchCase()) {
+            wxCharBuffer cb = findWhat.mb_str(conv);
+            if(cb.length()) { prefilter.SetNeedle(std::string(cb.data(), cb.length()), true); }
+        }
+    }
+
+    SearchBatch* batch = nextBatch();
+    while(batch) {
+        for(size_t i = batch->first; i < batch->last; ++i) {
+            if(cancelled.load() || TestStopSearch()) { break; }
+            DoSearchFile(files.Item(i), data, conv, re, prefilter, *batch);
+        }
+        batchDone(*batch);
+        batch = nextBatch();
     }
 }
 
@@ -236,52 +417,57 @@ void SearchThread::StopSearch(bool stop)
     m_stopSearch = stop;
 }
 
-void SearchThread::DoSearchFile(const wxString& fileName, const SearchData* data)
+void SearchThread::DoSearchFile(const wxString& fileName, const SearchData* data, wxMBConv& conv, wxRegEx& re,
+                                const clByteSearcher& prefilter, SearchBatch& batch)
 {
     // Process single lines
     int lineNumber = 1;
     if(!wxFileName::FileExists(fileName)) { return; }
 
-    size_t size = FileUtils::GetFileSize(fileName);
-    if(size == 0) { return; }
-    wxString fileData;
-    fileData.Alloc(size);
+    // Use the search index to skip files that can not contain a match
+    time_t lastModified = 0;
+    size_t fileSize = 0;
+    bool updateIndex = false;
+    if(m_useIndex) {
+        lastModified = FileUtils::GetFileModificationTime(fileName);
+        fileSize = FileUtils::GetFileSize(fileName);
+        clTrigramIndex::eMatch match = m_index.Match(fileName, lastModified, fileSize);
+        if(match == clTrigramIndex::kNoMatch) { return; }
+        updateIndex = (match == clTrigramIndex::kNotIndexed);
+    }
 
-#if wxUSE_GUI
-    // support for other encoding
-    wxFontEncoding enc = wxFontMapper::GetEncodingFromName(data->GetEncoding().c_str());
-    wxCSConv fontEncConv(enc);
-    if(!FileUtils::ReadFileContent(fileName, fileData, fontEncConv)) {
-        m_summary.GetFailedFiles().Add(fileName);
+    std::string rawData;
+    if(!FileUtils::ReadFileContentRaw(fileName, rawData)) {
+        batch.failedFiles.Add(fileName);
         return;
     }
-#else
-    if(!FileUtils::ReadFileContent(fileName, fileData, wxConvLibc)) {
-        m_summary.GetFailedFiles().Add(fileName);
-        return;
+
+    if(updateIndex) {
+        clTrigramIndex::Entry entry;
+        entry.lastModified = lastModified;
+        entry.size = fileSize;
+        clTrigramIndex::CollectTrigrams(rawData.c_str(), rawData.length(), entry.trigrams);
+        batch.indexUpdates.push_back({ fileName, entry });
     }
-#endif
-    // take a wild guess and see if we really need to construct
-    // a TextStatesPtr object (it is quite an expensive operation)
-    bool shouldCreateStates(true);
-    if(data->IsMatchCase() && !data->IsRegularExpression()) {
-        shouldCreateStates = (fileData.Find(data->GetFindString()) != wxNOT_FOUND);
-
-    } else if(!data->IsMatchCase() && !data->IsRegularExpression()) {
-        // !data->IsMatchCase()
-        wxString tmpData = fileData;
-        shouldCreateStates = (tmpData.MakeLower().Find(data->GetFindString()) != wxNOT_FOUND);
+    if(rawData.empty()) { return; }
+
+    // Most files do not contain the search string at all: check the raw bytes
+    // first and only decode + tokenize the file when there is a candidate
+    if(prefilter.IsOk() && prefilter.Find(rawData.c_str(), rawData.length()) == std::string::npos) { return; }
+
+    wxString fileData(rawData.c_str(), conv, rawData.length());
+    if(fileData.IsEmpty()) {
+        // Conversion failed
+        fileData = wxString::From8BitData(rawData.c_str(), rawData.length());
     }
+    rawData.clear();
 
     wxStringTokenizer tkz(fileData, wxT("\n"), wxTOKEN_RET_EMPTY_ALL);
 
-    // Incase one of the C++ options is enabled,
-    // create a text states object
-    TextStatesPtr states(NULL);
-    if(data->HasCppOptions() && shouldCreateStates && false) {
-        CppWordScanner scanner("", fileData.mb_str().data(), 0);
-        states = scanner.states();
-    }
+    // Incase one of the C++ options is enabled, classify the matches (code, comment or string). The
+    // classifier only scans the file up to the last match, and only if there is one
+    clCxxLexicalClassifier classifier(fileData);
+    clCxxLexicalClassifier* classifierPtr = data->HasCppOptions() ? &classifier : nullptr;
 
     int lineOffset = 0;
     if(data->IsRegularExpression()) {
@@ -289,7 +475,7 @@ void SearchThread::DoSearchFile(const wxString& fileName, const SearchData* data
         while(tkz.HasMoreTokens()) {
             // Read the next line
             wxString line = tkz.NextToken();
-            DoSearchLineRE(line, lineNumber, lineOffset, fileName, data, states);
+            DoSearchLineRE(line, lineNumber, lineOffset, fileName, data, classifierPtr, re, batch.results);
             lineOffset += line.Length() + 1;
             lineNumber++;
         }
@@ -318,19 +504,17 @@ void SearchThread::DoSearchFile(const wxString& fileName, const SearchData* data
 
             // Read the next line
             wxString line = tkz.NextToken();
-            DoSearchLine(line, lineNumber, lineOffset, fileName, data, findString, filters, states);
+            DoSearchLine(line, lineNumber, lineOffset, fileName, data, findString, filters, classifierPtr, batch.results);
             lineOffset += line.Length() + 1;
             lineNumber++;
         }
     }
-
-    if(m_results.empty() == false) { SendEvent(wxEVT_SEARCH_THREAD_MATCHFOUND, data->GetOwner()); }
 }
 
 void SearchThread::DoSearchLineRE(const wxString& line, const int lineNum, const int lineOffset,
-                                  const wxString& fileName, const SearchData* data, TextStatesPtr statesPtr)
+                                  const wxString& fileName, const SearchData* data,
+                                  clCxxLexicalClassifier* classifier, wxRegEx& re, SearchResultList& results)
 {
-    wxRegEx& re = GetRegex(data->GetFindString(), data->IsMatchCase());
     size_t col = 0;
     int iCorrectedCol = 0;
     int iCorrectedLen = 0;
@@ -357,48 +541,7 @@ void SearchThread::DoSearchLineRE(const wxString& line, const int lineNum, const
             result.SetFlags(data->m_flags);
             result.SetFindWhat(data->GetFindString());
 
-            // Make sure our match is not on a comment
-            int position(wxNOT_FOUND);
-            bool canAdd(true);
-
-            if(statesPtr) {
-                position = statesPtr->LineToPos(lineNum - 1);
-                position += iCorrectedCol;
-            }
-
-            if(statesPtr && position != wxNOT_FOUND && data->GetSkipComments()) {
-                if(statesPtr->states.size() > (size_t)position) {
-                    short state = statesPtr->states.at(position).state;
-                    if(state == CppWordScanner::STATE_CPP_COMMENT || state == CppWordScanner::STATE_C_COMMENT) {
-                        canAdd = false;
-                    }
-                }
-            }
-
-            if(statesPtr && position != wxNOT_FOUND && data->GetSkipStrings()) {
-                if(statesPtr->states.size() > (size_t)position) {
-                    short state = statesPtr->states.at(position).state;
-                    if(state == CppWordScanner::STATE_DQ_STRING || state == CppWordScanner::STATE_SINGLE_STRING) {
-                        canAdd = false;
-                    }
-                }
-            }
-
-            result.SetMatchState(CppWordScanner::STATE_NORMAL);
-            if(canAdd && statesPtr && position != wxNOT_FOUND && data->GetColourComments()) {
-                // set the match state
-                if(statesPtr->states.size() > (size_t)position) {
-                    short state = statesPtr->states.at(position).state;
-                    if(state == CppWordScanner::STATE_C_COMMENT || state == CppWordScanner::STATE_CPP_COMMENT) {
-                        result.SetMatchState(state);
-                    }
-                }
-            }
-
-            if(canAdd) {
-                m_results.push_back(result);
-                m_summary.SetNumMatchesFound(m_summary.GetNumMatchesFound() + 1);
-            }
+            if(DoCheckMatchState(result, data, classifier, lineOffset + col)) { results.push_back(result); }
 
             col += len;
 
@@ -411,7 +554,7 @@ void SearchThread::DoSearchLineRE(const wxString& line, const int lineNum, const
 
 void SearchThread::DoSearchLine(const wxString& line, const int lineNum, const int lineOffset, const wxString& fileName,
                                 const SearchData* data, const wxString& findWhat, const wxArrayString& filters,
-                                TextStatesPtr statesPtr)
+                                clCxxLexicalClassifier* classifier, SearchResultList& results)
 {
     wxString modLine = line;
 
@@ -484,48 +627,7 @@ void SearchThread::DoSearchLine(const wxString& line, const int lineNum, const i
             result.SetFindWhat(data->GetFindString());
             result.SetFlags(data->m_flags);
 
-            int position(wxNOT_FOUND);
-            bool canAdd(true);
-
-            if(statesPtr) {
-                position = statesPtr->LineToPos(lineNum - 1);
-                position += iCorrectedCol;
-            }
-
-            // Make sure our match is not on a comment
-            if(statesPtr && position != wxNOT_FOUND && data->GetSkipComments()) {
-                if(statesPtr->states.size() > (size_t)position) {
-                    short state = statesPtr->states.at(position).state;
-                    if(state == CppWordScanner::STATE_CPP_COMMENT || state == CppWordScanner::STATE_C_COMMENT) {
-                        canAdd = false;
-                    }
-                }
-            }
-
-            if(statesPtr && position != wxNOT_FOUND && data->GetSkipStrings()) {
-                if(statesPtr->states.size() > (size_t)position) {
-                    short state = statesPtr->states.at(position).state;
-                    if(state == CppWordScanner::STATE_DQ_STRING || state == CppWordScanner::STATE_SINGLE_STRING) {
-                        canAdd = false;
-                    }
-                }
-            }
-
-            result.SetMatchState(CppWordScanner::STATE_NORMAL);
-            if(canAdd && statesPtr && position != wxNOT_FOUND && data->GetColourComments()) {
-                // set the match state
-                if(statesPtr->states.size() > (size_t)position) {
-                    short state = statesPtr->states.at(position).state;
-                    if(state == CppWordScanner::STATE_C_COMMENT || state == CppWordScanner::STATE_CPP_COMMENT) {
-                        result.SetMatchState(state);
-                    }
-                }
-            }
-
-            if(canAdd) {
-                m_results.push_back(result);
-                m_summary.SetNumMatchesFound(m_summary.GetNumMatchesFound() + 1);
-            }
+            if(DoCheckMatchState(result, data, classifier, lineOffset + col)) { results.push_back(result); }
 
             if(!AdjustLine(modLine, pos, findWhat)) { break; }
             col += (int)findWhat.Length();
@@ -533,6 +635,20 @@ void SearchThread::DoSearchLine(const wxString& line, const int lineNum, const i
     }
 }
 
+bool SearchThread::DoCheckMatchState(SearchResult& result, const SearchData* data, clCxxLexicalClassifier* classifier,
+                                     size_t position)
+{
+    result.SetMatchState(CppWordScanner::STATE_NORMAL);
+    if(!classifier) { return true; }
+
+    int state = classifier->GetState(position);
+    // Make sure our match is not on a comment or a string
+    if(data->GetSkipComments() && clCxxLexicalClassifier::IsComment(state)) { return false; }
+    if(data->GetSkipStrings() && clCxxLexicalClassifier::IsString(state)) { return false; }
+    if(data->GetColourComments() && clCxxLexicalClassifier::IsComment(state)) { result.SetMatchState(state); }
+    return true;
+}
+
 bool SearchThread::AdjustLine(wxString& line, int& pos, const wxString& findString)
 {
     // adjust the current line
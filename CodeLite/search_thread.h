@@ -32,14 +32,19 @@
 #include "wx/event.h"
 #include "wx/filename.h"
 #include "wxStringHash.h"
+#include <atomic>
 #include <deque>
+#include <functional>
 #include <list>
 #include <map>
 #include <wx/regex.h>
 #include <wx/string.h>
 #include "JSON.h"
+#include "clTrigramIndex.h"
 
 class wxEvtHandler;
+class clByteSearcher;
+class clCxxLexicalClassifier;
 class SearchResult;
 class SearchThread;
 
@@ -73,6 +78,7 @@ class WXDLLIMPEXP_CL SearchData : public ThreadRequest
     wxEvtHandler* m_owner;
     wxString m_encoding;
     wxArrayString m_excludePatterns;
+    wxString m_indexFile;
     friend class SearchThread;
 
 private:
@@ -146,6 +152,12 @@ public:
     bool GetColourComments() const { return (m_flags & wxSD_COLOUR_COMMENTS); }
     const wxString& GetReplaceWith() const { return m_replaceWith; }
     void SetReplaceWith(const wxString& replaceWith) { this->m_replaceWith = replaceWith; }
+    /**
+     * @brief when set, the search uses (and updates) the trigram index stored in this file
+     * to skip files that can not contain a match
+     */
+    void SetIndexFile(const wxString& indexFile) { this->m_indexFile = indexFile; }
+    const wxString& GetIndexFile() const { return m_indexFile; }
 };
 
 //------------------------------------------
@@ -328,11 +340,25 @@ class WXDLLIMPEXP_CL SearchThread : public WorkerThread
     SearchResultList m_results;
     bool m_stopSearch;
     SearchSummary m_summary;
-    wxString m_reExpr;
-    wxRegEx m_regex;
-    bool m_matchCase;
     wxCriticalSection m_cs;
     int m_counter = 0;
+    size_t m_workersCount = 0;
+    clTrigramIndex m_index;
+    bool m_useIndex = false;
+
+    /**
+     * A contiguous range of files [first, last) searched by a single worker.
+     * The worker writes its matches here and the search thread merges the
+     * batches back in file order
+     */
+    struct SearchBatch {
+        size_t first = 0;
+        size_t last = 0;
+        SearchResultList results;
+        wxArrayString failedFiles;
+        clTrigramIndex::Vec_t indexUpdates;
+        bool done = false;
+    };
 
 public:
     /**
@@ -371,6 +397,13 @@ public:
      */
     void SetWordChars(const wxString& chars);
 
+    /**
+     * Set the number of workers used to scan the files in parallel.
+     * Passing 0 (the default) uses the number of available cores
+     */
+    void SetWorkersCount(size_t count) { m_workersCount = count; }
+    size_t GetWorkersCount() const { return m_workersCount; }
+
 private:
     /**
      * Return files to search
@@ -393,29 +426,45 @@ private:
      */
     void DoSearchFiles(ThreadRequest* data);
 
+    // The body of a worker thread: search the batches returned by "nextBatch" until it returns null.
+    // "batchDone" is called after each batch. The current batch is abandoned once "cancelled" is set
+    void DoSearchWorker(const wxArrayString& files, const SearchData* data,
+                        const std::function<SearchBatch*()>& nextBatch,
+                        const std::function<void(SearchBatch&)>& batchDone, const std::atomic_bool& cancelled);
+
     // Perform search on a single file
-    void DoSearchFile(const wxString& fileName, const SearchData* data);
+    void DoSearchFile(const wxString& fileName, const SearchData* data, wxMBConv& conv, wxRegEx& re,
+                      const clByteSearcher& prefilter, SearchBatch& batch);
 
     // Perform search on a line
     void DoSearchLine(const wxString& line, const int lineNum, const int lineOffset, const wxString& fileName,
                       const SearchData* data, const wxString& findWhat, const wxArrayString& filters,
-                      TextStatesPtr statesPtr);
+                      clCxxLexicalClassifier* classifier, SearchResultList& results);
 
     // Perform search on a line using regular expression
     void DoSearchLineRE(const wxString& line, const int lineNum, const int lineOffset, const wxString& fileName,
-                        const SearchData* data, TextStatesPtr statesPtr);
+                        const SearchData* data, clCxxLexicalClassifier* classifier, wxRegEx& re,
+                        SearchResultList& results);
+
+    // Check the lexical state of a match at "position" in the file (null classifier: no C++ options).
+    // Return false if the match must be skipped
+    bool DoCheckMatchState(SearchResult& result, const SearchData* data, clCxxLexicalClassifier* classifier,
+                           size_t position);
 
     // Send an event to the notified window
     void SendEvent(wxEventType type, wxEvtHandler* owner);
 
-    // return a compiled regex object for the expression
-    wxRegEx& GetRegex(const wxString& expr, bool matchCase);
+    // compile the expression into 're'
+    void CompileRegex(wxRegEx& re, const wxString& expr, bool matchCase);
 
     // Internal function
     bool AdjustLine(wxString& line, int& pos, const wxString& findString);
 
     // filter 'files' according to the files spec
     void FilterFiles(wxArrayString& files, const SearchData* data);
+
+    // open the search index and prepare the query for this search
+    void PrepareIndex(const SearchData* data);
 };
 
 class WXDLLIMPEXP_CL SearchThreadST
@@ -24,12 +24,47 @@
 //////////////////////////////////////////////////////////////////////////////
 #include "file_logger.h"
 #include "fileutils.h"
+#include "performance.h"
 #include "precompiled_header.h"
 #include "tags_storage_sqlite3.h"
 #include <algorithm>
+#include <stdlib.h>
 #include <wx/longlong.h>
 #include <wx/tokenzr.h>
 
+#define MAX_CACHED_STATEMENTS 100
+
+// Escape the LIKE wildcards of a user string, using '^' as the escape character
+static wxString EscapeLikePattern(const wxString& str)
+{
+    wxString escaped(str);
+    escaped.Replace(wxT("^"), wxT("^^"));
+    escaped.Replace(wxT("_"), wxT("^_"));
+    escaped.Replace(wxT("%"), wxT("^%"));
+    return escaped;
+}
+
+// Reset a cached statement when leaving the scope, however we leave it: a cached statement that is not reset
+// keeps its read lock and its bindings until it is reused
+class CachedStatementResetter
+{
+    wxSQLite3Statement* m_statement = nullptr;
+
+public:
+    CachedStatementResetter() {}
+    ~CachedStatementResetter()
+    {
+        if(!m_statement) { return; }
+        try {
+            m_statement->Reset();
+            m_statement->ClearBindings();
+        } catch(wxSQLite3Exception& e) {
+            clWARNING() << "Failed to reset statement:" << e.GetMessage() << clEndl;
+        }
+    }
+    void SetStatement(wxSQLite3Statement* statement) { m_statement = statement; }
+};
+
 //-------------------------------------------------
 // Tags database class implementation
 //-------------------------------------------------
@@ -110,7 +145,7 @@ void TagsStorageSQLite::CreateSchema()
         m_db->ExecuteUpdate(sql);
 
         sql = wxT("create  table if not exists FILES (ID INTEGER PRIMARY KEY AUTOINCREMENT, file string, last_retagged "
-                  "integer);");
+                  "integer, size integer, hash string);");
         m_db->ExecuteUpdate(sql);
 
         sql = wxT("create  table if not exists MACROS (ID INTEGER PRIMARY KEY AUTOINCREMENT, file string, line "
@@ -121,6 +156,14 @@ void TagsStorageSQLite::CreateSchema()
                   "string);");
         m_db->ExecuteUpdate(sql);
 
+        sql = wxT("create  table if not exists IDENTIFIERS (ID INTEGER PRIMARY KEY AUTOINCREMENT, name string, file "
+                  "string, occurrences string);");
+        m_db->ExecuteUpdate(sql);
+
+        sql = wxT("create  table if not exists IDENTIFIERS_FILES (ID INTEGER PRIMARY KEY AUTOINCREMENT, file string, "
+                  "last_modified integer, size integer);");
+        m_db->ExecuteUpdate(sql);
+
         // create unuque index on Files' file column
         sql = wxT("CREATE UNIQUE INDEX IF NOT EXISTS FILES_NAME on FILES(file)");
         m_db->ExecuteUpdate(sql);
@@ -179,6 +222,15 @@ void TagsStorageSQLite::CreateSchema()
         sql = wxT("CREATE INDEX IF NOT EXISTS SIMPLE_MACROS_FILE on SIMPLE_MACROS(file);");
         m_db->ExecuteUpdate(sql);
 
+        sql = wxT("CREATE INDEX IF NOT EXISTS IDENTIFIERS_NAME on IDENTIFIERS(name);");
+        m_db->ExecuteUpdate(sql);
+
+        sql = wxT("CREATE INDEX IF NOT EXISTS IDENTIFIERS_FILE on IDENTIFIERS(file);");
+        m_db->ExecuteUpdate(sql);
+
+        sql = wxT("CREATE UNIQUE INDEX IF NOT EXISTS IDENTIFIERS_FILES_NAME on IDENTIFIERS_FILES(file);");
+        m_db->ExecuteUpdate(sql);
+
         sql = wxT("create table if not exists tags_version (version string primary key);");
         m_db->ExecuteUpdate(sql);
 
@@ -217,6 +269,8 @@ void TagsStorageSQLite::RecreateDatabase()
             m_db->ExecuteUpdate(wxT("DROP TABLE IF EXISTS MACROS"));
             m_db->ExecuteUpdate(wxT("DROP TABLE IF EXISTS SIMPLE_MACROS"));
             m_db->ExecuteUpdate(wxT("DROP TABLE IF EXISTS GLOBAL_TAGS"));
+            m_db->ExecuteUpdate(wxT("DROP TABLE IF EXISTS IDENTIFIERS"));
+            m_db->ExecuteUpdate(wxT("DROP TABLE IF EXISTS IDENTIFIERS_FILES"));
 
             // drop indexes
             m_db->ExecuteUpdate(wxT("DROP INDEX IF EXISTS FILES_NAME"));
@@ -233,6 +287,9 @@ void TagsStorageSQLite::RecreateDatabase()
             m_db->ExecuteUpdate(wxT("DROP INDEX IF EXISTS SIMPLE_MACROS_FILE"));
             m_db->ExecuteUpdate(wxT("DROP INDEX IF EXISTS GLOBAL_TAGS_IDX_1"));
             m_db->ExecuteUpdate(wxT("DROP INDEX IF EXISTS GLOBAL_TAGS_IDX_2"));
+            m_db->ExecuteUpdate(wxT("DROP INDEX IF EXISTS IDENTIFIERS_NAME"));
+            m_db->ExecuteUpdate(wxT("DROP INDEX IF EXISTS IDENTIFIERS_FILE"));
+            m_db->ExecuteUpdate(wxT("DROP INDEX IF EXISTS IDENTIFIERS_FILES_NAME"));
 
             // Recreate the schema
             CreateSchema();
@@ -310,15 +367,15 @@ void TagsStorageSQLite::SelectTagsByFile(const wxString& file, std::vector<TagEn
     path.IsOk() == false ? databaseFileName = m_fileName : databaseFileName = path;
     OpenDatabase(databaseFileName);
 
-    wxString query;
-    query << wxT("select * from tags where file='") << file << "' ";
+    TagsStorageSQLiteQuery query(wxT("select * from tags where file=? "));
+    query.Bind(file);
     //#ifdef __WXMSW__
     //    // Under Windows, the file-crawler changes the file path
     //    // to lowercase. However, the database matches the file name
     //    // by case-sensitive
     //    query << "COLLATE NOCASE ";
     //#endif
-    query << wxT("order by line asc");
+    query.Append(wxT("order by line asc"));
     DoFetchTags(query, tags);
 }
 
@@ -475,6 +532,8 @@ void TagsStorageSQLite::GetFiles(std::vector<FileEntryPtr>& files)
             fe->SetId(res.GetInt(0));
             fe->SetFile(res.GetString(1));
             fe->SetLastRetaggedTimestamp(res.GetInt(2));
+            fe->SetSize((size_t)res.GetInt64(3).GetValue());
+            fe->SetHash(res.GetString(4));
 
             files.push_back(fe);
         }
@@ -566,29 +625,42 @@ TagEntry* TagsStorageSQLite::FromSQLite3ResultSet(wxSQLite3ResultSet& rs)
     return entry;
 }
 
-void TagsStorageSQLite::DoFetchTags(const wxString& sql, std::vector<TagEntryPtr>& tags)
+void TagsStorageSQLite::DoFetchTags(const TagsStorageSQLiteQuery& query, std::vector<TagEntryPtr>& tags)
 {
+    CL_TRACE_SCOPE("TagsStorageSQLite::DoFetchTags");
     if(GetUseCache()) {
-        clDEBUG1() << "Testing cache for" << sql << clEndl;
-        if(m_cache.Get(sql, tags) == true) {
-            clDEBUG1() << "[CACHED ITEMS]" << sql << clEndl;
+        clDEBUG1() << "Testing cache for" << query.GetSql() << clEndl;
+        if(m_cache.Get(query, tags) == true) {
+            clDEBUG1() << "[CACHED ITEMS]" << query.GetSql() << clEndl;
             return;
         }
     }
 
-    clDEBUG1() << "Entry not found in cache" << sql << clEndl;
+    clDEBUG1() << "Entry not found in cache" << query.GetSql() << clEndl;
     clDEBUG1() << "Fetching from disk..." << clEndl;
-    tags.reserve(500);
+
+    // Keep the result of this query apart from the tags we were called with, this is what we cache
+    std::vector<TagEntryPtr> result;
+    result.reserve(500);
+    const wxArrayString& kinds = query.GetKinds();
+    CachedStatementResetter resetter;
     try {
         wxSQLite3ResultSet ex_rs;
-        ex_rs = Query(sql);
+        if(query.IsParameterised()) {
+            wxSQLite3Statement* statement = &m_db->GetCachedStatement(query.GetSql());
+            resetter.SetStatement(statement);
+            query.BindTo(*statement);
+            ex_rs = statement->ExecuteQuery();
+        } else {
+            ex_rs = Query(query.GetSql());
+        }
 
-        // add results from external database to the workspace database
         while(ex_rs.NextRow()) {
+            // check if this kind is accepted
+            if(!kinds.IsEmpty() && kinds.Index(ex_rs.GetString(4)) == wxNOT_FOUND) { continue; }
+
             // Construct a TagEntry from the rescord set
-            TagEntryPtr tag(FromSQLite3ResultSet(ex_rs));
-            // conver the path to be real path
-            tags.push_back(tag);
+            result.push_back(TagEntryPtr(FromSQLite3ResultSet(ex_rs)));
         }
         ex_rs.Finalize();
     } catch(wxSQLite3Exception& e) {
@@ -597,49 +669,10 @@ void TagsStorageSQLite::DoFetchTags(const wxString& sql, std::vector<TagEntryPtr
     clDEBUG1() << "Fetching from disk...done" << clEndl;
     if(GetUseCache()) {
         clDEBUG1() << "Updating cache" << clEndl;
-        m_cache.Store(sql, tags);
-        clDEBUG1() << "Updating cache...done (" << tags.size() << "entries)" << clEndl;
-    }
-}
-
-void TagsStorageSQLite::DoFetchTags(const wxString& sql, std::vector<TagEntryPtr>& tags, const wxArrayString& kinds)
-{
-    if(GetUseCache()) {
-        CL_DEBUG1(wxT("Testing cache for: %s"), sql);
-        if(m_cache.Get(sql, kinds, tags) == true) {
-            CL_DEBUG1(wxT("[CACHED ITEMS] %s"), sql);
-            return;
-        }
-    }
-
-    CL_DEBUG1("Fetching from disk");
-    try {
-        wxSQLite3ResultSet ex_rs;
-        ex_rs = Query(sql);
-
-        // add results from external database to the workspace database
-        while(ex_rs.NextRow()) {
-            // check if this kind is accepted
-            if(kinds.Index(ex_rs.GetString(4)) != wxNOT_FOUND) {
-
-                // Construct a TagEntry from the rescord set
-                TagEntryPtr tag(FromSQLite3ResultSet(ex_rs));
-
-                // conver the path to be real path
-                tags.push_back(tag);
-            }
-        }
-        ex_rs.Finalize();
-
-    } catch(wxSQLite3Exception& e) {
-        wxUnusedVar(e);
-    }
-    CL_DEBUG1("Fetching from disk...done");
-    if(GetUseCache()) {
-        CL_DEBUG1("updating cache");
-        m_cache.Store(sql, kinds, tags);
-        CL_DEBUG1("updating cache...done");
+        m_cache.Store(query, result);
+        clDEBUG1() << "Updating cache...done (" << result.size() << "entries)" << clEndl;
     }
+    tags.insert(tags.end(), result.begin(), result.end());
 }
 
 void TagsStorageSQLite::GetTagsByScopeAndName(const wxString& scope, const wxString& name, bool partialNameAllowed,
@@ -647,88 +680,60 @@ void TagsStorageSQLite::GetTagsByScopeAndName(const wxString& scope, const wxStr
 {
     if(name.IsEmpty()) return;
 
-    wxString sql;
-    sql << wxT("select * from tags where ");
+    TagsStorageSQLiteQuery query(wxT("select * from tags where "));
 
     // did we get scope?
     if(scope.IsEmpty() || scope == wxT("<global>")) {
-        sql << wxT("ID IN (select tag_id from global_tags where ");
-        DoAddNamePartToQuery(sql, name, partialNameAllowed, false);
-        sql << wxT(" ) ");
+        query.Append(wxT("ID IN (select tag_id from global_tags where "));
+        DoAddNamePartToQuery(query, name, partialNameAllowed, false);
+        query.Append(wxT(" ) "));
 
     } else {
-        sql << " scope = '" << scope << "' ";
-        DoAddNamePartToQuery(sql, name, partialNameAllowed, true);
+        query.Append(wxT(" scope = ? ")).Bind(scope);
+        DoAddNamePartToQuery(query, name, partialNameAllowed, true);
     }
 
-    sql << wxT(" LIMIT ") << this->GetSingleSearchLimit();
+    query.Append(wxT(" LIMIT ? ")).Bind(GetSingleSearchLimit());
 
     // get get the tags
-    DoFetchTags(sql, tags);
+    DoFetchTags(query, tags);
 }
 
 void TagsStorageSQLite::GetTagsByScope(const wxString& scope, std::vector<TagEntryPtr>& tags)
 {
-    wxString sql;
-
-    // Build the SQL statement
-    sql << wxT("select * from tags where scope='") << scope << wxT("' ORDER BY NAME limit ") << GetSingleSearchLimit();
-
-    DoFetchTags(sql, tags);
+    TagsStorageSQLiteQuery query(wxT("select * from tags where scope=? ORDER BY NAME limit ?"));
+    query.Bind(scope).Bind(GetSingleSearchLimit());
+    DoFetchTags(query, tags);
 }
 
 void TagsStorageSQLite::GetTagsByKind(const wxArrayString& kinds, const wxString& orderingColumn, int order,
                                       std::vector<TagEntryPtr>& tags)
 {
-    wxString sql;
-    sql << wxT("select * from tags where kind in (");
-    for(size_t i = 0; i < kinds.GetCount(); i++) {
-        sql << wxT("'") << kinds.Item(i) << wxT("',");
-    }
-    sql.RemoveLast();
-    sql << wxT(") ");
-
-    if(orderingColumn.IsEmpty() == false) {
-        sql << wxT("order by ") << orderingColumn;
-        switch(order) {
-        case ITagsStorage::OrderAsc:
-            sql << wxT(" ASC");
-            break;
-        case ITagsStorage::OrderDesc:
-            sql << wxT(" DESC");
-            break;
-        case ITagsStorage::OrderNone:
-        default:
-            break;
-        }
-    }
+    if(kinds.empty()) { return; }
 
-    DoFetchTags(sql, tags);
+    TagsStorageSQLiteQuery query(wxT("select * from tags where kind in "));
+    query.BindList(kinds);
+    DoAddOrderPartToQuery(query, orderingColumn, order);
+    DoFetchTags(query, tags);
 }
 
 void TagsStorageSQLite::GetTagsByPath(const wxArrayString& path, std::vector<TagEntryPtr>& tags)
 {
     if(path.empty()) return;
 
-    wxString sql;
-
-    sql << wxT("select * from tags where path IN(");
-    for(size_t i = 0; i < path.GetCount(); i++) {
-        sql << wxT("'") << path.Item(i) << wxT("',");
-    }
-    sql.RemoveLast();
-    sql << wxT(")");
-    DoFetchTags(sql, tags);
+    TagsStorageSQLiteQuery query(wxT("select * from tags where path IN "));
+    query.BindList(path);
+    DoFetchTags(query, tags);
 }
 
 void TagsStorageSQLite::GetTagsByNameAndParent(const wxString& name, const wxString& parent,
                                                std::vector<TagEntryPtr>& tags)
 {
-    wxString sql;
-    sql << wxT("select * from tags where name='") << name << wxT("' LIMIT ") << GetSingleSearchLimit();
+    TagsStorageSQLiteQuery query(wxT("select * from tags where name=? LIMIT ?"));
+    query.Bind(name).Bind(GetSingleSearchLimit());
 
     std::vector<TagEntryPtr> tmpResults;
-    DoFetchTags(sql, tmpResults);
+    DoFetchTags(query, tmpResults);
 
     // Filter by parent
     for(size_t i = 0; i < tmpResults.size(); i++) {
@@ -741,25 +746,25 @@ void TagsStorageSQLite::GetTagsByKindAndPath(const wxArrayString& kinds, const w
 {
     if(kinds.empty()) { return; }
 
-    wxString sql;
-    sql << wxT("select * from tags where path='") << path << wxT("' LIMIT ") << GetSingleSearchLimit();
-
-    DoFetchTags(sql, tags, kinds);
+    TagsStorageSQLiteQuery query(wxT("select * from tags where path=? LIMIT ?"));
+    query.Bind(path).Bind(GetSingleSearchLimit());
+    query.SetKinds(kinds);
+    DoFetchTags(query, tags);
 }
 
 void TagsStorageSQLite::GetTagsByFileAndLine(const wxString& file, int line, std::vector<TagEntryPtr>& tags)
 {
-    wxString sql;
-    sql << wxT("select * from tags where file='") << file << wxT("' and line=") << line << wxT(" ");
-    DoFetchTags(sql, tags);
+    TagsStorageSQLiteQuery query(wxT("select * from tags where file=? and line=? "));
+    query.Bind(file).Bind(line);
+    DoFetchTags(query, tags);
 }
 
 TagEntryPtr TagsStorageSQLite::GetTagAboveFileAndLine(const wxString& file, int line)
 {
-    wxString sql;
-    sql << wxT("select * from tags where file='") << file << wxT("' and line<=") << line << wxT(" LIMIT 1");
+    TagsStorageSQLiteQuery query(wxT("select * from tags where file=? and line<=? LIMIT 1"));
+    query.Bind(file).Bind(line);
     TagEntryPtrVector_t tags;
-    DoFetchTags(sql, tags);
+    DoFetchTags(query, tags);
     if(!tags.empty()) { return tags.at(0); }
     return NULL;
 }
@@ -769,10 +774,11 @@ void TagsStorageSQLite::GetTagsByScopeAndKind(const wxString& scope, const wxArr
 {
     if(kinds.empty()) { return; }
 
-    wxString sql;
-    sql << wxT("select * from tags where scope='") << scope << wxT("' ");
-    if(applyLimit) { sql << wxT(" LIMIT ") << GetSingleSearchLimit(); }
-    DoFetchTags(sql, tags, kinds);
+    TagsStorageSQLiteQuery query(wxT("select * from tags where scope=? "));
+    query.Bind(scope);
+    if(applyLimit) { query.Append(wxT(" LIMIT ? ")).Bind(GetSingleSearchLimit()); }
+    query.SetKinds(kinds);
+    DoFetchTags(query, tags);
 }
 
 void TagsStorageSQLite::GetTagsByKindAndFile(const wxArrayString& kind, const wxString& fileName,
@@ -780,30 +786,11 @@ void TagsStorageSQLite::GetTagsByKindAndFile(const wxArrayString& kind, const wx
 {
     if(kind.empty()) { return; }
 
-    wxString sql;
-    sql << wxT("select * from tags where file='") << fileName << wxT("' and kind in (");
-
-    for(size_t i = 0; i < kind.GetCount(); i++) {
-        sql << wxT("'") << kind.Item(i) << wxT("',");
-    }
-    sql.RemoveLast();
-    sql << wxT(")");
-
-    if(orderingColumn.IsEmpty() == false) {
-        sql << wxT("order by ") << orderingColumn;
-        switch(order) {
-        case ITagsStorage::OrderAsc:
-            sql << wxT(" ASC");
-            break;
-        case ITagsStorage::OrderDesc:
-            sql << wxT(" DESC");
-            break;
-        case ITagsStorage::OrderNone:
-        default:
-            break;
-        }
-    }
-    DoFetchTags(sql, tags);
+    TagsStorageSQLiteQuery query(wxT("select * from tags where file=? and kind in "));
+    query.Bind(fileName);
+    query.BindList(kind);
+    DoAddOrderPartToQuery(query, orderingColumn, order);
+    DoFetchTags(query, tags);
 }
 
 int TagsStorageSQLite::DeleteFileEntry(const wxString& filename)
@@ -820,13 +807,15 @@ int TagsStorageSQLite::DeleteFileEntry(const wxString& filename)
     return TagOk;
 }
 
-int TagsStorageSQLite::InsertFileEntry(const wxString& filename, int timestamp)
+int TagsStorageSQLite::InsertFileEntry(const wxString& filename, int timestamp, const wxString& hash, size_t size)
 {
     try {
         wxSQLite3Statement statement =
-            m_db->GetPrepareStatement(wxT("INSERT OR REPLACE INTO FILES VALUES(NULL, ?, ?)"));
+            m_db->GetPrepareStatement(wxT("INSERT OR REPLACE INTO FILES VALUES(NULL, ?, ?, ?, ?)"));
         statement.Bind(1, filename);
         statement.Bind(2, timestamp);
+        statement.Bind(3, wxLongLong((wxLongLong_t)size));
+        statement.Bind(4, hash);
         statement.ExecuteUpdate();
 
     } catch(wxSQLite3Exception& exc) {
@@ -1035,20 +1024,15 @@ void TagsStorageSQLite::GetScopesFromFileAsc(const wxFileName& fileName, std::ve
 void TagsStorageSQLite::GetTagsByFileScopeAndKind(const wxFileName& fileName, const wxString& scopeName,
                                                   const wxArrayString& kind, std::vector<TagEntryPtr>& tags)
 {
-    wxString sql;
-    sql << wxT("select * from tags where file = '") << fileName.GetFullPath() << wxT("' ") << wxT(" and scope='")
-        << scopeName << wxT("' ");
+    TagsStorageSQLiteQuery query(wxT("select * from tags where file=? and scope=? "));
+    query.Bind(fileName.GetFullPath()).Bind(scopeName);
 
     if(kind.IsEmpty() == false) {
-        sql << wxT(" and kind in(");
-        for(size_t i = 0; i < kind.GetCount(); i++) {
-            sql << wxT("'") << kind.Item(i) << wxT("',");
-        }
-        sql.RemoveLast();
-        sql << wxT(")");
+        query.Append(wxT(" and kind in "));
+        query.BindList(kind);
     }
 
-    DoFetchTags(sql, tags);
+    DoFetchTags(query, tags);
 }
 
 void TagsStorageSQLite::GetAllTagsNames(wxArrayString& names)
@@ -1102,15 +1086,12 @@ void TagsStorageSQLite::GetTagsByScopesAndKind(const wxArrayString& scopes, cons
 {
     if(kinds.empty() || scopes.empty()) { return; }
 
-    wxString sql;
-    sql << wxT("select * from tags where scope in (");
-    for(size_t i = 0; i < scopes.GetCount(); i++) {
-        sql << wxT("'") << scopes.Item(i) << wxT("',");
-    }
-    sql.RemoveLast();
-    sql << wxT(") ORDER BY NAME ");
-    DoAddLimitPartToQuery(sql, tags);
-    DoFetchTags(sql, tags, kinds);
+    TagsStorageSQLiteQuery query(wxT("select * from tags where scope in "));
+    query.BindList(scopes);
+    query.Append(wxT(" ORDER BY NAME "));
+    DoAddLimitPartToQuery(query, tags);
+    query.SetKinds(kinds);
+    DoFetchTags(query, tags);
 }
 
 void TagsStorageSQLite::GetTagsByScopesAndKindNoLimit(const wxArrayString& scopes, const wxArrayString& kinds,
@@ -1118,15 +1099,11 @@ void TagsStorageSQLite::GetTagsByScopesAndKindNoLimit(const wxArrayString& scope
 {
     if(kinds.empty() || scopes.empty()) { return; }
 
-    wxString sql;
-    sql << wxT("select * from tags where scope in (");
-    for(size_t i = 0; i < scopes.GetCount(); i++) {
-        sql << wxT("'") << scopes.Item(i) << wxT("',");
-    }
-    sql.RemoveLast();
-    sql << wxT(") ORDER BY NAME");
-
-    DoFetchTags(sql, tags, kinds);
+    TagsStorageSQLiteQuery query(wxT("select * from tags where scope in "));
+    query.BindList(scopes);
+    query.Append(wxT(" ORDER BY NAME"));
+    query.SetKinds(kinds);
+    DoFetchTags(query, tags);
 }
 
 void TagsStorageSQLite::GetTagsByTyperefAndKind(const wxArrayString& typerefs, const wxArrayString& kinds,
@@ -1134,24 +1111,21 @@ void TagsStorageSQLite::GetTagsByTyperefAndKind(const wxArrayString& typerefs, c
 {
     if(kinds.empty() || typerefs.empty()) { return; }
 
-    wxString sql;
-    sql << wxT("select * from tags where typeref in (");
-    for(size_t i = 0; i < typerefs.GetCount(); i++) {
-        sql << wxT("'") << typerefs.Item(i) << wxT("',");
-    }
-    sql.RemoveLast();
-    sql << wxT(") ORDER BY NAME ");
-    DoAddLimitPartToQuery(sql, tags);
-    DoFetchTags(sql, tags, kinds);
+    TagsStorageSQLiteQuery query(wxT("select * from tags where typeref in "));
+    query.BindList(typerefs);
+    query.Append(wxT(" ORDER BY NAME "));
+    DoAddLimitPartToQuery(query, tags);
+    query.SetKinds(kinds);
+    DoFetchTags(query, tags);
 }
 
 void TagsStorageSQLite::GetTagsByPath(const wxString& path, std::vector<TagEntryPtr>& tags, int limit)
 {
     if(path.empty()) return;
 
-    wxString sql;
-    sql << wxT("select * from tags where path ='") << path << wxT("' LIMIT ") << limit;
-    DoFetchTags(sql, tags);
+    TagsStorageSQLiteQuery query(wxT("select * from tags where path =? LIMIT ?"));
+    query.Bind(path).Bind(limit);
+    DoFetchTags(query, tags);
 }
 
 void TagsStorageSQLite::GetTagsByScopeAndName(const wxArrayString& scope, const wxString& name, bool partialNameAllowed,
@@ -1172,42 +1146,30 @@ void TagsStorageSQLite::GetTagsByScopeAndName(const wxArrayString& scope, const
     }
 
     if(scopes.IsEmpty() == false) {
-        wxString sql;
-        sql << wxT("select * from tags where scope in(");
+        TagsStorageSQLiteQuery query(wxT("select * from tags where scope in "));
+        query.BindList(scopes);
 
-        for(size_t i = 0; i < scopes.GetCount(); i++) {
-            sql << wxT("'") << scopes.Item(i) << wxT("',");
-        }
-        sql.RemoveLast();
-        sql << wxT(") ");
-
-        DoAddNamePartToQuery(sql, name, partialNameAllowed, true);
-        DoAddLimitPartToQuery(sql, tags);
+        DoAddNamePartToQuery(query, name, partialNameAllowed, true);
+        DoAddLimitPartToQuery(query, tags);
         // get get the tags
-        DoFetchTags(sql, tags);
+        DoFetchTags(query, tags);
     }
 }
 
 void TagsStorageSQLite::GetGlobalFunctions(std::vector<TagEntryPtr>& tags)
 {
-    wxString sql;
-    sql << wxT("select * from tags where scope = '<global>' AND kind IN ('function', 'prototype')");
-    DoAddLimitPartToQuery(sql, tags);
-    DoFetchTags(sql, tags);
+    TagsStorageSQLiteQuery query(wxT("select * from tags where scope = '<global>' AND kind IN ('function', 'prototype')"));
+    DoAddLimitPartToQuery(query, tags);
+    DoFetchTags(query, tags);
 }
 
 void TagsStorageSQLite::GetTagsByFiles(const wxArrayString& files, std::vector<TagEntryPtr>& tags)
 {
     if(files.IsEmpty()) return;
 
-    wxString sql;
-    sql << wxT("select * from tags where file in (");
-    for(size_t i = 0; i < files.GetCount(); i++) {
-        sql << wxT("'") << files.Item(i) << wxT("',");
-    }
-    sql.RemoveLast();
-    sql << wxT(")");
-    DoFetchTags(sql, tags);
+    TagsStorageSQLiteQuery query(wxT("select * from tags where file in "));
+    query.BindList(files);
+    DoFetchTags(query, tags);
 }
 
 void TagsStorageSQLite::GetTagsByFilesAndScope(const wxArrayString& files, const wxString& scope,
@@ -1215,84 +1177,51 @@ void TagsStorageSQLite::GetTagsByFilesAndScope(const wxArrayString& files, const
 {
     if(files.IsEmpty()) return;
 
-    wxString sql;
-    sql << wxT("select * from tags where file in (");
-    for(size_t i = 0; i < files.GetCount(); i++) {
-        sql << wxT("'") << files.Item(i) << wxT("',");
-    }
-    sql.RemoveLast();
-    sql << wxT(")");
-
-    sql << wxT(" AND scope='") << scope << wxT("'");
-    DoFetchTags(sql, tags);
+    TagsStorageSQLiteQuery query(wxT("select * from tags where file in "));
+    query.BindList(files);
+    query.Append(wxT(" AND scope=?")).Bind(scope);
+    DoFetchTags(query, tags);
 }
 
 void TagsStorageSQLite::GetTagsByFilesKindAndScope(const wxArrayString& files, const wxArrayString& kinds,
                                                    const wxString& scope, std::vector<TagEntryPtr>& tags)
 {
-    if(files.IsEmpty()) return;
+    if(files.IsEmpty() || kinds.IsEmpty()) return;
 
-    wxString sql;
-    sql << wxT("select * from tags where file in (");
-    for(size_t i = 0; i < files.GetCount(); i++) {
-        sql << wxT("'") << files.Item(i) << wxT("',");
-    }
-    sql.RemoveLast();
-    sql << wxT(")");
-
-    sql << wxT(" AND scope='") << scope << wxT("'");
-    DoFetchTags(sql, tags, kinds);
+    TagsStorageSQLiteQuery query(wxT("select * from tags where file in "));
+    query.BindList(files);
+    query.Append(wxT(" AND scope=?")).Bind(scope);
+    query.SetKinds(kinds);
+    DoFetchTags(query, tags);
 }
 
 void TagsStorageSQLite::GetTagsByFilesScopeTyperefAndKind(const wxArrayString& files, const wxArrayString& kinds,
                                                           const wxString& scope, const wxString& typeref,
                                                           std::vector<TagEntryPtr>& tags)
 {
-    if(files.IsEmpty()) return;
+    if(files.IsEmpty() || kinds.IsEmpty()) return;
 
-    wxString sql;
-    sql << wxT("select * from tags where file in (");
-    for(size_t i = 0; i < files.GetCount(); i++) {
-        sql << wxT("'") << files.Item(i) << wxT("',");
-    }
-    sql.RemoveLast();
-    sql << wxT(")");
-
-    sql << wxT(" AND scope='") << scope << wxT("'");
-    sql << wxT(" AND typeref='") << typeref << wxT("'");
-    DoFetchTags(sql, tags, kinds);
+    TagsStorageSQLiteQuery query(wxT("select * from tags where file in "));
+    query.BindList(files);
+    query.Append(wxT(" AND scope=?")).Bind(scope);
+    query.Append(wxT(" AND typeref=?")).Bind(typeref);
+    query.SetKinds(kinds);
+    DoFetchTags(query, tags);
 }
 
 void TagsStorageSQLite::GetTagsByKindLimit(const wxArrayString& kinds, const wxString& orderingColumn, int order,
                                            int limit, const wxString& partName, std::vector<TagEntryPtr>& tags)
 {
-    wxString sql;
-    sql << wxT("select * from tags where kind in (");
-    for(size_t i = 0; i < kinds.GetCount(); i++) {
-        sql << wxT("'") << kinds.Item(i) << wxT("',");
-    }
-    sql.RemoveLast();
-    sql << wxT(") ");
-
-    if(orderingColumn.IsEmpty() == false) {
-        sql << wxT("order by ") << orderingColumn;
-        switch(order) {
-        case ITagsStorage::OrderAsc:
-            sql << wxT(" ASC");
-            break;
-        case ITagsStorage::OrderDesc:
-            sql << wxT(" DESC");
-            break;
-        case ITagsStorage::OrderNone:
-        default:
-            break;
-        }
-    }
+    if(kinds.empty()) { return; }
 
-    DoAddNamePartToQuery(sql, partName, true, true);
-    if(limit > 0) { sql << wxT(" LIMIT ") << limit; }
+    TagsStorageSQLiteQuery query(wxT("select * from tags where kind in "));
+    query.BindList(kinds);
 
-    DoFetchTags(sql, tags);
+    DoAddNamePartToQuery(query, partName, true, true);
+    DoAddOrderPartToQuery(query, orderingColumn, order);
+    if(limit > 0) { query.Append(wxT(" LIMIT ?")).Bind(limit); }
+
+    DoFetchTags(query, tags);
 }
 bool TagsStorageSQLite::IsTypeAndScopeExistLimitOne(const wxString& typeName, const wxString& scope)
 {
@@ -1318,60 +1247,88 @@ bool TagsStorageSQLite::IsTypeAndScopeExistLimitOne(const wxString& typeName, co
 
 void TagsStorageSQLite::GetDereferenceOperator(const wxString& scope, std::vector<TagEntryPtr>& tags)
 {
-    wxString sql;
-    sql << wxT("select * from tags where scope ='") << scope << wxT("' and name like 'operator%->%' LIMIT 1");
-    DoFetchTags(sql, tags);
+    TagsStorageSQLiteQuery query(wxT("select * from tags where scope =? and name like 'operator%->%' LIMIT 1"));
+    query.Bind(scope);
+    DoFetchTags(query, tags);
 }
 
 void TagsStorageSQLite::GetSubscriptOperator(const wxString& scope, std::vector<TagEntryPtr>& tags)
 {
-    wxString sql;
-    sql << wxT("select * from tags where scope ='") << scope << wxT("' and name like 'operator%[%]%' LIMIT 1");
-    DoFetchTags(sql, tags);
+    TagsStorageSQLiteQuery query(wxT("select * from tags where scope =? and name like 'operator%[%]%' LIMIT 1"));
+    query.Bind(scope);
+    DoFetchTags(query, tags);
 }
 
 //---------------------------------------------------------------------
-//-----------------------------TagsStorageSQLiteCache -----------------
+//-----------------------------TagsStorageSQLiteQuery -----------------
 //---------------------------------------------------------------------
 
-TagsStorageSQLiteCache::TagsStorageSQLiteCache() {}
-
-TagsStorageSQLiteCache::~TagsStorageSQLiteCache() { m_cache.clear(); }
+TagsStorageSQLiteQuery& TagsStorageSQLiteQuery::Bind(const wxString& value)
+{
+    Value v;
+    v.m_string = value;
+    m_values.push_back(v);
+    return *this;
+}
 
-bool TagsStorageSQLiteCache::Get(const wxString& sql, std::vector<TagEntryPtr>& tags) { return DoGet(sql, tags); }
+TagsStorageSQLiteQuery& TagsStorageSQLiteQuery::Bind(int value)
+{
+    Value v;
+    v.m_number = value;
+    v.m_isNumber = true;
+    m_values.push_back(v);
+    return *this;
+}
 
-bool TagsStorageSQLiteCache::Get(const wxString& sql, const wxArrayString& kind, std::vector<TagEntryPtr>& tags)
+TagsStorageSQLiteQuery& TagsStorageSQLiteQuery::BindList(const wxArrayString& values)
 {
-    wxString key;
-    key << sql;
-    for(size_t i = 0; i < kind.GetCount(); i++) {
-        key << wxT("@") << kind.Item(i);
+    m_sql << wxT("(");
+    for(size_t i = 0; i < values.GetCount(); ++i) {
+        m_sql << (i ? wxT(",?") : wxT("?"));
+        Bind(values.Item(i));
     }
-
-    return DoGet(key, tags);
+    m_sql << wxT(") ");
+    return *this;
 }
 
-void TagsStorageSQLiteCache::Store(const wxString& sql, const std::vector<TagEntryPtr>& tags) { DoStore(sql, tags); }
-
-void TagsStorageSQLiteCache::Clear()
+void TagsStorageSQLiteQuery::BindTo(wxSQLite3Statement& statement) const
 {
-    // CL_DEBUG1(wxT("[CACHE CLEARED]"));
-    m_cache.clear();
+    for(size_t i = 0; i < m_values.size(); ++i) {
+        // Parameters are 1 based
+        if(m_values[i].m_isNumber) {
+            statement.Bind((int)i + 1, m_values[i].m_number);
+        } else {
+            statement.Bind((int)i + 1, m_values[i].m_string);
+        }
+    }
 }
 
-void TagsStorageSQLiteCache::Store(const wxString& sql, const wxArrayString& kind, const std::vector<TagEntryPtr>& tags)
+size_t TagsStorageSQLiteQuery::GetHash() const
 {
-    wxString key;
-    key << sql;
-    for(size_t i = 0; i < kind.GetCount(); i++) {
-        key << wxT("@") << kind.Item(i);
+    std::hash<wxString> hasher;
+    size_t h = hasher(m_sql);
+    for(size_t i = 0; i < m_values.size(); ++i) {
+        size_t vh = m_values[i].m_isNumber ? std::hash<int>()(m_values[i].m_number) : hasher(m_values[i].m_string);
+        h ^= vh + 0x9e3779b9 + (h << 6) + (h >> 2);
+    }
+    for(size_t i = 0; i < m_kinds.size(); ++i) {
+        h ^= hasher(m_kinds.Item(i)) + 0x9e3779b9 + (h << 6) + (h >> 2);
     }
-    DoStore(key, tags);
+    return h;
 }
 
-bool TagsStorageSQLiteCache::DoGet(const wxString& key, std::vector<TagEntryPtr>& tags)
+//---------------------------------------------------------------------
+//-----------------------------TagsStorageSQLiteCache -----------------
+//---------------------------------------------------------------------
+
+TagsStorageSQLiteCache::TagsStorageSQLiteCache() {}
+
+TagsStorageSQLiteCache::~TagsStorageSQLiteCache() { m_cache.clear(); }
+
+bool TagsStorageSQLiteCache::Get(const TagsStorageSQLiteQuery& query, std::vector<TagEntryPtr>& tags)
 {
-    std::unordered_map<wxString, std::vector<TagEntryPtr> >::iterator iter = m_cache.find(key);
+    std::unordered_map<TagsStorageSQLiteQuery, std::vector<TagEntryPtr>, TagsStorageSQLiteQuery::Hash>::iterator iter =
+        m_cache.find(query);
     if(iter != m_cache.end()) {
         // Append the results to the output tags
         tags.insert(tags.end(), iter->second.begin(), iter->second.end());
@@ -1380,10 +1337,30 @@ bool TagsStorageSQLiteCache::DoGet(const wxString& key, std::vector<TagEntryPtr>
     return false;
 }
 
-void TagsStorageSQLiteCache::DoStore(const wxString& key, const std::vector<TagEntryPtr>& tags)
+void TagsStorageSQLiteCache::Store(const TagsStorageSQLiteQuery& query, const std::vector<TagEntryPtr>& tags)
 {
-    m_cache[key].reserve(tags.size());
-    m_cache[key] = tags;
+    m_cache[query] = tags;
+}
+
+void TagsStorageSQLiteCache::Clear()
+{
+    // CL_DEBUG1(wxT("[CACHE CLEARED]"));
+    m_cache.clear();
+}
+
+wxSQLite3Statement& clSqliteDB::GetCachedStatement(const wxString& sql)
+{
+    std::unordered_map<wxString, wxSQLite3Statement>::iterator iter = m_statements.find(sql);
+    if(iter == m_statements.end()) {
+        // Statements built with a list of values ("in (?,?...)") differ by the list length.
+        // Keep the cache bounded
+        if(m_statements.size() >= MAX_CACHED_STATEMENTS) { m_statements.clear(); }
+        wxSQLite3Statement statement = PrepareStatement(sql);
+        iter = m_statements.insert(std::make_pair(sql, statement)).first;
+    } else {
+        iter->second.Reset();
+    }
+    return iter->second;
 }
 
 void TagsStorageSQLite::ClearCache() { m_cache.Clear(); }
@@ -1497,29 +1474,27 @@ void TagsStorageSQLite::GetTagsByName(const wxString& prefix, std::vector<TagEnt
     try {
         if(prefix.IsEmpty()) return;
 
-        wxString sql;
-        sql << wxT("select * from tags where ");
-        DoAddNamePartToQuery(sql, prefix, !exactMatch, false);
-        DoAddLimitPartToQuery(sql, tags);
-        DoFetchTags(sql, tags);
+        TagsStorageSQLiteQuery query(wxT("select * from tags where "));
+        DoAddNamePartToQuery(query, prefix, !exactMatch, false);
+        DoAddLimitPartToQuery(query, tags);
+        DoFetchTags(query, tags);
 
     } catch(wxSQLite3Exception& e) {
         CL_DEBUG(wxT("%s"), e.GetMessage().c_str());
     }
 }
 
-void TagsStorageSQLite::DoAddNamePartToQuery(wxString& sql, const wxString& name, bool partial, bool prependAnd)
+void TagsStorageSQLite::DoAddNamePartToQuery(TagsStorageSQLiteQuery& query, const wxString& name, bool partial,
+                                             bool prependAnd)
 {
     if(name.empty()) return;
-    if(prependAnd) { sql << wxT(" AND "); }
+    if(prependAnd) { query.Append(wxT(" AND ")); }
 
     if(m_enableCaseInsensitive) {
-        wxString tmpName(name);
-        tmpName.Replace(wxT("_"), wxT("^_"));
         if(partial) {
-            sql << wxT(" name LIKE '") << tmpName << wxT("%%' ESCAPE '^' ");
+            query.Append(wxT(" name LIKE ? ESCAPE '^' ")).Bind(EscapeLikePattern(name) + wxT("%"));
         } else {
-            sql << wxT(" name ='") << name << wxT("' ");
+            query.Append(wxT(" name =? ")).Bind(name);
         }
     } else {
         // Don't use LIKE
@@ -1531,19 +1506,39 @@ void TagsStorageSQLite::DoAddNamePartToQuery(wxString& sql, const wxString& name
 
         // add the name condition
         if(partial) {
-            sql << wxT(" name >= '") << from << wxT("' AND  name < '") << until << wxT("'");
+            query.Append(wxT(" name >= ? AND  name < ?")).Bind(from).Bind(until);
         } else {
-            sql << wxT(" name ='") << name << wxT("' ");
+            query.Append(wxT(" name =? ")).Bind(name);
         }
     }
 }
 
-void TagsStorageSQLite::DoAddLimitPartToQuery(wxString& sql, const std::vector<TagEntryPtr>& tags)
+void TagsStorageSQLite::DoAddLimitPartToQuery(TagsStorageSQLiteQuery& query, const std::vector<TagEntryPtr>& tags)
 {
     if(tags.size() >= (size_t)GetSingleSearchLimit()) {
-        sql << wxT(" LIMIT 1 ");
+        query.Append(wxT(" LIMIT 1 "));
     } else {
-        sql << wxT(" LIMIT ") << (size_t)GetSingleSearchLimit() - tags.size();
+        query.Append(wxT(" LIMIT ? ")).Bind((int)((size_t)GetSingleSearchLimit() - tags.size()));
+    }
+}
+
+void TagsStorageSQLite::DoAddOrderPartToQuery(TagsStorageSQLiteQuery& query, const wxString& orderingColumn,
+                                              int order)
+{
+    if(orderingColumn.IsEmpty()) { return; }
+
+    // A column name can not be bound
+    query.Append(wxT(" order by ")).Append(orderingColumn);
+    switch(order) {
+    case ITagsStorage::OrderAsc:
+        query.Append(wxT(" ASC"));
+        break;
+    case ITagsStorage::OrderDesc:
+        query.Append(wxT(" DESC"));
+        break;
+    case ITagsStorage::OrderNone:
+    default:
+        break;
     }
 }
 
@@ -1553,12 +1548,11 @@ TagEntryPtr TagsStorageSQLite::GetTagsByNameLimitOne(const wxString& name)
         if(name.IsEmpty()) return NULL;
 
         std::vector<TagEntryPtr> tags;
-        wxString sql;
-        sql << wxT("select * from tags where ");
-        DoAddNamePartToQuery(sql, name, false, false);
-        sql << wxT(" LIMIT 1 ");
+        TagsStorageSQLiteQuery query(wxT("select * from tags where "));
+        DoAddNamePartToQuery(query, name, false, false);
+        query.Append(wxT(" LIMIT 1 "));
 
-        DoFetchTags(sql, tags);
+        DoFetchTags(query, tags);
         if(tags.size() == 1)
             return tags.at(0);
         else
@@ -1575,13 +1569,10 @@ void TagsStorageSQLite::GetTagsByPartName(const wxString& partname, std::vector<
     try {
         if(partname.IsEmpty()) return;
 
-        wxString tmpName(partname);
-        tmpName.Replace(wxT("_"), wxT("^_"));
-
-        wxString sql;
-        sql << wxT("select * from tags where name like '%%") << tmpName << wxT("%%' ESCAPE '^' ");
-        DoAddLimitPartToQuery(sql, tags);
-        DoFetchTags(sql, tags);
+        TagsStorageSQLiteQuery query(wxT("select * from tags where name like ? ESCAPE '^' "));
+        query.Bind(wxT("%") + EscapeLikePattern(partname) + wxT("%"));
+        DoAddLimitPartToQuery(query, tags);
+        DoFetchTags(query, tags);
 
     } catch(wxSQLite3Exception& e) {
         CL_DEBUG(wxT("%s"), e.GetMessage().c_str());
@@ -1656,28 +1647,182 @@ void TagsStorageSQLite::RemoveNonWorkspaceSymbols(const std::vector<wxString>& s
 
 const wxString& TagsStorageSQLite::GetVersion() const
 {
-    static const wxString gTagsDatabaseVersion(wxT("CodeLite Version 11.1"));
+    static const wxString gTagsDatabaseVersion(wxT("CodeLite Version 11.3"));
     return gTagsDatabaseVersion;
 }
 
 void TagsStorageSQLite::GetTagsByPartName(const wxArrayString& parts, std::vector<TagEntryPtr>& tags)
 {
-    wxString sql;
     try {
         if(parts.IsEmpty()) { return; }
 
-        wxString filterQuery = "where ";
+        TagsStorageSQLiteQuery query(wxT("select * from tags where "));
         for(size_t i = 0; i < parts.size(); ++i) {
-            wxString tmpName = parts.Item(i);
-            tmpName.Replace(wxT("_"), wxT("^_"));
-            filterQuery << "path like '%%" << tmpName << "%%' " << ((i == (parts.size() - 1)) ? "" : "AND ");
+            query.Append(wxT("path like ? ESCAPE '^' ")).Append((i == (parts.size() - 1)) ? "" : "AND ");
+            query.Bind(wxT("%") + EscapeLikePattern(parts.Item(i)) + wxT("%"));
+        }
+        DoAddLimitPartToQuery(query, tags);
+        DoFetchTags(query, tags);
+
+    } catch(wxSQLite3Exception& e) {
+        clWARNING() << "GetTagsByPartName:" << e.GetMessage() << clEndl;
+    }
+}
+
+void TagsStorageSQLite::GetTagsByIds(const std::vector<long>& ids, std::vector<TagEntryPtr>& tags)
+{
+    if(ids.empty()) { return; }
+
+    // SQLite limits the number of variables per statement, so query in chunks. All the chunks use the same
+    // statement: the unused variables are bound to 0, which is not a valid ID. The result is not kept in the
+    // query cache: the IDs are already the result of a (cached) symbol index lookup
+    const size_t chunkSize = 100;
+    static const wxString sql = [&]() {
+        wxString s = wxT("select * from tags where ID in (?");
+        for(size_t i = 1; i < chunkSize; ++i) {
+            s << wxT(",?");
+        }
+        return s << wxT(")");
+    }();
+
+    CachedStatementResetter resetter;
+    try {
+        wxSQLite3Statement* statement = &m_db->GetCachedStatement(sql);
+        resetter.SetStatement(statement);
+        for(size_t first = 0; first < ids.size(); first += chunkSize) {
+            for(size_t i = 0; i < chunkSize; ++i) {
+                // Parameters are 1 based
+                statement->Bind((int)i + 1, (first + i) < ids.size() ? (int)ids[first + i] : 0);
+            }
+            wxSQLite3ResultSet rs = statement->ExecuteQuery();
+            while(rs.NextRow()) {
+                tags.push_back(TagEntryPtr(FromSQLite3ResultSet(rs)));
+            }
+            rs.Finalize();
+
+            // Release the read lock held by the cached statement
+            statement->Reset();
+        }
+    } catch(wxSQLite3Exception& e) {
+        clWARNING() << "GetTagsByIds:" << e.GetMessage() << clEndl;
+    }
+}
+
+void TagsStorageSQLite::StoreIdentifiers(const wxString& filename, const CppIdentifiersFile& file,
+                                         const CppIdentifiersList& identifiers)
+{
+    // Group the occurrences by name
+    std::vector<wxString> occurrences(identifiers.names.size());
+    for(size_t i = 0; i < identifiers.occurrences.size(); ++i) {
+        const CppIdentifiersList::Occurrence& occurrence = identifiers.occurrences[i];
+        wxString& str = occurrences[occurrence.name];
+        if(!str.IsEmpty()) { str << ";"; }
+        str << occurrence.offset << "," << occurrence.line << "," << occurrence.state;
+    }
+
+    try {
+        wxSQLite3Statement deleteStmnt = m_db->GetPrepareStatement(wxT("delete from IDENTIFIERS where file=?"));
+        deleteStmnt.Bind(1, filename);
+        deleteStmnt.ExecuteUpdate();
+
+        wxSQLite3Statement insertStmnt =
+            m_db->GetPrepareStatement(wxT("insert into IDENTIFIERS values(NULL, ?, ?, ?)"));
+        for(size_t i = 0; i < occurrences.size(); ++i) {
+            insertStmnt.Bind(1, identifiers.names[i]);
+            insertStmnt.Bind(2, filename);
+            insertStmnt.Bind(3, occurrences[i]);
+            insertStmnt.ExecuteUpdate();
+            insertStmnt.Reset();
+        }
+
+        wxSQLite3Statement fileStmnt =
+            m_db->GetPrepareStatement(wxT("insert or replace into IDENTIFIERS_FILES values(NULL, ?, ?, ?)"));
+        fileStmnt.Bind(1, filename);
+        fileStmnt.Bind(2, wxLongLong((wxLongLong_t)file.lastModified));
+        fileStmnt.Bind(3, wxLongLong((wxLongLong_t)file.size));
+        fileStmnt.ExecuteUpdate();
+
+    } catch(wxSQLite3Exception& e) {
+        clWARNING() << "StoreIdentifiers:" << filename << e.GetMessage() << clEndl;
+    }
+}
+
+void TagsStorageSQLite::UpdateIdentifiersFile(const wxString& filename, const CppIdentifiersFile& file)
+{
+    try {
+        wxSQLite3Statement stmnt =
+            m_db->GetPrepareStatement(wxT("update IDENTIFIERS_FILES set last_modified=?, size=? where file=?"));
+        stmnt.Bind(1, wxLongLong((wxLongLong_t)file.lastModified));
+        stmnt.Bind(2, wxLongLong((wxLongLong_t)file.size));
+        stmnt.Bind(3, filename);
+        stmnt.ExecuteUpdate();
+
+    } catch(wxSQLite3Exception& e) {
+        clWARNING() << "UpdateIdentifiersFile:" << filename << e.GetMessage() << clEndl;
+    }
+}
+
+void TagsStorageSQLite::DeleteIdentifiers(const wxArrayString& files)
+{
+    try {
+        wxSQLite3Statement deleteStmnt = m_db->GetPrepareStatement(wxT("delete from IDENTIFIERS where file=?"));
+        wxSQLite3Statement deleteFileStmnt =
+            m_db->GetPrepareStatement(wxT("delete from IDENTIFIERS_FILES where file=?"));
+        for(size_t i = 0; i < files.size(); ++i) {
+            deleteStmnt.Bind(1, files.Item(i));
+            deleteStmnt.ExecuteUpdate();
+            deleteStmnt.Reset();
+            deleteFileStmnt.Bind(1, files.Item(i));
+            deleteFileStmnt.ExecuteUpdate();
+            deleteFileStmnt.Reset();
         }
+    } catch(wxSQLite3Exception& e) {
+        clWARNING() << "DeleteIdentifiers:" << e.GetMessage() << clEndl;
+    }
+}
 
-        sql << "select * from tags " << filterQuery << " ESCAPE '^' ";
-        DoAddLimitPartToQuery(sql, tags);
-        DoFetchTags(sql, tags);
+void TagsStorageSQLite::GetIdentifiersFiles(CppIdentifiersFile::Map_t& files)
+{
+    try {
+        wxSQLite3ResultSet res = m_db->ExecuteQuery(wxT("select file, last_modified, size from IDENTIFIERS_FILES"));
+        while(res.NextRow()) {
+            CppIdentifiersFile& file = files[res.GetString(0)];
+            file.lastModified = (time_t)res.GetInt64(1).GetValue();
+            file.size = (size_t)res.GetInt64(2).GetValue();
+        }
+    } catch(wxSQLite3Exception& e) {
+        clWARNING() << "GetIdentifiersFiles:" << e.GetMessage() << clEndl;
+    }
+}
 
+void TagsStorageSQLite::GetIdentifierOccurrences(const wxString& name, CppIdentifier::Vec_t& occurrences)
+{
+    try {
+        wxSQLite3Statement stmnt =
+            m_db->GetPrepareStatement(wxT("select file, occurrences from IDENTIFIERS where name=?"));
+        stmnt.Bind(1, name);
+        wxSQLite3ResultSet res = stmnt.ExecuteQuery();
+        while(res.NextRow()) {
+            CppIdentifier identifier;
+            identifier.name = name;
+            identifier.filename = res.GetString(0);
+
+            // "offset,line,state;offset,line,state..."
+            std::string str = res.GetString(1).ToStdString();
+            const char* p = str.c_str();
+            while(*p) {
+                char* end = NULL;
+                identifier.offset = (int)strtol(p, &end, 10);
+                if(*end != ',') { break; }
+                identifier.line = (int)strtol(end + 1, &end, 10);
+                if(*end != ',') { break; }
+                identifier.state = (int)strtol(end + 1, &end, 10);
+                occurrences.push_back(identifier);
+                if(*end != ';') { break; }
+                p = end + 1;
+            }
+        }
     } catch(wxSQLite3Exception& e) {
-        clWARNING() << sql << ":" << e.GetMessage() << clEndl;
+        clWARNING() << "GetIdentifierOccurrences:" << e.GetMessage() << clEndl;
     }
 }
@@ -90,22 +90,101 @@
  * @ingroup CodeLite
  */
 
-class TagsStorageSQLiteCache
+/**
+ * @class TagsStorageSQLiteQuery
+ * @brief a query over the TAGS table where the values are kept apart from the SQL text.
+ * The SQL text only contains '?' placeholders, so it can be prepared once and reused with
+ * different values. The SQL text, the values and the kinds filter form the cache key
+ */
+class WXDLLIMPEXP_CL TagsStorageSQLiteQuery
 {
-    std::unordered_map<wxString, std::vector<TagEntryPtr> > m_cache;
+public:
+    struct Value {
+        wxString m_string;
+        int m_number;
+        bool m_isNumber;
+
+        Value()
+            : m_number(0)
+            , m_isNumber(false)
+        {
+        }
+        bool operator==(const Value& other) const
+        {
+            return m_isNumber == other.m_isNumber && m_number == other.m_number && m_string == other.m_string;
+        }
+    };
+
+    struct Hash {
+        size_t operator()(const TagsStorageSQLiteQuery& query) const { return query.GetHash(); }
+    };
 
 protected:
-    bool DoGet(const wxString& key, std::vector<TagEntryPtr>& tags);
-    void DoStore(const wxString& key, const std::vector<TagEntryPtr>& tags);
+    wxString m_sql;
+    std::vector<Value> m_values;
+    wxArrayString m_kinds;
+
+public:
+    TagsStorageSQLiteQuery(const wxString& sql = wxEmptyString)
+        : m_sql(sql)
+    {
+    }
+
+    /**
+     * @brief append SQL text to the query. Never inline values here, use Bind() instead
+     */
+    TagsStorageSQLiteQuery& Append(const wxString& sql)
+    {
+        m_sql << sql;
+        return *this;
+    }
+
+    /**
+     * @brief bind a value to the next '?' placeholder
+     */
+    TagsStorageSQLiteQuery& Bind(const wxString& value);
+    TagsStorageSQLiteQuery& Bind(int value);
+
+    /**
+     * @brief append a list of placeholders "(?,?,...)" and bind each of 'values' to them
+     */
+    TagsStorageSQLiteQuery& BindList(const wxArrayString& values);
+
+    /**
+     * @brief accept only tags of these kinds (the filter is applied on the fetched rows)
+     */
+    void SetKinds(const wxArrayString& kinds) { m_kinds = kinds; }
+    const wxArrayString& GetKinds() const { return m_kinds; }
+
+    const wxString& GetSql() const { return m_sql; }
+
+    /**
+     * @brief does this query have values bound to it?
+     */
+    bool IsParameterised() const { return !m_values.empty(); }
+
+    /**
+     * @brief bind our values to a statement prepared from GetSql()
+     */
+    void BindTo(wxSQLite3Statement& statement) const;
+
+    size_t GetHash() const;
+    bool operator==(const TagsStorageSQLiteQuery& other) const
+    {
+        return m_sql == other.m_sql && m_values == other.m_values && m_kinds == other.m_kinds;
+    }
+};
+
+class TagsStorageSQLiteCache
+{
+    std::unordered_map<TagsStorageSQLiteQuery, std::vector<TagEntryPtr>, TagsStorageSQLiteQuery::Hash> m_cache;
 
 public:
     TagsStorageSQLiteCache();
     virtual ~TagsStorageSQLiteCache();
 
-    bool Get(const wxString& sql, std::vector<TagEntryPtr>& tags);
-    bool Get(const wxString& sql, const wxArrayString& kind, std::vector<TagEntryPtr>& tags);
-    void Store(const wxString& sql, const std::vector<TagEntryPtr>& tags);
-    void Store(const wxString& sql, const wxArrayString& kind, const std::vector<TagEntryPtr>& tags);
+    bool Get(const TagsStorageSQLiteQuery& query, std::vector<TagEntryPtr>& tags);
+    void Store(const TagsStorageSQLiteQuery& query, const std::vector<TagEntryPtr>& tags);
     void Clear();
 };
 
@@ -119,14 +198,23 @@ public:
     {
     }
 
+    virtual ~clSqliteDB() { m_statements.clear(); }
+
     void Close()
     {
-        if(IsOpen()) wxSQLite3Database::Close();
-
+        // Finalize the cached statements before we close the database
         m_statements.clear();
+        if(IsOpen()) wxSQLite3Database::Close();
     }
 
     wxSQLite3Statement GetPrepareStatement(const wxString& sql) { return wxSQLite3Database::PrepareStatement(sql); }
+
+    /**
+     * @brief return a prepared statement for 'sql' which is kept by the database and reused
+     * on the next calls. The statement is reset before it is returned.
+     * The statement is owned by the database: do not copy it and do not keep it around
+     */
+    wxSQLite3Statement& GetCachedStatement(const wxString& sql);
 };
 
 class WXDLLIMPEXP_CL TagsStorageSQLite : public ITagsStorage
@@ -136,21 +224,16 @@ class WXDLLIMPEXP_CL TagsStorageSQLite : public ITagsStorage
 
 private:
     /**
-     * @brief fetch tags from the database
-     * @param sql
-     * @param tags
-     */
-    void DoFetchTags(const wxString& sql, std::vector<TagEntryPtr>& tags);
-
-    /**
-     * @brief
-     * @param sql
-     * @param tags
+     * @brief fetch tags from the database. Parameterised queries are executed using
+     * a cached prepared statement
+     * @param query
+     * @param tags [output]
      */
-    void DoFetchTags(const wxString& sql, std::vector<TagEntryPtr>& tags, const wxArrayString& kinds);
+    void DoFetchTags(const TagsStorageSQLiteQuery& query, std::vector<TagEntryPtr>& tags);
 
-    void DoAddNamePartToQuery(wxString& sql, const wxString& name, bool partial, bool prependAnd);
-    void DoAddLimitPartToQuery(wxString& sql, const std::vector<TagEntryPtr>& tags);
+    void DoAddNamePartToQuery(TagsStorageSQLiteQuery& query, const wxString& name, bool partial, bool prependAnd);
+    void DoAddLimitPartToQuery(TagsStorageSQLiteQuery& query, const std::vector<TagEntryPtr>& tags);
+    void DoAddOrderPartToQuery(TagsStorageSQLiteQuery& query, const wxString& orderingColumn, int order);
     int DoInsertTagEntry(const TagEntry& tag);
 
 public:
@@ -491,9 +574,12 @@ public:
     /**
      * @brief insert entry by file name
      * @param filename
+     * @param timestamp retag timestamp
+     * @param hash the file content hash
+     * @param size the file size in bytes
      * @return
      */
-    virtual int InsertFileEntry(const wxString& filename, int timestamp);
+    virtual int InsertFileEntry(const wxString& filename, int timestamp, const wxString& hash, size_t size);
 
     /**
     * @brief update file entry using file name as key
@@ -619,6 +705,11 @@ public:
      */
     void GetTagsByPartName(const wxArrayString& parts, std::vector<TagEntryPtr>& tags);
 
+    /**
+     * @brief return the tags with the given IDs
+     */
+    void GetTagsByIds(const std::vector<long>& ids, std::vector<TagEntryPtr>& tags);
+
     /**
      * @brief this function takes as input argument array of symbols and removes from it all the
      * symbols that are not part of the workspace. A symbol must be in the tags database and its type
@@ -626,6 +717,17 @@ public:
      */
     void RemoveNonWorkspaceSymbols(const std::vector<wxString>& symbols, std::vector<wxString>& workspaceSymbols,
                                    std::vector<wxString>& nonWorkspaceSymbols);
+
+    /**
+     * @brief replace the identifiers stored for a file. The occurrences of each name are stored in a single
+     * IDENTIFIERS row as "offset,line,state;..."
+     */
+    void StoreIdentifiers(const wxString& filename, const CppIdentifiersFile& file,
+                          const CppIdentifiersList& identifiers);
+    void UpdateIdentifiersFile(const wxString& filename, const CppIdentifiersFile& file);
+    void DeleteIdentifiers(const wxArrayString& files);
+    void GetIdentifiersFiles(CppIdentifiersFile::Map_t& files);
+    void GetIdentifierOccurrences(const wxString& name, CppIdentifier::Vec_t& occurrences);
 };
 
 #endif // CODELITE_TAGS_DATABASE_H
@@ -1,12 +1,19 @@
 #include "CxxTokenizer.h"
 #include "CxxVariableScanner.h"
+#include "LSPMessageFramer.h"
+#include "clFilesCollector.h"
 #include "ctags_manager.h"
 #include "fileutils.h"
 #include "tester.h"
+#include <algorithm>
 #include <iostream>
 #include <stdio.h>
+#include <string>
+#include <string.h>
+#include <wx/dir.h>
 #include <wx/init.h>
 #include <wx/log.h>
+#include <wx/utils.h>
 
 TEST_FUNC(test_cxx_normalize_signature)
 {
@@ -188,6 +195,249 @@ TEST_FUNC(test_local_in_std_for_each)
     return true;
 }
 
+static int IgnoreMatch(const clFilesScanner::IgnoreRules& rules, const char* path, bool isDir = false)
+{
+    return rules.Match(path, strlen(path), isDir);
+}
+
+TEST_FUNC(test_files_matcher)
+{
+    clFilesScanner::Matcher matcher("*.cpp;Makefile;test_?.h");
+    CHECK_BOOL(matcher.Matches("main.cpp"));
+    CHECK_BOOL(matcher.Matches("MAIN.CPP"));
+    CHECK_BOOL(matcher.Matches("makefile"));
+    CHECK_BOOL(matcher.Matches("test_1.h"));
+    CHECK_BOOL(!matcher.Matches("test_12.h"));
+    CHECK_BOOL(!matcher.Matches("main.c"));
+    CHECK_BOOL(clFilesScanner::Matcher("").IsEmpty());
+    CHECK_BOOL(!clFilesScanner::Matcher("").Matches("main.cpp"));
+    return true;
+}
+
+TEST_FUNC(test_ignore_rules_double_star)
+{
+    clFilesScanner::IgnoreRules rules;
+    rules.Add("**/build");
+    rules.Add("docs/**/*.txt");
+    rules.Add("a/**/b");
+    CHECK_BOOL(IgnoreMatch(rules, "build", true) == 1);
+    CHECK_BOOL(IgnoreMatch(rules, "src/build", true) == 1);
+    CHECK_BOOL(IgnoreMatch(rules, "src/x/build", true) == 1);
+    CHECK_BOOL(IgnoreMatch(rules, "docs/readme.txt") == 1);
+    CHECK_BOOL(IgnoreMatch(rules, "docs/a/b/readme.txt") == 1);
+    CHECK_BOOL(IgnoreMatch(rules, "docs/readme.cpp") == 0);
+    CHECK_BOOL(IgnoreMatch(rules, "a/b") == 1);
+    CHECK_BOOL(IgnoreMatch(rules, "a/x/y/b") == 1);
+    CHECK_BOOL(IgnoreMatch(rules, "ab") == 0);
+    return true;
+}
+
+TEST_FUNC(test_ignore_rules_folders_only)
+{
+    clFilesScanner::IgnoreRules rules;
+    rules.Add("logs/");
+    CHECK_BOOL(IgnoreMatch(rules, "logs", true) == 1);
+    CHECK_BOOL(IgnoreMatch(rules, "src/logs", true) == 1);
+    CHECK_BOOL(IgnoreMatch(rules, "logs", false) == 0);
+    return true;
+}
+
+TEST_FUNC(test_ignore_rules_negate)
+{
+    clFilesScanner::IgnoreRules rules;
+    rules.Add("*.log");
+    rules.Add("!important.log");
+    CHECK_BOOL(IgnoreMatch(rules, "debug.log") == 1);
+    CHECK_BOOL(IgnoreMatch(rules, "important.log") == -1);
+    CHECK_BOOL(IgnoreMatch(rules, "src/important.log") == -1);
+    CHECK_BOOL(IgnoreMatch(rules, "main.cpp") == 0);
+
+    // The last matching rule wins
+    rules.Add("important.log");
+    CHECK_BOOL(IgnoreMatch(rules, "important.log") == 1);
+    return true;
+}
+
+TEST_FUNC(test_ignore_rules_anchored)
+{
+    clFilesScanner::IgnoreRules rules;
+    rules.Add("/TODO");
+    rules.Add("doc/*.txt");
+    CHECK_BOOL(IgnoreMatch(rules, "TODO") == 1);
+    CHECK_BOOL(IgnoreMatch(rules, "src/TODO") == 0);
+    CHECK_BOOL(IgnoreMatch(rules, "doc/notes.txt") == 1);
+    CHECK_BOOL(IgnoreMatch(rules, "doc/server/arch.txt") == 0);
+    CHECK_BOOL(IgnoreMatch(rules, "src/doc/notes.txt") == 0);
+    return true;
+}
+
+TEST_FUNC(test_ignore_rules_trailing_spaces)
+{
+    clFilesScanner::IgnoreRules rules;
+    rules.Add("# a comment");
+    rules.Add("   ");
+    CHECK_BOOL(rules.IsEmpty());
+
+    rules.Add("foo.txt   ");
+    rules.Add("bar\\ ");
+    rules.Add("\\#hash");
+    CHECK_BOOL(IgnoreMatch(rules, "foo.txt") == 1);
+    CHECK_BOOL(IgnoreMatch(rules, "foo.txt ") == 0);
+    CHECK_BOOL(IgnoreMatch(rules, "bar ") == 1);
+    CHECK_BOOL(IgnoreMatch(rules, "bar") == 0);
+    CHECK_BOOL(IgnoreMatch(rules, "#hash") == 1);
+    return true;
+}
+
+TEST_FUNC(test_files_scanner_parallel_output)
+{
+    wxFileName root(wxFileName::GetTempDir(), "");
+    root.AppendDir(wxString() << "cl_files_scanner_test_" << (int)::wxGetProcessId());
+    for(size_t i = 0; i < 6; ++i) {
+        for(size_t j = 0; j < 4; ++j) {
+            wxFileName folder(root);
+            folder.AppendDir(wxString() << "dir" << i);
+            folder.AppendDir(wxString() << "sub" << j);
+            folder.Mkdir(wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+            FileUtils::WriteFileContent(wxFileName(folder.GetPath(), "file.cpp"), "");
+            FileUtils::WriteFileContent(wxFileName(folder.GetPath(), "file.h"), "");
+            FileUtils::WriteFileContent(wxFileName(folder.GetPath(), "readme.txt"), "");
+        }
+    }
+    wxFileName hidden(root);
+    hidden.AppendDir(".hidden");
+    hidden.Mkdir(wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+    FileUtils::WriteFileContent(wxFileName(hidden.GetPath(), "hidden.cpp"), "");
+
+    // The sequential wxDir scan is the reference
+    wxArrayString arr;
+    wxDir::GetAllFiles(root.GetPath(), &arr, "*.cpp");
+    wxDir::GetAllFiles(root.GetPath(), &arr, "*.h");
+    std::vector<wxString> expected(arr.begin(), arr.end());
+    std::sort(expected.begin(), expected.end());
+
+    std::vector<wxString> parallel;
+    clFilesScanner scanner;
+    scanner.SetThreads(8);
+    scanner.Scan(root.GetPath(), parallel, "*.cpp;*.h");
+    std::sort(parallel.begin(), parallel.end());
+
+    std::vector<wxString> sequential;
+    scanner.SetThreads(1);
+    scanner.Scan(root.GetPath(), sequential, "*.cpp;*.h");
+    std::sort(sequential.begin(), sequential.end());
+
+    wxFileName::Rmdir(root.GetPath(), wxPATH_RMDIR_RECURSIVE);
+    CHECK_SIZE(expected.size(), 49);
+    CHECK_BOOL(parallel == expected);
+    CHECK_BOOL(sequential == expected);
+    return true;
+}
+
+static std::string MakeLSPMessage(const std::string& body)
+{
+    return "Content-Length: " + std::to_string(body.length()) + "\r\n\r\n" + body;
+}
+
+TEST_FUNC(test_lsp_framer_split_message)
+{
+    // Feed the message one byte at a time: the headers separator and the body are split too
+    std::string raw = MakeLSPMessage("{\"jsonrpc\":\"2.0\",\"id\":3,\"result\":\"ok\"}");
+    LSPMessageFramer framer;
+    LSP::ResponseMessage::Ptr_t message;
+    for(size_t i = 0; i + 1 < raw.length(); ++i) {
+        framer.Append(raw.c_str() + i, 1);
+        CHECK_BOOL(!framer.Next(message));
+    }
+    framer.Append(raw.c_str() + raw.length() - 1, 1);
+    CHECK_BOOL(framer.Next(message));
+    CHECK_BOOL(message && message->IsOk());
+    CHECK_BOOL(message->GetId() == 3);
+    CHECK_SIZE(framer.GetPendingBytes(), 0);
+    CHECK_BOOL(!framer.Next(message));
+    return true;
+}
+
+TEST_FUNC(test_lsp_framer_multiple_messages)
+{
+    std::string raw;
+    for(int id = 1; id <= 4; ++id) {
+        raw += MakeLSPMessage(std::string("{\"jsonrpc\":\"2.0\",\"id\":") + std::to_string(id) + ",\"result\":null}");
+    }
+
+    // Three messages and a half in a single read
+    size_t half = raw.length() - 10;
+    LSPMessageFramer framer;
+    LSP::ResponseMessage::Ptr_t message;
+    framer.Append(raw.c_str(), half);
+    for(int id = 1; id <= 3; ++id) {
+        CHECK_BOOL(framer.Next(message));
+        CHECK_BOOL(message && message->GetId() == id);
+    }
+    CHECK_BOOL(!framer.Next(message));
+
+    framer.Append(raw.c_str() + half, raw.length() - half);
+    CHECK_BOOL(framer.Next(message));
+    CHECK_BOOL(message && message->GetId() == 4);
+    CHECK_BOOL(!framer.Next(message));
+    return true;
+}
+
+TEST_FUNC(test_lsp_framer_headers)
+{
+    // A header block without a Content-Length is skipped. The header names are case insensitive
+    std::string body = "{\"jsonrpc\":\"2.0\",\"id\":7,\"result\":1}";
+    std::string raw = "Content-Type: application/vscode-jsonrpc; charset=utf-8\r\n\r\n";
+    raw += "content-length: " + std::to_string(body.length()) + "\r\n";
+    raw += "Content-Type: application/vscode-jsonrpc; charset=utf-8\r\n\r\n";
+    raw += body;
+
+    LSPMessageFramer framer;
+    LSP::ResponseMessage::Ptr_t message;
+    framer.Append(raw);
+    CHECK_BOOL(framer.Next(message));
+    CHECK_BOOL(message && message->GetId() == 7);
+    CHECK_SIZE(framer.GetPendingBytes(), 0);
+    return true;
+}
+
+TEST_FUNC(test_lsp_framer_utf8_body)
+{
+    // The Content-Length is a number of bytes, not characters. Split the input inside a multi-byte character
+    std::string text = "h\xc3\xa9llo \xe2\x9c\x93";
+    std::string raw = MakeLSPMessage("{\"jsonrpc\":\"2.0\",\"id\":1,\"result\":\"" + text + "\"}");
+    raw += MakeLSPMessage("{\"jsonrpc\":\"2.0\",\"id\":2,\"result\":null}");
+    size_t split = raw.find("\xe2\x9c\x93") + 1;
+
+    LSPMessageFramer framer;
+    LSP::ResponseMessage::Ptr_t message;
+    framer.Append(raw.c_str(), split);
+    CHECK_BOOL(!framer.Next(message));
+    framer.Append(raw.c_str() + split, raw.length() - split);
+    CHECK_BOOL(framer.Next(message));
+    CHECK_BOOL(message && message->IsOk());
+    CHECK_BOOL(message->Get("result").toString() == wxString::FromUTF8(text.c_str()));
+    CHECK_BOOL(framer.Next(message));
+    CHECK_BOOL(message && message->GetId() == 2);
+    return true;
+}
+
+TEST_FUNC(test_lsp_framer_invalid_json)
+{
+    // The invalid body is consumed (with a null message), the next message is still read
+    std::string raw = MakeLSPMessage("{\"jsonrpc\":\"2.0\",\"id\":");
+    raw += MakeLSPMessage("{\"jsonrpc\":\"2.0\",\"id\":5,\"result\":null}");
+
+    LSPMessageFramer framer;
+    LSP::ResponseMessage::Ptr_t message;
+    framer.Append(raw);
+    CHECK_BOOL(framer.Next(message));
+    CHECK_BOOL(!message);
+    CHECK_BOOL(framer.Next(message));
+    CHECK_BOOL(message && message->GetId() == 5);
+    return true;
+}
+
 int main(int argc, char** argv)
 {
     wxInitializer initializer(argc, argv);
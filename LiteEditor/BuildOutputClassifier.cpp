@@ -0,0 +1,342 @@
+#include "BuildOutputClassifier.h"
+#include "file_logger.h"
+#include <algorithm>
+
+wxDEFINE_EVENT(wxEVT_BUILD_OUTPUT_CLASSIFIED, clCommandEvent);
+
+namespace
+{
+void SkipBracket(const wxString& re, size_t& pos)
+{
+    // pos is on the opening '['. A ']' right after "[" or "[^" is a literal
+    ++pos;
+    if(pos < re.length() && re[pos] == '^') { ++pos; }
+    if(pos < re.length() && re[pos] == ']') { ++pos; }
+    while(pos < re.length() && re[pos] != ']') {
+        if(re[pos] == '\\') {
+            ++pos;
+        } else if(re[pos] == '[' && (pos + 1) < re.length() &&
+                  (re[pos + 1] == ':' || re[pos + 1] == '.' || re[pos + 1] == '=')) {
+            // [:class:], [.coll.] or [=equiv=]
+            wxUniChar delim = re[pos + 1];
+            pos += 2;
+            while((pos + 1) < re.length() && !(re[pos] == delim && re[pos + 1] == ']')) {
+                ++pos;
+            }
+            ++pos;
+        }
+        ++pos;
+    }
+    ++pos;
+}
+
+// Collect the literal strings that any match of the expression (or of the group starting at "pos") must contain.
+// "unsafe" is set when the expression has alternatives or a syntax we don't follow: the literals are meaningless
+void CollectLiterals(const wxString& re, size_t& pos, bool inGroup, std::vector<wxString>& literals, bool& unsafe)
+{
+    wxString run;                       // the current sequence of literal characters
+    std::vector<wxString> lastGroup;    // the literals of the previous atom, if it was a group
+    bool lastIsChar = false;            // was the previous atom the last character of "run"?
+    auto flushRun = [&]() {
+        if(!run.IsEmpty()) { literals.push_back(run); }
+        run.Clear();
+    };
+    auto commitGroup = [&]() {
+        literals.insert(literals.end(), lastGroup.begin(), lastGroup.end());
+        lastGroup.clear();
+    };
+
+    while(pos < re.length()) {
+        wxUniChar ch = re[pos];
+        if(ch == '*' || ch == '?' || ch == '{' || ch == '+') {
+            // A quantifier: the previous atom is optional unless it is '+'
+            bool optional = (ch != '+');
+            if(lastIsChar && optional) { run.RemoveLast(); }
+            if(!optional) { commitGroup(); }
+            lastGroup.clear();
+            flushRun();
+            if(ch == '{') {
+                while(pos < re.length() && re[pos] != '}') {
+                    ++pos;
+                }
+            }
+            ++pos;
+            // non greedy
+            if(pos < re.length() && re[pos] == '?') { ++pos; }
+            lastIsChar = false;
+            continue;
+        }
+
+        commitGroup();
+        lastIsChar = false;
+        if(ch == '|') {
+            unsafe = true;
+            ++pos;
+        } else if(ch == ')') {
+            ++pos;
+            if(!inGroup) { unsafe = true; }
+            break;
+        } else if(ch == '(') {
+            flushRun();
+            ++pos;
+            bool groupUnsafe = false;
+            if(pos < re.length() && re[pos] == '?') {
+                // (?:...), (?=...) ...
+                groupUnsafe = true;
+            }
+            CollectLiterals(re, pos, true, lastGroup, groupUnsafe);
+            if(groupUnsafe) { lastGroup.clear(); }
+        } else if(ch == '[') {
+            flushRun();
+            SkipBracket(re, pos);
+        } else if(ch == '\\') {
+            ++pos;
+            if(pos < re.length() && !wxIsalnum(re[pos])) {
+                // an escaped character
+                run << re[pos];
+                lastIsChar = true;
+            } else {
+                // a class (\d, \s...) or a constraint (\m, \y...)
+                flushRun();
+            }
+            ++pos;
+        } else if(ch == '.' || ch == '^' || ch == '$') {
+            flushRun();
+            ++pos;
+        } else {
+            run << ch;
+            lastIsChar = true;
+            ++pos;
+        }
+    }
+    commitGroup();
+    flushRun();
+}
+
+// The longest literal (lower case) that a line must contain to match "pattern", empty if there is none
+wxString GetRequiredLiteral(const wxString& pattern)
+{
+    // "***=" / "***:" directors and embedded options change the meaning of the whole expression
+    if(pattern.StartsWith("***") || pattern.StartsWith("(?")) { return ""; }
+
+    std::vector<wxString> literals;
+    bool unsafe = false;
+    size_t pos = 0;
+    CollectLiterals(pattern, pos, false, literals, unsafe);
+    if(unsafe) { return ""; }
+
+    wxString longest;
+    for(size_t i = 0; i < literals.size(); ++i) {
+        if(literals[i].length() > longest.length()) { longest = literals[i]; }
+    }
+    return longest.Lower();
+}
+} // namespace
+
+BuildOutputClassifier::BuildOutputClassifier(wxEvtHandler* owner)
+    : m_owner(owner)
+{
+    m_goingDown.store(false);
+    m_thread = new std::thread(
+        [](BuildOutputClassifier* classifier) {
+            while(!classifier->m_goingDown.load()) {
+                Request request;
+                if(classifier->m_requests.ReceiveTimeout(10, request) != wxMSGQUEUE_NO_ERROR) { continue; }
+
+                // Classify everything that is already queued before waking the main thread
+                std::vector<Line> lines;
+                size_t count = 0;
+                do {
+                    classifier->ProcessRequest(request, lines);
+                    ++count;
+                } while(classifier->m_requests.ReceiveTimeout(0, request) == wxMSGQUEUE_NO_ERROR);
+
+                bool notify = false;
+                {
+                    std::lock_guard<std::mutex> guard(classifier->m_linesLock);
+                    // The main thread was already notified if the list was not empty
+                    notify = classifier->m_lines.empty() && !lines.empty();
+                    classifier->m_lines.insert(classifier->m_lines.end(), lines.begin(), lines.end());
+                    classifier->m_processed += count;
+                }
+                classifier->m_linesCond.notify_all();
+                if(notify) {
+                    clCommandEvent evt(wxEVT_BUILD_OUTPUT_CLASSIFIED);
+                    classifier->m_owner->AddPendingEvent(evt);
+                }
+            }
+            clDEBUG() << "Build output classifier thread: going down";
+        },
+        this);
+}
+
+BuildOutputClassifier::~BuildOutputClassifier()
+{
+    m_goingDown.store(true);
+    m_thread->join();
+    wxDELETE(m_thread);
+    for(size_t i = 0; i < m_lines.size(); ++i) {
+        wxDELETE(m_lines[i].info);
+    }
+    m_lines.clear();
+}
+
+void BuildOutputClassifier::Post(Request& request)
+{
+    request.generation = m_generation;
+    ++m_posted;
+    m_requests.Post(request);
+}
+
+void BuildOutputClassifier::SetCompiler(CompilerPtr compiler, const wxString& cygwinRoot)
+{
+    Request request;
+    request.type = Request::kCompiler;
+    if(compiler) {
+        request.errors = compiler->GetErrPatterns();
+        request.warnings = compiler->GetWarnPatterns();
+    }
+    request.cygwinRoot = cygwinRoot;
+    Post(request);
+}
+
+void BuildOutputClassifier::Add(const wxArrayString& lines)
+{
+    Request request;
+    request.type = Request::kLines;
+    request.lines = lines;
+    Post(request);
+}
+
+void BuildOutputClassifier::Clear()
+{
+    // The lines of the previous generation are dropped by TakeLines()
+    ++m_generation;
+    Request request;
+    request.type = Request::kClear;
+    Post(request);
+}
+
+void BuildOutputClassifier::Flush()
+{
+    std::unique_lock<std::mutex> lock(m_linesLock);
+    m_linesCond.wait(lock, [this]() { return m_processed == m_posted; });
+}
+
+void BuildOutputClassifier::TakeLines(std::vector<Line>& lines)
+{
+    lines.clear();
+    {
+        std::lock_guard<std::mutex> guard(m_linesLock);
+        lines.swap(m_lines);
+    }
+
+    // Drop the lines posted before the last Clear()
+    std::vector<Line>::iterator iter = std::stable_partition(
+        lines.begin(), lines.end(), [this](const Line& line) { return line.generation == m_generation; });
+    for(std::vector<Line>::iterator stale = iter; stale != lines.end(); ++stale) {
+        wxDELETE(stale->info);
+    }
+    lines.erase(iter, lines.end());
+}
+
+void BuildOutputClassifier::ProcessRequest(const Request& request, std::vector<Line>& lines)
+{
+    switch(request.type) {
+    case Request::kClear:
+        m_directories.Clear();
+        break;
+    case Request::kCompiler:
+        SetPatterns(request);
+        break;
+    case Request::kLines:
+        for(size_t i = 0; i < request.lines.size(); ++i) {
+            Line line;
+            line.text = request.lines.Item(i);
+            line.info = Classify(line.text);
+            line.generation = request.generation;
+            lines.push_back(line);
+        }
+        break;
+    }
+}
+
+void BuildOutputClassifier::SetPatterns(const Request& request)
+{
+    m_cygwinRoot = request.cygwinRoot;
+    m_warningPatterns.clear();
+    m_errorPatterns.clear();
+    m_literals.clear();
+    AddPatterns(request.warnings, SV_WARNING, m_warningPatterns);
+    AddPatterns(request.errors, SV_ERROR, m_errorPatterns);
+    clDEBUG() << "Build output classifier:" << (m_warningPatterns.size() + m_errorPatterns.size()) << "patterns,"
+              << m_literals.size() << "distinct literals" << clEndl;
+}
+
+void BuildOutputClassifier::AddPatterns(const Compiler::CmpListInfoPattern& patterns, LINE_SEVERITY severity,
+                                        std::vector<Pattern>& compiled)
+{
+    Compiler::CmpListInfoPattern::const_iterator iter = patterns.begin();
+    for(; iter != patterns.end(); ++iter) {
+        CmpPatternPtr cmpPattern(new CmpPattern(new wxRegEx(iter->pattern, wxRE_ADVANCED | wxRE_ICASE),
+                                                iter->fileNameIndex, iter->lineNumberIndex, iter->columnIndex,
+                                                severity));
+        if(!cmpPattern->GetRegex()->IsValid()) { continue; }
+
+        Pattern pattern;
+        pattern.cmpPattern = cmpPattern;
+        wxString literal = GetRequiredLiteral(iter->pattern);
+        if(!literal.IsEmpty()) {
+            // The patterns share their literals (e.g. ": "), search each of them once per line
+            std::vector<wxString>::iterator where = std::find(m_literals.begin(), m_literals.end(), literal);
+            pattern.literal = where - m_literals.begin();
+            if(where == m_literals.end()) { m_literals.push_back(literal); }
+        }
+        compiled.push_back(pattern);
+    }
+}
+
+bool BuildOutputClassifier::MatchPatterns(const std::vector<Pattern>& patterns, const std::vector<bool>& literals,
+                                          const wxString& line, BuildLineInfo* info)
+{
+    for(size_t i = 0; i < patterns.size(); ++i) {
+        const Pattern& pattern = patterns[i];
+        if(pattern.literal != wxNOT_FOUND && !literals[pattern.literal]) { continue; }
+        if(pattern.cmpPattern->Matches(line, *info)) {
+            info->NormalizeFilename(m_directories, m_cygwinRoot);
+            return true;
+        }
+    }
+    return false;
+}
+
+BuildLineInfo* BuildOutputClassifier::Classify(const wxString& line)
+{
+    BuildLineInfo* info = new BuildLineInfo();
+    wxString lcLine = line.Lower();
+    if(lcLine.Contains("entering directory") || lcLine.Contains("leaving directory")) {
+        info->SetSeverity(SV_DIR_CHANGE);
+        // Collect the directory, the relative file names are resolved against it
+        wxString currentDir;
+        if(line.Contains("Entering directory `")) {
+            currentDir = line.AfterFirst('`').BeforeLast('\'');
+            m_directories.Add(currentDir);
+        } else if(line.Contains("Entering directory '")) {
+            currentDir = line.AfterFirst('\'').BeforeLast('\'');
+            m_directories.Add(currentDir);
+        }
+        return info;
+
+    } else if(line.StartsWith("====")) {
+        return info;
+    }
+
+    std::vector<bool> literals(m_literals.size());
+    for(size_t i = 0; i < m_literals.size(); ++i) {
+        literals[i] = lcLine.Contains(m_literals[i]);
+    }
+
+    // Find *warnings* first
+    if(!MatchPatterns(m_warningPatterns, literals, line, info)) { MatchPatterns(m_errorPatterns, literals, line, info); }
+    return info;
+}
@@ -0,0 +1,112 @@
+#ifndef BUILDOUTPUTCLASSIFIER_H
+#define BUILDOUTPUTCLASSIFIER_H
+
+#include "cl_command_event.h"
+#include "compiler.h"
+#include "new_build_tab.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <wx/msgqueue.h>
+
+wxDECLARE_EVENT(wxEVT_BUILD_OUTPUT_CLASSIFIED, clCommandEvent);
+
+/**
+ * @class BuildOutputClassifier
+ * @brief classify the build output lines (errors, warnings, directory changes) on a worker thread.
+ *
+ * The owner posts complete lines with Add() and is notified with wxEVT_BUILD_OUTPUT_CLASSIFIED when classified
+ * lines are ready, it then collects them with TakeLines(). The lines are classified by a single worker, in the
+ * order they were posted: the "Entering directory" lines change how the file names of the following lines are
+ * resolved. Each compiler pattern is only evaluated on the lines that contain its longest required literal (e.g.
+ * "undefined reference to" or ": "), so most of the lines never reach the regular expressions
+ */
+class BuildOutputClassifier
+{
+public:
+    struct Line {
+        wxString text;
+        BuildLineInfo* info = nullptr; // owned by the caller of TakeLines()
+        size_t generation = 0;
+    };
+
+protected:
+    struct Request {
+        enum eType { kLines, kCompiler, kClear };
+        eType type = kLines;
+        size_t generation = 0;
+        wxArrayString lines;
+        Compiler::CmpListInfoPattern errors;
+        Compiler::CmpListInfoPattern warnings;
+        wxString cygwinRoot;
+    };
+
+    struct Pattern {
+        CmpPatternPtr cmpPattern;
+        int literal = wxNOT_FOUND; // index in m_literals, wxNOT_FOUND if the pattern must run on every line
+    };
+
+    wxEvtHandler* m_owner = nullptr;
+    std::thread* m_thread = nullptr;
+    std::atomic_bool m_goingDown;
+    wxMessageQueue<Request> m_requests;
+    size_t m_generation = 0;
+    size_t m_posted = 0;
+
+    std::mutex m_linesLock;
+    std::condition_variable m_linesCond;
+    std::vector<Line> m_lines;
+    size_t m_processed = 0;
+
+    // Used by the worker thread only
+    std::vector<Pattern> m_warningPatterns;
+    std::vector<Pattern> m_errorPatterns;
+    std::vector<wxString> m_literals;
+    wxArrayString m_directories;
+    wxString m_cygwinRoot;
+
+protected:
+    void Post(Request& request);
+    void ProcessRequest(const Request& request, std::vector<Line>& lines);
+    void SetPatterns(const Request& request);
+    void AddPatterns(const Compiler::CmpListInfoPattern& patterns, LINE_SEVERITY severity,
+                     std::vector<Pattern>& compiled);
+    BuildLineInfo* Classify(const wxString& line);
+    bool MatchPatterns(const std::vector<Pattern>& patterns, const std::vector<bool>& literals, const wxString& line,
+                       BuildLineInfo* info);
+
+public:
+    BuildOutputClassifier(wxEvtHandler* owner);
+    virtual ~BuildOutputClassifier();
+
+    /**
+     * @brief use the error and warning patterns of "compiler" for the lines posted from now on
+     * @param compiler the build compiler, the lines are not matched against any pattern if it is null
+     * @param cygwinRoot the Windows path of the cygwin root folder, if any
+     */
+    void SetCompiler(CompilerPtr compiler, const wxString& cygwinRoot);
+
+    /**
+     * @brief classify complete build output lines
+     */
+    void Add(const wxArrayString& lines);
+
+    /**
+     * @brief discard the lines that were not taken yet and forget the directories seen so far
+     */
+    void Clear();
+
+    /**
+     * @brief block until all the posted lines were classified
+     */
+    void Flush();
+
+    /**
+     * @brief take the classified lines, in the order they were posted
+     */
+    void TakeLines(std::vector<Line>& lines);
+};
+
+#endif // BUILDOUTPUTCLASSIFIER_H
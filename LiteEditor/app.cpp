@@ -188,6 +188,8 @@ static void CodeLiteBlockSigChild()
 //-------------------------------------------
 static void WaitForDebugger(int signo)
 {
+    FileLogger::FlushOnCrash();
+
     wxString msg;
     wxString where;
 
@@ -267,6 +269,12 @@ bool CodeLiteApp::OnInit()
     SetAppName(wxT("codelite"));
 #endif
 
+    // Record a trace of this session (see performance.h)
+    wxString traceFile;
+    if(wxGetEnv("CODELITE_TRACE", &traceFile) && !traceFile.IsEmpty()) {
+        clTracer::Start(traceFile.ToStdString());
+    }
+
 #ifdef __WXGTK__
     // We need to set the installation prefix on GTK for some reason (mainly debug builds)
     wxString installationDir(INSTALL_DIR);
@@ -695,6 +703,7 @@ bool CodeLiteApp::OnInit()
 int CodeLiteApp::OnExit()
 {
     CL_DEBUG(wxT("Bye"));
+    clTracer::Stop();
     EditorConfigST::Free();
     ConfFileLocator::Release();
     return 0;
@@ -720,6 +729,7 @@ bool CodeLiteApp::CopySettings(const wxString& destDir, wxString& installPath)
 
 void CodeLiteApp::OnFatalException()
 {
+    FileLogger::FlushOnCrash();
 #if wxUSE_STACKWALKER
     wxString startdir;
     startdir << clStandardPaths::Get().GetUserDataDir() << wxT("/crash.log");
@@ -65,6 +65,7 @@
 #include "new_build_tab.h"
 #include "new_quick_watch_dlg.h"
 #include "parse_thread.h"
+#include "performance.h"
 #include "pluginmanager.h"
 #include "precompiled_header.h"
 #include "quickfindbar.h"
@@ -3812,6 +3813,7 @@ void clEditor::OnDbgCustomWatch(wxCommandEvent& event)
 
 void clEditor::UpdateColours()
 {
+    CL_TRACE_SCOPE("clEditor::UpdateColours");
     SetKeywordClasses("");
     SetKeywordLocals("");
 
@@ -37,6 +37,8 @@
 #include "cl_editor.h"
 #include "compilation_database.h"
 #include "compiler_command_line_parser.h"
+#include "CxxPreProcessorHeaderCache.h"
+#include "CompileCommandsJSON.h"
 #include "language.h"
 #include "code_completion_api.h"
 #include "parse_thread.h"
@@ -335,6 +337,7 @@ void CodeCompletionManager::OnCompileCommandsFileGenerated(clCommandEvent& event
 {
     event.Skip();
     clDEBUG() << "-- Code Completion Manager: process file" << event.GetFileName();
+    if(event.GetPtr()) { m_compileCommandsDb = event.GetPtr(); }
     this->CompileCommandsFileProcessed(event.GetStrings());
     clMainFrame::Get()->SetStatusText("Ready");
 }
@@ -521,6 +524,16 @@ bool CodeCompletionManager::GetDefinitionsAndSearchPaths(clEditor* editor, wxArr
     wxArrayString builtinMacros = compiler->GetBuiltinMacros();
     definitions.insert(definitions.end(), builtinMacros.begin(), builtinMacros.end());
 
+    // Use the flags the file is compiled with, if it is found in compile_commands.json
+    CompileCommandsJSON* compileCommands = dynamic_cast<CompileCommandsJSON*>(m_compileCommandsDb.get());
+    const CompileCommandsJSON::Flags* flags =
+        compileCommands ? compileCommands->GetFlags(editor->GetFileName()) : nullptr;
+    if(flags) {
+        CL_DEBUG("CxxPreProcessor will use the compile_commands.json flags of: %s", editor->GetFileName().GetFullPath());
+        searchPaths.insert(searchPaths.begin(), flags->includes.begin(), flags->includes.end());
+        definitions.insert(definitions.end(), flags->macros.begin(), flags->macros.end());
+    }
+
     return true;
 }
 
@@ -528,6 +541,8 @@ void CodeCompletionManager::OnWorkspaceClosed(wxCommandEvent& event)
 {
     event.Skip();
     LanguageST::Get()->ClearAdditionalScopesCache();
+    CxxPreProcessorHeaderCache::Get().Clear();
+    m_compileCommandsDb.reset();
 }
 
 void CodeCompletionManager::OnEnvironmentVariablesModified(clCommandEvent& event)
@@ -50,6 +50,7 @@ protected:
     wxFileName m_compileCommands;
     time_t m_compileCommandsLastModified = 0;
     CompileCommandsGenerator::Ptr_t m_compileCommandsGenerator;
+    wxSharedPtr<wxClientData> m_compileCommandsDb; // CompileCommandsJSON, the per file flags
 
 protected:
     /// ctags implementions
@@ -3023,6 +3023,7 @@ void ContextCpp::OnShowCodeNavMenu(clCodeCompletionEvent& e)
 
 void ContextCpp::ColourContextTokens(const wxString& workspaceTokensStr, const wxString& localsTokensStr)
 {
+    CL_TRACE_SCOPE("ContextCpp::ColourContextTokens");
     clEditor& ctrl = GetCtrl();
     size_t cc_flags = TagsManagerST::Get()->GetCtagsOptions().GetFlags();
 
@@ -229,6 +229,15 @@ FindInFilesDialogBase::FindInFilesDialogBase(wxWindow* parent, wxWindowID id, co
 
     boxSizer135->Add(m_checkBoxSaveFilesBeforeSearching, 0, wxALL | wxEXPAND, WXC_FROM_DIP(5));
 
+    m_checkBoxUseSearchIndex =
+        new wxCheckBox(this, wxID_ANY, _("Use index"), wxDefaultPosition, wxDLG_UNIT(this, wxSize(-1, -1)), 0);
+    m_checkBoxUseSearchIndex->SetValue(false);
+    m_checkBoxUseSearchIndex->SetToolTip(
+        _("Skip the files that can not contain the searched string using an index of their content. The index is "
+          "stored in the workspace folder and updated while searching"));
+
+    boxSizer135->Add(m_checkBoxUseSearchIndex, 0, wxALL | wxEXPAND, WXC_FROM_DIP(5));
+
     SetName(wxT("FindInFilesDialogBase"));
     SetSize(wxDLG_UNIT(this, wxSize(-1, -1)));
     if(GetSizer()) { GetSizer()->Fit(this); }
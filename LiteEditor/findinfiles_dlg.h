@@ -64,6 +64,7 @@ protected:
     wxCheckBox* m_regualrExpression;
     wxCheckBox* m_checkBoxPipeForGrep;
     wxCheckBox* m_checkBoxSaveFilesBeforeSearching;
+    wxCheckBox* m_checkBoxUseSearchIndex;
 
 protected:
     virtual void OnFind(wxCommandEvent& event) { event.Skip(); }
@@ -95,6 +96,7 @@ public:
     wxCheckBox* GetRegualrExpression() { return m_regualrExpression; }
     wxCheckBox* GetCheckBoxPipeForGrep() { return m_checkBoxPipeForGrep; }
     wxCheckBox* GetCheckBoxSaveFilesBeforeSearching() { return m_checkBoxSaveFilesBeforeSearching; }
+    wxCheckBox* GetCheckBoxUseSearchIndex() { return m_checkBoxUseSearchIndex; }
     FindInFilesDialogBase(wxWindow* parent, wxWindowID id = wxID_ANY, const wxString& title = _("Find In Files"),
                           const wxPoint& pos = wxDefaultPosition, const wxSize& size = wxSize(-1, -1),
                           long style = wxDEFAULT_DIALOG_STYLE | wxRESIZE_BORDER);
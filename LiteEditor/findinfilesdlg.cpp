@@ -71,6 +71,7 @@ FindInFilesDialog::FindInFilesDialog(wxWindow* parent, FindReplaceData& data)
     m_regualrExpression->SetValue(m_data.GetFlags() & wxFRD_REGULAREXPRESSION);
     m_checkBoxSaveFilesBeforeSearching->SetValue(m_data.GetFlags() & wxFRD_SAVE_BEFORE_SEARCH);
     m_checkBoxPipeForGrep->SetValue(m_data.GetFlags() & wxFRD_ENABLE_PIPE_SUPPORT);
+    m_checkBoxUseSearchIndex->SetValue(m_data.GetFlags() & wxFRD_USE_SEARCH_INDEX);
     // Set encoding
     wxArrayString astrEncodings;
     wxFontEncoding fontEnc;
@@ -180,6 +181,16 @@ SearchData FindInFilesDialog::DoGetSearchData()
     data.SetSkipStrings(flags & wxFRD_SKIP_STRINGS);
     data.SetColourComments(flags & wxFRD_COLOUR_COMMENTS);
     data.SetEnablePipeSupport(flags & wxFRD_ENABLE_PIPE_SUPPORT);
+
+    // Use the workspace search index, stored in the workspace private folder
+    if((flags & wxFRD_USE_SEARCH_INDEX) && clWorkspaceManager::Get().IsWorkspaceOpened()) {
+        wxFileName workspaceFile = clWorkspaceManager::Get().GetWorkspace()->GetFileName();
+        wxFileName indexFile(workspaceFile.GetPath(), workspaceFile.GetName());
+        indexFile.AppendDir(".codelite");
+        indexFile.SetExt("trigrams");
+        if(indexFile.Mkdir(wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL)) { data.SetIndexFile(indexFile.GetFullPath()); }
+    }
+
     wxArrayString searchWhere = GetPathsAsArray();
     wxArrayString files;
     wxArrayString rootDirs;
@@ -423,6 +434,7 @@ size_t FindInFilesDialog::GetSearchFlags()
     if(m_regualrExpression->IsChecked()) flags |= wxFRD_REGULAREXPRESSION;
     if(m_checkBoxSaveFilesBeforeSearching->IsChecked()) flags |= wxFRD_SAVE_BEFORE_SEARCH;
     if(m_checkBoxPipeForGrep->IsChecked()) flags |= wxFRD_ENABLE_PIPE_SUPPORT;
+    if(m_checkBoxUseSearchIndex->IsChecked()) flags |= wxFRD_USE_SEARCH_INDEX;
     return flags;
 }
 
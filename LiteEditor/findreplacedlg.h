@@ -46,6 +46,7 @@ class wxStaticText;
 #define wxFRD_COLOUR_COMMENTS (1 << 10)
 #define wxFRD_SEPARATETAB_DISPLAY (1 << 11)
 #define wxFRD_ENABLE_PIPE_SUPPORT (1 << 12)
+#define wxFRD_USE_SEARCH_INDEX (1 << 13)
 
 #define FIND_DLG 0
 #define REPLACE_DLG 1
@@ -136,6 +136,7 @@
 #include "newworkspacedlg.h"
 #include "openwindowspanel.h"
 #include "options_dlg2.h"
+#include "performance.h"
 #include "plugin.h"
 #include "pluginmanager.h"
 #include "pluginmgrdlg.h"
@@ -593,6 +594,8 @@ EVT_MENU(wxID_ABOUT, clMainFrame::OnAbout)
 EVT_MENU(XRCID("wxID_REPORT_BUG"), clMainFrame::OnReportIssue)
 EVT_MENU(XRCID("check_for_update"), clMainFrame::OnCheckForUpdate)
 EVT_MENU(XRCID("run_setup_wizard"), clMainFrame::OnRunSetupWizard)
+EVT_MENU(XRCID("record_trace"), clMainFrame::OnRecordTrace)
+EVT_UPDATE_UI(XRCID("record_trace"), clMainFrame::OnRecordTraceUI)
 
 //-------------------------------------------------------
 // Perspective menu
@@ -5255,6 +5258,24 @@ void clMainFrame::OnRunSetupWizard(wxCommandEvent& e)
     if(!StartSetupWizard()) { GetMainBook()->ApplySettingsChanges(); }
 }
 
+void clMainFrame::OnRecordTrace(wxCommandEvent& e)
+{
+    wxUnusedVar(e);
+    if(clTracer::IsEnabled()) {
+        clTracer::Stop();
+        GetStatusBar()->SetMessage(_("Performance trace written to: ") + wxString(clTracer::GetFileName()));
+        return;
+    }
+
+    wxString path = ::wxFileSelector(_("Save the trace as"), "", "codelite-trace.json", "json",
+                                     wxFileSelectorDefaultWildcardStr, wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+    if(path.IsEmpty()) { return; }
+    clTracer::Start(path.ToStdString());
+    GetStatusBar()->SetMessage(_("Recording a performance trace..."));
+}
+
+void clMainFrame::OnRecordTraceUI(wxUpdateUIEvent& e) { e.Check(clTracer::IsEnabled()); }
+
 void clMainFrame::OnCloseTabsToTheRight(wxCommandEvent& e)
 {
     wxUnusedVar(e);
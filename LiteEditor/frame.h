@@ -421,6 +421,8 @@ protected:
     void OnReportIssue(wxCommandEvent& event);
     void OnCheckForUpdate(wxCommandEvent& e);
     void OnRunSetupWizard(wxCommandEvent& e);
+    void OnRecordTrace(wxCommandEvent& e);
+    void OnRecordTraceUI(wxUpdateUIEvent& e);
     void OnFileNew(wxCommandEvent& event);
     void OnFileOpen(wxCommandEvent& event);
     void OnFileOpenFolder(wxCommandEvent& event);
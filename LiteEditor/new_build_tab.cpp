@@ -23,6 +23,7 @@
 //////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////
 
+#include "BuildOutputClassifier.h"
 #include "BuildTabTopPanel.h"
 #include "ColoursAndFontsManager.h"
 #include "Notebook.h"
@@ -91,6 +92,7 @@ typedef std::map<int, AnnotationInfo> AnnotationInfoByLineMap_t;
 
 NewBuildTab::NewBuildTab(wxWindow* parent)
     : wxPanel(parent)
+    , m_classifier(new BuildOutputClassifier(this))
     , m_warnCount(0)
     , m_errorCount(0)
     , m_buildInterrupted(false)
@@ -111,6 +113,7 @@ NewBuildTab::NewBuildTab(wxWindow* parent)
     // We dont really want to collect undo in the output tabs...
     InitView();
     Bind(wxEVT_IDLE, &NewBuildTab::OnIdle, this);
+    Bind(wxEVT_BUILD_OUTPUT_CLASSIFIED, &NewBuildTab::OnOutputClassified, this);
 
     m_view->Bind(wxEVT_STC_HOTSPOT_CLICK, &NewBuildTab::OnHotspotClicked, this);
     EventNotifier::Get()->Bind(wxEVT_CL_THEME_CHANGED, &NewBuildTab::OnThemeChanged, this);
@@ -155,6 +158,8 @@ NewBuildTab::~NewBuildTab()
                          wxCommandEventHandler(NewBuildTab::OnNextBuildError), NULL, this);
     wxTheApp->Disconnect(XRCID("next_build_error"), wxEVT_UPDATE_UI,
                          wxUpdateUIEventHandler(NewBuildTab::OnNextBuildErrorUI), NULL, this);
+    Unbind(wxEVT_BUILD_OUTPUT_CLASSIFIED, &NewBuildTab::OnOutputClassified, this);
+    wxDELETE(m_classifier);
 }
 
 void NewBuildTab::OnBuildEnded(clCommandEvent& e)
@@ -226,15 +231,15 @@ void NewBuildTab::OnBuildStarted(clCommandEvent& e)
 {
     e.Skip();
 
+    wxString cygwinRoot;
     if(IS_WINDOWS) {
-        m_cygwinRoot.Clear();
         EnvSetter es;
         wxString cmd;
         cmd << "cygpath -w /";
         wxArrayString arrOut;
         ProcUtils::SafeExecuteCommand(cmd, arrOut);
 
-        if(arrOut.IsEmpty() == false) { m_cygwinRoot = arrOut.Item(0); }
+        if(arrOut.IsEmpty() == false) { cygwinRoot = arrOut.Item(0); }
     }
 
     m_buildInProgress = true;
@@ -247,10 +252,7 @@ void NewBuildTab::OnBuildStarted(clCommandEvent& e)
     m_showMe = (BuildTabSettingsData::ShowBuildPane)m_buildTabSettings.GetShowBuildPane();
     m_skipWarnings = m_buildTabSettings.GetSkipWarnings();
 
-    if(e.GetEventType() != wxEVT_SHELL_COMMAND_STARTED_NOCLEAN) {
-        DoClear();
-        DoCacheRegexes();
-    }
+    if(e.GetEventType() != wxEVT_SHELL_COMMAND_STARTED_NOCLEAN) { DoClear(); }
 
     // Show the tab if needed
     OutputPane* opane = clMainFrame::Get()->GetOutputPane();
@@ -282,6 +284,8 @@ void NewBuildTab::OnBuildStarted(clCommandEvent& e)
         buildEvent.SetConfigurationName(bed->GetConfiguration());
         EventNotifier::Get()->AddPendingEvent(buildEvent);
     }
+    // The output of this build is matched against the patterns of its compiler
+    m_classifier->SetCompiler(m_cmp, cygwinRoot);
 }
 
 void NewBuildTab::OnBuildAddLine(clCommandEvent& e)
@@ -291,89 +295,18 @@ void NewBuildTab::OnBuildAddLine(clCommandEvent& e)
     DoProcessOutput(false, false);
 }
 
-BuildLineInfo* NewBuildTab::DoProcessLine(const wxString& line)
-{
-    BuildLineInfo* buildLineInfo = new BuildLineInfo();
-    LINE_SEVERITY severity;
-    // Get the matching regex for this line
-    CmpPatternPtr cmpPatterPtr = GetMatchingRegex(line, severity);
-    buildLineInfo->SetSeverity(severity);
-    BuildLineInfo bli;
-    if(cmpPatterPtr && cmpPatterPtr->Matches(line, bli)) {
-        buildLineInfo->SetFilename(bli.GetFilename());
-        buildLineInfo->SetSeverity(bli.GetSeverity());
-        buildLineInfo->SetLineNumber(bli.GetLineNumber());
-        buildLineInfo->NormalizeFilename(m_directories, m_cygwinRoot);
-        buildLineInfo->SetRegexLineMatch(bli.GetRegexLineMatch());
-        buildLineInfo->SetColumn(bli.GetColumn());
-        if(severity == SV_WARNING) {
-            // Warning
-            m_errorsAndWarningsList.push_back(buildLineInfo);
-            m_warnCount++;
-        } else {
-            // Error
-            m_errorsAndWarningsList.push_back(buildLineInfo);
-            m_errorsList.push_back(buildLineInfo);
-            m_errorCount++;
-        }
-    }
-    return buildLineInfo;
-}
-
-void NewBuildTab::DoCacheRegexes()
-{
-    m_cmpPatterns.clear();
-
-    // Loop over all known compilers and cache the regular expressions
-    BuildSettingsConfigCookie cookie;
-    CompilerPtr cmp = BuildSettingsConfigST::Get()->GetFirstCompiler(cookie);
-    while(cmp) {
-        CmpPatterns cmpPatterns;
-        const Compiler::CmpListInfoPattern& errPatterns = cmp->GetErrPatterns();
-        const Compiler::CmpListInfoPattern& warnPatterns = cmp->GetWarnPatterns();
-        Compiler::CmpListInfoPattern::const_iterator iter;
-        for(iter = errPatterns.begin(); iter != errPatterns.end(); iter++) {
-
-            CmpPatternPtr compiledPatternPtr(new CmpPattern(new wxRegEx(iter->pattern, wxRE_ADVANCED | wxRE_ICASE),
-                                                            iter->fileNameIndex, iter->lineNumberIndex,
-                                                            iter->columnIndex, SV_ERROR));
-            if(compiledPatternPtr->GetRegex()->IsValid()) { cmpPatterns.errorsPatterns.push_back(compiledPatternPtr); }
-        }
-
-        for(iter = warnPatterns.begin(); iter != warnPatterns.end(); iter++) {
-
-            CmpPatternPtr compiledPatternPtr(new CmpPattern(new wxRegEx(iter->pattern, wxRE_ADVANCED | wxRE_ICASE),
-                                                            iter->fileNameIndex, iter->lineNumberIndex,
-                                                            iter->columnIndex, SV_WARNING));
-            if(compiledPatternPtr->GetRegex()->IsValid()) { cmpPatterns.warningPatterns.push_back(compiledPatternPtr); }
-        }
-
-        m_cmpPatterns.insert(std::make_pair(cmp->GetName(), cmpPatterns));
-        cmp = BuildSettingsConfigST::Get()->GetNextCompiler(cookie);
-    }
-}
-
-bool NewBuildTab::DoGetCompilerPatterns(const wxString& compilerName, CmpPatterns& patterns)
-{
-    MapCmpPatterns_t::iterator iter = m_cmpPatterns.find(compilerName);
-    if(iter == m_cmpPatterns.end()) { return false; }
-    patterns = iter->second;
-    return true;
-}
-
 void NewBuildTab::DoClear()
 {
     wxFont font = DoGetFont();
     m_lastLineColoured = wxNOT_FOUND;
     m_maxlineWidth = wxNOT_FOUND;
     m_buildInterrupted = false;
-    m_directories.Clear();
+    m_classifier->Clear();
     m_buildInfoPerFile.clear();
     m_warnCount = 0;
     m_errorCount = 0;
     m_errorsAndWarningsList.clear();
     m_errorsList.clear();
-    m_cmpPatterns.clear();
 
     // Delete all the user data
     std::for_each(m_viewData.begin(), m_viewData.end(), [&](std::pair<int, BuildLineInfo*> p) { delete p.second; });
@@ -479,25 +412,6 @@ void NewBuildTab::MarkEditor(clEditor* editor)
     editor->Refresh();
 }
 
-void NewBuildTab::DoSearchForDirectory(const wxString& line)
-{
-    // Check for makefile directory changes lines
-    if(line.Contains(wxT("Entering directory `"))) {
-        wxString currentDir = line.AfterFirst(wxT('`'));
-        currentDir = currentDir.BeforeLast(wxT('\''));
-
-        // Collect the m_baseDir
-        m_directories.Add(currentDir);
-
-    } else if(line.Contains(wxT("Entering directory '"))) {
-        wxString currentDir = line.AfterFirst(wxT('\''));
-        currentDir = currentDir.BeforeLast(wxT('\''));
-
-        // Collect the m_baseDir
-        m_directories.Add(currentDir);
-    }
-}
-
 void NewBuildTab::OnWorkspaceClosed(wxCommandEvent& e)
 {
     e.Skip();
@@ -514,7 +428,6 @@ void NewBuildTab::OnWorkspaceLoaded(wxCommandEvent& e)
 
 void NewBuildTab::DoProcessOutput(bool compilationEnded, bool isSummaryLine)
 {
-    wxUnusedVar(isSummaryLine);
     if(!compilationEnded && m_output.Find(wxT("\n")) == wxNOT_FOUND) {
         // still dont have a complete line
         return;
@@ -524,58 +437,100 @@ void NewBuildTab::DoProcessOutput(bool compilationEnded, bool isSummaryLine)
     m_output.Clear();
 
     // Process only completed lines (i.e. a line that ends with '\n')
+    wxArrayString completedLines;
     for(size_t i = 0; i < lines.GetCount(); ++i) {
         if(!compilationEnded && !lines.Item(i).EndsWith(wxT("\n"))) {
             m_output << lines.Item(i);
-            return;
-        }
-
-        wxString buildLine = lines.Item(i); //.Trim().Trim(false);
-        // If this is a line similar to 'Entering directory `'
-        // add the path in the directories array
-        DoSearchForDirectory(buildLine);
-        BuildLineInfo* buildLineInfo = DoProcessLine(buildLine);
-
-        // keep the line info
-        if(buildLineInfo->GetFilename().IsEmpty() == false) {
-            m_buildInfoPerFile.insert(std::make_pair(buildLineInfo->GetFilename(), buildLineInfo));
+            break;
         }
+        completedLines.Add(lines.Item(i));
+    }
 
-        if(isSummaryLine) {
+    if(isSummaryLine) {
+        // Our own lines, no need to classify them
+        for(size_t i = 0; i < completedLines.GetCount(); ++i) {
+            wxString buildLine = completedLines.Item(i);
             buildLine.Trim();
             buildLine.Prepend("====");
             buildLine.Append("====");
-            buildLineInfo->SetSeverity(SV_NONE);
+            DoAppendLine(buildLine, new BuildLineInfo());
+        }
+        DoScrollToEnd();
+        return;
+    }
+
+    // The lines are classified by a worker thread, see OnOutputClassified()
+    if(!completedLines.IsEmpty()) { m_classifier->Add(completedLines); }
+    if(compilationEnded) {
+        // The caller needs the errors and warnings now
+        m_classifier->Flush();
+        DoAppendClassifiedLines();
+    }
+}
+
+void NewBuildTab::OnOutputClassified(clCommandEvent& event) { DoAppendClassifiedLines(); }
+
+void NewBuildTab::DoAppendClassifiedLines()
+{
+    std::vector<BuildOutputClassifier::Line> lines;
+    m_classifier->TakeLines(lines);
+    if(lines.empty()) { return; }
+
+    for(size_t i = 0; i < lines.size(); ++i) {
+        BuildLineInfo* buildLineInfo = lines[i].info;
+        if(buildLineInfo->GetSeverity() == SV_WARNING) {
+            // Warning
+            m_errorsAndWarningsList.push_back(buildLineInfo);
+            m_warnCount++;
+        } else if(buildLineInfo->GetSeverity() == SV_ERROR) {
+            // Error
+            m_errorsAndWarningsList.push_back(buildLineInfo);
+            m_errorsList.push_back(buildLineInfo);
+            m_errorCount++;
         }
+        DoAppendLine(lines[i].text, buildLineInfo);
+    }
+    DoScrollToEnd();
+}
 
-        // Keep the line number in the build tab
-        buildLineInfo->SetLineInBuildTab(m_view->GetLineCount() - 1); // -1 because the view always has 1 extra "\n"
-        // Store the line info *before* we add the text
-        // it is needed in the OnStyle function
-        m_viewData.insert(std::make_pair(buildLineInfo->GetLineInBuildTab(), buildLineInfo));
+void NewBuildTab::DoAppendLine(const wxString& text, BuildLineInfo* buildLineInfo)
+{
+    // keep the line info
+    if(buildLineInfo->GetFilename().IsEmpty() == false) {
+        m_buildInfoPerFile.insert(std::make_pair(buildLineInfo->GetFilename(), buildLineInfo));
+    }
 
-        m_view->SetEditable(true);
-        buildLine.Trim();
-        wxString modText;
-        ::clStripTerminalColouring(buildLine, modText);
+    // Keep the line number in the build tab
+    buildLineInfo->SetLineInBuildTab(m_view->GetLineCount() - 1); // -1 because the view always has 1 extra "\n"
+    // Store the line info *before* we add the text
+    // it is needed in the OnStyle function
+    m_viewData.insert(std::make_pair(buildLineInfo->GetLineInBuildTab(), buildLineInfo));
 
-        int curline = m_view->GetLineCount() - 1;
-        m_view->AppendText(modText + "\n");
+    m_view->SetEditable(true);
+    wxString buildLine = text;
+    buildLine.Trim();
+    wxString modText;
+    ::clStripTerminalColouring(buildLine, modText);
 
-        // get the newly added line width
-        int endPosition = m_view->GetLineEndPosition(curline); // get character position from begin
-        int beginPosition = m_view->PositionFromLine(curline); // and end of line
+    int curline = m_view->GetLineCount() - 1;
+    m_view->AppendText(modText + "\n");
 
-        wxPoint beginPos = m_view->PointFromPosition(beginPosition);
-        wxPoint endPos = m_view->PointFromPosition(endPosition);
+    // get the newly added line width
+    int endPosition = m_view->GetLineEndPosition(curline); // get character position from begin
+    int beginPosition = m_view->PositionFromLine(curline); // and end of line
 
-        int curLen = (endPos.x - beginPos.x) + 10;
-        m_maxlineWidth = wxMax(m_maxlineWidth, curLen);
-        if(m_maxlineWidth > 0) { m_view->SetScrollWidth(m_maxlineWidth); }
-        m_view->SetEditable(false);
+    wxPoint beginPos = m_view->PointFromPosition(beginPosition);
+    wxPoint endPos = m_view->PointFromPosition(endPosition);
 
-        if(clConfig::Get().Read(kConfigBuildAutoScroll, true)) { m_view->ScrollToEnd(); }
-    }
+    int curLen = (endPos.x - beginPos.x) + 10;
+    m_maxlineWidth = wxMax(m_maxlineWidth, curLen);
+    if(m_maxlineWidth > 0) { m_view->SetScrollWidth(m_maxlineWidth); }
+    m_view->SetEditable(false);
+}
+
+void NewBuildTab::DoScrollToEnd()
+{
+    if(clConfig::Get().Read(kConfigBuildAutoScroll, true)) { m_view->ScrollToEnd(); }
 }
 
 void NewBuildTab::CenterLineInView(int line)
@@ -959,10 +914,9 @@ void NewBuildTab::ColourOutput()
         m_view->StartStyling(startPos, 0x1f);
 #endif
 
-        // Run the regexes
-        wxString lineText = m_view->GetLine(i);
-        LINE_SEVERITY severity;
-        GetMatchingRegex(lineText, severity);
+        // Use the severity found when the line was added
+        std::map<int, BuildLineInfo*>::const_iterator iter = m_viewData.find(i);
+        LINE_SEVERITY severity = (iter == m_viewData.end()) ? SV_NONE : iter->second->GetSeverity();
         switch(severity) {
         case SV_WARNING:
             m_view->SetStyling((lineEndPos - startPos), LEX_GCC_WARNING);
@@ -985,58 +939,6 @@ void NewBuildTab::ColourOutput()
     m_lastLineColoured = untilLine;
 }
 
-CmpPatternPtr NewBuildTab::GetMatchingRegex(const wxString& lineText, LINE_SEVERITY& severity)
-{
-    if(lineText.Lower().Contains("entering directory") || lineText.Lower().Contains("leaving directory")) {
-        severity = SV_DIR_CHANGE;
-        return NULL;
-
-    } else if(lineText.StartsWith("====")) {
-        severity = SV_NONE;
-        return NULL;
-
-    } else {
-
-        // Find *warnings* first
-        bool isWarning = false;
-
-        if(!m_cmp) {
-            severity = SV_NONE;
-            return NULL;
-        }
-
-        CmpPatterns cmpPatterns;
-        if(!DoGetCompilerPatterns(m_cmp->GetName(), cmpPatterns)) {
-            severity = SV_NONE;
-            return NULL;
-        }
-
-        // If it is not an error, maybe it's a warning
-        for(size_t i = 0; i < cmpPatterns.warningPatterns.size(); i++) {
-            CmpPatternPtr cmpPatterPtr = cmpPatterns.warningPatterns.at(i);
-            BuildLineInfo bli;
-            if(cmpPatterPtr->Matches(lineText, bli)) {
-                severity = SV_WARNING;
-                return cmpPatterPtr;
-            }
-        }
-        if(!isWarning) {
-            for(size_t i = 0; i < cmpPatterns.errorsPatterns.size(); i++) {
-                BuildLineInfo bli;
-                CmpPatternPtr cmpPatterPtr = cmpPatterns.errorsPatterns.at(i);
-                if(cmpPatterPtr->Matches(lineText, bli)) {
-                    severity = SV_ERROR;
-                    return cmpPatterPtr;
-                }
-            }
-        }
-    }
-
-    // Default
-    severity = SV_NONE;
-    return NULL;
-}
-
 void NewBuildTab::OnIdle(wxIdleEvent& event)
 {
     if(m_view->IsEmpty()) { return; }
@@ -135,27 +135,20 @@ public:
 };
 typedef SmartPtr<CmpPattern> CmpPatternPtr;
 
-//////////////////////////////////////////////////////////////////
-
-struct CmpPatterns {
-    std::vector<CmpPatternPtr> errorsPatterns;
-    std::vector<CmpPatternPtr> warningPatterns;
-};
-
 ///////////////////////////////////////////////////////////////////
 class clEditor;
+class BuildOutputClassifier;
 class NewBuildTab : public wxPanel
 {
     enum BuildpaneScrollTo { ScrollToFirstError, ScrollToFirstItem, ScrollToEnd };
 
-    typedef std::map<wxString, CmpPatterns> MapCmpPatterns_t;
     typedef std::multimap<wxString, BuildLineInfo*> MultimapBuildInfo_t;
     typedef std::list<BuildLineInfo*> BuildInfoList_t;
 
     wxString m_output;
     wxStyledTextCtrl* m_view;
     CompilerPtr m_cmp;
-    MapCmpPatterns_t m_cmpPatterns;
+    BuildOutputClassifier* m_classifier;
     int m_warnCount;
     int m_errorCount;
     BuildTabSettingsData m_buildTabSettings;
@@ -164,14 +157,12 @@ class NewBuildTab : public wxPanel
     BuildTabSettingsData::ShowBuildPane m_showMe;
     wxStopWatch m_sw;
     MultimapBuildInfo_t m_buildInfoPerFile;
-    wxArrayString m_directories;
     bool m_skipWarnings;
     BuildpaneScrollTo m_buildpaneScrollTo;
     BuildInfoList_t m_errorsAndWarningsList;
     BuildInfoList_t m_errorsList;
     BuildInfoList_t::iterator m_curError;
     bool m_buildInProgress;
-    wxString m_cygwinRoot;
     std::map<int, BuildLineInfo*> m_viewData;
     int m_maxlineWidth;
     int m_lastLineColoured;
@@ -179,11 +170,10 @@ class NewBuildTab : public wxPanel
 protected:
     void InitView(const wxString& theme = "");
     void CenterLineInView(int line);
-    void DoCacheRegexes();
-    BuildLineInfo* DoProcessLine(const wxString& line);
     void DoProcessOutput(bool compilationEnded, bool isSummaryLine);
-    void DoSearchForDirectory(const wxString& line);
-    bool DoGetCompilerPatterns(const wxString& compilerName, CmpPatterns& patterns);
+    void DoAppendClassifiedLines();
+    void DoAppendLine(const wxString& text, BuildLineInfo* buildLineInfo);
+    void DoScrollToEnd();
     void DoClear();
     void MarkEditor(clEditor* editor);
     void DoToggleWindow();
@@ -191,7 +181,6 @@ protected:
     wxFont DoGetFont() const;
     void DoCentreErrorLine(BuildLineInfo* bli, clEditor* editor, bool centerLine);
     void ColourOutput();
-    CmpPatternPtr GetMatchingRegex(const wxString& lineText, LINE_SEVERITY& severity);
 
 public:
     NewBuildTab(wxWindow* parent);
@@ -227,6 +216,7 @@ protected:
     void OnStyleNeeded(wxStyledTextEvent& event);
     void OnHotspotClicked(wxStyledTextEvent& event);
     void OnIdle(wxIdleEvent& event);
+    void OnOutputClassified(clCommandEvent& event);
 };
 
 #endif // NEWBUILDTAB_H
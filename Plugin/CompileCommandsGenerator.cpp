@@ -83,9 +83,10 @@ void CompileCommandsGenerator::OnProcessTeraminated(clProcessEvent& event)
                 }
             }
 
+            CompileCommandsJSON* compileCommands = nullptr;
             if(generateCompileCommands) {
-                CompileCommandsJSON compileCommands(compile_commands);
-                const wxArrayString& paths = compileCommands.GetIncludes();
+                compileCommands = new CompileCommandsJSON(compile_commands);
+                const wxArrayString& paths = compileCommands->GetIncludes();
                 for(const wxString& path : paths) {
                     if(includeSet.count(path) == 0) {
                         includeSet.insert(path);
@@ -100,6 +101,8 @@ void CompileCommandsGenerator::OnProcessTeraminated(clProcessEvent& event)
             eventCompileCommandsGenerated.SetFileName(compile_commands); // compile_commands.json
             eventCompileCommandsGenerated.SetStrings(
                 includePaths); // include paths found and gathered from all the compile_flags.txt files scanned
+            // The per file flags, the event takes ownership
+            if(compileCommands) { eventCompileCommandsGenerated.SetClientObject(compileCommands); }
             EventNotifier::Get()->AddPendingEvent(eventCompileCommandsGenerated);
         },
         m_outputFile.GetFullPath());
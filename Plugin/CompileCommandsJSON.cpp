@@ -1,25 +1,265 @@
 #include "CompileCommandsJSON.h"
 #include "JSON.h"
 #include "compiler_command_line_parser.h"
-    
-CompileCommandsJSON::CompileCommandsJSON(const wxString& filename)
-    : m_filename(filename)
+#include "file_logger.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <wx/ffile.h>
+
+// Size of the chunks read from the file
+#define READ_CHUNK_SIZE (1024 * 1024)
+
+// Max number of threads used to parse the command lines
+#define MAX_PARSER_THREADS 8
+
+namespace
+{
+// A command line, as found in the file
+struct Command {
+    wxString command;
+    wxString directory;
+};
+
+std::string ReadString(cJSON* entry, const char* name)
 {
-    if(m_filename.FileExists()) {
-        JSON json(m_filename);
-        JSONItem arr = json.toElement();
-        const int count = arr.arraySize();
-        for(int i = 0; i < count; ++i) {
-            wxString command = arr.arrayItem(i).namedObject("command").toString();
-            wxString workingDirectory = arr.arrayItem(i).namedObject("directory").toString();
-            
-            // Use the workingDirectory to convert all paths to full path
-            CompilerCommandLineParser cclp(command, workingDirectory);
-            m_includes = cclp.GetIncludes();
-            m_macros = cclp.GetMacros();
-            m_others = cclp.GetOtherOptions();
+    cJSON* item = cJSON_GetObjectItem(entry, name);
+    return (item && item->type == cJSON_String && item->valuestring) ? item->valuestring : "";
+}
+
+// Split a command line into arguments, honouring quotes and escapes
+void SplitCommand(const std::string& command, std::vector<std::string>& args)
+{
+    std::string current;
+    bool hasArg = false;
+    char quote = 0;
+    for(size_t i = 0; i < command.length(); ++i) {
+        char ch = command[i];
+        if(ch == '\\' && (i + 1) < command.length() && quote != '\'') {
+            current += ch;
+            current += command[++i];
+            hasArg = true;
+        } else if(quote) {
+            if(ch == quote) { quote = 0; }
+            current += ch;
+        } else if(ch == '"' || ch == '\'') {
+            quote = ch;
+            current += ch;
+            hasArg = true;
+        } else if(ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n') {
+            if(hasArg) { args.push_back(current); }
+            current.clear();
+            hasArg = false;
+        } else {
+            current += ch;
+            hasArg = true;
         }
     }
+    if(hasArg) { args.push_back(current); }
+}
+
+std::string BaseName(const std::string& path)
+{
+    size_t where = path.find_last_of("/\\");
+    return where == std::string::npos ? path : path.substr(where + 1);
+}
+
+// Remove the parts of the command line that are specific to its source file (the file itself, the output
+// and dependency files) so the entries compiled with the same flags share the same command line
+std::string NormaliseCommand(const std::vector<std::string>& args, const std::string& file)
+{
+    std::string baseName = BaseName(file);
+    std::string command;
+    for(size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        if(arg == "-o" || arg == "-MF" || arg == "-MT" || arg == "-MQ") {
+            ++i; // skip the value as well
+            continue;
+        }
+        if(arg == "-c" || arg.compare(0, 3, "/Fo") == 0 || arg.compare(0, 3, "-Fo") == 0) { continue; }
+        if(arg[0] != '-' && arg[0] != '/' && BaseName(arg) == baseName) { continue; }
+        if(arg[0] == '/' && arg == file) { continue; }
+        if(!command.empty()) { command += " "; }
+        command += arg;
+    }
+    return command;
+}
+
+void AppendUnique(const wxArrayString& items, wxArrayString& output, wxStringSet_t& seen)
+{
+    for(size_t i = 0; i < items.size(); ++i) {
+        if(seen.insert(items.Item(i)).second) { output.Add(items.Item(i)); }
+    }
+}
+} // namespace
+
+CompileCommandsJSON::CompileCommandsJSON(const wxString& filename)
+    : m_filename(filename)
+{
+    if(m_filename.FileExists()) { Load(); }
 }
 
 CompileCommandsJSON::~CompileCommandsJSON() {}
+
+wxString CompileCommandsJSON::GetFileKey(const wxFileName& filename)
+{
+    wxString key = filename.GetFullPath();
+#ifdef __WXMSW__
+    key.MakeLower();
+#endif
+    return key;
+}
+
+const CompileCommandsJSON::Flags* CompileCommandsJSON::GetFlags(const wxFileName& filename) const
+{
+    std::unordered_map<wxString, size_t>::const_iterator iter = m_fileIndex.find(GetFileKey(filename));
+    if(iter == m_fileIndex.end()) { return nullptr; }
+    return &m_flags[iter->second];
+}
+
+void CompileCommandsJSON::Load()
+{
+    wxFFile fp(m_filename.GetFullPath(), "rb");
+    if(!fp.IsOpened()) { return; }
+
+    // The file is an array of objects. Scan the raw bytes and parse each object once it is complete,
+    // so we never hold more than one entry (and one chunk) in memory
+    std::vector<Command> commands;
+    std::unordered_map<std::string, size_t> commandsIndex;
+    std::vector<char> buffer(READ_CHUNK_SIZE);
+    std::string entry;
+    std::vector<std::string> args;
+    int depth = 0;
+    bool inString = false;
+    bool escape = false;
+    size_t entries = 0;
+
+    while(!fp.Eof()) {
+        size_t len = fp.Read(buffer.data(), buffer.size());
+        if(len == 0) { break; }
+
+        const char* chunk = buffer.data();
+        size_t entryStart = (depth >= 2) ? 0 : std::string::npos;
+        for(size_t i = 0; i < len; ++i) {
+            char ch = chunk[i];
+            if(inString) {
+                if(escape) {
+                    escape = false;
+                } else if(ch == '\\') {
+                    escape = true;
+                } else if(ch == '"') {
+                    inString = false;
+                }
+                continue;
+            }
+
+            switch(ch) {
+            case '"':
+                inString = true;
+                break;
+            case '{':
+            case '[':
+                ++depth;
+                if(depth == 2) { entryStart = i; }
+                break;
+            case '}':
+            case ']':
+                --depth;
+                if(depth == 1 && entryStart != std::string::npos) {
+                    entry.append(chunk + entryStart, i + 1 - entryStart);
+                    entryStart = std::string::npos;
+
+                    // A complete entry
+                    cJSON* json = cJSON_Parse(entry.c_str());
+                    entry.clear();
+                    if(!json || json->type != cJSON_Object) {
+                        cJSON_Delete(json);
+                        break;
+                    }
+                    ++entries;
+
+                    std::string directory = ReadString(json, "directory");
+                    std::string file = ReadString(json, "file");
+                    std::string command = ReadString(json, "command");
+                    args.clear();
+                    cJSON* arguments = cJSON_GetObjectItem(json, "arguments");
+                    if(arguments && arguments->type == cJSON_Array) {
+                        // Already split
+                        for(cJSON* arg = arguments->child; arg; arg = arg->next) {
+                            if(arg->type != cJSON_String) { continue; }
+                            std::string value = arg->valuestring;
+                            if(value.find_first_of(" \t") != std::string::npos) { value = "\"" + value + "\""; }
+                            args.push_back(value);
+                        }
+                    } else {
+                        SplitCommand(command, args);
+                    }
+                    cJSON_Delete(json);
+
+                    // Identical command lines (in the same folder) share their flags
+                    std::string key = NormaliseCommand(args, file);
+                    key += '\n';
+                    key += directory;
+                    std::unordered_map<std::string, size_t>::iterator iter = commandsIndex.find(key);
+                    size_t index = commands.size();
+                    if(iter == commandsIndex.end()) {
+                        Command c;
+                        c.command = wxString::FromUTF8(key.c_str(), key.length() - directory.length() - 1);
+                        c.directory = wxString::FromUTF8(directory.c_str());
+                        commands.push_back(c);
+                        commandsIndex.insert({ key, index });
+                    } else {
+                        index = iter->second;
+                    }
+
+                    if(!file.empty()) {
+                        wxFileName fn(wxString::FromUTF8(file.c_str()));
+                        if(fn.IsRelative()) { fn.MakeAbsolute(wxString::FromUTF8(directory.c_str())); }
+                        m_fileIndex[GetFileKey(fn)] = index;
+                    }
+                }
+                break;
+            default:
+                break;
+            }
+        }
+        // Keep the incomplete entry for the next chunk
+        if(entryStart != std::string::npos) { entry.append(chunk + entryStart, len - entryStart); }
+    }
+
+    // Parse the unique command lines in parallel
+    m_flags.resize(commands.size());
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        while(true) {
+            size_t i = next.fetch_add(1);
+            if(i >= commands.size()) { break; }
+            // Use the working directory to convert all paths to full path
+            CompilerCommandLineParser cclp(commands[i].command, commands[i].directory);
+            m_flags[i].includes = cclp.GetIncludes();
+            m_flags[i].macros = cclp.GetMacros();
+            m_flags[i].others = cclp.GetOtherOptions();
+        }
+    };
+
+    size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), MAX_PARSER_THREADS);
+    threads = std::min(threads, commands.size());
+    std::vector<std::thread> workers;
+    for(size_t i = 1; i < threads; ++i) {
+        workers.push_back(std::thread(worker));
+    }
+    worker();
+    for(size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+
+    // Accumulate the flags of all the entries
+    wxStringSet_t includes, macros, others;
+    for(size_t i = 0; i < m_flags.size(); ++i) {
+        AppendUnique(m_flags[i].includes, m_includes, includes);
+        AppendUnique(m_flags[i].macros, m_macros, macros);
+        AppendUnique(m_flags[i].others, m_others, others);
+    }
+    clDEBUG() << "Loaded" << entries << "entries from" << m_filename << "(" << commands.size()
+              << "unique command lines)" << clEndl;
+}
@@ -2,20 +2,50 @@
 #define COMPILECOMMANDSJSON_H
 
 #include "codelite_exports.h"
-#include <wx/filename.h>
+#include "wxStringHash.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include <wx/arrstr.h>
+#include <wx/clntdata.h>
+#include <wx/filename.h>
 
-class WXDLLIMPEXP_SDK CompileCommandsJSON
+/**
+ * @class CompileCommandsJSON
+ * @brief load a compile_commands.json file.
+ *
+ * The file is streamed: only one entry is held in memory at a time. Entries with the same command line
+ * (once the source and output files are removed from it) share their flags, and the unique command lines
+ * are parsed in parallel. GetIncludes()/GetMacros()/GetOthers() return the union of all the entries,
+ * GetFlags() returns the flags of a given source file.
+ * Once loaded, the object is read only: wxEVT_COMPILE_COMMANDS_JSON_GENERATED carries it (as its client object)
+ * to the code completion manager
+ */
+class WXDLLIMPEXP_SDK CompileCommandsJSON : public wxClientData
 {
+public:
+    struct Flags {
+        wxArrayString includes;
+        wxArrayString macros;
+        wxArrayString others;
+    };
+
+protected:
     wxFileName m_filename;
     wxArrayString m_macros;
     wxArrayString m_includes;
     wxArrayString m_others;
+    std::vector<Flags> m_flags;                       // one per unique command line
+    std::unordered_map<wxString, size_t> m_fileIndex; // source file -> index in m_flags
+
+protected:
+    void Load();
+    static wxString GetFileKey(const wxFileName& filename);
 
 public:
     CompileCommandsJSON(const wxString& filename);
     virtual ~CompileCommandsJSON();
-    
+
     void SetFilename(const wxFileName& filename) { this->m_filename = filename; }
     void SetIncludes(const wxArrayString& includes) { this->m_includes = includes; }
     void SetMacros(const wxArrayString& macros) { this->m_macros = macros; }
@@ -24,6 +54,16 @@ public:
     const wxArrayString& GetIncludes() const { return m_includes; }
     const wxArrayString& GetMacros() const { return m_macros; }
     const wxArrayString& GetOthers() const { return m_others; }
+
+    /**
+     * @brief return the flags used to compile a source file, null if the file is not in the database
+     */
+    const Flags* GetFlags(const wxFileName& filename) const;
+
+    /**
+     * @brief number of source files in the database
+     */
+    size_t GetFilesCount() const { return m_fileIndex.size(); }
 };
 
 #endif // COMPILECOMMANDSJSON_H
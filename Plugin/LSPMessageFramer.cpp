@@ -0,0 +1,117 @@
+#include "LSPMessageFramer.h"
+#include "JSON.h"
+#include "file_logger.h"
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+#define HEADER_CONTENT_LENGTH "content-length"
+#define HEADERS_SEPARATOR "\r\n\r\n"
+
+// Don't keep a huge buffer around once a big message (e.g. a large completion list) was consumed
+#define FRAMER_INITIAL_CAPACITY (64 * 1024)
+#define FRAMER_MAX_IDLE_CAPACITY (1024 * 1024)
+
+LSPMessageFramer::LSPMessageFramer() {}
+
+LSPMessageFramer::~LSPMessageFramer() {}
+
+void LSPMessageFramer::Clear()
+{
+    m_readPos = 0;
+    m_writePos = 0;
+    m_contentLength = std::string::npos;
+    if(m_buffer.size() > FRAMER_MAX_IDLE_CAPACITY) { std::vector<char>().swap(m_buffer); }
+}
+
+void LSPMessageFramer::Reserve(size_t len)
+{
+    // Always keep one spare byte after the data: Next() uses it to NULL terminate the body
+    size_t pending = GetPendingBytes();
+    size_t required = pending + len + 1;
+    if(m_writePos + len + 1 <= m_buffer.size()) { return; }
+
+    if(required <= m_buffer.size()) {
+        // Enough room, once the consumed bytes are discarded
+        memmove(m_buffer.data(), m_buffer.data() + m_readPos, pending);
+    } else {
+        // Grow. Move the pending bytes to the start of the new buffer
+        std::vector<char> buffer(std::max(required, std::max(m_buffer.size() * 2, (size_t)FRAMER_INITIAL_CAPACITY)));
+        if(pending) { memcpy(buffer.data(), m_buffer.data() + m_readPos, pending); }
+        m_buffer.swap(buffer);
+    }
+    m_readPos = 0;
+    m_writePos = pending;
+}
+
+void LSPMessageFramer::Append(const char* data, size_t len)
+{
+    if(len == 0) { return; }
+    Reserve(len);
+    memcpy(m_buffer.data() + m_writePos, data, len);
+    m_writePos += len;
+}
+
+bool LSPMessageFramer::ReadHeaders()
+{
+    while(true) {
+        const char* start = m_buffer.data() + m_readPos;
+        const char* end = m_buffer.data() + m_writePos;
+        const char* sep = std::search(start, end, HEADERS_SEPARATOR, HEADERS_SEPARATOR + 4);
+        if(sep == end) { return false; }
+
+        // Parse the header lines, we only care about the "Content-Length"
+        size_t contentLength = std::string::npos;
+        const char* line = start;
+        while(line < sep) {
+            const char* lineEnd = std::find(line, sep, '\n');
+            const char* colon = std::find(line, lineEnd, ':');
+            if(colon != lineEnd) {
+                std::string name(line, colon);
+                name.erase(0, name.find_first_not_of(" \t\r\n"));
+                std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+                if(name == HEADER_CONTENT_LENGTH) {
+                    std::string value(colon + 1, lineEnd);
+                    contentLength = strtoul(value.c_str(), nullptr, 10);
+                }
+            }
+            line = (lineEnd == sep) ? sep : lineEnd + 1;
+        }
+
+        // Skip the headers and the separator
+        m_readPos = (sep - m_buffer.data()) + 4;
+        if(contentLength != std::string::npos) {
+            m_contentLength = contentLength;
+            return true;
+        }
+        clWARNING() << "LSP: message without a Content-Length header. Skipping it" << clEndl;
+    }
+}
+
+bool LSPMessageFramer::Next(LSP::ResponseMessage::Ptr_t& message)
+{
+    message.reset(nullptr);
+    if(m_contentLength == std::string::npos && !ReadHeaders()) { return false; }
+    if(GetPendingBytes() < m_contentLength) {
+        // Wait for the rest of the body
+        return false;
+    }
+
+    // Parse the body in place: NULL terminate it (Reserve() keeps a spare byte after the data)
+    char* body = m_buffer.data() + m_readPos;
+    char saved = body[m_contentLength];
+    body[m_contentLength] = 0;
+    cJSON* json = cJSON_Parse(body);
+    body[m_contentLength] = saved;
+
+    m_readPos += m_contentLength;
+    m_contentLength = std::string::npos;
+    if(m_readPos == m_writePos) { Clear(); }
+
+    if(json) {
+        message.reset(new LSP::ResponseMessage(wxSharedPtr<JSON>(new JSON(json))));
+    } else {
+        clWARNING() << "LSP: failed to parse message body" << clEndl;
+    }
+    return true;
+}
@@ -0,0 +1,54 @@
+#ifndef LSPMESSAGEFRAMER_H
+#define LSPMESSAGEFRAMER_H
+
+#include "LSP/ResponseMessage.h"
+#include "codelite_exports.h"
+#include <string>
+#include <vector>
+
+/**
+ * @class LSPMessageFramer
+ * @brief split the raw byte stream coming from a language server into JSON-RPC messages.
+ *
+ * The bytes are kept in a growable buffer with read / write cursors. A message is framed by its
+ * "Content-Length" header (a byte count, which is exact since we never convert the stream into a wxString)
+ * and its body is parsed directly from the UTF-8 bytes. This class is not thread safe, but it does not
+ * touch the UI so it can be used from a worker thread
+ */
+class WXDLLIMPEXP_SDK LSPMessageFramer
+{
+    std::vector<char> m_buffer;
+    size_t m_readPos = 0;                       // first byte that was not consumed yet
+    size_t m_writePos = 0;                      // one past the last byte written
+    size_t m_contentLength = std::string::npos; // the length of the current body, once its headers were read
+
+protected:
+    void Reserve(size_t len);
+    bool ReadHeaders();
+
+public:
+    LSPMessageFramer();
+    virtual ~LSPMessageFramer();
+
+    /**
+     * @brief append bytes read from the server
+     */
+    void Append(const char* data, size_t len);
+    void Append(const std::string& data) { Append(data.c_str(), data.length()); }
+
+    /**
+     * @brief extract the next complete message from the buffer
+     * @param message [output] the parsed message, null if the body is not a valid JSON
+     * @return false if the buffer does not hold a complete message
+     */
+    bool Next(LSP::ResponseMessage::Ptr_t& message);
+
+    /**
+     * @brief number of bytes received but not consumed yet
+     */
+    size_t GetPendingBytes() const { return m_writePos - m_readPos; }
+
+    void Clear();
+};
+
+#endif // LSPMESSAGEFRAMER_H
@@ -8,6 +8,8 @@
 #include <wx/arrstr.h>
 #include <macros.h>
 #include "LSPStartupInfo.h"
+#include "LSP/ResponseMessage.h"
+#include <vector>
 
 wxDECLARE_EXPORTED_EVENT(WXDLLIMPEXP_SDK, wxEVT_LSP_NET_DATA_READY, clCommandEvent);
 wxDECLARE_EXPORTED_EVENT(WXDLLIMPEXP_SDK, wxEVT_LSP_NET_ERROR, clCommandEvent);
@@ -60,6 +62,13 @@ public:
      * @brief are we connected to the LSP server?
      */
     virtual bool IsConnected() const = 0;
+
+    /**
+     * @brief take the messages decoded by the network layer. Networks that decode the messages themselves
+     * fire wxEVT_LSP_NET_DATA_READY with an empty string once messages are available, the others
+     * pass the raw data in the event string
+     */
+    virtual void TakeMessages(std::vector<LSP::ResponseMessage::Ptr_t>& messages) { wxUnusedVar(messages); }
 };
 
 #endif // LSPNETWORK_H
@@ -6,12 +6,77 @@
 #include "ChildProcess.h"
 #include "processreaderthread.h"
 #include "dirsaver.h"
+#include "fileutils.h"
+#include "LSPMessageFramer.h"
 
-LSPNetworkSTDIO::LSPNetworkSTDIO() {}
+LSPNetworkSTDIO::LSPNetworkSTDIO() { m_goingDown.store(false); }
 
 LSPNetworkSTDIO::~LSPNetworkSTDIO() { Close(); }
 
-void LSPNetworkSTDIO::Close() { wxDELETE(m_server); }
+void LSPNetworkSTDIO::Close()
+{
+    // Delete the process first: it stops the process reader thread which feeds our queue
+    wxDELETE(m_server);
+    StopReaderThread();
+}
+
+void LSPNetworkSTDIO::StartReaderThread()
+{
+    m_goingDown.store(false);
+    m_readerThread = new std::thread(
+        [](LSPNetworkSTDIO* network) {
+            LSPMessageFramer framer;
+            while(!network->m_goingDown.load()) {
+                std::string buffer;
+                if(network->m_incomingQueue.ReceiveTimeout(10, buffer) != wxMSGQUEUE_NO_ERROR) { continue; }
+                framer.Append(buffer);
+                // Frame everything that is already queued before waking the main thread
+                while(network->m_incomingQueue.ReceiveTimeout(0, buffer) == wxMSGQUEUE_NO_ERROR) {
+                    framer.Append(buffer);
+                }
+
+                std::vector<LSP::ResponseMessage::Ptr_t> messages;
+                LSP::ResponseMessage::Ptr_t message;
+                while(framer.Next(message)) {
+                    if(message) { messages.push_back(message); }
+                }
+                if(messages.empty()) { continue; }
+
+                bool notify = false;
+                {
+                    std::lock_guard<std::mutex> guard(network->m_messagesLock);
+                    // The main thread was already notified if the list was not empty
+                    notify = network->m_messages.empty();
+                    network->m_messages.insert(network->m_messages.end(), messages.begin(), messages.end());
+                }
+                if(notify) {
+                    clCommandEvent evt(wxEVT_LSP_NET_DATA_READY);
+                    network->AddPendingEvent(evt);
+                }
+            }
+            clDEBUG() << "LSPNetworkSTDIO reader thread: going down";
+        },
+        this);
+}
+
+void LSPNetworkSTDIO::StopReaderThread()
+{
+    if(m_readerThread) {
+        m_goingDown.store(true);
+        m_readerThread->join();
+        wxDELETE(m_readerThread);
+    }
+    m_incomingQueue.Clear();
+    std::lock_guard<std::mutex> guard(m_messagesLock);
+    m_messages.clear();
+}
+
+void LSPNetworkSTDIO::TakeMessages(std::vector<LSP::ResponseMessage::Ptr_t>& messages)
+{
+    std::lock_guard<std::mutex> guard(m_messagesLock);
+    messages.swap(m_messages);
+    m_messages.clear();
+}
 
 void LSPNetworkSTDIO::Open(const LSPStartupInfo& siInfo)
 {
@@ -20,7 +85,10 @@ void LSPNetworkSTDIO::Open(const LSPStartupInfo& siInfo)
     // Start the LSP server first
     Close();
 
+    StartReaderThread();
     m_server = new ChildProcess();
+    // Let the process reader thread hand us the raw bytes, they are never converted into a wxString
+    m_server->SetStdoutCallback([this](const std::string& output) { m_incomingQueue.Post(output); });
     m_server->Bind(wxEVT_ASYNC_PROCESS_OUTPUT, &LSPNetworkSTDIO::OnProcessOutput, this);
     m_server->Bind(wxEVT_ASYNC_PROCESS_STDERR, &LSPNetworkSTDIO::OnProcessStderr, this);
     m_server->Bind(wxEVT_ASYNC_PROCESS_TERMINATED, &LSPNetworkSTDIO::OnProcessTerminated, this);
@@ -55,10 +123,8 @@ void LSPNetworkSTDIO::OnProcessTerminated(clProcessEvent& event)
 
 void LSPNetworkSTDIO::OnProcessOutput(clProcessEvent& event)
 {
-    const wxString& dataRead = event.GetOutput();
-    clCommandEvent evt(wxEVT_LSP_NET_DATA_READY);
-    evt.SetString(dataRead);
-    AddPendingEvent(evt);
+    // Only used when the process can't deliver the raw output (Windows)
+    m_incomingQueue.Post(FileUtils::ToStdString(event.GetOutput()));
 }
 
 void LSPNetworkSTDIO::OnProcessStderr(clProcessEvent& event) { clDEBUG() << event.GetOutput(); }
@@ -4,6 +4,10 @@
 #include "LSPNetwork.h"
 #include "cl_command_event.h"
 #include "SocketAPI/clSocketClientAsync.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <wx/msgqueue.h>
 #include <wx/process.h>
 
 ///===------------------------------
@@ -17,16 +21,26 @@ protected:
     clAsyncSocket::Ptr_t m_socket;
     ChildProcess* m_server = nullptr;
 
+    // The server output is framed and parsed by a worker thread
+    std::thread* m_readerThread = nullptr;
+    wxMessageQueue<std::string> m_incomingQueue;
+    std::atomic_bool m_goingDown;
+    std::mutex m_messagesLock;
+    std::vector<LSP::ResponseMessage::Ptr_t> m_messages;
+
 protected:
     void OnProcessTerminated(clProcessEvent& event);
     void OnProcessOutput(clProcessEvent& event);
     void OnProcessStderr(clProcessEvent& event);
+    void StartReaderThread();
+    void StopReaderThread();
     
 public:
     virtual void Close();
     virtual void Open(const LSPStartupInfo& info);
     virtual void Send(const std::string& data);
     virtual bool IsConnected() const;
+    virtual void TakeMessages(std::vector<LSP::ResponseMessage::Ptr_t>& messages);
 
     LSPNetworkSTDIO();
     virtual ~LSPNetworkSTDIO();
@@ -23,12 +23,24 @@
 #include "clWorkspaceManager.h"
 #include <wx/stc/stc.h>
 #include <wx/filesys.h>
+#include <wx/app.h>
 #include <iomanip>
 #include <sstream>
 #include "LSPNetworkSTDIO.h"
 #include "LSP/Request.h"
+#include "performance.h"
 #include "LSPNetworkSocketClient.h"
 #include "LSP/SignatureHelpRequest.h"
+#include "LSP/CancelRequest.h"
+
+// When an editor collects more changes than this, send its whole content instead
+#define MAX_PENDING_CHANGES 1000
+
+// The maximum number of requests sent to the server and waiting for a response
+#define MAX_IN_FLIGHT_REQUESTS 8
+
+// For how long (seconds) a request waits for its response before we give up on it
+#define REQUEST_TIMEOUT 30
 
 LanguageServerProtocol::LanguageServerProtocol(const wxString& name, eNetworkType netType, wxEvtHandler* owner)
     : ServiceProvider(wxString() << "LSP: " << name, eServiceType::kCodeCompletion)
@@ -39,6 +51,7 @@ LanguageServerProtocol::LanguageServerProtocol(const wxString& name, eNetworkTyp
     EventNotifier::Get()->Bind(wxEVT_FILE_CLOSED, &LanguageServerProtocol::OnFileClosed, this);
     EventNotifier::Get()->Bind(wxEVT_FILE_LOADED, &LanguageServerProtocol::OnFileLoaded, this);
     EventNotifier::Get()->Bind(wxEVT_ACTIVE_EDITOR_CHANGED, &LanguageServerProtocol::OnEditorChanged, this);
+    wxTheApp->Bind(wxEVT_STC_MODIFIED, &LanguageServerProtocol::OnStcModified, this);
 
     Bind(wxEVT_CC_FIND_SYMBOL, &LanguageServerProtocol::OnFindSymbol, this);
     Bind(wxEVT_CC_FIND_SYMBOL_DECLARATION, &LanguageServerProtocol::OnFindSymbolDecl, this);
@@ -46,6 +59,9 @@ LanguageServerProtocol::LanguageServerProtocol(const wxString& name, eNetworkTyp
     Bind(wxEVT_CC_CODE_COMPLETE, &LanguageServerProtocol::OnCodeComplete, this);
     Bind(wxEVT_CC_CODE_COMPLETE_FUNCTION_CALLTIP, &LanguageServerProtocol::OnFunctionCallTip, this);
 
+    m_timeoutTimer = new wxTimer(this);
+    Bind(wxEVT_TIMER, &LanguageServerProtocol::OnRequestsTimeout, this, m_timeoutTimer->GetId());
+
     // Use sockets here
     switch(netType) {
     case eNetworkType::kStdio:
@@ -66,11 +82,15 @@ LanguageServerProtocol::~LanguageServerProtocol()
     EventNotifier::Get()->Unbind(wxEVT_FILE_CLOSED, &LanguageServerProtocol::OnFileClosed, this);
     EventNotifier::Get()->Unbind(wxEVT_FILE_LOADED, &LanguageServerProtocol::OnFileLoaded, this);
     EventNotifier::Get()->Unbind(wxEVT_ACTIVE_EDITOR_CHANGED, &LanguageServerProtocol::OnEditorChanged, this);
+    wxTheApp->Unbind(wxEVT_STC_MODIFIED, &LanguageServerProtocol::OnStcModified, this);
     Unbind(wxEVT_CC_FIND_SYMBOL, &LanguageServerProtocol::OnFindSymbol, this);
     Unbind(wxEVT_CC_FIND_SYMBOL_DECLARATION, &LanguageServerProtocol::OnFindSymbolDecl, this);
     Unbind(wxEVT_CC_FIND_SYMBOL_DEFINITION, &LanguageServerProtocol::OnFindSymbolImpl, this);
     Unbind(wxEVT_CC_CODE_COMPLETE, &LanguageServerProtocol::OnCodeComplete, this);
     Unbind(wxEVT_CC_CODE_COMPLETE_FUNCTION_CALLTIP, &LanguageServerProtocol::OnFunctionCallTip, this);
+    m_timeoutTimer->Stop();
+    Unbind(wxEVT_TIMER, &LanguageServerProtocol::OnRequestsTimeout, this, m_timeoutTimer->GetId());
+    wxDELETE(m_timeoutTimer);
     DoClear();
 }
 
@@ -171,11 +191,13 @@ void LanguageServerProtocol::Start()
 
 void LanguageServerProtocol::DoClear()
 {
-    m_filesSent.clear();
+    m_documents.clear();
     m_outputBuffer.clear();
     m_state = kUnInitialized;
     m_initializeRequestID = wxNOT_FOUND;
+    m_textDocumentSync = LSP::kTextDocumentSyncFull;
     m_Queue.Clear();
+    m_requestsStartTime.clear();
 
     // Destory the current connection
     m_network->Close();
@@ -272,13 +294,7 @@ void LanguageServerProtocol::FindDefinition(IEditor* editor)
     CHECK_COND_RET(ShouldHandleFile(editor));
 
     // If the editor is modified, we need to tell the LSP to reparse the source file
-    const wxFileName& filename = editor->GetFileName();
-    if(m_filesSent.count(filename.GetFullPath()) && editor->IsModified()) {
-        // we already sent this file over, ask for change parse
-        SendChangeRequest(filename, editor->GetTextRange(0, editor->GetLength()));
-    } else if(m_filesSent.count(filename.GetFullPath()) == 0) {
-        SendOpenRequest(filename, editor->GetTextRange(0, editor->GetLength()), GetLanguageId(filename));
-    }
+    SyncEditor(editor);
 
     LSP::GotoDefinitionRequest::Ptr_t req = LSP::MessageWithParams::MakeRequest(new LSP::GotoDefinitionRequest(
         editor->GetFileName(), editor->GetCurrentLine(), editor->GetCtrl()->GetColumn(editor->GetCurrentPosition())));
@@ -294,11 +310,14 @@ void LanguageServerProtocol::SendOpenRequest(const wxFileName& filename, const w
     req->SetStatusMessage(wxString() << GetLogPrefix() << " parsing file: " << filename.GetFullName());
 #endif
     QueueMessage(req);
+
+    // Start tracking the changes made to this file
+    m_documents[filename.GetFullPath()] = Document();
 }
 
 void LanguageServerProtocol::SendCloseRequest(const wxFileName& filename)
 {
-    if(m_filesSent.count(filename.GetFullPath()) == 0) {
+    if(m_documents.count(filename.GetFullPath()) == 0) {
         clDEBUG() << GetLogPrefix() << "LanguageServerProtocol::FileClosed(): file" << filename << "is not opened";
         return;
     }
@@ -306,19 +325,56 @@ void LanguageServerProtocol::SendCloseRequest(const wxFileName& filename)
     LSP::DidCloseTextDocumentRequest::Ptr_t req =
         LSP::MessageWithParams::MakeRequest(new LSP::DidCloseTextDocumentRequest(filename));
     QueueMessage(req);
-    m_filesSent.erase(filename.GetFullPath());
+    m_documents.erase(filename.GetFullPath());
 }
 
 void LanguageServerProtocol::SendChangeRequest(const wxFileName& filename, const wxString& fileContent)
 {
-    LSP::DidChangeTextDocumentRequest::Ptr_t req =
-        LSP::MessageWithParams::MakeRequest(new LSP::DidChangeTextDocumentRequest(filename, fileContent));
+    // The whole content replaces any pending change
+    Document& doc = m_documents[filename.GetFullPath()];
+    doc.changes.clear();
+    doc.fullSyncNeeded = false;
+
+    LSP::DidChangeTextDocumentRequest::Ptr_t req = LSP::MessageWithParams::MakeRequest(
+        new LSP::DidChangeTextDocumentRequest(filename, ++doc.version, fileContent));
 #ifndef __WXOSX__
     req->SetStatusMessage(wxString() << GetLogPrefix() << " re-parsing file: " << filename.GetFullName());
 #endif
     QueueMessage(req);
 }
 
+void LanguageServerProtocol::SendChangeRequest(IEditor* editor)
+{
+    const wxFileName& filename = editor->GetFileName();
+    std::unordered_map<wxString, Document>::iterator iter = m_documents.find(filename.GetFullPath());
+    if(iter == m_documents.end()) { return; }
+
+    Document& doc = iter->second;
+    if(doc.fullSyncNeeded) {
+        SendChangeRequest(filename, editor->GetTextRange(0, editor->GetLength()));
+
+    } else if(!doc.changes.empty()) {
+        LSP::DidChangeTextDocumentRequest::Ptr_t req = LSP::MessageWithParams::MakeRequest(
+            new LSP::DidChangeTextDocumentRequest(filename, ++doc.version, doc.changes));
+        doc.changes.clear();
+#ifndef __WXOSX__
+        req->SetStatusMessage(wxString() << GetLogPrefix() << " re-parsing file: " << filename.GetFullName());
+#endif
+        QueueMessage(req);
+    }
+}
+
+void LanguageServerProtocol::SyncEditor(IEditor* editor)
+{
+    const wxFileName& filename = editor->GetFileName();
+    if(m_documents.count(filename.GetFullPath())) {
+        // we already sent this file over, send the changes made since
+        SendChangeRequest(editor);
+    } else {
+        SendOpenRequest(filename, editor->GetTextRange(0, editor->GetLength()), GetLanguageId(filename));
+    }
+}
+
 void LanguageServerProtocol::SendSaveRequest(const wxFileName& filename, const wxString& fileContent)
 {
     // LSP::DidSaveTextDocumentRequest req(filename, fileContent);
@@ -332,6 +388,8 @@ void LanguageServerProtocol::SendSaveRequest(const wxFileName& filename, const w
 void LanguageServerProtocol::SendCodeCompleteRequest(const wxFileName& filename, size_t line, size_t column)
 {
     if(ShouldHandleFile(filename)) {
+        // The user kept typing: the previous completion requests are no longer needed
+        CancelRequests("textDocument/completion");
         LSP::CompletionRequest::Ptr_t req = LSP::MessageWithParams::MakeRequest(
             new LSP::CompletionRequest(LSP::TextDocumentIdentifier(filename), LSP::Position(line, column)));
         QueueMessage(req);
@@ -359,7 +417,58 @@ void LanguageServerProtocol::OnFileSaved(clCommandEvent& event)
     event.Skip();
     // For now, it does the same as 'OnFileLoaded'
     IEditor* editor = clGetManager()->GetActiveEditor();
-    if(editor && ShouldHandleFile(editor)) { SendSaveRequest(editor->GetFileName(), editor->GetCtrl()->GetText()); }
+    if(editor && ShouldHandleFile(editor) && m_documents.count(editor->GetFileName().GetFullPath())) {
+        // For now: report the changes made since the last update
+        SendChangeRequest(editor);
+    }
+}
+
+LSP::Position LanguageServerProtocol::GetPosition(wxStyledTextCtrl* ctrl, int pos)
+{
+    // LSP columns are in UTF-16 code units, Scintilla positions are in bytes
+    int line = ctrl->LineFromPosition(pos);
+    wxString prefix = ctrl->GetTextRange(ctrl->PositionFromLine(line), pos);
+    int column = 0;
+    for(wxString::const_iterator iter = prefix.begin(); iter != prefix.end(); ++iter) {
+        // Characters outside of the BMP take 2 code units (when wxString is UTF-16, they are 2 characters already)
+        column += ((wxUint32)(*iter).GetValue() > 0xFFFF) ? 2 : 1;
+    }
+    return LSP::Position(line, column);
+}
+
+void LanguageServerProtocol::OnStcModified(wxStyledTextEvent& event)
+{
+    event.Skip();
+    if(m_documents.empty()) { return; }
+
+    // Deletions are recorded before they happen, while the range still exists in the editor
+    int type = event.GetModificationType();
+    if(!(type & (wxSTC_MOD_INSERTTEXT | wxSTC_MOD_BEFOREDELETE))) { return; }
+
+    // The editors are the wxStyledTextCtrl that implement IEditor, the other controls are skipped
+    IEditor* editor = dynamic_cast<IEditor*>(event.GetEventObject());
+    CHECK_PTR_RET(editor);
+    wxStyledTextCtrl* ctrl = editor->GetCtrl();
+
+    std::unordered_map<wxString, Document>::iterator iter = m_documents.find(editor->GetFileName().GetFullPath());
+    if(iter == m_documents.end()) { return; }
+
+    Document& doc = iter->second;
+    if(doc.fullSyncNeeded) { return; }
+    if(m_textDocumentSync != LSP::kTextDocumentSyncIncremental || doc.changes.size() >= MAX_PENDING_CHANGES) {
+        // Send the whole content on the next update
+        doc.fullSyncNeeded = true;
+        doc.changes.clear();
+        return;
+    }
+
+    LSP::Position start = GetPosition(ctrl, event.GetPosition());
+    if(type & wxSTC_MOD_INSERTTEXT) {
+        doc.changes.push_back(LSP::TextDocumentContentChangeEvent(LSP::Range(start, start), event.GetText()));
+    } else {
+        LSP::Position end = GetPosition(ctrl, event.GetPosition() + event.GetLength());
+        doc.changes.push_back(LSP::TextDocumentContentChangeEvent(LSP::Range(start, end), wxEmptyString));
+    }
 }
 
 wxString LanguageServerProtocol::GetLogPrefix() const { return wxString() << "[" << GetName() << "] "; }
@@ -368,9 +477,9 @@ void LanguageServerProtocol::OpenEditor(IEditor* editor)
 {
     if(!IsInitialized()) { return; }
     if(editor && ShouldHandleFile(editor)) {
-        if(m_filesSent.count(editor->GetFileName().GetFullPath())) {
+        if(m_documents.count(editor->GetFileName().GetFullPath())) {
             clDEBUG() << "OpenEditor->SendChangeRequest called for:" << editor->GetFileName().GetFullName();
-            SendChangeRequest(editor->GetFileName(), editor->GetCtrl()->GetText());
+            SendChangeRequest(editor);
         } else {
             clDEBUG() << "OpenEditor->SendOpenRequest called for:" << editor->GetFileName().GetFullName();
             SendOpenRequest(editor->GetFileName(), editor->GetCtrl()->GetText(), GetLanguageId(editor->GetFileName()));
@@ -384,15 +493,11 @@ void LanguageServerProtocol::FunctionHelp(IEditor* editor)
     CHECK_PTR_RET(editor);
     CHECK_COND_RET(ShouldHandleFile(editor));
     // If the editor is modified, we need to tell the LSP to reparse the source file
-    const wxFileName& filename = editor->GetFileName();
-    if(m_filesSent.count(filename.GetFullPath()) && editor->IsModified()) {
-        // we already sent this file over, ask for change parse
-        SendChangeRequest(filename, editor->GetTextRange(0, editor->GetLength()));
-    } else if(m_filesSent.count(filename.GetFullPath()) == 0) {
-        SendOpenRequest(filename, editor->GetTextRange(0, editor->GetLength()), GetLanguageId(filename));
-    }
+    SyncEditor(editor);
 
+    const wxFileName& filename = editor->GetFileName();
     if(ShouldHandleFile(filename)) {
+        CancelRequests("textDocument/signatureHelp");
         LSP::SignatureHelpRequest::Ptr_t req = LSP::MessageWithParams::MakeRequest(new LSP::SignatureHelpRequest(
             filename, editor->GetCurrentLine(), editor->GetCtrl()->GetColumn(editor->GetCurrentPosition())));
         QueueMessage(req);
@@ -406,13 +511,7 @@ void LanguageServerProtocol::CodeComplete(IEditor* editor)
     CHECK_COND_RET(ShouldHandleFile(editor));
 
     // If the editor is modified, we need to tell the LSP to reparse the source file
-    const wxFileName& filename = editor->GetFileName();
-    if(m_filesSent.count(filename.GetFullPath()) && editor->IsModified()) {
-        // we already sent this file over, ask for change parse
-        SendChangeRequest(filename, editor->GetTextRange(0, editor->GetLength()));
-    } else if(m_filesSent.count(filename.GetFullPath()) == 0) {
-        SendOpenRequest(filename, editor->GetTextRange(0, editor->GetLength()), GetLanguageId(filename));
-    }
+    SyncEditor(editor);
     // Now request the for code completion
     SendCodeCompleteRequest(editor->GetFileName(), editor->GetCurrentLine(),
                             editor->GetCtrl()->GetColumn(editor->GetCurrentPosition()));
@@ -421,21 +520,54 @@ void LanguageServerProtocol::CodeComplete(IEditor* editor)
 void LanguageServerProtocol::ProcessQueue()
 {
     if(m_Queue.IsEmpty()) { return; }
-    if(m_Queue.IsWaitingReponse()) {
-        clDEBUG() << "LSP is busy, will not send message";
-        return;
-    }
-    LSP::MessageWithParams::Ptr_t req = m_Queue.Get();
     if(!IsRunning()) {
         clDEBUG() << GetLogPrefix() << "is down.";
         return;
     }
 
-    // Write the message length as string of 10 bytes
-    m_network->Send(req->ToString());
-    m_Queue.SetWaitingReponse(true);
-    m_Queue.Pop();
-    if(!req->GetStatusMessage().IsEmpty()) { clGetManager()->SetStatusMessage(req->GetStatusMessage(), 1); }
+    // A request which response was lost must not hold its in-flight slot forever
+    std::vector<int> expiredIds;
+    m_Queue.ExpirePendingReplies(REQUEST_TIMEOUT, expiredIds);
+    for(int id : expiredIds) {
+        clDEBUG() << GetLogPrefix() << "request" << id << "timed out";
+        m_requestsStartTime.erase(id);
+        m_network->Send(LSP::MessageWithParams::MakeRequest(new LSP::CancelRequest(id))->ToString());
+    }
+
+    // Send everything we can, without waiting for the responses
+    while(!m_Queue.IsEmpty()) {
+        LSP::MessageWithParams::Ptr_t req = m_Queue.Get();
+        if(req->As<LSP::Request>() && m_Queue.GetPendingReplyCount() >= MAX_IN_FLIGHT_REQUESTS) {
+            // The messages are sent in order, so this request holds the ones queued after it.
+            // Check again once the oldest request may have timed out
+            clDEBUG() << GetLogPrefix() << "too many requests in flight, will send the rest later";
+            if(!m_timeoutTimer->IsRunning()) { m_timeoutTimer->StartOnce(REQUEST_TIMEOUT * 1000); }
+            break;
+        }
+
+        m_network->Send(req->ToString());
+        m_Queue.Pop();
+        if(clTracer::IsEnabled() && req->As<LSP::Request>()) {
+            m_requestsStartTime[req->As<LSP::Request>()->GetId()] = clTracer::Now();
+        }
+        if(!req->GetStatusMessage().IsEmpty()) { clGetManager()->SetStatusMessage(req->GetStatusMessage(), 1); }
+    }
+}
+
+void LanguageServerProtocol::OnRequestsTimeout(wxTimerEvent& event)
+{
+    wxUnusedVar(event);
+    ProcessQueue();
+}
+
+void LanguageServerProtocol::CancelRequests(const wxString& method)
+{
+    std::vector<int> sentIds;
+    m_Queue.CancelRequests(method, sentIds);
+    for(int id : sentIds) {
+        clDEBUG() << GetLogPrefix() << "cancelling request" << id << "(" << method << ")";
+        QueueMessage(LSP::MessageWithParams::MakeRequest(new LSP::CancelRequest(id)));
+    }
 }
 
 void LanguageServerProtocol::CloseEditor(IEditor* editor)
@@ -455,13 +587,7 @@ void LanguageServerProtocol::FindDeclaration(IEditor* editor)
         CHECK_COND_RET(ShouldHandleFile(editor));
 
         // If the editor is modified, we need to tell the LSP to reparse the source file
-        const wxFileName& filename = editor->GetFileName();
-        if(m_filesSent.count(filename.GetFullPath()) && editor->IsModified()) {
-            // we already sent this file over, ask for change parse
-            SendChangeRequest(filename, editor->GetTextRange(0, editor->GetLength()));
-        } else if(m_filesSent.count(filename.GetFullPath()) == 0) {
-            SendOpenRequest(filename, editor->GetTextRange(0, editor->GetLength()), GetLanguageId(filename));
-        }
+        SyncEditor(editor);
 
         LSP::GotoDeclarationRequest::Ptr_t req = LSP::MessageWithParams::MakeRequest(
             new LSP::GotoDeclarationRequest(editor->GetFileName(), editor->GetCurrentLine(),
@@ -497,121 +623,159 @@ void LanguageServerProtocol::OnNetError(clCommandEvent& event)
 
 void LanguageServerProtocol::OnNetDataReady(clCommandEvent& event)
 {
-    clDEBUG() << GetLogPrefix() << event.GetString();
-    wxString buffer = std::move(event.GetString());
-    m_outputBuffer << buffer;
-    m_Queue.SetWaitingReponse(false);
-
-    while(true) {
-        // Did we get a complete message?
-        LSP::ResponseMessage res(m_outputBuffer);
-        if(res.IsOk()) {
-            if(IsInitialized()) {
-                LSP::MessageWithParams::Ptr_t msg_ptr = m_Queue.TakePendingReplyMessage(res.GetId());
-                // Is this an error message?
-                if(res.Has("error")) {
-                    clDEBUG() << GetLogPrefix() << "received an error message";
-                    LSP::ResponseError errMsg(res.GetMessageString());
-                    switch(errMsg.GetErrorCode()) {
-                    case LSP::ResponseError::kErrorCodeInternalError:
-                    case LSP::ResponseError::kErrorCodeInvalidRequest: {
-                        // Restart this server
-                        LSPEvent restartEvent(wxEVT_LSP_RESTART_NEEDED);
-                        restartEvent.SetServerName(GetName());
-                        m_owner->AddPendingEvent(restartEvent);
-                        break;
-                    }
-                    case LSP::ResponseError::kErrorCodeMethodNotFound: {
-                        // User requested a mesasge which is not supported by this server
-                        clGetManager()->SetStatusMessage(wxString() << GetLogPrefix() << _("method: ")
-                                                                    << msg_ptr->GetMethod() << _(" is not supported"));
-                        m_unimplementedMethods.insert(msg_ptr->GetMethod());
-
-                        // Report this missing event
-                        LSPEvent eventMethodNotFound(wxEVT_LSP_METHOD_NOT_FOUND);
-                        eventMethodNotFound.SetServerName(GetName());
-                        eventMethodNotFound.SetString(msg_ptr->GetMethod());
-                        m_owner->AddPendingEvent(eventMethodNotFound);
-
-                    } break;
-                    case LSP::ResponseError::kErrorCodeInvalidParams: {
-                        // Recreate this AST (in other words: reparse), by default we reparse the current editor
-                        LSPEvent reparseEvent(wxEVT_LSP_REPARSE_NEEDED);
-                        reparseEvent.SetServerName(GetName());
-                        m_owner->AddPendingEvent(reparseEvent);
-                        break;
-                    }
-                    default:
-                        break;
+    // Messages decoded by the network layer
+    std::vector<LSP::ResponseMessage::Ptr_t> messages;
+    m_network->TakeMessages(messages);
+    for(size_t i = 0; i < messages.size(); ++i) {
+        ProcessResponse(*messages[i]);
+    }
+
+    // Raw data
+    if(!event.GetString().empty()) {
+        clDEBUG() << GetLogPrefix() << event.GetString();
+        wxString buffer = std::move(event.GetString());
+        m_outputBuffer << buffer;
+
+        while(true) {
+            // Did we get a complete message?
+            LSP::ResponseMessage res(m_outputBuffer);
+            if(!res.IsOk()) { break; }
+            ProcessResponse(res);
+
+            // A message was consumed from the buffer, see if we got more messages
+            if(m_outputBuffer.empty()) { break; }
+        }
+    }
+    ProcessQueue();
+}
+
+void LanguageServerProtocol::ProcessResponse(const LSP::ResponseMessage& res)
+{
+    if(IsInitialized()) {
+        LSP::MessageWithParams::Ptr_t msg_ptr = m_Queue.TakePendingReplyMessage(res.GetId());
+        std::unordered_map<int, long long>::iterator iter = m_requestsStartTime.find(res.GetId());
+        if(iter != m_requestsStartTime.end()) {
+            // Trace the request round-trip
+            if(msg_ptr) {
+                clTracer::AddSpan(("LSP " + msg_ptr->GetMethod()).ToStdString(), iter->second, clTracer::Now());
+            }
+            m_requestsStartTime.erase(iter);
+        }
+        if(!msg_ptr && res.GetId() != wxNOT_FOUND) {
+            // A late response to a request we cancelled (or never sent)
+            clDEBUG() << GetLogPrefix() << "dropping response for request" << res.GetId();
+
+        } else if(res.Has("error")) {
+            // Is this an error message?
+            clDEBUG() << GetLogPrefix() << "received an error message";
+            LSP::ResponseError errMsg(res.GetMessageString());
+            switch(errMsg.GetErrorCode()) {
+            case LSP::ResponseError::kErrorCodeInternalError:
+            case LSP::ResponseError::kErrorCodeInvalidRequest: {
+                // Restart this server
+                LSPEvent restartEvent(wxEVT_LSP_RESTART_NEEDED);
+                restartEvent.SetServerName(GetName());
+                m_owner->AddPendingEvent(restartEvent);
+                break;
+            }
+            case LSP::ResponseError::kErrorCodeMethodNotFound: {
+                // An error without a request ID can't be matched to its request
+                if(!msg_ptr) { break; }
+
+                // User requested a mesasge which is not supported by this server
+                clGetManager()->SetStatusMessage(wxString() << GetLogPrefix() << _("method: ")
+                                                            << msg_ptr->GetMethod() << _(" is not supported"));
+                m_unimplementedMethods.insert(msg_ptr->GetMethod());
+
+                // Report this missing event
+                LSPEvent eventMethodNotFound(wxEVT_LSP_METHOD_NOT_FOUND);
+                eventMethodNotFound.SetServerName(GetName());
+                eventMethodNotFound.SetString(msg_ptr->GetMethod());
+                m_owner->AddPendingEvent(eventMethodNotFound);
+
+            } break;
+            case LSP::ResponseError::kErrorCodeInvalidParams: {
+                // Recreate this AST (in other words: reparse), by default we reparse the current editor
+                LSPEvent reparseEvent(wxEVT_LSP_REPARSE_NEEDED);
+                reparseEvent.SetServerName(GetName());
+                m_owner->AddPendingEvent(reparseEvent);
+                break;
+            }
+            default:
+                break;
+            }
+        } else {
+            if(msg_ptr && msg_ptr->As<LSP::Request>()) {
+                clDEBUG() << GetLogPrefix() << "received a response";
+                // Check if the reply is still valid
+                IEditor* editor = clGetManager()->GetActiveEditor();
+                if(editor) {
+                    LSP::Request* preq = msg_ptr->As<LSP::Request>();
+                    // let the originating request to handle it
+                    const wxFileName& filename = editor->GetFileName();
+                    size_t line = editor->GetCurrentLine();
+                    size_t column = editor->GetCtrl()->GetColumn(editor->GetCurrentPosition());
+                    if(false && preq->IsPositionDependantRequest() &&
+                       !preq->IsValidAt(filename, line, column)) {
+                        clDEBUG() << "Response is no longer valid. Discarding its result";
+                    } else {
+                        preq->OnResponse(res, m_owner);
                     }
-                } else {
-                    if(msg_ptr && msg_ptr->As<LSP::Request>()) {
-                        clDEBUG() << GetLogPrefix() << "received a response";
-                        // Check if the reply is still valid
-                        IEditor* editor = clGetManager()->GetActiveEditor();
-                        if(editor) {
-                            LSP::Request* preq = msg_ptr->As<LSP::Request>();
-                            // let the originating request to handle it
-                            const wxFileName& filename = editor->GetFileName();
-                            size_t line = editor->GetCurrentLine();
-                            size_t column = editor->GetCtrl()->GetColumn(editor->GetCurrentPosition());
-                            if(false && preq->IsPositionDependantRequest() &&
-                               !preq->IsValidAt(filename, line, column)) {
-                                clDEBUG() << "Response is no longer valid. Discarding its result";
-                            } else {
-                                preq->OnResponse(res, m_owner);
-                            }
-                        }
-
-                    } else if(res.IsPushDiagnostics()) {
-                        // Get the URI
-                        clDEBUG() << GetLogPrefix() << "Received diagnostic message";
-                        wxFileName fn(wxFileSystem::URLToFileName(res.GetDiagnosticsUri()));
-                        fn.Normalize();
+                }
+
+            } else if(res.IsPushDiagnostics()) {
+                // Get the URI
+                clDEBUG() << GetLogPrefix() << "Received diagnostic message";
+                wxFileName fn(wxFileSystem::URLToFileName(res.GetDiagnosticsUri()));
+                fn.Normalize();
 #ifndef __WXOSX__
-                        // Don't show this message on macOS as it appears in the middle of the screen...
-                        clGetManager()->SetStatusMessage(
-                            wxString() << GetLogPrefix() << "parsing of file: " << fn.GetFullName() << " is completed",
-                            1);
+                // Don't show this message on macOS as it appears in the middle of the screen...
+                clGetManager()->SetStatusMessage(
+                    wxString() << GetLogPrefix() << "parsing of file: " << fn.GetFullName() << " is completed",
+                    1);
 #endif
-                        std::vector<LSP::Diagnostic> diags = res.GetDiagnostics();
-                        if(!diags.empty() && IsDisaplayDiagnostics()) {
-                            // report the diagnostics
-                            LSPEvent eventSetDiags(wxEVT_LSP_SET_DIAGNOSTICS);
-                            eventSetDiags.GetLocation().SetUri(fn.GetFullPath());
-                            eventSetDiags.SetDiagnostics(diags);
-                            m_owner->AddPendingEvent(eventSetDiags);
-                        } else if(diags.empty()) {
-                            // clear all diagnostics
-                            LSPEvent eventClearDiags(wxEVT_LSP_CLEAR_DIAGNOSTICS);
-                            eventClearDiags.GetLocation().SetUri(fn.GetFullPath());
-                            m_owner->AddPendingEvent(eventClearDiags);
-                        }
-                    } else {
-                        clDEBUG() << GetLogPrefix() << "received an unsupported message";
-                    }
+                std::vector<LSP::Diagnostic> diags = res.GetDiagnostics();
+                if(!diags.empty() && IsDisaplayDiagnostics()) {
+                    // report the diagnostics
+                    LSPEvent eventSetDiags(wxEVT_LSP_SET_DIAGNOSTICS);
+                    eventSetDiags.GetLocation().SetUri(fn.GetFullPath());
+                    eventSetDiags.SetDiagnostics(diags);
+                    m_owner->AddPendingEvent(eventSetDiags);
+                } else if(diags.empty()) {
+                    // clear all diagnostics
+                    LSPEvent eventClearDiags(wxEVT_LSP_CLEAR_DIAGNOSTICS);
+                    eventClearDiags.GetLocation().SetUri(fn.GetFullPath());
+                    m_owner->AddPendingEvent(eventClearDiags);
                 }
             } else {
-                // we only accept initialization responses here
-                if(res.GetId() == m_initializeRequestID) {
-                    clDEBUG() << GetLogPrefix() << "initialization completed";
-                    m_initializeRequestID = wxNOT_FOUND;
-                    m_state = kInitialized;
-
-                    // Notify about this
-                    LSPEvent initEvent(wxEVT_LSP_INITIALIZED);
-                    initEvent.SetServerName(GetName());
-                    m_owner->AddPendingEvent(initEvent);
-                } else {
-                    clDEBUG() << GetLogPrefix() << "Server not initialized. This message is ignored";
-                }
+                clDEBUG() << GetLogPrefix() << "received an unsupported message";
             }
-            // A message was consumed from the buffer, see if we got more messages
-            if(!m_outputBuffer.empty()) { continue; }
         }
-        break;
+    } else {
+        // we only accept initialization responses here
+        if(res.GetId() == m_initializeRequestID) {
+            clDEBUG() << GetLogPrefix() << "initialization completed";
+            m_Queue.TakePendingReplyMessage(res.GetId());
+            m_initializeRequestID = wxNOT_FOUND;
+            m_state = kInitialized;
+
+            // "textDocumentSync" is either a TextDocumentSyncKind or a TextDocumentSyncOptions object
+            JSONItem sync = res.Get("result").namedObject("capabilities").namedObject("textDocumentSync");
+            if(sync.isNumber()) {
+                m_textDocumentSync = sync.toInt(LSP::kTextDocumentSyncFull);
+            } else if(sync.hasNamedObject("change")) {
+                m_textDocumentSync = sync.namedObject("change").toInt(LSP::kTextDocumentSyncFull);
+            }
+            clDEBUG() << GetLogPrefix() << "text document sync kind:" << m_textDocumentSync;
+
+            // Notify about this
+            LSPEvent initEvent(wxEVT_LSP_INITIALIZED);
+            initEvent.SetServerName(GetName());
+            m_owner->AddPendingEvent(initEvent);
+        } else {
+            clDEBUG() << GetLogPrefix() << "Server not initialized. This message is ignored";
+        }
     }
-    ProcessQueue();
 }
 
 void LanguageServerProtocol::Stop()
@@ -638,13 +802,7 @@ void LanguageServerProtocol::FindImplementation(IEditor* editor)
         CHECK_COND_RET(ShouldHandleFile(editor));
 
         // If the editor is modified, we need to tell the LSP to reparse the source file
-        const wxFileName& filename = editor->GetFileName();
-        if(m_filesSent.count(filename.GetFullPath()) && editor->IsModified()) {
-            // we already sent this file over, ask for change parse
-            SendChangeRequest(filename, editor->GetTextRange(0, editor->GetLength()));
-        } else if(m_filesSent.count(filename.GetFullPath()) == 0) {
-            SendOpenRequest(filename, editor->GetTextRange(0, editor->GetLength()), GetLanguageId(filename));
-        }
+        SyncEditor(editor);
 
         LSP::GotoImplementationRequest::Ptr_t req = LSP::MessageWithParams::MakeRequest(
             new LSP::GotoImplementationRequest(editor->GetFileName(), editor->GetCurrentLine(),
@@ -657,19 +815,46 @@ void LanguageServerProtocol::FindImplementation(IEditor* editor)
 // LSPRequestMessageQueue
 //===------------------------------------------------------------------
 
-void LSPRequestMessageQueue::Push(LSP::MessageWithParams::Ptr_t message)
+void LSPRequestMessageQueue::Push(LSP::MessageWithParams::Ptr_t message) { m_Queue.push_back(message); }
+
+void LSPRequestMessageQueue::Pop()
 {
-    m_Queue.push(message);
+    if(m_Queue.empty()) { return; }
 
     // Messages of type 'Request' require responses from the server
+    LSP::MessageWithParams::Ptr_t message = m_Queue.front();
     LSP::Request* req = message->As<LSP::Request>();
-    if(req) { m_pendingReplyMessages.insert({ req->GetId(), message }); }
+    if(req) {
+        PendingReply pending;
+        pending.message = message;
+        pending.sent = time(NULL);
+        m_pendingReplyMessages.insert({ req->GetId(), pending });
+    }
+    m_Queue.pop_front();
 }
 
-void LSPRequestMessageQueue::Pop()
+void LSPRequestMessageQueue::CancelRequests(const wxString& method, std::vector<int>& sentIds)
 {
-    if(!m_Queue.empty()) { m_Queue.pop(); }
-    SetWaitingReponse(false);
+    // Not sent yet, simply drop them
+    std::deque<LSP::MessageWithParams::Ptr_t>::iterator iter = m_Queue.begin();
+    while(iter != m_Queue.end()) {
+        if((*iter)->GetMethod() == method) {
+            iter = m_Queue.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+
+    // Already sent, forget about them so their responses are ignored
+    std::unordered_map<int, PendingReply>::iterator pending = m_pendingReplyMessages.begin();
+    while(pending != m_pendingReplyMessages.end()) {
+        if(pending->second.message->GetMethod() == method) {
+            sentIds.push_back(pending->first);
+            pending = m_pendingReplyMessages.erase(pending);
+        } else {
+            ++pending;
+        }
+    }
 }
 
 LSP::MessageWithParams::Ptr_t LSPRequestMessageQueue::Get()
@@ -680,10 +865,7 @@ LSP::MessageWithParams::Ptr_t LSPRequestMessageQueue::Get()
 
 void LSPRequestMessageQueue::Clear()
 {
-    while(!m_Queue.empty()) {
-        m_Queue.pop();
-    }
-    SetWaitingReponse(false);
+    m_Queue.clear();
     m_pendingReplyMessages.clear();
 }
 
@@ -691,7 +873,21 @@ LSP::MessageWithParams::Ptr_t LSPRequestMessageQueue::TakePendingReplyMessage(in
 {
     if(m_pendingReplyMessages.empty()) { return LSP::MessageWithParams::Ptr_t(nullptr); }
     if(m_pendingReplyMessages.count(msgid) == 0) { return LSP::MessageWithParams::Ptr_t(nullptr); }
-    LSP::MessageWithParams::Ptr_t msgptr = m_pendingReplyMessages[msgid];
+    LSP::MessageWithParams::Ptr_t msgptr = m_pendingReplyMessages[msgid].message;
     m_pendingReplyMessages.erase(msgid);
     return msgptr;
 }
+
+void LSPRequestMessageQueue::ExpirePendingReplies(time_t timeout, std::vector<int>& expiredIds)
+{
+    time_t now = time(NULL);
+    std::unordered_map<int, PendingReply>::iterator pending = m_pendingReplyMessages.begin();
+    while(pending != m_pendingReplyMessages.end()) {
+        if((now - pending->second.sent) >= timeout) {
+            expiredIds.push_back(pending->first);
+            pending = m_pendingReplyMessages.erase(pending);
+        } else {
+            ++pending;
+        }
+    }
+}
@@ -7,22 +7,29 @@
 #include <wxStringHash.h>
 #include <wx/sharedptr.h>
 #include "macros.h"
+#include <deque>
 #include <map>
-#include <queue>
 #include <string>
 #include "LSP/MessageWithParams.h"
+#include "LSP/basic_types.h"
 #include <unordered_map>
 #include "SocketAPI/clSocketClientAsync.h"
 #include "LSPNetwork.h"
 #include <wx/filename.h>
+#include <wx/timer.h>
 #include "ServiceProvider.h"
 
 class IEditor;
+class wxStyledTextCtrl;
+class wxStyledTextEvent;
 class WXDLLIMPEXP_SDK LSPRequestMessageQueue
 {
-    std::queue<LSP::MessageWithParams::Ptr_t> m_Queue;
-    std::unordered_map<int, LSP::MessageWithParams::Ptr_t> m_pendingReplyMessages;
-    bool m_waitingReponse = false;
+    struct PendingReply {
+        LSP::MessageWithParams::Ptr_t message;
+        time_t sent = 0;
+    };
+    std::deque<LSP::MessageWithParams::Ptr_t> m_Queue;              // not sent yet
+    std::unordered_map<int, PendingReply> m_pendingReplyMessages; // sent, by request ID
 
 public:
     LSPRequestMessageQueue() {}
@@ -30,12 +37,32 @@ public:
 
     LSP::MessageWithParams::Ptr_t TakePendingReplyMessage(int msgid);
     void Push(LSP::MessageWithParams::Ptr_t message);
+
+    /**
+     * @brief remove the first message from the queue, once it was sent. If it is a request, it is kept until
+     * its response arrives (see TakePendingReplyMessage)
+     */
     void Pop();
     LSP::MessageWithParams::Ptr_t Get();
     void Clear();
     bool IsEmpty() const { return m_Queue.empty(); }
-    void SetWaitingReponse(bool waitingReponse) { this->m_waitingReponse = waitingReponse; }
-    bool IsWaitingReponse() const { return m_waitingReponse; }
+
+    /**
+     * @brief the number of requests sent and waiting for a response
+     */
+    size_t GetPendingReplyCount() const { return m_pendingReplyMessages.size(); }
+
+    /**
+     * @brief cancel all the requests of a given method. The requests not sent yet are removed from the queue,
+     * the IDs of the requests already sent are returned in 'sentIds' (their responses will be ignored)
+     */
+    void CancelRequests(const wxString& method, std::vector<int>& sentIds);
+
+    /**
+     * @brief forget the requests waiting for a response for more than 'timeout' seconds, so they no longer hold
+     * an in-flight slot. Their IDs are returned in 'expiredIds' (their responses, if any, will be ignored)
+     */
+    void ExpirePendingReplies(time_t timeout, std::vector<int>& expiredIds);
 };
 
 class WXDLLIMPEXP_SDK LanguageServerProtocol : public ServiceProvider
@@ -45,12 +72,19 @@ class WXDLLIMPEXP_SDK LanguageServerProtocol : public ServiceProvider
         kInitialized,
     };
 
+    // A document opened in the server
+    struct Document {
+        int version = 1;
+        bool fullSyncNeeded = false;                              // send the whole content on the next update
+        std::vector<LSP::TextDocumentContentChangeEvent> changes; // the changes not sent yet
+    };
+
     wxString m_name;
     wxEvtHandler* m_owner = nullptr;
     LSPNetwork::Ptr_t m_network;
     wxArrayString m_lspCommand;
     wxString m_workingDirectory;
-    wxStringSet_t m_filesSent;
+    std::unordered_map<wxString, Document> m_documents;
     wxStringSet_t m_languages;
     wxString m_outputBuffer;
     wxString m_rootFolder;
@@ -59,12 +93,15 @@ class WXDLLIMPEXP_SDK LanguageServerProtocol : public ServiceProvider
     // initialization
     eState m_state = kUnInitialized;
     int m_initializeRequestID = wxNOT_FOUND;
+    int m_textDocumentSync = LSP::kTextDocumentSyncFull;
 
     // Parsing queue
     LSPRequestMessageQueue m_Queue;
+    std::unordered_map<int, long long> m_requestsStartTime; // request ID -> clTracer::Now(), when tracing
     size_t m_createFlags = 0;
     wxStringSet_t m_unimplementedMethods;
     bool m_disaplayDiagnostics = true;
+    wxTimer* m_timeoutTimer = nullptr;
 
 public:
     typedef wxSharedPtr<LanguageServerProtocol> Ptr_t;
@@ -78,11 +115,13 @@ protected:
     void OnFileClosed(clCommandEvent& event);
     void OnFileSaved(clCommandEvent& event);
     void OnEditorChanged(wxCommandEvent& event);
+    void OnStcModified(wxStyledTextEvent& event);
     void OnCodeComplete(clCodeCompletionEvent& event);
     void OnFindSymbolDecl(clCodeCompletionEvent& event);
     void OnFindSymbolImpl(clCodeCompletionEvent& event);
     void OnFindSymbol(clCodeCompletionEvent& event);
     void OnFunctionCallTip(clCodeCompletionEvent& event);
+    void OnRequestsTimeout(wxTimerEvent& event);
 
 protected:
     void DoClear();
@@ -90,8 +129,15 @@ protected:
     bool ShouldHandleFile(IEditor* editor) const;
     wxString GetLogPrefix() const;
     void ProcessQueue();
+    void ProcessResponse(const LSP::ResponseMessage& res);
+
+    /**
+     * @brief cancel the requests of a given method, e.g. the completion requests that were superseded by a new one
+     */
+    void CancelRequests(const wxString& method);
     static wxString GetLanguageId(const wxFileName& fn) { return GetLanguageId(fn.GetFullName()); }
     static wxString GetLanguageId(const wxString& fn);
+    static LSP::Position GetPosition(wxStyledTextCtrl* ctrl, int pos);
 
 protected:
     /**
@@ -105,10 +151,21 @@ protected:
     void SendCloseRequest(const wxFileName& filename);
 
     /**
-     * @brief report a file-changed notification
+     * @brief report a file-changed notification, with the whole file content
      */
     void SendChangeRequest(const wxFileName& filename, const wxString& fileContent);
 
+    /**
+     * @brief report the changes made to the editor since the last notification. When the server supports it,
+     * only the modified ranges are sent. Nothing is sent if the editor was not modified
+     */
+    void SendChangeRequest(IEditor* editor);
+
+    /**
+     * @brief make sure the server has the current content of the editor
+     */
+    void SyncEditor(IEditor* editor);
+
     /**
      * @brief report a file-save notification
      */
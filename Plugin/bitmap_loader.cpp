@@ -34,14 +34,28 @@
 #include "optionsconfig.h"
 #include <algorithm>
 #include <wx/dcscreen.h>
-#include <wx/dir.h>
 #include <wx/ffile.h>
+#include <wx/mstream.h>
 #include <wx/stdpaths.h>
 #include <wx/tokenzr.h>
 #include "clSystemSettings.h"
 
 std::unordered_map<wxString, wxBitmap> BitmapLoader::m_toolbarsBitmaps;
 std::unordered_map<wxString, wxString> BitmapLoader::m_manifest;
+std::unordered_map<wxString, BitmapLoader::PendingBitmap> BitmapLoader::m_pendingBitmaps;
+
+#ifndef __WXGTK__
+// The per platform rule wxWidgets (macOS) and clBitmap::LoadFile (MSW) used to pick the "@2x" version of an image
+static bool ShouldUseHiResImages()
+{
+#ifdef __WXOSX__
+    static double scaleFactor = wxScreenDC().GetContentScaleFactor();
+    return scaleFactor > 1.0;
+#else
+    return clBitmap::ShouldLoadHiResImages();
+#endif
+}
+#endif
 
 BitmapLoader::~BitmapLoader() {}
 
@@ -61,91 +75,142 @@ const wxBitmap& BitmapLoader::LoadBitmap(const wxString& name, int requestedSize
     if(clBitmap::ShouldLoadHiResImages()) { newName << "@2x"; }
 #endif
 
-    std::unordered_map<wxString, wxBitmap>::const_iterator iter = m_toolbarsBitmaps.find(newName);
-    if(iter != m_toolbarsBitmaps.end()) {
-        const wxBitmap& b = iter->second;
-        return b;
-    }
+    const wxBitmap* bmp = FindBitmap(newName);
+    if(bmp) { return *bmp; }
 
-    iter = m_toolbarsBitmaps.find(name);
-    if(iter != m_toolbarsBitmaps.end()) { return iter->second; }
+    bmp = FindBitmap(name);
+    if(bmp) { return *bmp; }
 
     return wxNullBitmap;
 }
 
-void BitmapLoader::doLoadManifest()
+const wxBitmap* BitmapLoader::FindBitmap(const wxString& name)
 {
-    wxString targetFile;
-    if(ExtractFileFromZip(m_zipPath.GetFullPath(), wxT("manifest.ini"), clStandardPaths::Get().GetUserDataDir(),
-                          targetFile)) {
-        // we got the file extracted, read it
-        wxFileName manifest(targetFile);
-        wxFFile fp(manifest.GetFullPath(), wxT("r"));
-        if(fp.IsOpened()) {
-
-            wxString content;
-            fp.ReadAll(&content);
-
-            m_manifest.clear();
-            wxArrayString entries = wxStringTokenize(content, wxT("\n"), wxTOKEN_STRTOK);
-            for(size_t i = 0; i < entries.size(); i++) {
-                wxString entry = entries[i];
-                entry.Trim().Trim(false);
-
-                // empty?
-                if(entry.empty()) continue;
-
-                // comment?
-                if(entry.StartsWith(wxT(";"))) continue;
-
-                wxString key = entry.BeforeFirst(wxT('='));
-                wxString val = entry.AfterFirst(wxT('='));
-                key.Trim().Trim(false);
-                val.Trim().Trim(false);
-
-                wxString key16, key24;
-                key16 = key;
-                key24 = key;
-
-                key16.Replace(wxT("<size>"), wxT("16"));
-                key24.Replace(wxT("<size>"), wxT("24"));
-
-                key16.Replace(wxT("."), wxT("/"));
-                key24.Replace(wxT("."), wxT("/"));
-
-                m_manifest[key16] = val;
-                m_manifest[key24] = val;
-            }
-
-            fp.Close();
-            clRemoveFile(manifest.GetFullPath());
-        }
-        clRemoveFile(targetFile);
+    std::unordered_map<wxString, wxBitmap>::const_iterator iter = m_toolbarsBitmaps.find(name);
+    if(iter != m_toolbarsBitmaps.end()) { return &iter->second; }
+
+    // Not decoded yet?
+    std::unordered_map<wxString, PendingBitmap>::iterator pending = m_pendingBitmaps.find(name);
+    if(pending == m_pendingBitmaps.end()) { return nullptr; }
+
+    clBitmap bmp;
+    wxMemoryInputStream in(pending->second.data.GetData(), pending->second.data.GetDataLen());
+    wxImage img(in, wxBITMAP_TYPE_PNG);
+    if(img.IsOk()) {
+        bmp = clBitmap(img, pending->second.scale);
+    } else {
+        clWARNING() << "Failed to decode image:" << name << clEndl;
     }
+    m_pendingBitmaps.erase(pending);
+
+    // Keep the failures as well, so we don't try to decode them again
+    wxBitmap& bitmap = m_toolbarsBitmaps[name];
+    bitmap = bmp;
+    return &bitmap;
 }
 
-wxBitmap BitmapLoader::doLoadBitmap(const wxString& filepath)
+void BitmapLoader::AddPendingBitmap(const wxString& name, const wxMemoryBuffer& data, double scale)
 {
-    wxString bitmapFile;
-    if(ExtractFileFromZip(m_zipPath.GetFullPath(), filepath, clStandardPaths::Get().GetUserDataDir(), bitmapFile)) {
-        clBitmap bmp;
-        if(bmp.LoadFile(bitmapFile, wxBITMAP_TYPE_PNG)) {
-            clRemoveFile(bitmapFile);
-            return bmp;
-        }
-        clRemoveFile(bitmapFile);
+    // Replaces any image with the same name
+    m_toolbarsBitmaps.erase(name);
+    PendingBitmap& pending = m_pendingBitmaps[name];
+    pending.data = data;
+    pending.scale = scale;
+}
+
+const wxMemoryBuffer* BitmapLoader::FindHiResImage(const ZipContent_t& content, const wxString& filepath,
+                                                   const wxMemoryBuffer* data, double& scale)
+{
+#ifndef __WXGTK__
+    if(!ShouldUseHiResImages()) { return data; }
+    wxString hiResPath = filepath.BeforeLast('.');
+    hiResPath << "@2x." << filepath.AfterLast('.');
+    ZipContent_t::const_iterator hiRes = content.find(hiResPath);
+    if(hiRes == content.end()) { return data; }
+    scale = 2.0;
+    return &hiRes->second;
+#else
+    // Under GTK, the "@2x" images are requested by name
+    return data;
+#endif
+}
+
+void BitmapLoader::doLoadManifest(const ZipContent_t& content)
+{
+    ZipContent_t::const_iterator iter = content.find("manifest.ini");
+    if(iter == content.end()) { return; }
+
+    const wxMemoryBuffer& buffer = iter->second;
+    wxString manifest((const char*)buffer.GetData(), wxConvUTF8, buffer.GetDataLen());
+
+    m_manifest.clear();
+    wxArrayString entries = wxStringTokenize(manifest, wxT("\n"), wxTOKEN_STRTOK);
+    for(size_t i = 0; i < entries.size(); i++) {
+        wxString entry = entries[i];
+        entry.Trim().Trim(false);
+
+        // empty?
+        if(entry.empty()) continue;
+
+        // comment?
+        if(entry.StartsWith(wxT(";"))) continue;
+
+        wxString key = entry.BeforeFirst(wxT('='));
+        wxString val = entry.AfterFirst(wxT('='));
+        key.Trim().Trim(false);
+        val.Trim().Trim(false);
+
+        wxString key16, key24;
+        key16 = key;
+        key24 = key;
+
+        key16.Replace(wxT("<size>"), wxT("16"));
+        key24.Replace(wxT("<size>"), wxT("24"));
+
+        key16.Replace(wxT("."), wxT("/"));
+        key24.Replace(wxT("."), wxT("/"));
+
+        m_manifest[key16] = val;
+        m_manifest[key24] = val;
     }
-    return wxNullBitmap;
 }
 
-void BitmapLoader::doLoadBitmaps()
+void BitmapLoader::doLoadBitmaps(const ZipContent_t& content)
 {
+    // The images are only decoded when they are first requested
     std::unordered_map<wxString, wxString>::iterator iter = m_manifest.begin();
     for(; iter != m_manifest.end(); iter++) {
         wxString key = iter->first;
         key = key.BeforeLast(wxT('/'));
-        m_toolbarsBitmaps[iter->first] =
-            doLoadBitmap(wxString::Format(wxT("%s/%s"), key.c_str(), iter->second.c_str()));
+
+        wxString filepath = wxString::Format(wxT("%s/%s"), key.c_str(), iter->second.c_str());
+        filepath.MakeLower();
+        ZipContent_t::const_iterator file = content.find(filepath);
+        if(file == content.end()) { continue; }
+
+        double scale = 1.0;
+        const wxMemoryBuffer* data = FindHiResImage(content, filepath, &file->second, scale);
+        AddPendingBitmap(iter->first, *data, scale);
+    }
+}
+
+void BitmapLoader::doLoadThemeBitmaps(const ZipContent_t& content)
+{
+    ZipContent_t::const_iterator iter = content.begin();
+    for(; iter != content.end(); ++iter) {
+        const wxString& filepath = iter->first;
+        if(!filepath.EndsWith(".png")) { continue; }
+
+        wxString name = wxFileName(filepath).GetName();
+        double scale = 1.0;
+        const wxMemoryBuffer* data = &iter->second;
+#ifndef __WXGTK__
+        // The hi-res images are loaded in place of their normal version
+        if(name.Contains("@2x")) { continue; }
+        data = FindHiResImage(content, filepath, data, scale);
+#endif
+        clDEBUG1() << "Adding new image:" << name << clEndl;
+        AddPendingBitmap(name, *data, scale);
     }
 }
 
@@ -177,11 +242,18 @@ void BitmapLoader::initialize()
     fn = wxFileName(clStandardPaths::Get().GetDataDir(), zipname);
 #endif
 
-    if(m_manifest.empty() || m_toolbarsBitmaps.empty()) {
+    if(m_manifest.empty() || (m_toolbarsBitmaps.empty() && m_pendingBitmaps.empty())) {
         m_zipPath = fn;
         if(m_zipPath.FileExists()) {
-            doLoadManifest();
-            doLoadBitmaps();
+            // The names in this archive are matched case insensitive
+            ZipContent_t files, content;
+            clZipReader zip(m_zipPath);
+            zip.ExtractAll(files);
+            for(ZipContent_t::iterator iter = files.begin(); iter != files.end(); ++iter) {
+                content.insert({ iter->first.Lower(), iter->second });
+            }
+            doLoadManifest(content);
+            doLoadBitmaps(content);
         }
     }
 
@@ -192,44 +264,11 @@ void BitmapLoader::initialize()
     }
 
     if(fnNewZip.FileExists()) {
+        // Read the archive into memory, the images are decoded on demand
+        ZipContent_t content;
         clZipReader zip(fnNewZip);
-        wxFileName tmpFolder(clStandardPaths::Get().GetTempDir(), "");
-
-        // Make sure we append the user name to the temporary user folder
-        // this way, multiple CodeLite instances from different users can extract the
-        // bitmaps to /tmp
-        wxString bitmapFolder = "codelite-bitmaps";
-        bitmapFolder << "." << clGetUserName();
-
-        tmpFolder.AppendDir(bitmapFolder);
-        if(tmpFolder.DirExists()) { tmpFolder.Rmdir(wxPATH_RMDIR_RECURSIVE); }
-
-        tmpFolder.Mkdir(wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
-
-        // Extract all images into this folder
-        zip.Extract("*", tmpFolder.GetPath());
-
-        // Load all the files into wxBitmap
-        wxArrayString files;
-        wxDir::GetAllFiles(tmpFolder.GetPath(), &files, "*.png");
-
-        for(size_t i = 0; i < files.size(); ++i) {
-            wxFileName pngFile(files.Item(i));
-            wxString fullpath = pngFile.GetFullPath();
-#ifndef __WXGTK__
-            if(pngFile.GetFullName().Contains("@2x")) {
-                // No need to load the hi-res images manually,
-                // this is done by wxWidgets
-                continue;
-            }
-#endif
-            clBitmap bmp;
-            if(bmp.LoadFile(fullpath, wxBITMAP_TYPE_PNG)) {
-                clDEBUG1() << "Adding new image:" << pngFile.GetName() << clEndl;
-                m_toolbarsBitmaps.erase(pngFile.GetName());
-                m_toolbarsBitmaps.insert({ pngFile.GetName(), bmp });
-            }
-        }
+        zip.ExtractAll(content);
+        doLoadThemeBitmaps(content);
     }
 
     // Create the mime-list
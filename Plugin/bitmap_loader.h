@@ -31,6 +31,7 @@
 #include "wxStringHash.h"
 #include <vector>
 #include <wx/bitmap.h>
+#include <wx/buffer.h>
 #include <wx/filename.h>
 #include <wx/imaglist.h>
 
@@ -103,9 +104,18 @@ public:
         kSort,
     };
 
+protected:
+    // A PNG file read from the archive, decoded on its first use
+    struct PendingBitmap {
+        wxMemoryBuffer data;
+        double scale = 1.0;
+    };
+    typedef std::unordered_map<wxString, wxMemoryBuffer> ZipContent_t;
+
 protected:
     wxFileName m_zipPath;
     static std::unordered_map<wxString, wxBitmap> m_toolbarsBitmaps;
+    static std::unordered_map<wxString, PendingBitmap> m_pendingBitmaps;
     static std::unordered_map<wxString, wxString> m_manifest;
     std::unordered_map<FileExtManager::FileType, int> m_fileIndexMap;
     bool m_bMapPopulated;
@@ -154,9 +164,16 @@ public:
     int GetImageIndex(int type) { return GetMimeImageId(type); }
 
 protected:
-    void doLoadManifest();
-    void doLoadBitmaps();
-    wxBitmap doLoadBitmap(const wxString& filepath);
+    void doLoadManifest(const ZipContent_t& content);
+    void doLoadBitmaps(const ZipContent_t& content);
+    void doLoadThemeBitmaps(const ZipContent_t& content);
+    void AddPendingBitmap(const wxString& name, const wxMemoryBuffer& data, double scale = 1.0);
+    /**
+     * @brief return the "@2x" version of "filepath" if this platform uses it (and set "scale" to 2), "data" otherwise
+     */
+    static const wxMemoryBuffer* FindHiResImage(const ZipContent_t& content, const wxString& filepath,
+                                                const wxMemoryBuffer* data, double& scale);
+    const wxBitmap* FindBitmap(const wxString& name);
     void CreateMimeList();
 
 private:
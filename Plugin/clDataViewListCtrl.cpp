@@ -383,6 +383,7 @@ void clDataViewListCtrl::SetSortFunction(const clSortFunc_t& CompareFunc)
 
     // Step 3: sort the children
     std::sort(children.begin(), children.end(), CompareFunc);
+    root->InvalidateRowsIndex();
 
     // Now, reconnect the children, starting with the root
     clRowEntry* prev = root;
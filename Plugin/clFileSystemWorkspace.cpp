@@ -18,6 +18,7 @@
 #include <wx/tokenzr.h>
 #include "shell_command.h"
 #include "processreaderthread.h"
+#include "fileutils.h"
 
 #define WSP_FILE_NAME "CodeLiteFS.workspace"
 
@@ -43,6 +44,11 @@ clFileSystemWorkspace::clFileSystemWorkspace(bool dummy)
         EventNotifier::Get()->Bind(wxEVT_BUILD_STARTING, &clFileSystemWorkspace::OnBuildStarting, this);
         Bind(wxEVT_ASYNC_PROCESS_TERMINATED, &clFileSystemWorkspace::OnBuildProcessTerminated, this);
         Bind(wxEVT_ASYNC_PROCESS_OUTPUT, &clFileSystemWorkspace::OnBuildProcessOutput, this);
+
+        // Changes made to the workspace folder outside of CodeLite
+        m_watcher.SetOwner(this);
+        Bind(wxEVT_FILES_MODIFIED, &clFileSystemWorkspace::OnFilesModified, this);
+        Bind(wxEVT_FILES_DELETED, &clFileSystemWorkspace::OnFilesDeleted, this);
     }
 }
 
@@ -63,6 +69,10 @@ clFileSystemWorkspace::~clFileSystemWorkspace()
         EventNotifier::Get()->Unbind(wxEVT_BUILD_STARTING, &clFileSystemWorkspace::OnBuildStarting, this);
         Unbind(wxEVT_ASYNC_PROCESS_TERMINATED, &clFileSystemWorkspace::OnBuildProcessTerminated, this);
         Unbind(wxEVT_ASYNC_PROCESS_OUTPUT, &clFileSystemWorkspace::OnBuildProcessOutput, this);
+
+        m_watcher.Clear();
+        Unbind(wxEVT_FILES_MODIFIED, &clFileSystemWorkspace::OnFilesModified, this);
+        Unbind(wxEVT_FILES_DELETED, &clFileSystemWorkspace::OnFilesDeleted, this);
     }
 }
 
@@ -258,6 +268,16 @@ void clFileSystemWorkspace::DoOpen()
     // Cache the source files from the workspace directories
     CacheFiles();
 
+    // Keep the files list and the symbols up to date with the changes made outside of CodeLite
+    // (e.g. 'git checkout'). Only supported by the native watcher (Linux)
+    wxArrayString excludeFolders;
+    excludeFolders.Add(".git");
+    excludeFolders.Add(".svn");
+    excludeFolders.Add(".codelite");
+    m_watcher.Clear();
+    m_watcher.AddTree(GetFileName().GetPath(), excludeFolders);
+    m_watcher.Start();
+
     // Load the workspace session (if any)
     CallAfter(&clFileSystemWorkspace::RestoreSession);
     m_isLoaded = true;
@@ -272,6 +292,7 @@ void clFileSystemWorkspace::DoClose()
 
     // avoid any file re-cache, we are closing
     m_fileScanNeeded = false;
+    m_watcher.Clear();
     Save();
     DoClear();
 
@@ -491,3 +512,56 @@ void clFileSystemWorkspace::DoPrintBuildMessage(const wxString& message)
     e.SetString(message);
     EventNotifier::Get()->AddPendingEvent(e);
 }
+
+void clFileSystemWorkspace::OnFilesModified(clFileSystemEvent& event)
+{
+    if(!m_isLoaded) { return; }
+
+    wxStringSet_t knownFiles;
+    for(const wxFileName& fn : m_files) {
+        knownFiles.insert(fn.GetFullPath());
+    }
+
+    // Files created or modified outside of CodeLite
+    std::vector<wxFileName> modifiedFiles;
+    for(const wxString& path : event.GetPaths()) {
+        wxFileName fn(path);
+        if(!FileUtils::WildMatch(GetFilesMask(), fn) || !fn.FileExists()) { continue; }
+        if(knownFiles.insert(fn.GetFullPath()).second) { m_files.push_back(fn); }
+        modifiedFiles.push_back(fn);
+    }
+
+    // The parser thread skips the files which content did not change (e.g. touched by 'git checkout')
+    if(!modifiedFiles.empty()) {
+        TagsManagerST::Get()->RetagFiles(modifiedFiles, TagsManager::Retag_Quick_No_Scan);
+    }
+}
+
+void clFileSystemWorkspace::OnFilesDeleted(clFileSystemEvent& event)
+{
+    if(!m_isLoaded) { return; }
+
+    // A deleted folder is reported once: remove the files under it as well
+    const wxArrayString& paths = event.GetPaths();
+    wxArrayString deletedFiles;
+    std::vector<wxFileName> files;
+    files.reserve(m_files.size());
+    for(const wxFileName& fn : m_files) {
+        wxString fullpath = fn.GetFullPath();
+        bool deleted = false;
+        for(size_t i = 0; i < paths.size() && !deleted; ++i) {
+            const wxString& path = paths.Item(i);
+            deleted = (fullpath == path) ||
+                      (fullpath.StartsWith(path) && fullpath[path.length()] == wxFileName::GetPathSeparator());
+        }
+        if(deleted) {
+            deletedFiles.Add(fullpath);
+        } else {
+            files.push_back(fn);
+        }
+    }
+
+    if(deletedFiles.IsEmpty()) { return; }
+    m_files.swap(files);
+    TagsManagerST::Get()->DeleteFilesTags(deletedFiles);
+}
@@ -10,6 +10,7 @@
 #include "clFileSystemEvent.h"
 #include "macros.h"
 #include "asyncprocess.h"
+#include "clFileSystemWatcher.h"
 
 class clFileSystemWorkspaceView;
 class WXDLLIMPEXP_SDK clFileSystemWorkspace : public IWorkspace
@@ -28,6 +29,7 @@ class WXDLLIMPEXP_SDK clFileSystemWorkspace : public IWorkspace
     size_t m_flags = 0;
     wxStringMap_t m_buildTargets;
     clFileSystemWorkspaceView* m_view = nullptr;
+    clFileSystemWatcher m_watcher;
 
 protected:
     void CacheFiles();
@@ -49,6 +51,8 @@ protected:
     void OnParseThreadScanIncludeCompleted(wxCommandEvent& event);
     void OnBuildProcessTerminated(clProcessEvent& event);
     void OnBuildProcessOutput(clProcessEvent& event);
+    void OnFilesModified(clFileSystemEvent& event);
+    void OnFilesDeleted(clFileSystemEvent& event);
 
 protected:
     bool Load(const wxFileName& file);
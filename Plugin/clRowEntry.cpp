@@ -36,6 +36,10 @@ int clRowEntry::Y_SPACER = 3;
 #define IS_OSX 0
 #endif
 
+// Folders with less children than this are scanned linearly
+#define ROWS_INDEX_MIN_CHILDREN 32
+#define LOWEST_BIT(i) ((i) & (~(i) + 1))
+
 struct clClipperHelper {
 
     bool m_used = false;
@@ -137,35 +141,45 @@ void clRowEntry::InsertChild(clRowEntry* child, clRowEntry* prev)
     child->SetIndentsCount(GetIndentsCount() + 1);
 
     // We need the last item of this subtree (prev 'this' is the root)
+    size_t where = 0;
     if(prev == nullptr) {
         // make it the first item
-        m_children.insert(m_children.begin(), child);
+        where = 0;
+    } else if(!m_children.empty() && prev == m_children.back()) {
+        // appending (AddChild), no need to search
+        where = m_children.size();
     } else {
         // Insert the item in the parent children list
-        clRowEntry::Vec_t::iterator iter = m_children.end();
-        iter = std::find_if(m_children.begin(), m_children.end(), [&](clRowEntry* c) { return c == prev; });
-        if(iter != m_children.end()) { ++iter; }
+        clRowEntry::Vec_t::iterator iter =
+            std::find_if(m_children.begin(), m_children.end(), [&](clRowEntry* c) { return c == prev; });
         // if iter is end(), than the is actually appending the item
-        m_children.insert(iter, child);
+        where = (iter == m_children.end()) ? m_children.size() : (iter - m_children.begin() + 1);
     }
+    m_children.insert(m_children.begin() + where, child);
 
     // Connect the linked list for sequential iteration
-    clRowEntry::Vec_t::iterator iterCur =
-        std::find_if(m_children.begin(), m_children.end(), [&](clRowEntry* c) { return c == child; });
-
     clRowEntry* nodeBefore = nullptr;
     // Find the item before and after
-    if(iterCur == m_children.begin()) {
+    if(where == 0) {
         nodeBefore = child->GetParent(); // "this"
     } else {
-        --iterCur;
-        clRowEntry* prevSibling = (*iterCur);
+        clRowEntry* prevSibling = m_children[where - 1];
         while(prevSibling && prevSibling->HasChildren()) {
             prevSibling = prevSibling->GetLastChild();
         }
         nodeBefore = prevSibling;
     }
     child->ConnectNodes(nodeBefore, nodeBefore->m_next);
+
+    // Appending keeps the positions of the other children, so the index is extended in place. An insertion
+    // in the middle moves the children after it and the index is rebuilt on the next query
+    if((where + 1) == m_children.size() && !m_rowsIndexDirty &&
+       (!m_rowsIndex.empty() || m_children.size() < ROWS_INDEX_MIN_CHILDREN)) {
+        AppendToRowsIndex(child);
+    } else {
+        InvalidateRowsIndex();
+    }
+    UpdateRowsCount(child, child->GetRowsCount());
 }
 
 void clRowEntry::AddChild(clRowEntry* child) { InsertChild(child, m_children.empty() ? nullptr : m_children.back()); }
@@ -181,9 +195,9 @@ void clRowEntry::DeleteChild(clRowEntry* child)
 {
     // first remove all of its children
     // do this in a while loop since 'child->RemoveChild(c);' will alter
-    // the array and will invalidate all iterators
+    // the array and will invalidate all iterators. Start from the last child, so nothing is moved
     while(!child->m_children.empty()) {
-        clRowEntry* c = child->m_children[0];
+        clRowEntry* c = child->m_children.back();
         child->DeleteChild(c);
     }
     // Connect the list
@@ -192,55 +206,138 @@ void clRowEntry::DeleteChild(clRowEntry* child)
     if(prev) { prev->m_next = next; }
     if(next) { next->m_prev = prev; }
     // Now disconnect this child from this node
-    clRowEntry::Vec_t::iterator iter =
-        std::find_if(m_children.begin(), m_children.end(), [&](clRowEntry* c) { return c == child; });
-    if(iter != m_children.end()) { m_children.erase(iter); }
+    if(child->m_indexInParent < m_children.size() && m_children[child->m_indexInParent] == child) {
+        // Removing the last child keeps the positions of the other children: the index of the first N - 1
+        // children is the index of the N children without its last node
+        bool isLast = !m_rowsIndexDirty && (child->m_indexInParent + 1) == m_children.size();
+        m_children.erase(m_children.begin() + child->m_indexInParent);
+        if(isLast) {
+            if(!m_rowsIndex.empty()) { m_rowsIndex.pop_back(); }
+        } else {
+            InvalidateRowsIndex();
+        }
+    } else {
+        clRowEntry::Vec_t::reverse_iterator iter = std::find(m_children.rbegin(), m_children.rend(), child);
+        if(iter != m_children.rend()) { m_children.erase((++iter).base()); }
+        InvalidateRowsIndex();
+    }
+    UpdateRowsCount(child, -child->GetRowsCount());
     wxDELETE(child);
 }
 
-int clRowEntry::GetExpandedLines() const
+void clRowEntry::EnsureRowsIndex()
 {
-    clRowEntry* node = const_cast<clRowEntry*>(this);
-    int counter = 0;
-    while(node) {
-        if(node->IsVisible()) { ++counter; }
-        node = node->m_next;
+    if(!m_rowsIndexDirty) { return; }
+    m_rowsIndexDirty = false;
+    for(size_t i = 0; i < m_children.size(); ++i) {
+        m_children[i]->m_indexInParent = i;
+    }
+
+    m_rowsIndex.clear();
+    if(m_children.size() < ROWS_INDEX_MIN_CHILDREN) { return; }
+
+    // Build the Fenwick tree in O(n). m_rowsIndex[i] holds the rows of the children (i - LOWEST_BIT(i), i]
+    m_rowsIndex.resize(m_children.size() + 1, 0);
+    for(size_t i = 1; i < m_rowsIndex.size(); ++i) {
+        m_rowsIndex[i] += m_children[i - 1]->GetRowsCount();
+        size_t parent = i + LOWEST_BIT(i);
+        if(parent < m_rowsIndex.size()) { m_rowsIndex[parent] += m_rowsIndex[i]; }
     }
-    return counter;
 }
 
-void clRowEntry::GetNextItems(int count, clRowEntry::Vec_t& items, bool selfIncluded)
+void clRowEntry::AppendToRowsIndex(clRowEntry* child)
 {
-    if(count <= 0) { return; }
-    items.reserve(count);
-    if(!this->IsHidden() && selfIncluded) { items.push_back(this); }
-    clRowEntry* next = GetNext();
-    while(next) {
-        if(next->IsVisible() && !next->IsHidden()) { items.push_back(next); }
-        if((int)items.size() == count) { return; }
-        next = next->GetNext();
+    child->m_indexInParent = m_children.size() - 1;
+    // Small folders are scanned linearly
+    if(m_rowsIndex.empty()) { return; }
+
+    // The new node i covers the children (i - LOWEST_BIT(i), i]: sum the ones before the new child in O(log n).
+    // The rows of the new child are added by UpdateRowsCount()
+    size_t i = m_children.size();
+    int rows = 0;
+    for(size_t j = i - 1; j > (i - LOWEST_BIT(i)); j -= LOWEST_BIT(j)) {
+        rows += m_rowsIndex[j];
     }
+    m_rowsIndex.push_back(rows);
 }
 
-void clRowEntry::GetPrevItems(int count, clRowEntry::Vec_t& items, bool selfIncluded)
+void clRowEntry::UpdateRowsCount(clRowEntry* child, int delta)
 {
-    if(count <= 0) { return; }
-    items.reserve(count);
-    if(!this->IsHidden() && selfIncluded) { items.insert(items.begin(), this); }
-    clRowEntry* prev = GetPrev();
-    while(prev) {
-        if(prev->IsVisible() && !prev->IsHidden()) { items.insert(items.begin(), prev); }
-        if((int)items.size() == count) { return; }
-        prev = prev->GetPrev();
+    clRowEntry* parent = this;
+    while(parent && delta != 0) {
+        parent->m_childrenRows += delta;
+        if(!parent->m_rowsIndexDirty && !parent->m_rowsIndex.empty()) {
+            for(size_t i = child->m_indexInParent + 1; i < parent->m_rowsIndex.size(); i += LOWEST_BIT(i)) {
+                parent->m_rowsIndex[i] += delta;
+            }
+        }
+        // a collapsed item hides the change from its ancestors
+        if(!parent->IsExpanded()) { break; }
+        child = parent;
+        parent = parent->m_parent;
     }
 }
 
-clRowEntry* clRowEntry::GetVisibleItem(int index)
+int clRowEntry::GetChildrenRowsBefore(clRowEntry* child)
+{
+    EnsureRowsIndex();
+    size_t where = child->m_indexInParent;
+    int rows = 0;
+    if(m_rowsIndex.empty()) {
+        for(size_t i = 0; i < where; ++i) {
+            rows += m_children[i]->GetRowsCount();
+        }
+    } else {
+        for(size_t i = where; i > 0; i -= LOWEST_BIT(i)) {
+            rows += m_rowsIndex[i];
+        }
+    }
+    return rows;
+}
+
+clRowEntry* clRowEntry::GetChildByRow(int& row)
+{
+    if(row < 0 || row >= m_childrenRows) { return nullptr; }
+    EnsureRowsIndex();
+    if(m_rowsIndex.empty()) {
+        for(size_t i = 0; i < m_children.size(); ++i) {
+            int rows = m_children[i]->GetRowsCount();
+            if(row < rows) { return m_children[i]; }
+            row -= rows;
+        }
+        return nullptr;
+    }
+
+    // Descend the Fenwick tree: find the number of children that end before 'row'
+    size_t count = m_children.size();
+    size_t mask = 1;
+    while((mask << 1) <= count) {
+        mask <<= 1;
+    }
+    size_t pos = 0;
+    for(; mask; mask >>= 1) {
+        size_t next = pos + mask;
+        if(next <= count && m_rowsIndex[next] <= row) {
+            pos = next;
+            row -= m_rowsIndex[next];
+        }
+    }
+    return pos < count ? m_children[pos] : nullptr;
+}
+
+clRowEntry* clRowEntry::GetNextSibling()
+{
+    if(!m_parent) { return nullptr; }
+    m_parent->EnsureRowsIndex();
+    size_t where = m_indexInParent + 1;
+    return where < m_parent->m_children.size() ? m_parent->m_children[where] : nullptr;
+}
+
+clRowEntry* clRowEntry::GetPrevSibling()
 {
-    clRowEntry::Vec_t items;
-    GetNextItems(index, items);
-    if((int)items.size() != index) { return nullptr; }
-    return items.back();
+    if(!m_parent) { return nullptr; }
+    m_parent->EnsureRowsIndex();
+    return m_indexInParent > 0 ? m_parent->m_children[m_indexInParent - 1] : nullptr;
 }
 
 void clRowEntry::UnselectAll()
@@ -261,7 +358,7 @@ bool clRowEntry::SetExpanded(bool b)
     }
 
     if(IsHidden()) {
-        // Hidden node do not fire events
+        // Hidden node do not fire events (and since they are always expanded, their rows count does not change)
         SetFlag(kNF_Expanded, b);
         return true;
     }
@@ -273,7 +370,9 @@ bool clRowEntry::SetExpanded(bool b)
     if(!b && !IsExpanded()) { return true; }
     if(!m_model->NodeExpanding(this, b)) { return false; }
 
+    int rows = GetRowsCount();
     SetFlag(kNF_Expanded, b);
+    if(m_parent) { m_parent->UpdateRowsCount(this, GetRowsCount() - rows); }
     m_model->NodeExpanded(this, b);
     return true;
 }
@@ -556,7 +655,7 @@ bool clRowEntry::IsVisible() const
 void clRowEntry::DeleteAllChildren()
 {
     while(!m_children.empty()) {
-        clRowEntry* c = m_children[0];
+        clRowEntry* c = m_children.back();
         // DeleteChild will remove it from the array
         DeleteChild(c);
     }
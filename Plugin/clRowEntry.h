@@ -69,6 +69,10 @@ protected:
     wxRect m_rowRect;
     wxRect m_buttonRect;
     clMatchResult m_higlightInfo;
+    int m_childrenRows = 0;          // number of rows the children take when this item is expanded
+    size_t m_indexInParent = 0;      // valid while the parent's rows index is up to date
+    std::vector<int> m_rowsIndex;    // Fenwick tree over the children rows, only built for large folders
+    bool m_rowsIndexDirty = true;
 
 protected:
     void SetFlag(clTreeCtrlNodeFlags flag, bool b)
@@ -83,9 +87,17 @@ protected:
     bool HasFlag(clTreeCtrlNodeFlags flag) const { return m_flags & flag; }
 
     /**
-     * @brief return the nth visible item
+     * @brief rebuild the children positions and the rows index, if needed
      */
-    clRowEntry* GetVisibleItem(int index);
+    void EnsureRowsIndex();
+    /**
+     * @brief 'child' was just appended to the children, extend the rows index without rebuilding it
+     */
+    void AppendToRowsIndex(clRowEntry* child);
+    /**
+     * @brief the number of rows of 'child' changed by 'delta', update this item and its ancestors
+     */
+    void UpdateRowsCount(clRowEntry* child, int delta);
     clCellValue& GetColumn(size_t col = 0);
     const clCellValue& GetColumn(size_t col = 0) const;
     void DrawSimpleSelection(wxWindow* win, wxDC& dc, const wxRect& rect, const clColours& colours);
@@ -211,9 +223,30 @@ public:
         this->m_clientObject = clientData;
     }
     size_t GetChildrenCount(bool recurse) const;
-    int GetExpandedLines() const;
-    void GetNextItems(int count, clRowEntry::Vec_t& items, bool selfIncluded = true);
-    void GetPrevItems(int count, clRowEntry::Vec_t& items, bool selfIncluded = true);
+
+    /**
+     * @brief number of rows this item and its visible descendants take on screen
+     */
+    int GetRowsCount() const { return (IsHidden() ? 0 : 1) + (IsExpanded() ? m_childrenRows : 0); }
+
+    /**
+     * @brief number of rows taken by the children placed before 'child'
+     */
+    int GetChildrenRowsBefore(clRowEntry* child);
+
+    /**
+     * @brief return the child that holds the row 'row' (counted from the first child's row)
+     * On return, 'row' is relative to the returned child
+     */
+    clRowEntry* GetChildByRow(int& row);
+
+    clRowEntry* GetNextSibling();
+    clRowEntry* GetPrevSibling();
+
+    /**
+     * @brief must be called after the children were re-ordered directly (e.g. sorted)
+     */
+    void InvalidateRowsIndex() { m_rowsIndexDirty = true; }
     void SetIndentsCount(int count) { this->m_indentsCount = count; }
     int GetIndentsCount() const { return m_indentsCount; }
 
@@ -1,6 +1,7 @@
 #include "clTreeCtrl.h"
 #include "clTreeCtrlModel.h"
 #include <algorithm>
+#include <cstdlib>
 #include <wx/dc.h>
 #include <wx/settings.h>
 #include <wx/treebase.h>
@@ -29,14 +30,28 @@ clTreeCtrlModel::~clTreeCtrlModel()
 
 void clTreeCtrlModel::GetNextItems(clRowEntry* from, int count, clRowEntry::Vec_t& items, bool selfIncluded) const
 {
-    if(count < 0) { count = 0; }
+    if(count <= 0) { return; }
     items.reserve(count);
-    return from->GetNextItems(count, items, selfIncluded);
+    if(!from->IsHidden() && selfIncluded) { items.push_back(from); }
+    clRowEntry* next = GetRowAfter(from, true);
+    while(next && ((int)items.size() < count)) {
+        items.push_back(next);
+        next = GetRowAfter(next, true);
+    }
 }
 
 void clTreeCtrlModel::GetPrevItems(clRowEntry* from, int count, clRowEntry::Vec_t& items, bool selfIncluded) const
 {
-    return from->GetPrevItems(count, items, selfIncluded);
+    if(count <= 0) { return; }
+    items.reserve(count);
+    // Collect the items backward, then restore their order
+    if(!from->IsHidden() && selfIncluded) { items.push_back(from); }
+    clRowEntry* prev = GetRowBefore(from, true);
+    while(prev && ((int)items.size() < count)) {
+        items.push_back(prev);
+        prev = GetRowBefore(prev, true);
+    }
+    std::reverse(items.begin(), items.end());
 }
 
 wxTreeItemId clTreeCtrlModel::AddRoot(const wxString& text, int image, int selImage, wxTreeItemData* data)
@@ -299,14 +314,19 @@ int clTreeCtrlModel::GetItemIndex(clRowEntry* item) const
 {
     if(item == NULL) { return wxNOT_FOUND; }
     if(!m_root) { return wxNOT_FOUND; }
-    int counter = 0;
-    clRowEntry* current = m_root;
-    while(current) {
-        if(current == item) { return counter; }
-        if(current->IsVisible()) { ++counter; }
-        current = current->GetNext();
+
+    // Sum the rows placed before the item, one level at a time
+    int rows = 0;
+    clRowEntry* child = item;
+    clRowEntry* parent = item->GetParent();
+    while(parent) {
+        // a collapsed item hides all of its descendants
+        rows = parent->IsExpanded() ? (rows + parent->GetChildrenRowsBefore(child)) : 0;
+        if(!parent->IsHidden()) { ++rows; }
+        child = parent;
+        parent = parent->GetParent();
     }
-    return wxNOT_FOUND;
+    return (child == m_root) ? rows : wxNOT_FOUND;
 }
 
 bool clTreeCtrlModel::GetRange(clRowEntry* from, clRowEntry* to, clRowEntry::Vec_t& items) const
@@ -332,13 +352,11 @@ bool clTreeCtrlModel::GetRange(clRowEntry* from, clRowEntry* to, clRowEntry::Vec
     clRowEntry* start_item = index1 > index2 ? to : from;
     clRowEntry* end_item = index1 > index2 ? from : to;
     clRowEntry* current = start_item;
-    while(current) {
-        if(current == end_item) {
-            items.push_back(current);
-            break;
-        }
-        if(current->IsVisible()) { items.push_back(current); }
-        current = current->GetNext();
+    if(current->IsVisible()) { items.push_back(current); }
+    int count = std::abs(index2 - index1);
+    while(current && (current != end_item) && (count-- > 0)) {
+        current = GetRowAfter(current, true);
+        if(current) { items.push_back(current); }
     }
     return true;
 }
@@ -346,19 +364,24 @@ bool clTreeCtrlModel::GetRange(clRowEntry* from, clRowEntry* to, clRowEntry::Vec
 size_t clTreeCtrlModel::GetExpandedLines() const
 {
     if(!GetRoot()) { return 0; }
-    return m_root->GetExpandedLines();
+    return m_root->GetRowsCount();
 }
 
 clRowEntry* clTreeCtrlModel::GetItemFromIndex(int index) const
 {
     if(index < 0) { return nullptr; }
     if(!m_root) { return nullptr; }
-    int curIndex = -1;
+
+    // Descend from the root, picking the child that holds the requested row
+    int row = index;
     clRowEntry* current = m_root;
     while(current) {
-        if(current->IsVisible()) { ++curIndex; }
-        if(curIndex == index) { return current; }
-        current = current->GetNext();
+        if(!current->IsHidden()) {
+            if(row == 0) { return current; }
+            --row;
+        }
+        if(!current->IsExpanded()) { return nullptr; }
+        current = current->GetChildByRow(row);
     }
     return nullptr;
 }
@@ -373,46 +396,9 @@ void clTreeCtrlModel::SelectChildren(const wxTreeItemId& item)
                   [&](clRowEntry* child) { AddSelection(wxTreeItemId(child)); });
 }
 
-clRowEntry* clTreeCtrlModel::GetNextSibling(clRowEntry* item) const
-{
-    if(!item->GetParent()) { return nullptr; }
-    const clRowEntry::Vec_t& children = item->GetParent()->GetChildren();
-    if(children.empty()) { return nullptr; }
-    size_t where = -1;
-    for(size_t i = 0; i < children.size(); ++i) {
-        if(item == children[i]) {
-            where = i;
-            break;
-        }
-    }
-
-    // if we couldnt find 'item' in the children list or if it's the last child
-    // return nullptr
-    if((where == (size_t)-1) || (where == (children.size() - 1))) { return nullptr; }
-    ++where;
-    return children[where];
-}
-
-clRowEntry* clTreeCtrlModel::GetPrevSibling(clRowEntry* item) const
-{
-    if(!item->GetParent()) { return nullptr; }
-    const clRowEntry::Vec_t& children = item->GetParent()->GetChildren();
-    if(children.empty()) { return nullptr; }
-    size_t where = -1;
-    for(size_t i = 0; i < children.size(); ++i) {
-        if(item == children[i]) {
-            where = i;
-            break;
-        }
-    }
+clRowEntry* clTreeCtrlModel::GetNextSibling(clRowEntry* item) const { return item->GetNextSibling(); }
 
-    // if we couldnt find item in the children list or if it's the first child
-    // we return nullptr
-    if((where == (size_t)-1) || (where == (size_t)0)) { return nullptr; }
-
-    --where;
-    return children[where];
-}
+clRowEntry* clTreeCtrlModel::GetPrevSibling(clRowEntry* item) const { return item->GetPrevSibling(); }
 
 void clTreeCtrlModel::AddSelection(const wxTreeItemId& item)
 {
@@ -483,28 +469,44 @@ clRowEntry* clTreeCtrlModel::GetRowBefore(clRowEntry* item, bool visibleItem) co
 {
     clRowEntry* curp = item;
     if(!curp) { return nullptr; }
-    curp = curp->GetPrev();
-    while(curp) {
-        if(visibleItem && !curp->IsVisible()) {
-            curp = curp->GetPrev();
-            continue;
-        }
-        break;
+    if(!visibleItem) { return curp->GetPrev(); }
+
+    if(!curp->IsVisible()) {
+        // the last visible row placed before the item
+        int index = GetItemIndex(curp);
+        return (index > 0) ? GetItemFromIndex(index - 1) : nullptr;
     }
-    return curp;
+
+    // The deepest visible descendant of the previous sibling, or the parent
+    clRowEntry* sibling = curp->GetPrevSibling();
+    if(!sibling) {
+        clRowEntry* parent = curp->GetParent();
+        return (parent && !parent->IsHidden()) ? parent : nullptr;
+    }
+    while(sibling->IsExpanded() && sibling->HasChildren()) {
+        sibling = sibling->GetLastChild();
+    }
+    return sibling;
 }
 
 clRowEntry* clTreeCtrlModel::GetRowAfter(clRowEntry* item, bool visibleItem) const
 {
     clRowEntry* curp = item;
     if(!curp) { return nullptr; }
-    curp = curp->GetNext();
+    if(!visibleItem) { return curp->GetNext(); }
+
+    if(!curp->IsVisible()) {
+        // the number of visible rows before the item is also the index of the first visible row after it
+        int index = GetItemIndex(curp);
+        return (index != wxNOT_FOUND) ? GetItemFromIndex(index) : nullptr;
+    }
+
+    // The first child, or the next sibling of the item or of its closest ancestor that has one
+    if(curp->IsExpanded() && curp->HasChildren()) { return curp->GetFirstChild(); }
     while(curp) {
-        if(visibleItem && !curp->IsVisible()) {
-            curp = curp->GetNext();
-            continue;
-        }
-        break;
+        clRowEntry* sibling = curp->GetNextSibling();
+        if(sibling) { return sibling; }
+        curp = curp->GetParent();
     }
-    return curp;
+    return nullptr;
 }
@@ -85,3 +85,29 @@ void clZipReader::ExtractAll(const wxString& directory)
         entry = m_zip->GetNextEntry();
     }
 }
+
+void clZipReader::ExtractAll(std::unordered_map<wxString, wxMemoryBuffer>& files)
+{
+    wxZipEntry* entry(NULL);
+    char chunk[16 * 1024];
+
+    entry = m_zip->GetNextEntry();
+    while(entry) {
+        if(!entry->IsDir()) {
+            wxString name = entry->GetName();
+            name.Replace("\\", "/");
+
+            wxMemoryBuffer content;
+            if(entry->GetSize() > 0) { content.SetBufSize(entry->GetSize()); }
+            while(m_zip->CanRead()) {
+                m_zip->Read(chunk, sizeof(chunk));
+                size_t len = m_zip->LastRead();
+                if(len == 0) { break; }
+                content.AppendData(chunk, len);
+            }
+            files[name] = content;
+        }
+        wxDELETE(entry);
+        entry = m_zip->GetNextEntry();
+    }
+}
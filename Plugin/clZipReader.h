@@ -27,6 +27,9 @@
 #define CLZIP_H
 
 #include "codelite_exports.h"
+#include "wxStringHash.h"
+#include <unordered_map>
+#include <wx/buffer.h>
 #include <wx/zipstrm.h>
 #include <wx/wfstream.h>
 #include <wx/stream.h>
@@ -52,6 +55,12 @@ public:
      * @brief extract the entire content of a zip archive into a directory
      */
     void ExtractAll(const wxString &directory);
+
+    /**
+     * @brief read the content of all the files in the archive into memory, without writing them to the disk
+     * @param files [output] entry name (using '/' as the path separator) -> file content
+     */
+    void ExtractAll(std::unordered_map<wxString, wxMemoryBuffer>& files);
     
     /**
      * @brief close the zip archive
@@ -31,6 +31,7 @@
 #include "globals.h"
 #include "localworkspace.h"
 #include "macros.h"
+#include "performance.h"
 #include "plugin.h"
 #include "project.h"
 #include "workspace.h"
@@ -111,6 +112,7 @@ bool clCxxWorkspace::OpenReadOnly(const wxString& fileName, wxString& errMsg)
 
 bool clCxxWorkspace::OpenWorkspace(const wxString& fileName, wxString& errMsg)
 {
+    CL_TRACE_SCOPE("clCxxWorkspace::OpenWorkspace");
     if(!DoLoadWorkspace(fileName, errMsg)) { return false; }
 
     // Notify about active project changed
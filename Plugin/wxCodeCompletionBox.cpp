@@ -22,12 +22,124 @@
 #include "imanager.h"
 #include <wx/display.h>
 #include "ColoursAndFontsManager.h"
+#include <algorithm>
+#include <climits>
 
 static int LINES_PER_PAGE = 8;
 static int Y_SPACER = 2;
 static int SCROLLBAR_WIDTH = 12;
 static int BOX_WIDTH = 400 + SCROLLBAR_WIDTH;
 
+// Number of matches ordered when the filter changes, the rest is ordered only if the user scrolls that far
+#define FILTER_TOP_K 256
+
+namespace
+{
+// Match tiers, in the order they are displayed
+enum eMatchTier {
+    kTierExact = 0,
+    kTierExactNoCase,
+    kTierStartsWith,
+    kTierStartsWithNoCase,
+    kTierContains,
+    kTierContainsNoCase,
+    kTierFuzzy,
+};
+
+// Fuzzy scoring (similar to fzf / Sublime Text): every matched character is worth SCORE_MATCH, with a bonus
+// when it starts a word and when it follows the previous match. Gaps between the matches are penalised
+#define SCORE_MATCH 16
+#define SCORE_EXACT_CASE 1
+#define SCORE_CONSECUTIVE 6
+#define SCORE_GAP_START 3 // each additional character of the gap costs 1
+#define SCORE_LEADING_MAX 3
+#define BONUS_FIRST_CHAR 10
+#define BONUS_WORD_START 8
+#define BONUS_CAMEL_HUMP 7
+
+std::string ComputeBonus(const std::wstring& text)
+{
+    std::string bonus(text.length(), 0);
+    for(size_t i = 0; i < text.length(); ++i) {
+        wchar_t ch = text[i];
+        if(i == 0) {
+            bonus[i] = BONUS_FIRST_CHAR;
+        } else {
+            wchar_t prev = text[i - 1];
+            if(!wxIsalnum(prev) && wxIsalnum(ch)) {
+                bonus[i] = BONUS_WORD_START;
+            } else if(wxIsupper(ch) && (wxIslower(prev) || wxIsdigit(prev))) {
+                bonus[i] = BONUS_CAMEL_HUMP;
+            }
+        }
+    }
+    return bonus;
+}
+
+bool IsSubsequence(const std::wstring& lcText, const std::wstring& lcFilter)
+{
+    size_t j = 0;
+    for(size_t i = 0; i < lcText.length() && j < lcFilter.length(); ++i) {
+        if(lcText[i] == lcFilter[j]) { ++j; }
+    }
+    return j == lcFilter.length();
+}
+
+/**
+ * @brief return the best score of all the ways 'filter' can be matched as a subsequence of 'text'
+ * Call it only after IsSubsequence() returned true
+ */
+int FuzzyScore(const std::wstring& text, const std::wstring& lcText, const std::string& bonus,
+               const std::wstring& filter, const std::wstring& lcFilter, std::vector<int>& prevRow,
+               std::vector<int>& curRow)
+{
+    const int NONE = INT_MIN / 2;
+    size_t n = lcText.length();
+    size_t m = lcFilter.length();
+    prevRow.assign(n, NONE);
+    curRow.assign(n, NONE);
+
+    // row[j]: the best score with the current filter character matched at text[j]
+    for(size_t j = 0; j < n; ++j) {
+        if(lcText[j] != lcFilter[0]) { continue; }
+        prevRow[j] = SCORE_MATCH + bonus[j] + (text[j] == filter[0] ? SCORE_EXACT_CASE : 0) -
+                     std::min((int)j, SCORE_LEADING_MAX);
+    }
+
+    for(size_t i = 1; i < m; ++i) {
+        // best of (prevRow[k] + k) for k <= j - 2, to compute the gap penalty in O(1)
+        int bestBeforeGap = NONE;
+        for(size_t j = 0; j < n; ++j) {
+            if(j >= 2 && prevRow[j - 2] != NONE) {
+                bestBeforeGap = std::max(bestBeforeGap, prevRow[j - 2] + (int)j - 2);
+            }
+            curRow[j] = NONE;
+            if(j < i || lcText[j] != lcFilter[i]) { continue; }
+
+            int best = NONE;
+            if(prevRow[j - 1] != NONE) { best = prevRow[j - 1] + SCORE_CONSECUTIVE; }
+            if(bestBeforeGap != NONE) {
+                // a gap of (j - k - 1) characters costs SCORE_GAP_START + (j - k - 2)
+                best = std::max(best, bestBeforeGap - (int)j + 2 - SCORE_GAP_START);
+            }
+            if(best == NONE) { continue; }
+            curRow[j] = best + SCORE_MATCH + bonus[j] + (text[j] == filter[i] ? SCORE_EXACT_CASE : 0);
+        }
+        prevRow.swap(curRow);
+    }
+    return *std::max_element(prevRow.begin(), prevRow.end());
+}
+
+struct MatchSorter {
+    template <typename T> bool operator()(const T& a, const T& b) const
+    {
+        if(a.tier != b.tier) { return a.tier < b.tier; }
+        if(a.score != b.score) { return a.score > b.score; }
+        return a.index < b.index;
+    }
+};
+} // namespace
+
 wxCodeCompletionBox::BmpVec_t wxCodeCompletionBox::m_defaultBitmaps;
 
 wxCodeCompletionBox::wxCodeCompletionBox(wxWindow* parent, wxEvtHandler* eventObject, size_t flags)
@@ -226,6 +338,7 @@ void wxCodeCompletionBox::OnPaint(wxPaintEvent& event)
     int firstIndex = m_index;
     int lastIndex = m_index + LINES_PER_PAGE;
     if(lastIndex > (int)m_entries.size()) { lastIndex = m_entries.size(); }
+    EnsureSorted(lastIndex);
 
     // if the number of items to display is less from the number of lines
     // on the box, try prepending items from the top
@@ -330,6 +443,7 @@ void wxCodeCompletionBox::ShowCompletionBox(wxStyledTextCtrl* ctrl, const wxCode
     }
     // Filter all duplicate entries from the list (based on simple string match)
     RemoveDuplicateEntries();
+    BuildFilterKeys();
 
     // Filter results based on user input
     FilterResults();
@@ -483,52 +597,98 @@ bool wxCodeCompletionBox::FilterResults()
     wxString word = GetFilter();
     if(word.IsEmpty()) {
         m_entries = m_allEntries;
+        m_matches.clear();
+        m_lastFilter.clear();
+        m_sortedCount = m_entries.size();
         return false;
     }
 
-    m_entries.clear();
-    wxString lcFilter = word.Lower();
-    // Smart sorting:
-    // We preare the list of matches in the following order:
-    // Exact matches
-    // Starts with
-    // Contains
-    wxCodeCompletionBoxEntry::Vec_t exactMatches, exactMatchesI, startsWith, startsWithI, contains, containsI;
-    for(size_t i = 0; i < m_allEntries.size(); ++i) {
-        wxString entryText = m_allEntries.at(i)->GetText().BeforeFirst('(');
-        entryText.Trim().Trim(false);
-        wxString lcEntryText = entryText.Lower();
-
-        // Exact match:
-        if(word == entryText) {
-            exactMatches.push_back(m_allEntries.at(i));
-
-        } else if(lcEntryText == lcFilter) {
-            exactMatchesI.push_back(m_allEntries.at(i));
-
-        } else if(entryText.StartsWith(word)) {
-            startsWith.push_back(m_allEntries.at(i));
+    if(m_filterKeys.size() != m_allEntries.size()) { BuildFilterKeys(); }
+
+    std::wstring filter = word.ToStdWstring();
+    std::wstring lcFilter = word.Lower().ToStdWstring();
+
+    // When the user only added characters to the filter, the new matches are a subset of the previous ones
+    bool narrowing = !m_lastFilter.IsEmpty() && word.StartsWith(m_lastFilter);
+    size_t candidates = narrowing ? m_matches.size() : m_filterKeys.size();
+
+    std::vector<FilterMatch> matches;
+    std::vector<int> prevRow, curRow;
+    bool hasPrefixMatch = false;
+    for(size_t i = 0; i < candidates; ++i) {
+        size_t index = narrowing ? m_matches[i].index : i;
+        const FilterKey& key = m_filterKeys[index];
+
+        // Smart sorting:
+        // We prepare the list of matches in the following order:
+        // Exact matches
+        // Starts with
+        // Contains
+        // Fuzzy matches
+        // The case sensitive matches come first in each group
+        FilterMatch match;
+        match.index = index;
+        if(key.text == filter) {
+            match.tier = kTierExact;
+        } else if(key.lcText == lcFilter) {
+            match.tier = kTierExactNoCase;
+        } else if(key.text.compare(0, filter.length(), filter) == 0) {
+            match.tier = kTierStartsWith;
+        } else if(key.lcText.compare(0, lcFilter.length(), lcFilter) == 0) {
+            match.tier = kTierStartsWithNoCase;
+        } else if(key.text.find(filter) != std::wstring::npos) {
+            match.tier = kTierContains;
+        } else if(key.lcText.find(lcFilter) != std::wstring::npos) {
+            match.tier = kTierContainsNoCase;
+        } else if(IsSubsequence(key.lcText, lcFilter)) {
+            match.tier = kTierFuzzy;
+        } else {
+            continue;
+        }
+        match.score = FuzzyScore(key.text, key.lcText, key.bonus, filter, lcFilter, prevRow, curRow);
+        if(match.tier <= kTierStartsWithNoCase) { hasPrefixMatch = true; }
+        matches.push_back(match);
+    }
 
-        } else if(lcEntryText.StartsWith(lcFilter)) {
-            startsWithI.push_back(m_allEntries.at(i));
+    // Order the top matches only, the rest is ordered on demand (see EnsureSorted)
+    m_sortedCount = std::min(matches.size(), (size_t)FILTER_TOP_K);
+    std::partial_sort(matches.begin(), matches.begin() + m_sortedCount, matches.end(), MatchSorter());
 
-        } else if(entryText.Contains(word)) {
-            contains.push_back(m_allEntries.at(i));
+    m_matches.swap(matches);
+    m_lastFilter = word;
+    m_entries.clear();
+    m_entries.reserve(m_matches.size());
+    for(size_t i = 0; i < m_matches.size(); ++i) {
+        m_entries.push_back(m_allEntries[m_matches[i].index]);
+    }
+    m_index = 0;
+    return !hasPrefixMatch;
+}
 
-        } else if(lcEntryText.Contains(lcFilter)) {
-            containsI.push_back(m_allEntries.at(i));
-        }
+void wxCodeCompletionBox::EnsureSorted(size_t count)
+{
+    if(count <= m_sortedCount || m_sortedCount >= m_matches.size()) { return; }
+    std::sort(m_matches.begin() + m_sortedCount, m_matches.end(), MatchSorter());
+    for(size_t i = m_sortedCount; i < m_matches.size(); ++i) {
+        m_entries[i] = m_allEntries[m_matches[i].index];
     }
+    m_sortedCount = m_matches.size();
+}
 
-    // Merge the results
-    m_entries.insert(m_entries.end(), exactMatches.begin(), exactMatches.end());
-    m_entries.insert(m_entries.end(), exactMatchesI.begin(), exactMatchesI.end());
-    m_entries.insert(m_entries.end(), startsWith.begin(), startsWith.end());
-    m_entries.insert(m_entries.end(), startsWithI.begin(), startsWithI.end());
-    m_entries.insert(m_entries.end(), contains.begin(), contains.end());
-    m_entries.insert(m_entries.end(), containsI.begin(), containsI.end());
-    m_index = 0;
-    return exactMatches.empty() && exactMatchesI.empty() && startsWith.empty() && startsWithI.empty();
+void wxCodeCompletionBox::BuildFilterKeys()
+{
+    m_filterKeys.clear();
+    m_filterKeys.resize(m_allEntries.size());
+    for(size_t i = 0; i < m_allEntries.size(); ++i) {
+        wxString entryText = m_allEntries[i]->GetText().BeforeFirst('(');
+        entryText.Trim().Trim(false);
+        FilterKey& key = m_filterKeys[i];
+        key.text = entryText.ToStdWstring();
+        key.lcText = entryText.Lower().ToStdWstring();
+        key.bonus = ComputeBonus(key.text);
+    }
+    m_matches.clear();
+    m_lastFilter.clear();
 }
 
 void wxCodeCompletionBox::InsertSelection()
@@ -32,6 +32,7 @@
 #include <wx/sharedptr.h>
 #include <vector>
 #include <list>
+#include <string>
 #include <wx/bitmap.h>
 #include <wx/stc/stc.h>
 #include <wx/font.h>
@@ -59,9 +60,28 @@ public:
         kNoShowingEvent = (1 << 2), // Dont send the wxEVT_CCBOX_SHOWING event
     };
 
+protected:
+    // The text used for filtering an entry, computed once per entry
+    struct FilterKey {
+        std::wstring text;   // the entry text, up to the first '('
+        std::wstring lcText; // lower case version of 'text'
+        std::string bonus;   // per character bonus: start of word, camel hump
+    };
+
+    // An entry that matched the filter
+    struct FilterMatch {
+        int tier;     // exact, starts with, contains, fuzzy (case sensitive first)
+        int score;    // fuzzy score, higher is better
+        size_t index; // index in m_allEntries
+    };
+
 protected:
     wxCodeCompletionBoxEntry::Vec_t m_allEntries;
     wxCodeCompletionBoxEntry::Vec_t m_entries;
+    std::vector<FilterKey> m_filterKeys;    // same order as m_allEntries
+    std::vector<FilterMatch> m_matches;     // the matches of m_lastFilter, same order as m_entries
+    wxString m_lastFilter;
+    size_t m_sortedCount = 0;               // m_entries is ordered up to this index
     wxCodeCompletionBox::BmpVec_t m_bitmaps;
     static wxCodeCompletionBox::BmpVec_t m_defaultBitmaps;
     std::unordered_map<int, int> m_lspCompletionItemImageIndexMap;
@@ -178,6 +198,14 @@ protected:
      */
     bool FilterResults();
     void RemoveDuplicateEntries();
+    /**
+     * @brief compute the filter keys of m_allEntries. Must be called whenever m_allEntries is modified
+     */
+    void BuildFilterKeys();
+    /**
+     * @brief make sure that the first 'count' entries of m_entries are ordered
+     */
+    void EnsureSorted(size_t count);
     void InsertSelection();
     wxString GetFilter();
 
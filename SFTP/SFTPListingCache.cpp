@@ -0,0 +1,110 @@
+#include "SFTPListingCache.h"
+
+// For how long (seconds) a listing is used without checking the folder
+#define LISTING_TTL 30
+
+// Upper limit for the number of folders, the cache is cleared when it is reached
+#define MAX_LISTING_CACHE_ENTRIES 2000
+
+SFTPListingCache::SFTPListingCache() {}
+
+SFTPListingCache::~SFTPListingCache() {}
+
+SFTPListingCache::Listing::Ptr_t SFTPListingCache::MakeListing(const SFTPAttribute::List_t& attributes)
+{
+    std::shared_ptr<Listing> listing(new Listing());
+    listing->entries.reserve(attributes.size());
+    SFTPAttribute::List_t::const_iterator iter = attributes.begin();
+    for(; iter != attributes.end(); ++iter) {
+        SFTPAttribute::Ptr_t attr = (*iter);
+        if(attr->GetName() == ".") {
+            // The folder itself
+            listing->modificationTime = attr->GetModificationTime();
+            continue;
+        }
+        if(attr->GetName() == "..") { continue; }
+
+        Entry entry;
+        entry.name = attr->GetName();
+        entry.symlinkPath = attr->GetSymlinkPath();
+        if(attr->IsFolder()) { entry.flags |= SFTPAttribute::TYPE_FOLDER; }
+        if(attr->IsFile()) { entry.flags |= SFTPAttribute::TYPE_REGULAR_FILE; }
+        if(attr->IsSymlink()) { entry.flags |= SFTPAttribute::TYPE_SYMBLINK; }
+        listing->entries.push_back(entry);
+    }
+    return listing;
+}
+
+wxString SFTPListingCache::MakeKey(const wxString& folder)
+{
+    wxString key = folder;
+    while(key.Replace("//", "/")) {}
+    if(key.length() > 1 && key.EndsWith("/")) { key.RemoveLast(); }
+    return key;
+}
+
+SFTPListingCache::Listing::Ptr_t SFTPListingCache::Find(const wxString& folder, bool& fresh)
+{
+    fresh = false;
+    std::lock_guard<std::mutex> guard(m_lock);
+    std::unordered_map<wxString, Record>::iterator iter = m_records.find(MakeKey(folder));
+    if(iter == m_records.end()) { return Listing::Ptr_t(); }
+    fresh = (time(NULL) - iter->second.fetched) < LISTING_TTL;
+    return iter->second.listing;
+}
+
+bool SFTPListingCache::IsValid(const wxString& folder, Listing::Ptr_t listing, size_t modificationTime)
+{
+    if(!listing || listing->modificationTime == 0 || listing->modificationTime != modificationTime) { return false; }
+
+    std::lock_guard<std::mutex> guard(m_lock);
+    std::unordered_map<wxString, Record>::iterator iter = m_records.find(MakeKey(folder));
+    if(iter == m_records.end() || iter->second.listing != listing) { return false; }
+    // The modification time has a one second resolution: a change made during the second the listing was
+    // fetched goes unnoticed
+    return (time_t)modificationTime < iter->second.fetched;
+}
+
+void SFTPListingCache::Touch(const wxString& folder)
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    std::unordered_map<wxString, Record>::iterator iter = m_records.find(MakeKey(folder));
+    if(iter != m_records.end()) { iter->second.fetched = time(NULL); }
+}
+
+size_t SFTPListingCache::GetStamp()
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    return m_invalidations;
+}
+
+void SFTPListingCache::Store(const wxString& folder, Listing::Ptr_t listing, size_t stamp)
+{
+    Record record;
+    record.listing = listing;
+    record.fetched = time(NULL);
+
+    std::lock_guard<std::mutex> guard(m_lock);
+    if(stamp != m_invalidations) { return; }
+    if(m_records.size() >= MAX_LISTING_CACHE_ENTRIES) { m_records.clear(); }
+    m_records[MakeKey(folder)] = record;
+}
+
+void SFTPListingCache::Invalidate(const wxString& folder, bool recursive)
+{
+    wxString key = MakeKey(folder);
+    std::lock_guard<std::mutex> guard(m_lock);
+    ++m_invalidations;
+    m_records.erase(key);
+    if(!recursive) { return; }
+
+    wxString prefix = key == "/" ? key : key + "/";
+    std::unordered_map<wxString, Record>::iterator iter = m_records.begin();
+    while(iter != m_records.end()) {
+        if(iter->first.StartsWith(prefix)) {
+            iter = m_records.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+}
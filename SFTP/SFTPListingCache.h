@@ -0,0 +1,101 @@
+#ifndef SFTPLISTINGCACHE_H
+#define SFTPLISTINGCACHE_H
+
+#include "cl_sftp_attribute.h"
+#include "wxStringHash.h"
+#include <memory>
+#include <mutex>
+#include <time.h>
+#include <unordered_map>
+#include <vector>
+#include <wx/string.h>
+
+/**
+ * @class SFTPListingCache
+ * @brief the content of the remote folders already listed by the SFTP tree view.
+ *
+ * A listing is used as is for a few seconds after it was fetched. Past that, it is still used if the folder
+ * modification time did not change, which costs a single stat instead of a full listing.
+ * The listings are immutable and the cache is thread safe: the prefetch thread fills it while the UI reads it.
+ * The cache is shared with the prefetch thread, which may still be running once its session is closed
+ */
+class SFTPListingCache
+{
+public:
+    struct Entry {
+        wxString name;
+        wxString symlinkPath;
+        size_t flags = 0; // SFTPAttribute::TYPE_*
+        bool IsFolder() const { return flags & SFTPAttribute::TYPE_FOLDER; }
+        bool IsFile() const { return flags & SFTPAttribute::TYPE_REGULAR_FILE; }
+        bool IsSymlink() const { return flags & SFTPAttribute::TYPE_SYMBLINK; }
+    };
+
+    struct Listing {
+        // The folder entries, without "." and ".."
+        std::vector<Entry> entries;
+        // The folder modification time, 0 if unknown
+        size_t modificationTime = 0;
+        typedef std::shared_ptr<const Listing> Ptr_t;
+    };
+
+protected:
+    struct Record {
+        Listing::Ptr_t listing;
+        time_t fetched = 0;
+    };
+    std::unordered_map<wxString, Record> m_records;
+    size_t m_invalidations = 0;
+    std::mutex m_lock;
+
+public:
+    typedef std::shared_ptr<SFTPListingCache> Ptr_t;
+
+    SFTPListingCache();
+    virtual ~SFTPListingCache();
+
+    /**
+     * @brief build a listing from the result of clSFTP::List
+     */
+    static Listing::Ptr_t MakeListing(const SFTPAttribute::List_t& attributes);
+
+    /**
+     * @brief the key of a remote folder: no double slashes and no trailing slash
+     */
+    static wxString MakeKey(const wxString& folder);
+
+    /**
+     * @brief return the listing of "folder", null if it was never fetched or was invalidated
+     * @param fresh set to true if the listing is recent enough to be used without checking the folder
+     */
+    Listing::Ptr_t Find(const wxString& folder, bool& fresh);
+
+    /**
+     * @brief can "listing" be validated by comparing the folder modification time with "modificationTime"?
+     */
+    bool IsValid(const wxString& folder, Listing::Ptr_t listing, size_t modificationTime);
+
+    /**
+     * @brief mark the listing of "folder" as fetched now
+     */
+    void Touch(const wxString& folder);
+
+    /**
+     * @brief a stamp to pass to Store(): take it before listing the folder
+     */
+    size_t GetStamp();
+
+    /**
+     * @brief add (or replace) the listing of "folder". The listing is dropped if the cache was invalidated
+     * since "stamp" was taken: it may have been fetched before the change
+     */
+    void Store(const wxString& folder, Listing::Ptr_t listing, size_t stamp);
+
+    /**
+     * @brief forget the listing of "folder", call this after modifying the folder content
+     * @param recursive forget the listings of its sub folders as well (the folder was deleted or renamed)
+     */
+    void Invalidate(const wxString& folder, bool recursive = false);
+};
+
+#endif // SFTPLISTINGCACHE_H
@@ -0,0 +1,133 @@
+#include "SFTPPrefetchThread.h"
+#include "cl_exception.h"
+#include "file_logger.h"
+
+// For how long (seconds) a remote call of the thread waits for the server
+#define PREFETCH_TIMEOUT 5
+
+std::vector<SFTPPrefetchThread*> SFTPPrefetchThread::ms_retired;
+
+SFTPPrefetchThread::SFTPPrefetchThread(const SSHAccountInfo& account, SFTPListingCache::Ptr_t cache)
+    : m_account(account)
+    , m_cache(cache)
+{
+    m_goingDown.store(false);
+    m_done.store(false);
+    m_generation.store(0);
+    m_thread = new std::thread(
+        [](SFTPPrefetchThread* prefetcher) {
+            while(true) {
+                Request request;
+                if(prefetcher->m_requests.Receive(request) != wxMSGQUEUE_NO_ERROR || request.shutdown) { break; }
+                prefetcher->ProcessRequest(request);
+            }
+            prefetcher->m_sftp.reset(NULL);
+            clDEBUG() << "SFTP prefetch thread: going down" << clEndl;
+            prefetcher->m_done.store(true);
+        },
+        this);
+}
+
+SFTPPrefetchThread::~SFTPPrefetchThread()
+{
+    Stop();
+    m_thread->join();
+    wxDELETE(m_thread);
+}
+
+void SFTPPrefetchThread::Stop()
+{
+    if(m_goingDown.exchange(true)) { return; }
+    // Abort the current request and wake the thread
+    Request request;
+    request.shutdown = true;
+    m_requests.Post(request);
+}
+
+void SFTPPrefetchThread::Retire(SFTPPrefetchThread* prefetcher)
+{
+    // Delete the prefetchers whose thread already exited, this does not wait
+    std::vector<SFTPPrefetchThread*>::iterator iter = ms_retired.begin();
+    while(iter != ms_retired.end()) {
+        if((*iter)->m_done.load()) {
+            delete(*iter);
+            iter = ms_retired.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+
+    if(!prefetcher) { return; }
+    prefetcher->Stop();
+    ms_retired.push_back(prefetcher);
+}
+
+void SFTPPrefetchThread::ReleaseRetired()
+{
+    for(size_t i = 0; i < ms_retired.size(); ++i) {
+        delete ms_retired[i];
+    }
+    ms_retired.clear();
+}
+
+void SFTPPrefetchThread::Prefetch(const wxArrayString& folders)
+{
+    if(folders.IsEmpty()) { return; }
+    Request request;
+    request.folders = folders;
+    request.generation = ++m_generation;
+    m_requests.Post(request);
+}
+
+bool SFTPPrefetchThread::DoConnect()
+{
+    if(m_sftp && m_sftp->IsConnected()) { return true; }
+    // Don't retry: the UI session reports the connection errors
+    if(m_connectFailed) { return false; }
+
+    try {
+        clSSH::Ptr_t ssh(
+            new clSSH(m_account.GetHost(), m_account.GetUsername(), m_account.GetPassword(), m_account.GetPort()));
+        ssh->Connect();
+        // Keep the remote calls short, the thread is joined when the session is closed
+        ssh->SetTimeout(PREFETCH_TIMEOUT);
+        // The UI session already had the user accept the server
+        wxString message;
+        if(!ssh->AuthenticateServer(message)) { ssh->AcceptServerAuthentication(); }
+        ssh->Login();
+        m_sftp.reset(new clSFTP(ssh));
+        m_sftp->SetAccount(m_account.GetAccountName());
+        m_sftp->Initialize();
+
+    } catch(clException& e) {
+        clDEBUG() << "SFTP prefetch thread: could not connect to" << m_account.GetAccountName() << "." << e.What()
+                  << clEndl;
+        m_sftp.reset(NULL);
+        m_connectFailed = true;
+    }
+    return m_sftp.get() != NULL;
+}
+
+void SFTPPrefetchThread::ProcessRequest(const Request& request)
+{
+    for(size_t i = 0; i < request.folders.size(); ++i) {
+        // Stop as soon as a newer request is posted
+        if(m_goingDown.load() || request.generation != m_generation.load()) { return; }
+
+        const wxString& folder = request.folders.Item(i);
+        bool fresh = false;
+        if(m_cache->Find(folder, fresh) && fresh) { continue; }
+        if(!DoConnect()) { return; }
+
+        try {
+            size_t stamp = m_cache->GetStamp();
+            SFTPAttribute::List_t attributes =
+                m_sftp->List(folder, clSFTP::SFTP_BROWSE_FILES | clSFTP::SFTP_BROWSE_FOLDERS);
+            m_cache->Store(folder, SFTPListingCache::MakeListing(attributes), stamp);
+
+        } catch(clException& e) {
+            // e.g. permission denied, the UI reports it if the user expands the folder
+            clDEBUG1() << "SFTP prefetch thread: failed to list" << folder << "." << e.What() << clEndl;
+        }
+    }
+}
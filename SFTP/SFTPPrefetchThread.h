@@ -0,0 +1,70 @@
+#ifndef SFTPPREFETCHTHREAD_H
+#define SFTPPREFETCHTHREAD_H
+
+#include "SFTPListingCache.h"
+#include "cl_sftp.h"
+#include "ssh_account_info.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <wx/arrstr.h>
+#include <wx/msgqueue.h>
+
+/**
+ * @class SFTPPrefetchThread
+ * @brief list remote folders in the background and store the result in a SFTPListingCache.
+ *
+ * The thread uses its own SFTP session, so the UI session is never blocked by a prefetch.
+ * When a folder is expanded, the tree view asks for its sub folders: expanding one of them is then served from
+ * the cache. A new request replaces the folders of the previous one that were not listed yet.
+ * The remote calls of the thread time out after a few seconds, so deleting the object (which joins the thread)
+ * never waits longer than that. To avoid waiting on the UI thread at all, Retire() the object instead: it is
+ * deleted once its thread exits, or by ReleaseRetired() when the plugin is unloaded
+ */
+class SFTPPrefetchThread
+{
+    struct Request {
+        wxArrayString folders;
+        size_t generation = 0;
+        bool shutdown = false;
+    };
+
+    SSHAccountInfo m_account;
+    SFTPListingCache::Ptr_t m_cache;
+    std::thread* m_thread = nullptr;
+    std::atomic_bool m_goingDown;
+    std::atomic_bool m_done;
+    std::atomic<size_t> m_generation;
+    wxMessageQueue<Request> m_requests;
+    // Accessed by the worker thread only
+    clSFTP::Ptr_t m_sftp;
+    bool m_connectFailed = false;
+
+    static std::vector<SFTPPrefetchThread*> ms_retired;
+
+protected:
+    void ProcessRequest(const Request& request);
+    bool DoConnect();
+    void Stop();
+
+public:
+    SFTPPrefetchThread(const SSHAccountInfo& account, SFTPListingCache::Ptr_t cache);
+    virtual ~SFTPPrefetchThread();
+
+    /**
+     * @brief list "folders" in the background
+     */
+    void Prefetch(const wxArrayString& folders);
+
+    /**
+     * @brief stop "prefetcher" without waiting for its thread, and take ownership of it
+     */
+    static void Retire(SFTPPrefetchThread* prefetcher);
+
+    /**
+     * @brief wait for the threads of the retired prefetchers and delete them. Call this before the plugin is unloaded
+     */
+    static void ReleaseRetired();
+};
+
+#endif // SFTPPREFETCHTHREAD_H
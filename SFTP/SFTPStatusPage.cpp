@@ -44,6 +44,7 @@ SFTPStatusPage::SFTPStatusPage(wxWindow* parent, SFTP* plugin)
     m_stcOutput->Bind(wxEVT_MENU, &SFTPStatusPage::OnClearLog, this, wxID_CLEAR);
     m_stcOutput->Bind(wxEVT_MENU, &SFTPStatusPage::OnCopy, this, wxID_COPY);
     m_stcOutput->Bind(wxEVT_MENU, &SFTPStatusPage::OnSelectAll, this, wxID_SELECTALL);
+    m_stcOutput->Bind(wxEVT_MENU, &SFTPStatusPage::OnCancelTransfers, this, XRCID("sftp_cancel_transfers"));
     EventNotifier::Get()->Bind(wxEVT_CL_THEME_CHANGED, &SFTPStatusPage::OnThemeChanged, this);
     m_stcOutput->SetReadOnly(true);
     m_stcSearch->SetReadOnly(true);
@@ -67,6 +68,7 @@ SFTPStatusPage::~SFTPStatusPage()
     m_stcOutput->Unbind(wxEVT_MENU, &SFTPStatusPage::OnClearLog, this, wxID_CLEAR);
     m_stcOutput->Unbind(wxEVT_MENU, &SFTPStatusPage::OnCopy, this, wxID_COPY);
     m_stcOutput->Unbind(wxEVT_MENU, &SFTPStatusPage::OnSelectAll, this, wxID_SELECTALL);
+    m_stcOutput->Unbind(wxEVT_MENU, &SFTPStatusPage::OnCancelTransfers, this, XRCID("sftp_cancel_transfers"));
     EventNotifier::Get()->Unbind(wxEVT_CL_THEME_CHANGED, &SFTPStatusPage::OnThemeChanged, this);
 }
 
@@ -109,9 +111,17 @@ void SFTPStatusPage::ShowContextMenu()
     menu.AppendSeparator();
     menu.Append(wxID_CLEAR);
     menu.Enable(wxID_CLEAR, !m_stcOutput->IsEmpty());
+    menu.AppendSeparator();
+    menu.Append(XRCID("sftp_cancel_transfers"), _("Cancel Transfers"));
     m_stcOutput->PopupMenu(&menu);
 }
 
+void SFTPStatusPage::OnCancelTransfers(wxCommandEvent& event)
+{
+    wxUnusedVar(event);
+    SFTPWorkerThread::Instance()->CancelAll();
+}
+
 void SFTPStatusPage::OnClearLog(wxCommandEvent& event)
 {
     wxUnusedVar(event);
@@ -58,6 +58,7 @@ protected:
     virtual void OnClearLog(wxCommandEvent& event);
     virtual void OnCopy(wxCommandEvent& event);
     virtual void OnSelectAll(wxCommandEvent& event);
+    void OnCancelTransfers(wxCommandEvent& event);
     void OnThemeChanged(wxCommandEvent& event);
 
     void OnFindOutput(clCommandEvent& event);
@@ -25,6 +25,7 @@
 
 #include "SFTPBookmark.h"
 #include "SFTPManageBookmarkDlg.h"
+#include "SFTPPrefetchThread.h"
 #include "SFTPQuickConnectDlg.h"
 #include "SFTPSettingsDialog.h"
 #include "SFTPTreeView.h"
@@ -70,9 +71,13 @@ static const int ID_SHOW_TYPE_COL = ::wxNewId();
 static const int ID_OPEN_WITH_DEFAULT_APP = ::wxNewId();
 static const int ID_OPEN_CONTAINING_FOLDER = ::wxNewId();
 
+// The number of sub folders listed in the background when a folder is expanded
+#define MAX_PREFETCH_FOLDERS 50
+
 SFTPTreeView::SFTPTreeView(wxWindow* parent, SFTP* plugin)
     : SFTPTreeViewBase(parent)
     , m_plugin(plugin)
+    , m_listingCache(new SFTPListingCache())
 {
     m_bmpLoader = clGetManager()->GetStdIcons();
     m_treeCtrl->SetBitmaps(m_bmpLoader->GetStandardMimeBitmapListPtr());
@@ -137,6 +142,8 @@ SFTPTreeView::SFTPTreeView(wxWindow* parent, SFTP* plugin)
 
 SFTPTreeView::~SFTPTreeView()
 {
+    SFTPPrefetchThread::Retire(m_prefetcher);
+    m_prefetcher = nullptr;
     if(m_channel && m_channel->IsOpen()) { m_channel->Close(); }
     m_channel.reset(NULL);
 
@@ -245,10 +252,46 @@ void SFTPTreeView::DoCloseSession()
         m_sessions.Load().SetSession(sess).Save();
     }
 
+    SFTPPrefetchThread::Retire(m_prefetcher);
+    m_prefetcher = nullptr;
+    m_listingCache.reset(new SFTPListingCache());
     m_sftp.reset(NULL);
     m_treeCtrl->DeleteAllItems();
 }
 
+SFTPListingCache::Listing::Ptr_t SFTPTreeView::DoListFolder(const wxString& folder)
+{
+    bool fresh = false;
+    SFTPListingCache::Listing::Ptr_t listing = m_listingCache->Find(folder, fresh);
+    if(listing && fresh) { return listing; }
+
+    if(listing) {
+        // A single round trip tells whether the folder was modified since it was listed
+        try {
+            SFTPAttribute::Ptr_t attr = m_sftp->Stat(folder);
+            if(m_listingCache->IsValid(folder, listing, attr->GetModificationTime())) {
+                m_listingCache->Touch(folder);
+                return listing;
+            }
+        } catch(clException& e) {
+            // List() below reports the error
+        }
+    }
+
+    size_t stamp = m_listingCache->GetStamp();
+    listing = SFTPListingCache::MakeListing(
+        m_sftp->List(folder, clSFTP::SFTP_BROWSE_FILES | clSFTP::SFTP_BROWSE_FOLDERS));
+    m_listingCache->Store(folder, listing, stamp);
+    return listing;
+}
+
+void SFTPTreeView::DoInvalidateParentFolder(const wxString& path)
+{
+    wxString folder = SFTPListingCache::MakeKey(path).BeforeLast('/');
+    if(folder.IsEmpty()) { folder = "/"; }
+    m_listingCache->Invalidate(folder);
+}
+
 bool SFTPTreeView::DoExpandItem(const wxTreeItemId& item)
 {
     wxBusyCursor bc;
@@ -259,10 +302,9 @@ bool SFTPTreeView::DoExpandItem(const wxTreeItemId& item)
     if(cd->IsInitialized()) { return true; }
 
     // get list of files and populate the tree
-    SFTPAttribute::List_t attributes;
+    SFTPListingCache::Listing::Ptr_t listing;
     try {
-        attributes = m_sftp->List(cd->IsSymlink() ? cd->GetSymlinkTarget() : cd->GetFullPath(),
-                                  clSFTP::SFTP_BROWSE_FILES | clSFTP::SFTP_BROWSE_FOLDERS);
+        listing = DoListFolder(cd->IsSymlink() ? cd->GetSymlinkTarget() : cd->GetFullPath());
 
     } catch(clException& e) {
         ::wxMessageBox(e.What(), "SFTP", wxOK | wxICON_ERROR | wxCENTER, EventNotifier::Get()->TopFrame());
@@ -276,25 +318,24 @@ bool SFTPTreeView::DoExpandItem(const wxTreeItemId& item)
     cd->SetInitialized(true);
 
     int nNumOfRealChildren = 0;
+    wxArrayString prefetchFolders;
 
-    SFTPAttribute::List_t::iterator iter = attributes.begin();
-    for(; iter != attributes.end(); ++iter) {
-        SFTPAttribute::Ptr_t attr = (*iter);
-        if(attr->GetName() == "." || attr->GetName() == "..") continue;
+    for(size_t i = 0; i < listing->entries.size(); ++i) {
+        const SFTPListingCache::Entry& entry = listing->entries[i];
 
         ++nNumOfRealChildren;
         // determine the icon index
         int imgIdx = wxNOT_FOUND;
         int expandImgIDx = wxNOT_FOUND;
-        if(attr->IsFolder()) {
+        if(entry.IsFolder()) {
             imgIdx = m_bmpLoader->GetMimeImageId(FileExtManager::TypeFolder);
             expandImgIDx = m_bmpLoader->GetMimeImageId(FileExtManager::TypeFolderExpanded);
-        } else if(attr->IsFile()) {
-            imgIdx = m_bmpLoader->GetMimeImageId(attr->GetName());
+        } else if(entry.IsFile()) {
+            imgIdx = m_bmpLoader->GetMimeImageId(entry.name);
         }
 
-        if(attr->IsSymlink()) {
-            if(attr->IsFile()) {
+        if(entry.IsSymlink()) {
+            if(entry.IsFile()) {
                 imgIdx = m_bmpLoader->GetMimeImageId(FileExtManager::TypeFileSymlink);
 
             } else {
@@ -306,26 +347,33 @@ bool SFTPTreeView::DoExpandItem(const wxTreeItemId& item)
         if(imgIdx == wxNOT_FOUND) { imgIdx = m_bmpLoader->GetMimeImageId(FileExtManager::TypeText); }
 
         wxString path;
-        path << cd->GetFullPath() << "/" << attr->GetName();
+        path << cd->GetFullPath() << "/" << entry.name;
         while(path.Replace("//", "/")) {}
 
         MyClientData* childClientData = new MyClientData(path);
-        if(attr->IsFolder()) {
+        if(entry.IsFolder()) {
             childClientData->SetFolder();
-        } else if(attr->IsFile()) {
+        } else if(entry.IsFile()) {
             childClientData->SetFile();
         }
 
-        if(attr->IsSymlink()) {
+        if(entry.IsSymlink()) {
             childClientData->SetSymlink();
-            childClientData->SetSymlinkTarget(attr->GetSymlinkPath());
+            childClientData->SetSymlinkTarget(entry.symlinkPath);
         }
 
-        wxTreeItemId child = m_treeCtrl->AppendItem(item, attr->GetName(), imgIdx, expandImgIDx, childClientData);
+        wxTreeItemId child = m_treeCtrl->AppendItem(item, entry.name, imgIdx, expandImgIDx, childClientData);
         // if its type folder, add a fake child item
-        if(attr->IsFolder()) { m_treeCtrl->AppendItem(child, "<dummy>"); }
+        if(entry.IsFolder()) {
+            m_treeCtrl->AppendItem(child, "<dummy>");
+            // The user is likely to expand one of the sub folders next
+            if(prefetchFolders.size() < MAX_PREFETCH_FOLDERS) {
+                prefetchFolders.Add(entry.IsSymlink() ? entry.symlinkPath : path);
+            }
+        }
     }
 
+    if(m_prefetcher) { m_prefetcher->Prefetch(prefetchFolders); }
     return nNumOfRealChildren > 0;
 }
 
@@ -409,10 +457,12 @@ void SFTPTreeView::OnMenuDelete(wxCommandEvent& event)
             MyClientData* cd = GetItemData(items.Item(i));
             if(cd->IsFolder()) {
                 m_sftp->RemoveDir(cd->GetFullPath());
+                m_listingCache->Invalidate(cd->GetFullPath(), true);
 
             } else {
                 m_sftp->UnlinkFile(cd->GetFullPath());
             }
+            DoInvalidateParentFolder(cd->GetFullPath());
             // Remove the selection
             m_treeCtrl->Delete(items.Item(i));
         }
@@ -482,6 +532,8 @@ void SFTPTreeView::OnMenuRename(wxCommandEvent& event)
                 wxString old_path = cd->GetFullPath();
                 cd->SetFullName(new_name);
                 m_sftp->Rename(old_path, cd->GetFullPath());
+                if(cd->IsFolder()) { m_listingCache->Invalidate(old_path, true); }
+                DoInvalidateParentFolder(old_path);
 
                 // Remove the selection
                 m_treeCtrl->SetItemText(items.Item(i), new_name);
@@ -519,6 +571,7 @@ wxTreeItemId SFTPTreeView::DoAddFile(const wxTreeItemId& parent, const wxString&
     try {
         wxMemoryBuffer memBuffer;
         m_sftp->Write(memBuffer, path);
+        DoInvalidateParentFolder(path);
         SFTPAttribute::Ptr_t attr = m_sftp->Stat(path);
         // Update the UI
         MyClientData* newFile = new MyClientData(path);
@@ -540,6 +593,7 @@ wxTreeItemId SFTPTreeView::DoAddFolder(const wxTreeItemId& parent, const wxStrin
 {
     try {
         m_sftp->CreateDir(path);
+        DoInvalidateParentFolder(path);
         SFTPAttribute::Ptr_t attr = m_sftp->Stat(path);
         // Update the UI
         MyClientData* newCd = new MyClientData(path);
@@ -695,6 +749,10 @@ void SFTPTreeView::DoOpenSession()
         m_sftp.reset(new clSFTP(ssh));
         m_sftp->Initialize();
         m_sftp->SetAccount(m_account.GetAccountName());
+        SFTPPrefetchThread::Retire(m_prefetcher);
+        m_prefetcher = nullptr;
+        m_listingCache.reset(new SFTPListingCache());
+        m_prefetcher = new SFTPPrefetchThread(m_account, m_listingCache);
         m_plugin->GetManager()->SetStatusMessage(wxString() << _("Done!"));
 
         dlg.Update(9, _("Fetching directory list..."));
@@ -737,8 +795,9 @@ void SFTPTreeView::OnMenuRefreshFolder(wxCommandEvent& event)
     MyClientData* cd = GetItemData(item);
     if(!cd || !cd->IsFolder()) { return; }
 
-    // Uninitialize the folder
+    // Uninitialize the folder and list it again on the next expand
     cd->SetInitialized(false);
+    m_listingCache->Invalidate(cd->IsSymlink() ? cd->GetSymlinkTarget() : cd->GetFullPath(), true);
 
     // Delete all the children
     wxTreeItemIdValue cookie;
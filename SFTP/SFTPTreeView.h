@@ -26,6 +26,7 @@
 #ifndef SFTPTREEVIEW_H
 #define SFTPTREEVIEW_H
 
+#include "SFTPListingCache.h"
 #include "SFTPSessionInfo.h"
 #include "UI.h"
 #include "bitmap_loader.h"
@@ -37,6 +38,7 @@
 
 class MyClientData;
 class SFTP;
+class SFTPPrefetchThread;
 
 typedef std::vector<MyClientData*> MyClientDataVect_t;
 
@@ -49,6 +51,8 @@ class SFTPTreeView : public SFTPTreeViewBase
     SFTP* m_plugin;
     wxString m_commandOutput;
     SFTPSessionInfoList m_sessions;
+    SFTPListingCache::Ptr_t m_listingCache;
+    SFTPPrefetchThread* m_prefetcher = nullptr;
 
 public:
     enum {
@@ -109,6 +113,14 @@ protected:
     void DoCloseSession();
     void DoOpenSession();
     bool DoExpandItem(const wxTreeItemId& item);
+    /**
+     * @brief return the content of a remote folder, from the cache when it is still valid
+     */
+    SFTPListingCache::Listing::Ptr_t DoListFolder(const wxString& folder);
+    /**
+     * @brief forget the cached content of the folder containing "path"
+     */
+    void DoInvalidateParentFolder(const wxString& path);
     void DoBuildTree(const wxString& initialFolder);
     void ManageBookmarks();
     /**
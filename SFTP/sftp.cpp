@@ -24,6 +24,7 @@
 //////////////////////////////////////////////////////////////////////////////
 
 #include "SFTPBrowserDlg.h"
+#include "SFTPPrefetchThread.h"
 #include "SFTPSettingsDialog.h"
 #include "SFTPStatusPage.h"
 #include "SFTPTreeView.h"
@@ -217,6 +218,8 @@ void SFTP::UnPlug()
     }
     m_treeView->Destroy();
 
+    // Don't leave a prefetch thread running once the plugin is unloaded
+    SFTPPrefetchThread::ReleaseRetired();
     SFTPWorkerThread::Release();
     wxTheApp->Disconnect(wxEVT_SFTP_OPEN_SSH_ACCOUNT_MANAGER, wxEVT_MENU, wxCommandEventHandler(SFTP::OnAccountManager),
                          NULL, this);
@@ -27,18 +27,55 @@
 #include "cl_ssh.h"
 #include "sftp.h"
 #include "sftp_worker_thread.h"
+#include <algorithm>
+#include <chrono>
+#include <iterator>
 #include <libssh/sftp.h>
 #include <wx/ffile.h>
 
+// Number of sessions (connections) opened per account
+#define SFTP_SESSIONS_PER_ACCOUNT 3
+
+// A session idle for that long (seconds) is closed
+#define SFTP_SESSION_IDLE_TIMEOUT 60
+
+// Min delay between two progress updates of a transfer, in milliseconds
+#define SFTP_PROGRESS_INTERVAL_MS 500
+
 SFTPWorkerThread* SFTPWorkerThread::ms_instance = 0;
 
 SFTPWorkerThread::SFTPWorkerThread()
-    : m_sftp(NULL)
+    : m_notifiedWindow(NULL)
     , m_plugin(NULL)
 {
+    m_generation.store(0);
 }
 
-SFTPWorkerThread::~SFTPWorkerThread() {}
+SFTPWorkerThread::~SFTPWorkerThread()
+{
+    std::vector<SFTPSessionThread*> sessions;
+    {
+        // Collect the sessions and drop the waiting requests, so the sessions won't start or retire any
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_shuttingDown = true;
+        std::unordered_map<wxString, Account>::iterator iter = m_accounts.begin();
+        for(; iter != m_accounts.end(); ++iter) {
+            std::copy_if(iter->second.sessions.begin(), iter->second.sessions.end(), std::back_inserter(sessions),
+                         [&](SFTPSessionThread* session) { return session != NULL; });
+            std::for_each(iter->second.waiting.begin(), iter->second.waiting.end(),
+                          [&](SFTPThreadRequet* req) { delete req; });
+            iter->second.waiting.clear();
+        }
+        sessions.insert(sessions.end(), m_retired.begin(), m_retired.end());
+        m_retired.clear();
+    }
+
+    std::for_each(sessions.begin(), sessions.end(), [&](SFTPSessionThread* session) {
+        session->Stop();
+        delete session;
+    });
+    m_accounts.clear();
+}
 
 SFTPWorkerThread* SFTPWorkerThread::Instance()
 {
@@ -48,30 +85,156 @@ SFTPWorkerThread* SFTPWorkerThread::Instance()
 
 void SFTPWorkerThread::Release()
 {
-    if(ms_instance) {
-        ms_instance->Stop();
-        delete ms_instance;
-    }
+    if(ms_instance) { delete ms_instance; }
     ms_instance = 0;
 }
 
-void SFTPWorkerThread::ProcessRequest(ThreadRequest* request)
+bool SFTPWorkerThread::IsBarrier(const SFTPThreadRequet* req)
 {
-    SFTPThreadRequet* req = dynamic_cast<SFTPThreadRequet*>(request);
-    // Check if we need to open an ssh connection
-    wxString currentAccout = m_sftp ? m_sftp->GetAccount() : "";
-    wxString requestAccount = req->GetAccount().GetAccountName();
+    return req->GetAction() == eSFTPActions::kRename || req->GetAction() == eSFTPActions::kDelete;
+}
 
-    if(currentAccout.IsEmpty() || currentAccout != requestAccount) {
-        m_sftp.reset(NULL);
-        DoConnect(req);
+void SFTPWorkerThread::Add(SFTPThreadRequet* req)
+{
+    req->SetGeneration(m_generation.load());
+
+    std::vector<SFTPSessionThread*> retired;
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        retired.swap(m_retired);
+
+        Account& account = m_accounts[req->GetAccount().GetAccountName()];
+        if(!account.waiting.empty() || account.barrierRunning || (IsBarrier(req) && account.running)) {
+            account.waiting.push_back(req);
+        } else {
+            DoDispatch(account, req);
+        }
+    }
+
+    // The threads of the retired sessions already exited
+    std::for_each(retired.begin(), retired.end(), [&](SFTPSessionThread* session) {
+        session->Stop();
+        delete session;
+    });
+}
+
+void SFTPWorkerThread::DoDispatch(Account& account, SFTPThreadRequet* req)
+{
+    if(account.sessions.empty()) { account.sessions.resize(SFTP_SESSIONS_PER_ACCOUNT, NULL); }
+
+    // The transfers of a remote file always go to the same session so they are executed in order
+    size_t index = IsBarrier(req) ? 0 : std::hash<wxString>()(req->GetRemoteFile()) % account.sessions.size();
+    SFTPSessionThread*& session = account.sessions[index];
+    if(!session) {
+        session = new SFTPSessionThread(this, req->GetAccount().GetAccountName());
+        session->SetNotifyWindow(m_notifiedWindow);
+        session->Start();
     }
+    ++account.running;
+    ++session->m_pending;
+    if(IsBarrier(req)) { account.barrierRunning = true; }
+    session->Add(req);
+}
+
+void SFTPWorkerThread::RequestDone(SFTPSessionThread* session, bool barrier)
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    Account& account = m_accounts[session->m_accountName];
+    --session->m_pending;
+    --account.running;
+    if(barrier) { account.barrierRunning = false; }
+
+    // Release the requests that were waiting: up to the next rename or delete, which itself waits for the
+    // running requests to complete
+    while(!account.waiting.empty() && !account.barrierRunning) {
+        SFTPThreadRequet* req = account.waiting.front();
+        if(IsBarrier(req) && account.running) { break; }
+        account.waiting.pop_front();
+        DoDispatch(account, req);
+    }
+}
+
+bool SFTPWorkerThread::Retire(SFTPSessionThread* session)
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    if(m_shuttingDown || session->m_pending) { return false; }
+
+    Account& account = m_accounts[session->m_accountName];
+    std::replace(account.sessions.begin(), account.sessions.end(), session, (SFTPSessionThread*)NULL);
+    m_retired.push_back(session);
+    return true;
+}
+
+void SFTPWorkerThread::CancelAll()
+{
+    m_generation.fetch_add(1);
+
+    // The waiting requests were not started yet, drop them
+    std::lock_guard<std::mutex> guard(m_lock);
+    std::unordered_map<wxString, Account>::iterator iter = m_accounts.begin();
+    for(; iter != m_accounts.end(); ++iter) {
+        std::for_each(iter->second.waiting.begin(), iter->second.waiting.end(),
+                      [&](SFTPThreadRequet* req) { delete req; });
+        iter->second.waiting.clear();
+    }
+}
+
+void SFTPWorkerThread::SetSftpPlugin(SFTP* sftp) { m_plugin = sftp; }
+
+// -----------------------------------------
+// SFTPSessionThread
+// -----------------------------------------
+
+SFTPSessionThread::SFTPSessionThread(SFTPWorkerThread* pool, const wxString& accountName)
+    : m_pool(pool)
+    , m_sftp(NULL)
+    , m_accountName(accountName)
+{
+}
+
+SFTPSessionThread::~SFTPSessionThread() {}
+
+void* SFTPSessionThread::Entry()
+{
+    std::chrono::steady_clock::time_point lastActive = std::chrono::steady_clock::now();
+    while(!TestDestroy()) {
+        ThreadRequest* request = NULL;
+        if(m_queue.ReceiveTimeout(50, request) == wxMSGQUEUE_NO_ERROR) {
+            ProcessRequest(request);
+            wxDELETE(request);
+            lastActive = std::chrono::steady_clock::now();
+
+        } else if(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - lastActive)
+                          .count() >= SFTP_SESSION_IDLE_TIMEOUT &&
+                  m_pool->Retire(this)) {
+            // Nothing to do for a while: close the connection and exit
+            break;
+        }
+    }
+    m_sftp.reset(NULL);
+    return NULL;
+}
+
+void SFTPSessionThread::ProcessRequest(ThreadRequest* request)
+{
+    SFTPThreadRequet* req = dynamic_cast<SFTPThreadRequet*>(request);
+    bool barrier = SFTPWorkerThread::IsBarrier(req);
+    // A request queued again for a retry is still running
+    if(!DoProcessRequest(req)) { m_pool->RequestDone(this, barrier); }
+}
+
+bool SFTPSessionThread::DoProcessRequest(SFTPThreadRequet* req)
+{
+    if(m_pool->IsCancelled(req)) { return false; }
+
+    // All the requests of this session belong to the same account
+    if(!m_sftp) { DoConnect(req); }
 
     if(req->GetAction() == eSFTPActions::kConnect) {
         // Nothing more to be done here
         // Disconnect
         m_sftp.reset(NULL);
-        return;
+        return false;
     }
 
     wxString msg;
@@ -82,12 +245,13 @@ void SFTPWorkerThread::ProcessRequest(ThreadRequest* request)
             switch(req->GetAction()) {
             case eSFTPActions::kConnect:
                 // We don't really need this case. Just make the compiler silence
-                return;
+                return false;
             case eSFTPActions::kUpload: {
-                DoReportStatusBarMessage(wxString() << _("Uploading file: ") << req->GetRemoteFile());
+                DoSetProgressMessage(req, wxString() << _("Uploading file: ") << req->GetRemoteFile());
                 SFTPAttribute::Ptr_t attr(new SFTPAttribute(NULL));
                 attr->SetPermissions(req->GetPermissions());
                 m_sftp->CreateRemoteFile(req->GetRemoteFile(), wxFileName(req->GetLocalFile()), attr);
+                m_sftp->SetProgressCallback(clSFTP::ProgressCallback_t());
                 msg << "Successfully uploaded file: " << req->GetLocalFile() << " -> " << req->GetRemoteFile();
                 DoReportMessage(accountName, msg, SFTPThreadMessage::STATUS_OK);
                 DoReportStatusBarMessage("");
@@ -96,9 +260,10 @@ void SFTPWorkerThread::ProcessRequest(ThreadRequest* request)
             case eSFTPActions::kDownload:
             case eSFTPActions::kDownloadAndOpenContainingFolder:
             case eSFTPActions::kDownloadAndOpenWithDefaultApp: {
-                DoReportStatusBarMessage(wxString() << _("Downloading file: ") << req->GetRemoteFile());
+                DoSetProgressMessage(req, wxString() << _("Downloading file: ") << req->GetRemoteFile());
                 wxMemoryBuffer buffer;
                 SFTPAttribute::Ptr_t fileAttr = m_sftp->Read(req->GetRemoteFile(), buffer);
+                m_sftp->SetProgressCallback(clSFTP::ProgressCallback_t());
                 wxFFile fp(req->GetLocalFile(), "w+b");
                 if(fp.IsOpened()) {
                     fp.Write(buffer.GetData(), buffer.GetDataLen());
@@ -110,19 +275,20 @@ void SFTPWorkerThread::ProcessRequest(ThreadRequest* request)
                 DoReportStatusBarMessage("");
 
                 // We should also notify the parent window about download completed
+                SFTP* plugin = m_pool->GetSftpPlugin();
                 if(req->GetAction() == eSFTPActions::kDownload) {
                     SFTPClientData cd;
                     cd.SetLocalPath(req->GetLocalFile());
                     cd.SetRemotePath(req->GetRemoteFile());
                     cd.SetPermissions(fileAttr ? fileAttr->GetPermissions() : 0);
                     cd.SetLineNumber(req->GetLineNumber());
-                    m_plugin->CallAfter(&SFTP::FileDownloadedSuccessfully, cd);
+                    plugin->CallAfter(&SFTP::FileDownloadedSuccessfully, cd);
 
                 } else if(req->GetAction() == eSFTPActions::kDownloadAndOpenContainingFolder) {
-                    m_plugin->CallAfter(&SFTP::OpenContainingFolder, req->GetLocalFile());
+                    plugin->CallAfter(&SFTP::OpenContainingFolder, req->GetLocalFile());
 
                 } else {
-                    m_plugin->CallAfter(&SFTP::OpenWithDefaultApp, req->GetLocalFile());
+                    plugin->CallAfter(&SFTP::OpenWithDefaultApp, req->GetLocalFile());
                 }
                 break;
             }
@@ -150,24 +316,45 @@ void SFTPWorkerThread::ProcessRequest(ThreadRequest* request)
             msg << "SFTP error: " << e.What();
             DoReportMessage(accountName, msg, SFTPThreadMessage::STATUS_ERROR);
             DoReportStatusBarMessage(msg);
+            // The session may still have replies in flight: start over with a new one
             m_sftp.reset(NULL);
 
             // Requeue our request
-            if(req->GetRetryCounter() == 0) {
+            if(req->GetRetryCounter() == 0 && !m_pool->IsCancelled(req)) {
                 msg.Clear();
                 msg << "Retrying to upload file: " << req->GetRemoteFile();
                 DoReportMessage(req->GetAccount().GetAccountName(), msg, SFTPThreadMessage::STATUS_NONE);
 
-                // first time trying this request, requeue it
+                // first time trying this request, requeue it (in this session, to keep the order of the requests)
                 SFTPThreadRequet* retryReq = static_cast<SFTPThreadRequet*>(req->Clone());
                 retryReq->SetRetryCounter(1);
                 Add(retryReq);
+                return true;
             }
         }
     }
+    return false;
 }
 
-void SFTPWorkerThread::DoConnect(SFTPThreadRequet* req)
+void SFTPSessionThread::DoSetProgressMessage(SFTPThreadRequet* req, const wxString& message)
+{
+    DoReportStatusBarMessage(message);
+
+    // Report the progress of the transfer in the status bar, and stop it if the request was cancelled
+    std::chrono::steady_clock::time_point lastReport = std::chrono::steady_clock::now();
+    m_sftp->SetProgressCallback([=](wxInt64 transferred, wxInt64 total) mutable {
+        if(m_pool->IsCancelled(req)) { return false; }
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if(total > 0 && std::chrono::duration_cast<std::chrono::milliseconds>(now - lastReport).count() >=
+                            SFTP_PROGRESS_INTERVAL_MS) {
+            lastReport = now;
+            DoReportStatusBarMessage(wxString() << message << " (" << (int)((transferred * 100) / total) << "%)");
+        }
+        return true;
+    });
+}
+
+void SFTPSessionThread::DoConnect(SFTPThreadRequet* req)
 {
     wxString accountName = req->GetAccount().GetAccountName();
     clSSH::Ptr_t ssh(new clSSH(req->GetAccount().GetHost(), req->GetAccount().GetUsername(),
@@ -198,7 +385,7 @@ void SFTPWorkerThread::DoConnect(SFTPThreadRequet* req)
     }
 }
 
-void SFTPWorkerThread::DoReportMessage(const wxString& account, const wxString& message, int status)
+void SFTPSessionThread::DoReportMessage(const wxString& account, const wxString& message, int status)
 {
     SFTPThreadMessage* pMessage = new SFTPThreadMessage();
     pMessage->SetStatus(status);
@@ -207,9 +394,7 @@ void SFTPWorkerThread::DoReportMessage(const wxString& account, const wxString&
     GetNotifiedWindow()->CallAfter(&SFTPStatusPage::AddLine, pMessage);
 }
 
-void SFTPWorkerThread::SetSftpPlugin(SFTP* sftp) { m_plugin = sftp; }
-
-void SFTPWorkerThread::DoReportStatusBarMessage(const wxString& message)
+void SFTPSessionThread::DoReportStatusBarMessage(const wxString& message)
 {
     GetNotifiedWindow()->CallAfter(&SFTPStatusPage::SetStatusBarMessage, message);
 }
@@ -273,6 +458,9 @@ SFTPThreadRequet& SFTPThreadRequet::operator=(const SFTPThreadRequet& other)
     m_uploadSuccess = other.m_uploadSuccess;
     m_action = other.m_action;
     m_permissions = other.m_permissions;
+    m_newRemoteFile = other.m_newRemoteFile;
+    m_lineNumber = other.m_lineNumber;
+    m_generation = other.m_generation;
     return *this;
 }
 
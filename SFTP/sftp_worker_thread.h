@@ -30,8 +30,15 @@
 #include "remote_file_info.h"
 #include "ssh_account_info.h"
 #include "worker_thread.h" // Base class: WorkerThread
+#include "wxStringHash.h"
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 class SFTP;
+class SFTPWorkerThread;
 
 enum class eSFTPActions {
     kUpload,
@@ -54,6 +61,7 @@ class SFTPThreadRequet : public ThreadRequest
     size_t m_permissions = 0;
     wxString m_newRemoteFile;
     int m_lineNumber = wxNOT_FOUND;
+    size_t m_generation = 0;
 
 public:
     SFTPThreadRequet(const SSHAccountInfo& accountInfo, const wxString& remoteFile, const wxString& localFile,
@@ -85,6 +93,8 @@ public:
     const wxString& GetNewRemoteFile() const { return m_newRemoteFile; }
     void SetLineNumber(int lineNumber) { this->m_lineNumber = lineNumber; }
     int GetLineNumber() const { return m_lineNumber; }
+    void SetGeneration(size_t generation) { this->m_generation = generation; }
+    size_t GetGeneration() const { return m_generation; }
 };
 
 class SFTPThreadMessage
@@ -113,10 +123,61 @@ public:
     int GetStatus() const { return m_status; }
 };
 
-class SFTPWorkerThread : public WorkerThread
+/**
+ * @class SFTPSessionThread
+ * @brief a connection to an account with its own thread and queue of requests
+ */
+class SFTPSessionThread : public WorkerThread
 {
-    static SFTPWorkerThread* ms_instance;
+    friend class SFTPWorkerThread;
+    SFTPWorkerThread* m_pool;
     clSFTP::Ptr_t m_sftp;
+    wxString m_accountName;
+    size_t m_pending = 0; // requests added and not completed yet, guarded by the pool lock
+
+private:
+    /**
+     * @brief execute a request, return true if it was queued again for a retry
+     */
+    bool DoProcessRequest(SFTPThreadRequet* req);
+    void DoConnect(SFTPThreadRequet* req);
+    void DoReportMessage(const wxString& account, const wxString& message, int status);
+    void DoReportStatusBarMessage(const wxString& message);
+    void DoSetProgressMessage(SFTPThreadRequet* req, const wxString& message);
+
+public:
+    SFTPSessionThread(SFTPWorkerThread* pool, const wxString& accountName);
+    virtual ~SFTPSessionThread();
+    virtual void* Entry();
+    virtual void ProcessRequest(ThreadRequest* request);
+};
+
+/**
+ * @class SFTPWorkerThread
+ * @brief execute the SFTP requests in the background.
+ *
+ * Each account gets a pool of sessions (connections), each served by its own thread, so a large transfer does not
+ * hold the other requests of the account. The uploads and downloads of a given remote file are always executed by
+ * the same session, in the order they were added. A rename or a delete changes the remote tree: it waits for all
+ * the requests added before it to complete, and the requests added after it wait for it to complete.
+ * A session that stays idle is closed, its thread exits
+ */
+class SFTPWorkerThread
+{
+    struct Account {
+        std::vector<SFTPSessionThread*> sessions;
+        size_t running = 0;                    // the requests added to the sessions and not completed yet
+        bool barrierRunning = false;           // a rename or a delete is running
+        std::deque<SFTPThreadRequet*> waiting; // the requests waiting for the running ones to complete
+    };
+
+    static SFTPWorkerThread* ms_instance;
+    std::unordered_map<wxString, Account> m_accounts;
+    std::vector<SFTPSessionThread*> m_retired; // idle sessions whose thread exited
+    bool m_shuttingDown = false;
+    std::mutex m_lock;
+    std::atomic<size_t> m_generation; // incremented by CancelAll()
+    wxEvtHandler* m_notifiedWindow;
     SFTP* m_plugin;
 
 public:
@@ -126,13 +187,41 @@ public:
 private:
     SFTPWorkerThread();
     virtual ~SFTPWorkerThread();
-    void DoConnect(SFTPThreadRequet* req);
-    void DoReportMessage(const wxString& account, const wxString& message, int status);
-    void DoReportStatusBarMessage(const wxString& message);
+
+    static bool IsBarrier(const SFTPThreadRequet* req);
+    // Hand a request to one of the account sessions. Called with m_lock held
+    void DoDispatch(Account& account, SFTPThreadRequet* req);
+
+    // Called by the sessions
+    friend class SFTPSessionThread;
+    void RequestDone(SFTPSessionThread* session, bool barrier);
+    bool Retire(SFTPSessionThread* session);
 
 public:
-    virtual void ProcessRequest(ThreadRequest* request);
+    /**
+     * @brief the sessions are started when a request is added to them. Kept for compatibility
+     */
+    void Start() {}
+
+    /**
+     * @brief queue a request, the ownership is passed to the worker
+     */
+    void Add(SFTPThreadRequet* req);
+
+    /**
+     * @brief cancel the transfers in progress and drop all the queued requests
+     */
+    void CancelAll();
+
+    /**
+     * @brief was "req" cancelled by CancelAll()?
+     */
+    bool IsCancelled(const SFTPThreadRequet* req) const { return req->GetGeneration() != m_generation.load(); }
+
+    void SetNotifyWindow(wxEvtHandler* evtHandler) { m_notifiedWindow = evtHandler; }
+    wxEvtHandler* GetNotifiedWindow() { return m_notifiedWindow; }
     void SetSftpPlugin(SFTP* sftp);
+    SFTP* GetSftpPlugin() { return m_plugin; }
 };
 
 #endif // SFTPWRITERTHREAD_H